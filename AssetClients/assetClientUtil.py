@@ -5,8 +5,12 @@ import hashlib
 import binascii
 import requests
 import datetime
+import msgpack
+import json
 from urllib.parse import urlunparse, urlencode, quote
 
+MSGPACK_CONTENT_TYPE = 'application/msgpack'
+
 #
 # Simple Logging Helper
 #
@@ -30,7 +34,7 @@ def create_hmac_signature(secret_key, token, token_timestamp_str):
 #
 # Creates the final request URL and calls the endpoint.
 #
-def call_endpoint(switch_ip, headers, operation, queryStr, max_retries=15, retry_interval=5, verb='GET'):
+def call_endpoint(switch_ip, headers, operation, queryStr, max_retries=15, retry_interval=5, verb='GET', accept=None):
     netloc = switch_ip
     logIfTurnedOn("[Call Endpoint] Netloc: {}".format(netloc))
     logIfTurnedOn("[Call Endpoint] Operation: {}".format(operation))
@@ -38,9 +42,15 @@ def call_endpoint(switch_ip, headers, operation, queryStr, max_retries=15, retry
     path = '/{}?{}'.format(operation, queryStr)
     finalUrl = urlunparse(('http', netloc, path, '', '', ''))
 
+    # The assets answer with compact JSON by default, accept allows asking for pretty JSON or MessagePack.
+    if accept is not None:
+        headers = dict(headers)
+        headers['Accept'] = accept
+
     # Retry since the sensor sometimes disconnects from the WiFi due to signal strength issues.
     for retry in range(max_retries):
         try:
+            start_time = time.monotonic()
             if verb == 'GET':
                 response = requests.get(finalUrl, headers=headers)
             elif verb == 'POST':
@@ -49,6 +59,10 @@ def call_endpoint(switch_ip, headers, operation, queryStr, max_retries=15, retry
                 response = requests.put(finalUrl, headers=headers)
             elif verb == 'DELETE':
                 response = requests.delete(finalUrl, headers=headers)
+            elapsed_ms = (time.monotonic() - start_time) * 1000
+            # The assets report their own per-stage breakdown (auth, storage, rf, ...) in the Server-Timing header.
+            logIfTurnedOn("[Call Endpoint] {} {} returned {} in {:.1f} ms, Server-Timing: {}".format(
+                verb, operation, response.status_code, elapsed_ms, response.headers.get('Server-Timing', 'n/a')))
             return response
         except requests.exceptions.RequestException as e:
             logIfTurnedOn(f"Request failed: {e}")
@@ -61,6 +75,14 @@ def call_endpoint(switch_ip, headers, operation, queryStr, max_retries=15, retry
 
     return response
 
+#
+# Decodes a response body based on its content type, either MessagePack or JSON.
+#
+def decode_response_body(response):
+    if response.headers.get('Content-Type', '').startswith(MSGPACK_CONTENT_TYPE):
+        return msgpack.unpackb(response.content, raw=False)
+    return json.loads(response.text)
+
 #
 # Calls the endpoint for getting metadata from the switch.
 #
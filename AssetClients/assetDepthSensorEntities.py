@@ -75,7 +75,10 @@ class DepthSensorMeasurementCollection:
     
     @classmethod
     def from_json(cls, json_str):
-        json_dict = json.loads(json_str)
+        return cls.from_dict(json.loads(json_str))
+
+    @classmethod
+    def from_dict(cls, json_dict):
         measurements = [DepthSensorMeasurement(**measurement) for measurement in json_dict['measurements']]
         return cls(
             measurements
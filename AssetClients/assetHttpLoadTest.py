@@ -0,0 +1,164 @@
+import sys
+import time
+import socket
+import secrets
+import argparse
+
+import assetClientUtil as mszutl
+
+#
+# Load test for the web API of the assets. Sends the same request repeatedly, either on a new
+# connection per request, on one kept-alive connection or pipelined on one connection, and
+# reports the requests per second and latencies of each mode.
+#
+MODES = ['close', 'keepalive', 'pipelined']
+TOKEN_REFRESH_SECONDS = 30
+
+class HttpLoadClient:
+    def __init__(self, asset_ip, port, secret_key, timeout):
+        self.address = (asset_ip, port)
+        self.secret_key = secret_key
+        self.timeout = timeout
+        self.sock = None
+        self.buffer = b''
+        self.authorization = None
+        self.authorization_time = 0
+
+    def get_authorization(self):
+        if self.authorization is None or time.monotonic() - self.authorization_time > TOKEN_REFRESH_SECONDS:
+            token_data = secrets.token_hex(32)
+            token_timestamp_str = str(int(time.time()))
+            signature, _ = mszutl.create_hmac_signature(self.secret_key, token_data, token_timestamp_str)
+            self.authorization = token_timestamp_str + "|" + token_data + "|" + signature
+            self.authorization_time = time.monotonic()
+        return self.authorization
+
+    def build_request(self, path, keep_alive):
+        return ("GET {} HTTP/1.1\r\nHost: {}\r\nAuthorization: {}\r\nConnection: {}\r\n\r\n".format(
+            path, self.address[0], self.get_authorization(), 'keep-alive' if keep_alive else 'close')).encode()
+
+    def connect(self):
+        self.close()
+        self.sock = socket.create_connection(self.address, timeout=self.timeout)
+        self.sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        self.buffer = b''
+
+    def close(self):
+        if self.sock is not None:
+            self.sock.close()
+            self.sock = None
+
+    def read_until(self, marker):
+        while marker not in self.buffer:
+            data = self.sock.recv(4096)
+            if not data:
+                raise ConnectionError("connection closed by the asset")
+            self.buffer += data
+        index = self.buffer.index(marker) + len(marker)
+        result, self.buffer = self.buffer[:index], self.buffer[index:]
+        return result
+
+    def read_exactly(self, length):
+        while len(self.buffer) < length:
+            data = self.sock.recv(4096)
+            if not data:
+                raise ConnectionError("connection closed by the asset")
+            self.buffer += data
+        result, self.buffer = self.buffer[:length], self.buffer[length:]
+        return result
+
+    # Reads one response and returns its status code and whether the asset keeps the connection open.
+    def read_response(self):
+        head = self.read_until(b'\r\n\r\n').decode('latin-1').split('\r\n')
+        status = int(head[0].split(' ')[1])
+        headers = {}
+        for line in head[1:]:
+            name, _, value = line.partition(':')
+            headers[name.strip().lower()] = value.strip()
+        if 'content-length' in headers:
+            self.read_exactly(int(headers['content-length']))
+        elif headers.get('transfer-encoding', '').lower() == 'chunked':
+            while True:
+                size = int(self.read_until(b'\r\n').strip(), 16)
+                self.read_exactly(size + 2)
+                if size == 0:
+                    break
+        return status, headers.get('connection', '').lower() != 'close'
+
+def run_mode(client, mode, path, count, depth):
+    latencies = []
+    failures = 0
+    started = time.perf_counter()
+    try:
+        if mode == 'close':
+            for _ in range(count):
+                request_start = time.perf_counter()
+                client.connect()
+                client.sock.sendall(client.build_request(path, False))
+                status, _ = client.read_response()
+                client.close()
+                latencies.append((time.perf_counter() - request_start) * 1000)
+                failures += 0 if status == 200 else 1
+        else:
+            client.connect()
+            sent = 0
+            while sent < count:
+                batch = min(depth if mode == 'pipelined' else 1, count - sent)
+                request_start = time.perf_counter()
+                client.sock.sendall(b''.join(client.build_request(path, True) for _ in range(batch)))
+                for _ in range(batch):
+                    status, open_ = client.read_response()
+                    latencies.append((time.perf_counter() - request_start) * 1000)
+                    failures += 0 if status == 200 else 1
+                    if not open_:
+                        client.connect()
+                sent += batch
+            client.close()
+    except (OSError, ConnectionError) as e:
+        print("{}: aborted after {} requests: {}".format(mode, len(latencies), e))
+        client.close()
+        failures += count - len(latencies)
+
+    duration = time.perf_counter() - started
+    rate = len(latencies) / duration if duration > 0 else 0
+    print("{:>10}: {} requests, {} failed, {:.1f} req/s".format(mode, count, failures, rate), end='')
+    if latencies:
+        latencies.sort()
+        p50 = latencies[len(latencies) // 2]
+        p99 = latencies[min(len(latencies) - 1, int(len(latencies) * 0.99))]
+        print(", latency ms p50 {:.1f}, p99 {:.1f}".format(p50, p99))
+    else:
+        print()
+    return rate, failures
+
+#
+# Main program execution
+#
+
+def main():
+    parser = argparse.ArgumentParser(description='Compare the request rate of an asset with and without HTTP keep-alive.')
+    parser.add_argument('--secret', required=False, default='', help='secret for operations')
+    parser.add_argument('--ip', required=True, help='ip address of the asset to work with')
+    parser.add_argument('--port', required=False, type=int, default=80)
+    parser.add_argument('--path', required=False, default='/info', help='GET endpoint to call')
+    parser.add_argument('--count', required=False, type=int, default=100, help='requests per mode')
+    parser.add_argument('--depth', required=False, type=int, default=4, help='requests in flight when pipelining')
+    parser.add_argument('--timeout', required=False, type=float, default=5.0)
+    parser.add_argument('--modes', required=False, nargs='+', choices=MODES, default=MODES)
+    args = parser.parse_args()
+
+    client = HttpLoadClient(args.ip, args.port, args.secret, args.timeout)
+    results = {}
+    for mode in args.modes:
+        results[mode] = run_mode(client, mode, args.path, args.count, args.depth)
+
+    if 'close' in results and results['close'][0] > 0:
+        for mode in args.modes:
+            if mode != 'close':
+                print("{} is {:.1f}x the request rate of a connection per request.".format(mode, results[mode][0] / results['close'][0]))
+
+    if any(failures > 0 for _, failures in results.values()):
+        sys.exit(1)
+
+if __name__ == "__main__":
+    main()
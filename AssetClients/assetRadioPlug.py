@@ -41,18 +41,23 @@ def update_switch_data(switch_ip, headers, switch_name, on_command, off_command,
 #
 # Register a SwitchReceiveData with the switch-sensor.
 #
-def update_switch_receive_data(switch_ip, headers, receiveValue, receiveProtocol, receiveTriggerMqttTopic, receiveTriggerMqttCommand):
+# receiveActions are local actions run by the switch itself, e.g. "on:lamp,off:fan,repeat:1:350".
+#
+def update_switch_receive_data(switch_ip, headers, receiveValue, receiveProtocol, receiveTriggerMqttTopic, receiveTriggerMqttCommand, receiveActions=None):
     mszutl.logIfTurnedOn("[Save Switch Receive Data] Storing switch receive data...")
+    params = 'recval={}&recprot={}&rectopic={}&reccmd={}'.format(
+        receiveValue, 
+        receiveProtocol, 
+        receiveTriggerMqttTopic or '', 
+        receiveTriggerMqttCommand or ''
+    )
+    if receiveActions:
+        params += '&recactions={}'.format(receiveActions)
     response = mszutl.call_endpoint(
         switch_ip, 
         headers, 
         'updateswitchreceive', 
-        'recval={}&recprot={}&rectopic={}&reccmd={}'.format(
-            receiveValue, 
-            receiveProtocol, 
-            receiveTriggerMqttTopic, 
-            receiveTriggerMqttCommand
-        ),
+        params,
         verb='PUT'
     )
     mszutl.logIfTurnedOn("[Save Switch Receive Data] Response status code: {}".format(response.status_code))
@@ -115,7 +120,7 @@ def apply_configuration(switch_ip, headers, config_file_name):
                         return False
                 # Now, register the receive values and mqtt topics
                 for rec in config.receivers:
-                    result = update_switch_receive_data(switch_ip, headers, rec.receiveValue, rec.receiveProtocol, rec.receiveTopic, rec.receiveCommand)
+                    result = update_switch_receive_data(switch_ip, headers, rec.receiveValue, rec.receiveProtocol, rec.receiveTopic, rec.receiveCommand, rec.receiveActions)
                     if not result:
                         mszutl.logIfTurnedOn("[Apply config] Failed updating receiver {}, stopping.".format(rec.receiveValue))
                         return False
@@ -203,8 +208,9 @@ def main():
     parser_registerreceiver = subparsers.add_parser('registerreceiver')
     parser_registerreceiver.add_argument('--recvalue', required=True)
     parser_registerreceiver.add_argument('--recprot', required=True, choices=[1, 2, 3, 4, 5], type=int)
-    parser_registerreceiver.add_argument('--rectopic', required=True)
-    parser_registerreceiver.add_argument('--reccommand', required=True)
+    parser_registerreceiver.add_argument('--rectopic', required=False)
+    parser_registerreceiver.add_argument('--reccommand', required=False)
+    parser_registerreceiver.add_argument('--recactions', required=False, help='local actions, e.g. on:lamp,off:fan,repeat:1:350')
 
     # Create the parser for the "switch" command
     parser_switch = subparsers.add_parser('switch')
@@ -272,7 +278,7 @@ def main():
             mszutl.logIfTurnedOn("Failed to register switch. Exiting...")
             sys.exit(1)
     elif operation == 'registerreceiver':
-        result = update_switch_receive_data(args.ip, headers, args.recvalue, args.recprot, args.rectopic, args.reccommand)
+        result = update_switch_receive_data(args.ip, headers, args.recvalue, args.recprot, args.rectopic, args.reccommand, args.recactions)
         if not result:
             mszutl.logIfTurnedOn("Failed to register receiver. Exiting...")
             sys.exit(1)
@@ -11,12 +11,13 @@ class RadioPlug:
         self.repeatTransmit = repeatTransmit
 
 class RadioReceive:
-    def __init__(self, receiveValue, receiveProtocol, receiveTopic, receiveCommand, receiveName):
+    def __init__(self, receiveValue, receiveProtocol, receiveTopic, receiveCommand, receiveName, receiveActions=None):
         self.receiveValue = receiveValue
         self.receiveProtocol = receiveProtocol
         self.receiveTopic = receiveTopic
         self.receiveCommand = receiveCommand
         self.receiveName = receiveName
+        self.receiveActions = receiveActions
 
 class RadioPlugCollection:
     def __init__(self, name, location, mqttServer, mqttPort, mqttUser, mqttPassword, plugs, receivers):
@@ -0,0 +1,225 @@
+import sys
+import time
+import hmac
+import socket
+import struct
+import hashlib
+import argparse
+import secrets
+
+import assetClientUtil as mszutl
+
+#
+# Constants of the UDP command protocol, see AssetUdpProtocol.h of the assets.
+#
+UDP_DEFAULT_PORT = 4210
+UDP_MAGIC = b'MZ'
+UDP_VERSION = 1
+UDP_HEADER_FORMAT = '>2sBBIQH'
+UDP_HEADER_LENGTH = struct.calcsize(UDP_HEADER_FORMAT)
+UDP_SIGNATURE_LENGTH = 8
+UDP_RESPONSE_FLAG = 0x80
+
+UDP_COMMAND_SWITCH_ON = 0x01
+UDP_COMMAND_SWITCH_OFF = 0x02
+UDP_COMMAND_SCENE = 0x03
+UDP_COMMAND_TIME = 0x04
+
+UDP_STATUS_NAMES = {0: 'OK', 1: 'BAD_REQUEST', 2: 'NOT_FOUND', 3: 'BUSY', 4: 'UNKNOWN_COMMAND'}
+
+#
+# A client of the UDP command protocol. Nonces are the unix seconds in the upper and a counter
+# in the lower 32 bits, the client id is random per client instance.
+#
+class UdpCommandClient:
+    def __init__(self, asset_ip, secret_key, port=UDP_DEFAULT_PORT, timeout=1.0):
+        self.address = (asset_ip, port)
+        self.secret_key = secret_key.encode()
+        self.client_id = secrets.randbits(32)
+        self.counter = 0
+        self.last_seconds = 0
+        self.sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        self.sock.settimeout(timeout)
+
+    def close(self):
+        self.sock.close()
+
+    def next_nonce(self):
+        seconds = int(time.time())
+        if seconds != self.last_seconds:
+            self.last_seconds = seconds
+            self.counter = 0
+        self.counter += 1
+        return (seconds << 32) | self.counter
+
+    def sign(self, data):
+        return hmac.new(self.secret_key, data, hashlib.sha256).digest()[:UDP_SIGNATURE_LENGTH]
+
+    def encode(self, command, nonce, payload):
+        header = struct.pack(UDP_HEADER_FORMAT, UDP_MAGIC, UDP_VERSION, command, self.client_id, nonce, len(payload))
+        return header + payload + self.sign(header + payload)
+
+    # Returns the status of the response, None if no valid response arrived in time.
+    def send(self, command, payload=b''):
+        nonce = self.next_nonce()
+        self.sock.sendto(self.encode(command, nonce, payload), self.address)
+        deadline = time.monotonic() + self.sock.gettimeout()
+        while time.monotonic() < deadline:
+            try:
+                datagram, _ = self.sock.recvfrom(512)
+            except socket.timeout:
+                return None
+            status = self.decode_response(datagram, command, nonce)
+            if status is not None:
+                return status
+        return None
+
+    def decode_response(self, datagram, command, nonce):
+        if len(datagram) < UDP_HEADER_LENGTH + 1 + UDP_SIGNATURE_LENGTH:
+            return None
+        signed, signature = datagram[:-UDP_SIGNATURE_LENGTH], datagram[-UDP_SIGNATURE_LENGTH:]
+        if not hmac.compare_digest(self.sign(signed), signature):
+            mszutl.logIfTurnedOn("[UDP] Dropping response with invalid signature")
+            return None
+        magic, version, resp_command, client_id, resp_nonce, length = struct.unpack(UDP_HEADER_FORMAT, signed[:UDP_HEADER_LENGTH])
+        if magic != UDP_MAGIC or resp_command != (command | UDP_RESPONSE_FLAG) or client_id != self.client_id or resp_nonce != nonce or length < 1:
+            return None
+        return signed[UDP_HEADER_LENGTH]
+
+    def switch(self, switch_name, turn_on):
+        return self.send(UDP_COMMAND_SWITCH_ON if turn_on else UDP_COMMAND_SWITCH_OFF, switch_name.encode())
+
+    # switch_states is a list of (switch name, on) tuples.
+    def scene(self, switch_states):
+        payload = b''
+        for switch_name, turn_on in switch_states:
+            name = switch_name.encode()
+            payload += struct.pack('>BB', 1 if turn_on else 0, len(name)) + name
+        return self.send(UDP_COMMAND_SCENE, payload)
+
+    def set_time(self, unix_millis=None):
+        if unix_millis is None:
+            unix_millis = int(time.time() * 1000)
+        return self.send(UDP_COMMAND_TIME, struct.pack('>Q', unix_millis))
+
+    # Broadcasts the current time to all assets listening on the port, usually with a broadcast ip like
+    # 255.255.255.255. Returns the addresses of all assets that acknowledged the beacon within the timeout.
+    def beacon(self):
+        self.sock.setsockopt(socket.SOL_SOCKET, socket.SO_BROADCAST, 1)
+        nonce = self.next_nonce()
+        payload = struct.pack('>Q', int(time.time() * 1000))
+        self.sock.sendto(self.encode(UDP_COMMAND_TIME, nonce, payload), self.address)
+        acknowledged = []
+        deadline = time.monotonic() + self.sock.gettimeout()
+        while time.monotonic() < deadline:
+            try:
+                datagram, address = self.sock.recvfrom(512)
+            except socket.timeout:
+                break
+            if self.decode_response(datagram, UDP_COMMAND_TIME, nonce) == 0 and address[0] not in acknowledged:
+                acknowledged.append(address[0])
+        return acknowledged
+
+#
+# Sends count requests at the given rate and prints the latency distribution.
+#
+def run_load(client, count, rate, command_factory):
+    latencies = []
+    failures = 0
+    interval = 1.0 / rate if rate > 0 else 0
+    started = time.monotonic()
+    for i in range(count):
+        scheduled = started + i * interval
+        delay = scheduled - time.monotonic()
+        if delay > 0:
+            time.sleep(delay)
+        request_start = time.perf_counter()
+        status = command_factory(i)
+        elapsed_ms = (time.perf_counter() - request_start) * 1000
+        if status is None or status != 0:
+            failures += 1
+        else:
+            latencies.append(elapsed_ms)
+
+    duration = time.monotonic() - started
+    print("Requests: {}, failed or timed out: {}, duration: {:.1f}s, throughput: {:.1f}/s".format(count, failures, duration, count / duration if duration > 0 else 0))
+    if latencies:
+        latencies.sort()
+        def percentile(p):
+            return latencies[min(len(latencies) - 1, int(len(latencies) * p / 100))]
+        print("Latency ms: min {:.2f}, p50 {:.2f}, p90 {:.2f}, p99 {:.2f}, max {:.2f}".format(latencies[0], percentile(50), percentile(90), percentile(99), latencies[-1]))
+    return failures == 0
+
+def print_status(status):
+    if status is None:
+        print("No valid response received.")
+        return False
+    print(UDP_STATUS_NAMES.get(status, str(status)))
+    return status == 0
+
+#
+# Main program execution
+#
+
+def main():
+    parser = argparse.ArgumentParser(description='Send signed commands to an asset via the UDP command protocol.')
+    parser.add_argument('--secret', required=True, help='secret for operations')
+    parser.add_argument('--ip', required=True, help='ip address of the asset to work with')
+    parser.add_argument('--port', required=False, type=int, default=UDP_DEFAULT_PORT)
+    parser.add_argument('--timeout', required=False, type=float, default=1.0, help='seconds to wait for a response')
+    subparsers = parser.add_subparsers(dest="operation")
+
+    parser_switch = subparsers.add_parser('switch')
+    parser_switch.add_argument('--name', required=True)
+    parser_switch.add_argument('--status', required=True, choices=['on', 'off'])
+
+    parser_scene = subparsers.add_parser('scene', help='switch several switches at once, e.g. --switches lamp=on fan=off')
+    parser_scene.add_argument('--switches', required=True, nargs='+')
+
+    subparsers.add_parser('settime', help='Set the time on the asset with the current time on the operating system.')
+
+    parser_beacon = subparsers.add_parser('beacon', help='Broadcast the current time to all assets, use a broadcast address as --ip.')
+    parser_beacon.add_argument('--interval', required=False, type=float, default=0, help='seconds between beacons, 0 = send a single beacon')
+
+    parser_load = subparsers.add_parser('loadtest', help='toggle a switch repeatedly and report latencies')
+    parser_load.add_argument('--name', required=True)
+    parser_load.add_argument('--count', required=False, type=int, default=100)
+    parser_load.add_argument('--rate', required=False, type=float, default=20, help='requests per second, 0 = as fast as possible')
+
+    args = parser.parse_args()
+    client = UdpCommandClient(args.ip, args.secret, args.port, args.timeout)
+    try:
+        if args.operation == 'switch':
+            result = print_status(client.switch(args.name, args.status == 'on'))
+        elif args.operation == 'scene':
+            switch_states = []
+            for switch in args.switches:
+                switch_name, _, state = switch.partition('=')
+                if state not in ('on', 'off'):
+                    print("Invalid switch state for {}, use <name>=on or <name>=off.".format(switch_name))
+                    sys.exit(1)
+                switch_states.append((switch_name, state == 'on'))
+            result = print_status(client.scene(switch_states))
+        elif args.operation == 'settime':
+            result = print_status(client.set_time())
+        elif args.operation == 'beacon':
+            while True:
+                acknowledged = client.beacon()
+                print("Beacon acknowledged by {} asset(s): {}".format(len(acknowledged), ', '.join(acknowledged)))
+                if args.interval <= 0:
+                    break
+                time.sleep(args.interval)
+            result = len(acknowledged) > 0
+        elif args.operation == 'loadtest':
+            result = run_load(client, args.count, args.rate, lambda i: client.switch(args.name, i % 2 == 0))
+        else:
+            parser.print_help()
+            result = True
+    finally:
+        client.close()
+
+    if not result:
+        sys.exit(1)
+
+if __name__ == "__main__":
+    main()
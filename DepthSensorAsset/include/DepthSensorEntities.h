@@ -2,6 +2,7 @@
 #define DEPTHSENSORENTITIES
 
 #include <Arduino.h>
+#include <AssetResourceVersions.h>
 
 #define ULTRASOUND_METERS_PER_SECOND 343.2
 #define ULTRASOUND_CENTIMETERS_PER_MILLISECOND (ULTRASOUND_METERS_PER_SECOND * 100 / 1000)
@@ -14,6 +15,8 @@
 #define DEFAULT_MEASURE_INTERVAL_IN_SECONDS (60 * 5)
 #define MAX_MEASURE_INTERVAL_IN_SECONDS 32767
 
+#define DEPTH_SENSOR_RESOURCE_CONFIG MszResourceVersions::RESOURCE_FIRST_ASSET_SPECIFIC
+
 #define MIN_MEASUREMENTS_TO_KEEP_UNTIL_PURGE 10
 #define MAX_MEASUREMENTS_TO_KEEP_UNTIL_PURGE 100
 
@@ -25,6 +28,13 @@ struct DepthSensorConfig {
     int measurementsToKeepUntilPurge;
 };
 
+// Stored fields of DepthSensorConfig, the codec is generated from them with MSZ_RECORD_DEFINE.
+#define DEPTH_SENSOR_CONFIG_RECORD_VERSION 1
+#define DEPTH_SENSOR_CONFIG_RECORD_FIELDS(FIELD) \
+    FIELD(1, Bool, isDefault)                    \
+    FIELD(2, Int, measureIntervalInSeconds)      \
+    FIELD(3, Int, measurementsToKeepUntilPurge)
+
 /// @brief Measurement data for the Depth Sensor
 /// @details Defines the time of the measurement, the measurement in centimeters, and whether the measurement has been retrieved.
 struct DepthSensorMeasurement {
@@ -2,14 +2,16 @@
 #define DEPTHSENSORAPI
 
 #include <Arduino.h>
-#include <WebServer.h>
 #include <AssetApiBase.h>
 #include <SecretHandler.h>
 #include <DepthSensorEntities.h>
 #include <DepthSensorRepository.h>
 
+#define DEPTH_SENSOR_API_ROUTE_SLOTS 8
+
 /// @brief API for the Depth Sensor
-/// @details This class is responsible for handling the API calls for the Depth Sensor.
+/// @details This class is responsible for handling the API calls for the Depth Sensor, it is served through
+///          MszAssetApiServer with the web server backend the build flags select.
 class MszDepthSensorApi
 : public MszAssetApiBase
 {
@@ -22,39 +24,28 @@ public:
     static constexpr const char *API_ENDPOINT_DEPTH_SENSOR_CONFIG = "/config";
     static constexpr const char *API_ENDPOINT_DEPTH_SENSOR_GETMEASUREMENTS = "/measurements";
 
+    static const MszApiRoute ROUTES[];
+    static const MszApiRouteTable<DEPTH_SENSOR_API_ROUTE_SLOTS> ROUTE_TABLE;
+
     static constexpr const char *API_PARAM_CONFIG_MEASUREMENT_INTERVAL = "measurementintervalseconds";
     static constexpr const char *API_PARAM_CONFIG_MEASUREMENTS_TOKEEP = "measurementstokeep";
 
 protected:
-    WebServer server;
     MszDepthSensorRepository *depthSensorRepository = NULL;
 
     /*
      * The configuration method is overridden by the specific API servers such as this DepthSensorApi
      */
     virtual void beginCfg() override;
+    virtual const MszApiRoute *findRoute(MszHttpMethod method, const char *path) override;
 
     /*
-     * The methods below contain the library-specific request handling. They call the corresponding
-     * core-methods which are library independent.
-     */
-    void handleGetDepthSensorConfig();
-    void handleUpdateDepthSensorConfig();
-    void handleGetDepthSensorMeasurements();
-    void handlePurgeDepthSensorMeasurements();
-
-    /*
-     * Overrides for the actual web server handling methods 
+     * The request handlers, called through the route table once a request is authorized.
      */
-    virtual void beginServe() override;
-    virtual void handleClient() override;
-    virtual void registerGetEndpoint(String endPoint, std::function<void()> handler) override;
-    virtual void registerPostEndpoint(String endPoint, std::function<void()> handler) override;
-    virtual void registerPutEndpoint(String endPoint, std::function<void()> handler) override;
-    virtual void registerDeleteEndpoint(String endPoint, std::function<void()> handler) override;
-    virtual String getQueryStringParam(String paramName) override;
-    virtual String getHttpHeader(String headerName) override;
-    virtual void sendResponseData(CoreHandlerResponse responseData) override;
+    CoreHandlerResponse handleGetDepthSensorConfig();
+    CoreHandlerResponse handleUpdateDepthSensorConfig();
+    CoreHandlerResponse handleGetDepthSensorMeasurements();
+    CoreHandlerResponse handlePurgeDepthSensorMeasurements();
 };
 
 #endif // DEPTHSENSORAPI
\ No newline at end of file
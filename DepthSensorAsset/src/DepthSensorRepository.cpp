@@ -1,15 +1,17 @@
 #include <Arduino.h>
 #include <functional>
-#include <SPIFFS.h>
 #include <TimeLib.h>
+#include <AssetWriteBehindStore.h>
 #include "DepthSensorEntities.h"
 #include "DepthSensorRepository.h"
 
 DepthSensorState MszDepthSensorRepository::inMemoryState;
 
+MSZ_RECORD_DEFINE(DepthSensorConfig, DEPTH_SENSOR_CONFIG_RECORD_VERSION, DEPTH_SENSOR_CONFIG_RECORD_FIELDS)
+
 MszDepthSensorRepository::MszDepthSensorRepository() : AssetBaseRepository()
 {
-    // In addition to the base class setup of the SPIFFS file system, here we are initializing the
+    // In addition to the base class setup of the file system, here we are initializing the
     // in-memory state of the depth sensor.
     purgeAllMeasurements();
 
@@ -25,7 +27,7 @@ DepthSensorConfig MszDepthSensorRepository::loadDepthSensorConfig()
 {
     Serial.println("DepthSensorRepository::loadDepthSensorConfig - enter");
 
-    if (!SPIFFS.begin())
+    if (MszWriteBehindStore::getFileSystem() == NULL)
     {
         Serial.println("DepthSensorRepository::loadDepthSensorConfig - Failed to mount file system, aborting...");
         return inMemoryState.currentConfig;
@@ -45,16 +47,12 @@ DepthSensorConfig MszDepthSensorRepository::loadDepthSensorConfig()
 
     // The configuration is out of sync, or it has never been read before, hence it is worth checking.
     Serial.println("DepthSensorRepository::loadDepthSensorConfig - configuration is out of sync, or it has never been read before, hence it is worth checking.");
-    bool fileExists = SPIFFS.exists(DEPTH_SENSOR_CONFIG_FILENAME);
+    bool fileExists = MszWriteBehindStore::exists(DEPTH_SENSOR_CONFIG_FILENAME);
     if (fileExists)
     {
-        DepthSensorConfig readConfigFromFile;
-        File file = SPIFFS.open(DEPTH_SENSOR_CONFIG_FILENAME, "r");
-        if (file)
+        DepthSensorConfig readConfigFromFile = inMemoryState.currentConfig;
+        if (MszWriteBehindStore::readRecord(DEPTH_SENSOR_CONFIG_FILENAME, readConfigFromFile))
         {
-            file.readBytes((char *)&readConfigFromFile, sizeof(readConfigFromFile));
-            file.close();
-
             // After successfully reading content from file, updated the in-memory state.
             inMemoryState.currentConfig = readConfigFromFile;
             inMemoryState.lastConfigTimeRead = now();
@@ -73,7 +71,7 @@ bool MszDepthSensorRepository::saveDepthSensorConfig(DepthSensorConfig depthSens
 {
     Serial.println("DepthSensorRepository::saveDepthSensorConfig - enter");
 
-    if (!SPIFFS.begin())
+    if (MszWriteBehindStore::getFileSystem() == NULL)
     {
         Serial.println("DepthSensorRepository::saveDepthSensorConfig - Failed to mount file system, aborting...");
         return false;
@@ -88,20 +86,20 @@ bool MszDepthSensorRepository::saveDepthSensorConfig(DepthSensorConfig depthSens
     Serial.println("DepthSensorRepository::saveDepthSensorConfig - lastConfigTimeRead = " + String(inMemoryState.lastConfigTimeRead));
     Serial.println("DepthSensorRepository::saveDepthSensorConfig - lastConfigTimeWrite = " + String(inMemoryState.lastConfigTimeWrite));
 
-    bool succeeded = false;
-    File file = SPIFFS.open(DEPTH_SENSOR_CONFIG_FILENAME, "w");
-    if (file)
+    // Staged for the next group commit, the in-memory state below serves reads until then.
+    bool succeeded = MszWriteBehindStore::writeRecord(DEPTH_SENSOR_CONFIG_FILENAME, depthSensorConfig);
+    if (succeeded)
     {
-        file.write((const uint8_t *)&depthSensorConfig, sizeof(depthSensorConfig));
-        file.close();
-
-        // Updating time when the file was written last time.
+        // Updating time when the file was written last time and invalidating ETags handed out for the configuration.
+        // The in-memory copy is updated right away, otherwise a read within the same second would keep serving the
+        // old configuration under the new ETag.
+        inMemoryState.currentConfig = depthSensorConfig;
         inMemoryState.lastConfigTimeWrite = now();
-        succeeded = true;
+        MszResourceVersions::bump(DEPTH_SENSOR_RESOURCE_CONFIG);
     }
     else
     {
-        Serial.println("DepthSensorRepository::saveDepthSensorConfig - failed to open file");
+        Serial.println("DepthSensorRepository::saveDepthSensorConfig - failed to stage file");
     }
 
     Serial.println("DepthSensorRepository::saveDepthSensorConfig - exit");
@@ -9,6 +9,16 @@
 #include "DepthSensorRepository.h"
 #include "DepthSensorWebApi.h"
 
+constexpr MszApiRoute MszDepthSensorApi::ROUTES[] = {
+    {MszHttpMethod::Get, MszDepthSensorApi::API_ENDPOINT_DEPTH_SENSOR_CONFIG, static_cast<MszApiHandler>(&MszDepthSensorApi::handleGetDepthSensorConfig), true, DEPTH_SENSOR_RESOURCE_CONFIG},
+    {MszHttpMethod::Put, MszDepthSensorApi::API_ENDPOINT_DEPTH_SENSOR_CONFIG, static_cast<MszApiHandler>(&MszDepthSensorApi::handleUpdateDepthSensorConfig), true, MszResourceVersions::NO_RESOURCE},
+    {MszHttpMethod::Get, MszDepthSensorApi::API_ENDPOINT_DEPTH_SENSOR_GETMEASUREMENTS, static_cast<MszApiHandler>(&MszDepthSensorApi::handleGetDepthSensorMeasurements), true, MszResourceVersions::NO_RESOURCE},
+    {MszHttpMethod::Delete, MszDepthSensorApi::API_ENDPOINT_DEPTH_SENSOR_GETMEASUREMENTS, static_cast<MszApiHandler>(&MszDepthSensorApi::handlePurgeDepthSensorMeasurements), true, MszResourceVersions::NO_RESOURCE},
+};
+constexpr MszApiRouteTable<DEPTH_SENSOR_API_ROUTE_SLOTS> MszDepthSensorApi::ROUTE_TABLE =
+    mszMakeRouteTable<DEPTH_SENSOR_API_ROUTE_SLOTS>(MszDepthSensorApi::ROUTES, sizeof(MszDepthSensorApi::ROUTES) / sizeof(MszDepthSensorApi::ROUTES[0]));
+static_assert(MszDepthSensorApi::ROUTE_TABLE.seed != API_ROUTE_NO_SEED, "No perfect hash for the depth sensor API routes, increase DEPTH_SENSOR_API_ROUTE_SLOTS.");
+
 MszDepthSensorApi::MszDepthSensorApi(MszDepthSensorRepository *depthRepository)
     : MszAssetApiBase()
 {
@@ -16,7 +26,7 @@ MszDepthSensorApi::MszDepthSensorApi(MszDepthSensorRepository *depthRepository)
 }
 
 MszDepthSensorApi::MszDepthSensorApi(MszDepthSensorRepository *depthRepository, short secretId, int serverPort)
-    : MszAssetApiBase(secretId, serverPort), server(serverPort)
+    : MszAssetApiBase(secretId, serverPort)
 {
     this->depthSensorRepository = depthRepository;
 }
@@ -24,211 +34,179 @@ MszDepthSensorApi::MszDepthSensorApi(MszDepthSensorRepository *depthRepository,
 void MszDepthSensorApi::beginCfg()
 {
     Serial.println("MszDepthSensorApi::beginCfg() - enter");
-
-    Serial.println("MszDepthSensorApi::beginCfg() - Configuring Depth Sensor API secret handler");
-    this->registerGetEndpoint(API_ENDPOINT_DEPTH_SENSOR_CONFIG, std::bind(&MszDepthSensorApi::handleGetDepthSensorConfig, this));
-    this->registerPutEndpoint(API_ENDPOINT_DEPTH_SENSOR_CONFIG, std::bind(&MszDepthSensorApi::handleUpdateDepthSensorConfig, this));
-    this->registerGetEndpoint(API_ENDPOINT_DEPTH_SENSOR_GETMEASUREMENTS, std::bind(&MszDepthSensorApi::handleGetDepthSensorMeasurements, this));
-    this->registerDeleteEndpoint(API_ENDPOINT_DEPTH_SENSOR_GETMEASUREMENTS, std::bind(&MszDepthSensorApi::handlePurgeDepthSensorMeasurements, this));
-    Serial.println("MszDepthSensorApi::beginCfg() - Depth Sensor API endpoints configured!");
-
     Serial.println("MszDepthSensorApi::beginCfg() - exit");
 }
 
-void MszDepthSensorApi::beginServe()
-{
-    this->server.begin();
-}
-
-void MszDepthSensorApi::handleClient()
-{
-    this->server.handleClient();
-}
-
-void MszDepthSensorApi::registerGetEndpoint(String endpoint, std::function<void()> handler)
-{
-    server.on(endpoint.c_str(), HTTP_GET, handler);
-}
-
-void MszDepthSensorApi::registerPostEndpoint(String endpoint, std::function<void()> handler)
+const MszApiRoute *MszDepthSensorApi::findRoute(MszHttpMethod method, const char *path)
 {
-    server.on(endpoint.c_str(), HTTP_POST, handler);
+    const MszApiRoute *route = MszDepthSensorApi::ROUTE_TABLE.find(method, path);
+    return (route != NULL) ? route : MszAssetApiBase::findRoute(method, path);
 }
 
-void MszDepthSensorApi::registerPutEndpoint(String endpoint, std::function<void()> handler)
-{
-    server.on(endpoint.c_str(), HTTP_PUT, handler);
-}
-
-void MszDepthSensorApi::registerDeleteEndpoint(String endpoint, std::function<void()> handler)
-{
-    server.on(endpoint.c_str(), HTTP_DELETE, handler);
-}
-
-String MszDepthSensorApi::getQueryStringParam(String paramName)
-{
-    return server.arg(paramName.c_str());
-}
-
-String MszDepthSensorApi::getHttpHeader(String headerName)
-{
-    return server.header(headerName.c_str());
-}
-
-void MszDepthSensorApi::sendResponseData(CoreHandlerResponse response)
-{
-    Serial.println("Sending response data - enter.");
-    server.send(response.statusCode, response.contentType, response.returnContent);
-    Serial.println("Sending response data - exit.");
-}
-
-void MszDepthSensorApi::handleGetDepthSensorConfig()
+CoreHandlerResponse MszDepthSensorApi::handleGetDepthSensorConfig()
 {
     Serial.println("Depth Sensor API handleGetDepthSensorConfig - enter");
-    performAuthorizedAction([&]()
-    {
-        Serial.println("Depth Sensor API handleGetDepthSensorConfig - authorized, performing action");
-        CoreHandlerResponse response;
+    CoreHandlerResponse response;
+
+    unsigned long storageStartMicros = micros();
+    DepthSensorConfig config = this->depthSensorRepository->loadDepthSensorConfig();
+    this->requestTimings.addSince(RequestStage::Storage, storageStartMicros);
+    response.statusCode = HTTP_OK_CODE;
+    response.contentType = HTTP_RESPONSE_CONTENT_TYPE_APPLICATION_JSON;
+    
+    // Create the JSON content for the depth sensor configuration in the negotiated format
+    JsonDocument responseDoc(&this->requestArena);
+    responseDoc["isDefault"] = config.isDefault;
+    responseDoc["measurementIntervalSeconds"] = config.measureIntervalInSeconds;
+    responseDoc["measurementsToKeep"] = config.measurementsToKeepUntilPurge;
+    response.returnContent = this->serializeJsonDocument(responseDoc);
 
-        DepthSensorConfig config = this->depthSensorRepository->loadDepthSensorConfig();
-        response.statusCode = HTTP_OK_CODE;
-        response.contentType = HTTP_RESPONSE_CONTENT_TYPE_APPLICATION_JSON;
-        
-        // Create the JSON content for the depth sensor configuration using serializeJsonPretty
-        JsonDocument responseDoc;
-        responseDoc["isDefault"] = config.isDefault;
-        responseDoc["measurementIntervalSeconds"] = config.measureIntervalInSeconds;
-        responseDoc["measurementsToKeep"] = config.measurementsToKeepUntilPurge;
-        serializeJsonPretty(responseDoc, response.returnContent);
-
-        Serial.println("Depth Sensor API handleGetDepthSensorConfig - authorized action exit");
-        return response; 
-    });
     Serial.println("Depth Sensor API handleGetDepthSensorConfig - exit");
+    return response; 
 }
 
-void MszDepthSensorApi::handleUpdateDepthSensorConfig()
+CoreHandlerResponse MszDepthSensorApi::handleUpdateDepthSensorConfig()
 {
     Serial.println("Depth Sensor API handleUpdateDepthSensorConfig - enter");
-    performAuthorizedAction([&]()
-    {
-        Serial.println("Depth Sensor API handleUpdateDepthSensorConfig - authorized, performing action");
-        DepthSensorConfig config;
-        CoreHandlerResponse response;
+    DepthSensorConfig config;
+    CoreHandlerResponse response;
 
-        bool validationSucceeded = true;
+    bool validationSucceeded = true;
 
-        // First, get the configuration parameters from the request.
-        String measureIntervalString = this->getQueryStringParam(API_PARAM_CONFIG_MEASUREMENT_INTERVAL);
-        String measurementsKeepString = this->getQueryStringParam(API_PARAM_CONFIG_MEASUREMENTS_TOKEEP);
+    // First, get the configuration parameters from the request.
+    String measureIntervalString = this->getQueryStringParam(API_PARAM_CONFIG_MEASUREMENT_INTERVAL);
+    String measurementsKeepString = this->getQueryStringParam(API_PARAM_CONFIG_MEASUREMENTS_TOKEEP);
 
-        // Validate if all required parameters are present.
-        if (measureIntervalString == nullptr || measureIntervalString == "" || measurementsKeepString == nullptr || measurementsKeepString == "")
-        {
-            validationSucceeded = false;
-        }
+    // Validate if all required parameters are present.
+    if (measureIntervalString == nullptr || measureIntervalString == "" || measurementsKeepString == nullptr || measurementsKeepString == "")
+    {
+        validationSucceeded = false;
+    }
 
-        // Validate if both parameters are integers.
-        std::istringstream intValidator(measureIntervalString.c_str());
-        intValidator >> std::noskipws >> config.measureIntervalInSeconds;
-        if (intValidator.fail())
-        {
-            validationSucceeded = false;
-        }
-        intValidator.clear();
-        intValidator.str(measurementsKeepString.c_str());
-        intValidator >> std::noskipws >> config.measurementsToKeepUntilPurge;
-        if (intValidator.fail())
-        {
-            validationSucceeded = false;
-        }
+    // Validate if both parameters are integers.
+    std::istringstream intValidator(measureIntervalString.c_str());
+    intValidator >> std::noskipws >> config.measureIntervalInSeconds;
+    if (intValidator.fail())
+    {
+        validationSucceeded = false;
+    }
+    intValidator.clear();
+    intValidator.str(measurementsKeepString.c_str());
+    intValidator >> std::noskipws >> config.measurementsToKeepUntilPurge;
+    if (intValidator.fail())
+    {
+        validationSucceeded = false;
+    }
 
-        // If any of the validations failed above, return a bad request response.
-        if (!validationSucceeded)
-        {
-            Serial.println("Depth Sensor API handleUpdateDepthSensorConfig - config data invalid");
+    // If any of the validations failed above, return a bad request response.
+    if (!validationSucceeded)
+    {
+        Serial.println("Depth Sensor API handleUpdateDepthSensorConfig - config data invalid");
 
-            response.statusCode = HTTP_BAD_REQUEST_CODE;
-            response.contentType = HTTP_RESPONSE_CONTENT_TYPE_APPLICATION_JSON;
-            response.returnContent = this->getErrorJsonDocument(
-                HTTP_BAD_REQUEST_CODE,
-                "Invalid Depth Sensor Config Data!",
-                "You did not provide valid depth sensor config data for updating the depth sensor!");
+        response.statusCode = HTTP_BAD_REQUEST_CODE;
+        response.contentType = HTTP_RESPONSE_CONTENT_TYPE_APPLICATION_JSON;
+        response.returnContent = this->getErrorJsonDocument(
+            HTTP_BAD_REQUEST_CODE,
+            "Invalid Depth Sensor Config Data!",
+            "You did not provide valid depth sensor config data for updating the depth sensor!");
 
-            Serial.println("Depth Sensor API handleUpdateDepthSensorConfig - exit");
-            return response;
-        }
+        Serial.println("Depth Sensor API handleUpdateDepthSensorConfig - exit");
+        return response;
+    }
 
-        // If all parameters are validated, execute the core logic.
-        config.isDefault = false;
-        bool succeeded = this->depthSensorRepository->saveDepthSensorConfig(config);
+    // If all parameters are validated, execute the core logic.
+    config.isDefault = false;
+    unsigned long storageStartMicros = micros();
+    bool succeeded = this->depthSensorRepository->saveDepthSensorConfig(config);
+    this->requestTimings.addSince(RequestStage::Storage, storageStartMicros);
 
-        response.statusCode = (succeeded ? HTTP_OK_CODE : HTTP_INTERNAL_SERVER_ERROR_CODE);
-        response.contentType = HTTP_RESPONSE_CONTENT_TYPE_APPLICATION_JSON;
+    response.statusCode = (succeeded ? HTTP_OK_CODE : HTTP_INTERNAL_SERVER_ERROR_CODE);
+    response.contentType = HTTP_RESPONSE_CONTENT_TYPE_APPLICATION_JSON;
 
-        JsonDocument respDoc;
-        respDoc["isDefault"] = config.isDefault;
-        respDoc["measurementIntervalSeconds"] = config.measureIntervalInSeconds;
-        respDoc["measurementsToKeep"] = config.measurementsToKeepUntilPurge;
-        respDoc["configStatus"] = (succeeded ? "CONFIG_UPDATED" : "CONFIG_UPDATE_FAILED");
-        serializeJsonPretty(respDoc, response.returnContent);
+    JsonDocument respDoc(&this->requestArena);
+    respDoc["isDefault"] = config.isDefault;
+    respDoc["measurementIntervalSeconds"] = config.measureIntervalInSeconds;
+    respDoc["measurementsToKeep"] = config.measurementsToKeepUntilPurge;
+    respDoc["configStatus"] = (succeeded ? "CONFIG_UPDATED" : "CONFIG_UPDATE_FAILED");
+    response.returnContent = this->serializeJsonDocument(respDoc);
 
-        Serial.println("Depth Sensor API handleUpdateDepthSensorConfig - exit");
-        return response;
-    });
     Serial.println("Depth Sensor API handleUpdateDepthSensorConfig - exit");
+    return response;
 }
 
-void MszDepthSensorApi::handleGetDepthSensorMeasurements()
+CoreHandlerResponse MszDepthSensorApi::handleGetDepthSensorMeasurements()
 {
     Serial.println("Depth Sensor API handleGetDepthSensorMeasurements - enter");
-    performAuthorizedAction([&]()
+    CoreHandlerResponse response;
+    response.statusCode = HTTP_OK_CODE;
+    response.contentType = (this->responseFormat == ResponseFormat::MessagePack ? HTTP_RESPONSE_CONTENT_TYPE_APPLICATION_MSGPACK : HTTP_RESPONSE_CONTENT_TYPE_APPLICATION_JSON);
+
+    // The measurement list is streamed one measurement at a time so that memory use does not
+    // depend on the number of measurements kept by the sensor.
+    response.streamContent = [this](Print &output)
     {
-        Serial.println("Depth Sensor API handleGetDepthSensorMeasurements - authorized, performing action");
-        CoreHandlerResponse response;
+        DepthSensorState state = this->depthSensorRepository->loadDepthSensorState();
+        bool asMsgPack = (this->responseFormat == ResponseFormat::MessagePack);
 
-        DepthSensorState state;
-        state = this->depthSensorRepository->loadDepthSensorState();
-        response.statusCode = HTTP_OK_CODE;
-        response.contentType = HTTP_RESPONSE_CONTENT_TYPE_APPLICATION_JSON;
+        if (asMsgPack)
+        {
+            // MessagePack needs the element count up-front: fixmap(1), fixstr("measurements"), array16(count).
+            const uint8_t header[] = {0x81, 0xAC, 'm', 'e', 'a', 's', 'u', 'r', 'e', 'm', 'e', 'n', 't', 's', 0xDC,
+                                      (uint8_t)(state.measurementCount >> 8), (uint8_t)(state.measurementCount & 0xFF)};
+            output.write(header, sizeof(header));
+        }
+        else
+        {
+            output.print("{\"measurements\":[");
+        }
 
-        // Create the JSON content for the depth sensor state using serializeJsonPretty
-        JsonDocument responseDoc;
-        JsonArray measurementsArray = responseDoc["measurements"].to<JsonArray>();
+        JsonDocument measurement(&this->requestArena);
         for (int i = 0; i < state.measurementCount; i++)
         {
-            JsonObject measurement = measurementsArray.add<JsonObject>();
+            measurement.clear();
             measurement["measureTime"] = state.measurements[i].measurementTime;
             measurement["centimeters"] = state.measurements[i].measurementInCm;
             measurement["retrievedBefore"] = state.measurements[i].hasBeenRetrieved;
+            if (asMsgPack)
+            {
+                serializeMsgPack(measurement, output);
+            }
+            else
+            {
+                if (i > 0)
+                {
+                    output.print(',');
+                }
+                this->writeJsonDocument(measurement, output);
+            }
             this->depthSensorRepository->setMeasurementRetrieved(i);
         }
-        serializeJsonPretty(responseDoc, response.returnContent);
 
-        Serial.println("Depth Sensor API handleGetDepthSensorMeasurements - authorized action exit");
-        return response;
-    });
+        if (!asMsgPack)
+        {
+            output.print("]}");
+        }
+    };
+
     Serial.println("Depth Sensor API handleGetDepthSensorMeasurements - exit");
+    return response;
 }
 
-void MszDepthSensorApi::handlePurgeDepthSensorMeasurements()
+CoreHandlerResponse MszDepthSensorApi::handlePurgeDepthSensorMeasurements()
 {
     Serial.println("Depth Sensor API handlePurgeDepthSensorMeasurements - enter");
-    performAuthorizedAction([&]()
-    {
-        Serial.println("Depth Sensor API handlePurgeDepthSensorMeasurements - authorized, performing action");
-        CoreHandlerResponse response;
+    CoreHandlerResponse response;
 
-        bool succeeded = this->depthSensorRepository->purgeMeasurements();
-        response.statusCode = (succeeded ? HTTP_OK_CODE : HTTP_INTERNAL_SERVER_ERROR_CODE);
-        response.contentType = HTTP_RESPONSE_CONTENT_TYPE_APPLICATION_JSON;
+    unsigned long storageStartMicros = micros();
+    bool succeeded = this->depthSensorRepository->purgeMeasurements();
+    this->requestTimings.addSince(RequestStage::Storage, storageStartMicros);
+    response.statusCode = (succeeded ? HTTP_OK_CODE : HTTP_INTERNAL_SERVER_ERROR_CODE);
+    response.contentType = HTTP_RESPONSE_CONTENT_TYPE_APPLICATION_JSON;
 
-        JsonDocument respDoc;
-        respDoc["purgeStatus"] = (succeeded ? "PURGE_SUCCESS" : "PURGE_FAILED");
-        serializeJsonPretty(respDoc, response.returnContent);
+    JsonDocument respDoc(&this->requestArena);
+    respDoc["purgeStatus"] = (succeeded ? "PURGE_SUCCESS" : "PURGE_FAILED");
+    response.returnContent = this->serializeJsonDocument(respDoc);
 
-        Serial.println("Depth Sensor API handlePurgeDepthSensorMeasurements - exit");
-        return response;
-    });
     Serial.println("Depth Sensor API handlePurgeDepthSensorMeasurements - exit");
+    return response;
 }
\ No newline at end of file
@@ -7,10 +7,24 @@
 
 #include "AssetUtilWifi.h"
 #include "SecretHandler.h"
+#include "AssetMetrics.h"
+#include "AssetLoopProfiler.h"
+#include "AssetScheduler.h"
+#include "AssetUdpCommandServer.h"
+#include <atomic>
+
+#if defined(MSZ_DUAL_CORE)
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "AssetCoreTask.h"
+#include "AssetBoundedQueue.h"
+#endif
 
 #include "DepthSensorEntities.h"
 #include "DepthSensorRepository.h"
 #include "DepthSensorWebApi.h"
+#include "AssetApiServer.h"
+#include "AssetWriteBehindStore.h"
 
 const char *WIFI_HOST_NAME = "mszDepthSensor";
 const char *WIFI_NETWORK_NAME = "mszIoTConfigWiFi";
@@ -26,7 +40,40 @@ MszSecretHandler *secretHandler;
 MszDepthSensorRepository *depthRepository;
 MszDepthSensorApi *depthSensorApi;
 
-time_t lastMeasurementTime = 0;
+// The UDP command server lets a controller set the time of the sensor with a single datagram.
+MszUdpCommandServer udpServer;
+
+MszCounter *measurementsMetric;
+MszHistogram *measurementDurationMetric;
+
+// All work of the loop runs as tasks of the scheduler. With MSZ_DUAL_CORE, measurements run on a scheduler of
+// their own on the realtime core and are handed to the network core through a queue for storing them.
+MszScheduler scheduler;
+#if defined(MSZ_DUAL_CORE)
+#define MEASUREMENT_QUEUE_SIZE 8
+MszScheduler realtimeScheduler;
+MszScheduler *measurementScheduler = &realtimeScheduler;
+MszBoundedQueue<DepthSensorMeasurement, MEASUREMENT_QUEUE_SIZE> measurementQueue;
+#else
+MszScheduler *measurementScheduler = &scheduler;
+#endif
+int measurementTaskId = MszScheduler::NO_TASK;
+std::atomic<unsigned long> measurementIntervalMs{1000};
+const unsigned long MEASUREMENT_DEADLINE_MS = 100;
+const unsigned long METRICS_SAMPLE_INTERVAL_MS = 10000;
+const unsigned long STORAGE_COMMIT_CHECK_INTERVAL_MS = 250;
+
+// Loop phases reported by the loop profiler when built with MSZ_LOOP_PROFILER.
+enum LoopPhase
+{
+  LOOP_PHASE_MEASUREMENT,
+  LOOP_PHASE_WEB_SERVER,
+  LOOP_PHASE_UDP,
+  LOOP_PHASE_HOUSEKEEPING,
+  LOOP_PHASE_COUNT
+};
+const char *const LOOP_PHASE_NAMES[LOOP_PHASE_COUNT] = {"measurement", "webServer", "udp", "housekeeping"};
+const uint32_t LOOP_BUDGET_MICROS = 50000;
 
 float createMeasurement()
 {
@@ -60,6 +107,54 @@ float createMeasurement()
   return distanceInCm;
 }
 
+DepthSensorMeasurement takeMeasurement()
+{
+  Serial.println("\nTaking a measurement...");
+
+  // Create the measurement entity.
+  DepthSensorMeasurement depthMeasurement;
+  depthMeasurement.measurementTime = now();
+  depthMeasurement.hasBeenRetrieved = false;
+
+  // Take a measurement.
+  unsigned long measurementStartMicros = micros();
+  depthMeasurement.measurementInCm = createMeasurement();
+  measurementDurationMetric->observe(micros() - measurementStartMicros);
+
+  // Print the measurement
+  Serial.println("-- Measurement time: " + String(depthMeasurement.measurementTime));
+  Serial.println("-- Measurement in cm: " + String(depthMeasurement.measurementInCm));
+
+  return depthMeasurement;
+}
+
+void storeMeasurement(const DepthSensorMeasurement &depthMeasurement)
+{
+  // Loading the updated configuration to apply after the next cycle.
+  depthSensorConfig = depthRepository->loadDepthSensorConfig();
+  measurementIntervalMs = (depthSensorConfig.measureIntervalInSeconds > 0 ? depthSensorConfig.measureIntervalInSeconds : 1) * 1000UL;
+
+  // Store the measurement in the repository.
+  depthRepository->addMeasurement(depthMeasurement);
+  measurementsMetric->increment();
+}
+
+void handleMeasurementTask()
+{
+  DepthSensorMeasurement depthMeasurement = takeMeasurement();
+#if defined(MSZ_DUAL_CORE)
+  if (!measurementQueue.tryPush(depthMeasurement))
+  {
+    Serial.println("-- Measurement queue full, measurement dropped");
+  }
+#else
+  storeMeasurement(depthMeasurement);
+#endif
+  measurementScheduler->setTaskPeriod(measurementTaskId, measurementIntervalMs);
+}
+
+void runNetworkPass();
+
 void setup() {
   // Start the serial logger
   Serial.begin(9600);
@@ -71,7 +166,11 @@ void setup() {
   // Creating the required instances of the core implementation objects.
   secretHandler = new MszSecretHandler();
   depthRepository = new MszDepthSensorRepository();
-  depthSensorApi = new MszDepthSensorApi(depthRepository, MszDepthSensorApi::HTTP_AUTH_SECRET_ID, 80);
+  depthSensorApi = new MszAssetApiServer<MszDepthSensorApi>(depthRepository, MszDepthSensorApi::HTTP_AUTH_SECRET_ID, 80);
+
+  // Metrics for the measurement step, exposed through the /metrics endpoint of the API.
+  measurementsMetric = MszMetricsRegistry::registerCounter("depth_measurements_total", "Depth measurements taken.");
+  measurementDurationMetric = MszMetricsRegistry::registerHistogram("depth_measurement_duration_seconds", "Duration of taking and storing a depth measurement.");
 
   // Load the settings for the depth sensor
   //depthSensorConfig = depthRepository.loadDepthSensorConfig();
@@ -95,7 +194,6 @@ void setup() {
   // running outside of the sensor instead of introducing a dependency
   // to the Internet for this sensor to work.
   setTime(0, 0, 0, 1, 1, 2024); // Set the time to Jan 1, 2024 (midnight)
-  lastMeasurementTime = now();
 
   // Set the PINs for the Ultrasound sensor.
   pinMode(ULTRASOUND_SENSOR_SEND_PIN, OUTPUT);
@@ -103,40 +201,68 @@ void setup() {
 
   // Now start the web server
   depthSensorApi->begin(secretHandler);
-}
-
-void loop() {
+  udpServer.begin(secretHandler, MszDepthSensorApi::HTTP_AUTH_SECRET_ID);
 
-  // Take a senor measurement, but only per defined interval.
-  time_t currentTime = now();
-  if ( (currentTime - lastMeasurementTime) >= depthSensorConfig.measureIntervalInSeconds)
-  {
-    Serial.println("\nTaking a measurement...");
-    Serial.println("Last measurement time: " + String(lastMeasurementTime));
-    Serial.println("Current time: " + String(currentTime));
+  // Register the work of the loop, measurements go first whenever they are due. The interval is
+  // re-applied from the configuration with every measurement.
+#if defined(MSZ_DUAL_CORE)
+  measurementTaskId = measurementScheduler->addPeriodicTask("measurement", handleMeasurementTask, measurementIntervalMs, MszScheduler::PRIORITY_HIGH, MEASUREMENT_DEADLINE_MS);
+  scheduler.addContinuousTask("measurementStore", []() {
+    DepthSensorMeasurement depthMeasurement;
+    while (measurementQueue.tryPop(depthMeasurement))
+    {
+      storeMeasurement(depthMeasurement);
+    }
+    MSZ_LOOP_PROFILER_PHASE(LOOP_PHASE_MEASUREMENT);
+  }, MszScheduler::PRIORITY_HIGH);
+#else
+  measurementTaskId = measurementScheduler->addPeriodicTask("measurement", []() {
+    handleMeasurementTask();
+    MSZ_LOOP_PROFILER_PHASE(LOOP_PHASE_MEASUREMENT);
+  }, measurementIntervalMs, MszScheduler::PRIORITY_HIGH, MEASUREMENT_DEADLINE_MS);
+#endif
+  scheduler.addContinuousTask("webServer", []() {
+    depthSensorApi->loop();
+    MSZ_LOOP_PROFILER_PHASE(LOOP_PHASE_WEB_SERVER);
+  }, MszScheduler::PRIORITY_NORMAL);
+  scheduler.addContinuousTask("udp", []() {
+    udpServer.loop();
+    MSZ_LOOP_PROFILER_PHASE(LOOP_PHASE_UDP);
+  }, MszScheduler::PRIORITY_NORMAL);
+  scheduler.addPeriodicTask("metrics", []() {
+    depthSensorApi->sampleSystemMetrics();
+    MSZ_LOOP_PROFILER_PHASE(LOOP_PHASE_HOUSEKEEPING);
+  }, METRICS_SAMPLE_INTERVAL_MS, MszScheduler::PRIORITY_LOW);
+  scheduler.addPeriodicTask("storageCommit", []() {
+    // Settings updated by the APIs reach the flash here in one batch, not inside the requests.
+    MszWriteBehindStore::loop();
+    MSZ_LOOP_PROFILER_PHASE(LOOP_PHASE_HOUSEKEEPING);
+  }, STORAGE_COMMIT_CHECK_INTERVAL_MS, MszScheduler::PRIORITY_LOW);
 
-    // Loading the updated configuration to apply after the next cycle.
-    depthSensorConfig = depthRepository->loadDepthSensorConfig();
+  MSZ_LOOP_PROFILER_SETUP(LOOP_PHASE_NAMES, LOOP_PHASE_COUNT, LOOP_BUDGET_MICROS);
 
-    // Create the measurement entity.
-    DepthSensorMeasurement depthMeasurement;
-    depthMeasurement.measurementTime = now();
-    depthMeasurement.hasBeenRetrieved = false;
+#if defined(MSZ_DUAL_CORE)
+  // The busy-waiting measurement gets the realtime core, everything touching the network or the file system stays on the other.
+  MszCoreTask::start("sensor", []() { realtimeScheduler.runPending(); }, MSZ_REALTIME_CORE);
+  MszCoreTask::start("network", []() { runNetworkPass(); }, MSZ_NETWORK_CORE);
+#endif
+}
 
-    // Take a measurement.
-    depthMeasurement.measurementInCm = createMeasurement();
+void runNetworkPass()
+{
+  MSZ_LOOP_PROFILER_BEGIN();
 
-    // Print the measurement
-    Serial.println("-- Measurement time: " + String(depthMeasurement.measurementTime));
-    Serial.println("-- Measurement in cm: " + String(depthMeasurement.measurementInCm));
-    
-    // Store the measurement in the repository.
-    depthRepository->addMeasurement(depthMeasurement);
+  // Run all tasks that are due, measurements per the configured interval and the web server on every pass.
+  scheduler.runPending();
 
-    // Update the last measurement time
-    lastMeasurementTime = currentTime;
-  }
+  MSZ_LOOP_PROFILER_END();
+}
 
-  // Then handle the request
-  depthSensorApi->loop();
+void loop() {
+#if defined(MSZ_DUAL_CORE)
+  // All work runs in the core-pinned tasks started in setup().
+  vTaskDelete(NULL);
+#else
+  runNetworkPass();
+#endif
 }
\ No newline at end of file
@@ -1,5 +1,24 @@
+#include <new>
 #include "AssetApiBase.h"
 
+const char *MszAssetApiBase::COLLECTED_HTTP_HEADERS[] = {MszAssetApiBase::HEADER_ACCEPT, MszAssetApiBase::HEADER_ACCEPT_ENCODING, MszAssetApiBase::HEADER_IF_NONE_MATCH};
+const size_t MszAssetApiBase::COLLECTED_HTTP_HEADERS_COUNT = sizeof(MszAssetApiBase::COLLECTED_HTTP_HEADERS) / sizeof(MszAssetApiBase::COLLECTED_HTTP_HEADERS[0]);
+
+// The endpoints that all assets should have.
+constexpr MszApiRoute MszAssetApiBase::ROUTES[] = {
+    {MszHttpMethod::Get, MszAssetApiBase::API_ENDPOINT_INFO, &MszAssetApiBase::handleGetInfo, true, MszResourceVersions::RESOURCE_METADATA},
+    {MszHttpMethod::Put, MszAssetApiBase::API_ENDPOINT_UPDATEINFO, &MszAssetApiBase::handleUpdateInfo, true, MszResourceVersions::NO_RESOURCE},
+    {MszHttpMethod::Put, MszAssetApiBase::API_ENDPOINT_SETTIME, &MszAssetApiBase::handleSetSensorTime, true, MszResourceVersions::NO_RESOURCE},
+    {MszHttpMethod::Get, MszAssetApiBase::API_ENDPOINT_METRICS, &MszAssetApiBase::handleGetMetrics, true, MszResourceVersions::NO_RESOURCE},
+#if defined(MSZ_LOOP_PROFILER)
+    {MszHttpMethod::Get, MszAssetApiBase::API_ENDPOINT_LOOPSTATS, &MszAssetApiBase::handleGetLoopStats, true, MszResourceVersions::NO_RESOURCE},
+    {MszHttpMethod::Delete, MszAssetApiBase::API_ENDPOINT_LOOPSTATS, &MszAssetApiBase::handleResetLoopStats, true, MszResourceVersions::NO_RESOURCE},
+#endif
+};
+constexpr MszApiRouteTable<ASSET_API_ROUTE_SLOTS> MszAssetApiBase::ROUTE_TABLE =
+    mszMakeRouteTable<ASSET_API_ROUTE_SLOTS>(MszAssetApiBase::ROUTES, sizeof(MszAssetApiBase::ROUTES) / sizeof(MszAssetApiBase::ROUTES[0]));
+static_assert(MszAssetApiBase::ROUTE_TABLE.seed != API_ROUTE_NO_SEED, "No perfect hash for the asset API routes, increase ASSET_API_ROUTE_SLOTS.");
+
 MszAssetApiBase::MszAssetApiBase()
 {
 }
@@ -19,10 +38,14 @@ void MszAssetApiBase::begin(MszSecretHandler *secretHandler)
     // First set protected members such as secretHandler.
     this->secretHandler = secretHandler;
 
-    // Configure the endpoints that all assets should have.
-    this->registerGetEndpoint(MszAssetApiBase::API_ENDPOINT_INFO, std::bind(&MszAssetApiBase::handleGetInfo, this));
-    this->registerPutEndpoint(MszAssetApiBase::API_ENDPOINT_UPDATEINFO, std::bind(&MszAssetApiBase::handleUpdateInfo, this));
-    this->registerPutEndpoint(MszAssetApiBase::API_ENDPOINT_SETTIME, std::bind(&MszAssetApiBase::handleSetSensorTime, this));
+    // Register the metrics every asset exposes, endpoint metrics follow lazily with the first request.
+    this->authFailuresMetric = MszMetricsRegistry::registerCounter("asset_http_auth_failures_total", "Requests rejected with 401.");
+    this->rateLimitedMetric = MszMetricsRegistry::registerCounter("asset_http_rate_limited_total", "Requests rejected with 429.");
+    this->freeHeapMetric = MszMetricsRegistry::registerGauge("asset_free_heap_bytes", "Free heap in bytes.");
+    this->largestFreeBlockMetric = MszMetricsRegistry::registerGauge("asset_largest_free_block_bytes", "Largest allocatable heap block in bytes.");
+    this->uptimeMetric = MszMetricsRegistry::registerGauge("asset_uptime_seconds", "Seconds since boot.");
+    this->requestArenaHighWaterMetric = MszMetricsRegistry::registerGauge("asset_request_arena_high_water_bytes", "Most bytes a request took from the request arena.");
+    this->requestArenaOverflowsMetric = MszMetricsRegistry::registerCounter("asset_request_arena_overflows_total", "Request allocations that did not fit the arena and went to the heap.");
 
     // Then allow derived classes doing their configuration
     this->beginCfg();
@@ -41,6 +64,60 @@ void MszAssetApiBase::loop()
     this->handleClient();
 }
 
+void MszAssetApiBase::sampleSystemMetrics()
+{
+    this->freeHeapMetric->set(ESP.getFreeHeap());
+#if defined(ESP32)
+    this->largestFreeBlockMetric->set(ESP.getMaxAllocHeap());
+#elif defined(ESP8266)
+    this->largestFreeBlockMetric->set(ESP.getMaxFreeBlockSize());
+#endif
+    this->uptimeMetric->set(millis() / 1000);
+}
+
+void MszAssetApiBase::dispatchRequest()
+{
+    // Rejected requests are answered without routing, authorizing or logging, they have to stay cheap.
+    uint32_t retryAfterSeconds = this->rateLimiter.admit(this->getRemoteAddress(), millis());
+    if (retryAfterSeconds > 0)
+    {
+        this->rateLimitedMetric->increment();
+        this->sendHttpHeader(MszAssetApiBase::HEADER_RETRY_AFTER, String(retryAfterSeconds).c_str());
+        CoreHandlerResponse response;
+        response.statusCode = HTTP_TOO_MANY_REQUESTS_CODE;
+        response.contentType = HTTP_RESPONSE_CONTENT_TYPE_TEXT_PLAIN;
+        this->sendResponseData(response);
+        return;
+    }
+
+    String path = this->getRequestPath();
+    const MszApiRoute *route = this->findRoute(mszParseHttpMethod(this->getRequestMethod()), path.c_str());
+    if (route == NULL)
+    {
+        Serial.println("Asset API - dispatchRequest - no route for " + String(this->getRequestMethod()) + " " + path);
+        CoreHandlerResponse response;
+        response.statusCode = HTTP_NOT_FOUND_CODE;
+        response.contentType = HTTP_RESPONSE_CONTENT_TYPE_TEXT_PLAIN;
+        response.returnContent = "Not found: " + path;
+        this->sendResponseData(response);
+    }
+    else
+    {
+        this->performRoute(*route);
+    }
+
+    // The response and the documents of the handler are gone, everything they took from the arena goes at once.
+    this->requestArenaHighWaterMetric->set(this->requestArena.getHighWater());
+    this->requestArenaOverflowsMetric->increment(this->requestArena.getOverflowCount() - this->requestArenaOverflowsReported);
+    this->requestArenaOverflowsReported = this->requestArena.getOverflowCount();
+    this->requestArena.reset();
+}
+
+const MszApiRoute *MszAssetApiBase::findRoute(MszHttpMethod method, const char *path)
+{
+    return MszAssetApiBase::ROUTE_TABLE.find(method, path);
+}
+
 bool MszAssetApiBase::authorize()
 {
     bool authZResult = false;
@@ -56,11 +133,13 @@ bool MszAssetApiBase::authorize()
     }
     else
     {
+        // The header is split in place in a copy in the request arena, instead of into three heap substrings.
         String authHeader = this->getHttpHeader(MszAssetApiBase::HEADER_AUTHORIZATION);
-        int firstPipe = authHeader.indexOf('|');
-        int secondPipe = authHeader.indexOf('|', firstPipe + 1);
+        char *timestampStr = this->requestArena.copyString(authHeader.c_str(), authHeader.length());
+        char *token = (timestampStr != NULL) ? strchr(timestampStr, '|') : NULL;
+        char *signature = (token != NULL) ? strchr(token + 1, '|') : NULL;
 
-        if (firstPipe == -1 || secondPipe == -1)
+        if (token == NULL || signature == NULL)
         {
             // The authorization header does not contain two pipe characters
             // Return an empty string to indicate an error
@@ -69,13 +148,12 @@ bool MszAssetApiBase::authorize()
         }
         else
         {
-            // The timestamp is the substring before the first pipe character
-            String timestampStr = authHeader.substring(0, firstPipe);
-            String token = authHeader.substring(firstPipe + 1, secondPipe);
-            String signature = authHeader.substring(secondPipe + 1);
-            Serial.println("Switch API authorize - token: " + token);
-            Serial.println("Switch API authorize - signature: " + signature);
-            if (token == nullptr || token == "" || signature == nullptr || signature == "" || timestampStr == nullptr || timestampStr == "")
+            // The timestamp is the part before the first pipe character
+            *token++ = '\0';
+            *signature++ = '\0';
+            Serial.println("Switch API authorize - token: " + String(token));
+            Serial.println("Switch API authorize - signature: " + String(signature));
+            if (*token == '\0' || *signature == '\0' || *timestampStr == '\0')
             {
                 Serial.println("Switch API authorize FAILED NO TOKEN - exit");
                 authZResult = false;
@@ -83,12 +161,11 @@ bool MszAssetApiBase::authorize()
             else
             {
                 // First, convert the timestamp to an int, if possible
-                int timestamp = 0;
-                std::istringstream issTimeStamp(timestampStr.c_str());
-                issTimeStamp >> std::noskipws >> timestamp;
-                if (issTimeStamp.eof() || !issTimeStamp.fail())
+                char *timestampEnd = NULL;
+                long timestamp = strtol(timestampStr, &timestampEnd, 10);
+                if (timestampEnd != timestampStr)
                 {
-                    authZResult = this->validateAuthorizationToken(timestamp, token, signature);
+                    authZResult = this->validateAuthorizationToken((int)timestamp, String(token), String(signature));
                 }
                 else
                 {
@@ -97,33 +174,96 @@ bool MszAssetApiBase::authorize()
                 }
             }
         }
+        this->requestArena.deallocate(timestampStr);
     }
 
     Serial.println("Asset API - authorize - exit");
     return authZResult;
 }
 
-void MszAssetApiBase::performAuthorizedAction(std::function<CoreHandlerResponse()> action)
+void MszAssetApiBase::performRoute(const MszApiRoute &route)
 {
-    Serial.println("Asset API - performAuthorizedAction - enter");
+    Serial.println("Asset API - performRoute - enter");
 
-    if (this->authorize())
+    unsigned long startMicros = micros();
+    EndpointMetrics *metrics = this->getEndpointMetrics();
+    if (metrics != NULL)
     {
-        Serial.println("Asset API - performAuthorizedAction - authorized, performing action");
-        CoreHandlerResponse response = action();
-        this->sendResponseData(response);
+        metrics->requests->increment();
+    }
+
+    this->requestTimings.reset();
+    this->responseFormat = this->negotiateResponseFormat();
+    this->acceptsGzip = (this->getHttpHeader(MszAssetApiBase::HEADER_ACCEPT_ENCODING).indexOf("gzip") >= 0);
+
+    unsigned long authStartMicros = micros();
+    bool authorized = !route.requiresAuth || this->authorize();
+    this->requestTimings.addSince(RequestStage::Auth, authStartMicros);
+    if (authorized)
+    {
+        if (route.requiresAuth)
+        {
+            this->rateLimiter.reportAuthSuccess(this->getRemoteAddress());
+        }
+
+        String etag;
+        if (route.resourceId != MszResourceVersions::NO_RESOURCE)
+        {
+            // Strong ETags must differ per representation, hence the negotiated format and encoding are part of it.
+            char variant[3] = {(char)('a' + (int)this->responseFormat), (this->acceptsGzip ? 'z' : 'i'), '\0'};
+            etag = MszResourceVersions::getETag(route.resourceId, variant);
+            String ifNoneMatch = this->getHttpHeader(MszAssetApiBase::HEADER_IF_NONE_MATCH);
+            if (ifNoneMatch.length() > 0 && (ifNoneMatch.indexOf(etag) >= 0 || ifNoneMatch == "*"))
+            {
+                Serial.println("Asset API - performRoute - resource not modified, returning 304");
+                CoreHandlerResponse response;
+                response.statusCode = HTTP_NOT_MODIFIED_CODE;
+                response.contentType = HTTP_RESPONSE_CONTENT_TYPE_TEXT_PLAIN;
+                this->sendHttpHeader(MszAssetApiBase::HEADER_ETAG, etag.c_str());
+                this->sendServerTimingHeader();
+                this->sendResponseData(response);
+                if (metrics != NULL)
+                {
+                    metrics->latency->observe(micros() - startMicros);
+                }
+                Serial.println("Asset API - performRoute - exit");
+                return;
+            }
+        }
+
+        Serial.println("Asset API - performRoute - authorized, performing action");
+        uint32_t attributedMicros = this->requestTimings.getTotalMicros();
+        unsigned long actionStartMicros = micros();
+        CoreHandlerResponse response = (this->*route.handler)();
+        uint32_t actionMicros = micros() - actionStartMicros;
+        attributedMicros = this->requestTimings.getTotalMicros() - attributedMicros;
+        this->requestTimings.add(RequestStage::Handler, actionMicros > attributedMicros ? actionMicros - attributedMicros : 0);
+
+        if (etag.length() > 0 && response.statusCode == HTTP_OK_CODE)
+        {
+            this->sendHttpHeader(MszAssetApiBase::HEADER_ETAG, etag.c_str());
+        }
+        this->sendServerTimingHeader();
+        this->sendResponse(response);
     }
     else
     {
-        Serial.println("Asset API - performAuthorizedAction - not authorized, returning 401");
+        Serial.println("Asset API - performRoute - not authorized, returning 401");
+        this->authFailuresMetric->increment();
+        this->rateLimiter.reportAuthFailure(this->getRemoteAddress(), millis());
         CoreHandlerResponse response;
         response.statusCode = HTTP_UNAUTHORIZED_CODE;
         response.contentType = HTTP_RESPONSE_CONTENT_TYPE_TEXT_PLAIN;
         response.returnContent = "Unauthorized";
-        this->sendResponseData(response);
+        this->sendServerTimingHeader();
+        this->sendResponse(response);
     }
 
-    Serial.println("Asset API - performAuthorizedAction - exit");
+    if (metrics != NULL)
+    {
+        metrics->latency->observe(micros() - startMicros);
+    }
+    Serial.println("Asset API - performRoute - exit");
 }
 
 bool MszAssetApiBase::validateAuthorizationToken(int timestamp, String token, String signature)
@@ -155,144 +295,371 @@ bool MszAssetApiBase::validateAuthorizationToken(int timestamp, String token, St
 
 String MszAssetApiBase::getErrorJsonDocument(int errorCode, String errorTitle, String errorMessage)
 {
-    JsonDocument errDoc;
+    JsonDocument errDoc(&this->requestArena);
 
     errDoc["errorCode"] = errorCode;
     errDoc["errorTitle"] = errorTitle;
     errDoc["details"] = errorMessage;
 
-    String errJsonStr;
-    serializeJsonPretty(errDoc, errJsonStr);
-    return errJsonStr;
+    return this->serializeJsonDocument(errDoc);
 }
 
-void MszAssetApiBase::handleGetInfo()
+ResponseFormat MszAssetApiBase::negotiateResponseFormat()
+{
+    // Scripts typically send no or a wildcard Accept header and get compact JSON. Browsers ask for
+    // text/html, and humans using curl can ask for text/plain to get indented JSON.
+    String accept = this->getHttpHeader(MszAssetApiBase::HEADER_ACCEPT);
+    if (accept.indexOf("msgpack") >= 0)
+    {
+        return ResponseFormat::MessagePack;
+    }
+    if (accept.indexOf("text/html") >= 0 || accept.indexOf("text/plain") >= 0)
+    {
+        return ResponseFormat::JsonPretty;
+    }
+    return ResponseFormat::JsonCompact;
+}
+
+String MszAssetApiBase::serializeJsonDocument(JsonDocument &document)
+{
+    unsigned long serializeStartMicros = micros();
+    String jsonStr;
+    if (this->responseFormat == ResponseFormat::JsonPretty)
+    {
+        serializeJsonPretty(document, jsonStr);
+    }
+    else
+    {
+        serializeJson(document, jsonStr);
+    }
+    this->requestTimings.addSince(RequestStage::Serialize, serializeStartMicros);
+    return jsonStr;
+}
+
+size_t MszAssetApiBase::writeJsonDocument(JsonDocument &document, Print &output)
+{
+    // Not timed: streamed documents are written while sending, after the Server-Timing header is already out.
+    if (this->responseFormat == ResponseFormat::JsonPretty)
+    {
+        return serializeJsonPretty(document, output);
+    }
+    return serializeJson(document, output);
+}
+
+void MszAssetApiBase::sendResponse(const CoreHandlerResponse &response)
+{
+    bool isStreamed = (bool)response.streamContent;
+    MszChunkedResponseWriter writer(this);
+    MszGzipStreamWriter *gzipWriter = NULL;
+    if (this->acceptsGzip && (isStreamed || response.returnContent.length() >= COMPRESSION_MIN_RESPONSE_SIZE))
+    {
+        // The compressor has a fixed memory budget of a few KB, if even that is not available send uncompressed.
+        gzipWriter = new (std::nothrow) MszGzipStreamWriter(writer);
+    }
+
+    if (!isStreamed && gzipWriter == NULL)
+    {
+        this->sendResponseData(response);
+        return;
+    }
+
+    Serial.println("Asset API - sendResponse - streaming response");
+    if (gzipWriter != NULL)
+    {
+        this->sendHttpHeader(MszAssetApiBase::HEADER_CONTENT_ENCODING, "gzip");
+        this->sendHttpHeader(MszAssetApiBase::HEADER_VARY, MszAssetApiBase::HEADER_ACCEPT_ENCODING);
+    }
+    this->beginChunkedResponse(response.statusCode, response.contentType.c_str());
+
+    Print &output = (gzipWriter != NULL ? (Print &)*gzipWriter : (Print &)writer);
+    if (isStreamed)
+    {
+        response.streamContent(output);
+    }
+    else
+    {
+        output.write((const uint8_t *)response.returnContent.c_str(), response.returnContent.length());
+    }
+
+    if (gzipWriter != NULL)
+    {
+        gzipWriter->finish();
+        Serial.println("Asset API - sendResponse - compressed " + String(gzipWriter->getBytesIn()) + " to " + String(gzipWriter->getBytesOut()) + " bytes");
+        delete gzipWriter;
+    }
+    writer.flushChunk();
+    this->endChunkedResponse();
+    Serial.println("Asset API - sendResponse - streamed " + String(writer.getBytesWritten()) + " bytes");
+}
+
+CoreHandlerResponse MszAssetApiBase::handleGetInfo()
 {
     Serial.println("Asset API - handleGetInfo - enter");
-    performAuthorizedAction([this]() -> CoreHandlerResponse {
-        AssetBaseRepository switchRepository;
-        AssetMetadataParams metadata = switchRepository.loadMetadata();
+    unsigned long storageStartMicros = micros();
+    AssetBaseRepository switchRepository;
+    AssetMetadataParams metadata = switchRepository.loadMetadata();
+    this->requestTimings.addSince(RequestStage::Storage, storageStartMicros);
+
+    CoreHandlerResponse response;
+    response.statusCode = HTTP_OK_CODE;
+    response.contentType = HTTP_RESPONSE_CONTENT_TYPE_APPLICATION_JSON;
+    response.streamContent = [this, metadata](Print &output) {
+        this->writeMetadataJson(output, "running", metadata);
+    };
+
+    return response;
+}
+
+CoreHandlerResponse MszAssetApiBase::handleUpdateInfo()
+{
+    Serial.println("Asset API - handleUpdateInfo - enter");
+    AssetBaseRepository assetRepository;
+    AssetMetadataParams metadataParams;
+
+    if(!(this->getMetadataParams(metadataParams)))
+    {
+        Serial.println("Asset API - handleUpdateInfo - invalid metadata parameters - exit");
 
         CoreHandlerResponse response;
-        response.statusCode = HTTP_OK_CODE;
+        response.statusCode = HTTP_BAD_REQUEST_CODE;
         response.contentType = HTTP_RESPONSE_CONTENT_TYPE_APPLICATION_JSON;
-        response.returnContent = this->getMetadataJson("running", metadata);
-
+        response.returnContent = this->getErrorJsonDocument(HTTP_BAD_REQUEST_CODE, "BadRequest", "You provided invalid parameters for the Switch Information!");
+        
+        Serial.println("Asset API - handleUpdateInfo - exit");
         return response;
-    });
-    Serial.println("Asset API - handleGetInfo - exit");
+    }
+
+    // Validation succeeded, let's write the data to the repository.
+    unsigned long storageStartMicros = micros();
+    assetRepository.saveMetadata(metadataParams);
+    this->requestTimings.addSince(RequestStage::Storage, storageStartMicros);
+
+    CoreHandlerResponse response;
+    response.statusCode = HTTP_OK_CODE;
+    response.contentType = HTTP_RESPONSE_CONTENT_TYPE_APPLICATION_JSON;
+    response.streamContent = [this, metadataParams](Print &output) {
+        this->writeMetadataJson(output, "updated", metadataParams);
+    };
+    return response;
 }
 
-void MszAssetApiBase::handleUpdateInfo()
+CoreHandlerResponse MszAssetApiBase::handleSetSensorTime()
 {
-    Serial.println("Asset API - handleUpdateInfo - enter");
-    performAuthorizedAction([this]() -> CoreHandlerResponse {
-        AssetBaseRepository assetRepository;
-        AssetMetadataParams metadataParams;
-
-        if(!(this->getMetadataParams(metadataParams)))
-        {
-            Serial.println("Asset API - handleUpdateInfo - invalid metadata parameters - exit");
-
-            CoreHandlerResponse response;
-            response.statusCode = HTTP_BAD_REQUEST_CODE;
-            response.contentType = HTTP_RESPONSE_CONTENT_TYPE_APPLICATION_JSON;
-            response.returnContent = this->getErrorJsonDocument(HTTP_BAD_REQUEST_CODE, "BadRequest", "You provided invalid parameters for the Switch Information!");
-            
-            Serial.println("Asset API - handleUpdateInfo - exit");
-            return response;
-        }
+    Serial.println("Asset API - handleSetSensorTime - enter");
+    Serial.println("Asset API - handleSetSensorTime - validating prameters...");
+    bool invalidParams = false;
+    String paramHourString = this->getQueryStringParam(MszAssetApiBase::PARAM_HOUR);
+    String paramMinuteString = this->getQueryStringParam(MszAssetApiBase::PARAM_MINUTE);
+    String paramSecondString = this->getQueryStringParam(MszAssetApiBase::PARAM_SECOND);
+    String paramDayString = this->getQueryStringParam(MszAssetApiBase::PARAM_DAY);
+    String paramMonthString = this->getQueryStringParam(MszAssetApiBase::PARAM_MONTH);
+    String paramYearString = this->getQueryStringParam(MszAssetApiBase::PARAM_YEAR);
+
+    // Check if any parameters are missing.
+    if ( (paramHourString == nullptr) || (paramMinuteString == nullptr) || (paramSecondString == nullptr) || (paramDayString == nullptr) || (paramMonthString == nullptr) || (paramYearString == nullptr) || 
+         (paramHourString == "") || (paramMinuteString == "") || (paramSecondString == "") || (paramDayString == "") || (paramMonthString == "") || (paramYearString == "") )
+    {
+        Serial.println("Asset API - handleSetSensorTime - missing parameters - exit");
+        invalidParams = true;
+    }
 
-        // Validation succeeded, let's write the data to the repository.
-        assetRepository.saveMetadata(metadataParams);
+    // Now convert all parameters into integers.
+    int hour, min, sec, day, month, year;
+    std::istringstream intStreamConverter(paramHourString.c_str());
+    intStreamConverter >> std::noskipws >> hour;
+    invalidParams = invalidParams || intStreamConverter.fail();
+    intStreamConverter.clear();
+    intStreamConverter.str(paramMinuteString.c_str());
+    intStreamConverter >> std::noskipws >> min;
+    invalidParams = invalidParams || intStreamConverter.fail();
+    intStreamConverter.clear();
+    intStreamConverter.str(paramSecondString.c_str());
+    intStreamConverter >> std::noskipws >> sec;
+    invalidParams = invalidParams || intStreamConverter.fail();
+    intStreamConverter.clear();
+    intStreamConverter.str(paramDayString.c_str());
+    intStreamConverter >> std::noskipws >> day;
+    invalidParams = invalidParams || intStreamConverter.fail();
+    intStreamConverter.clear();
+    intStreamConverter.str(paramMonthString.c_str());
+    intStreamConverter >> std::noskipws >> month;
+    invalidParams = invalidParams || intStreamConverter.fail();
+    intStreamConverter.clear();
+    intStreamConverter.str(paramYearString.c_str());
+    intStreamConverter >> std::noskipws >> year;
+    invalidParams = invalidParams || intStreamConverter.fail();
+
+    // If any of the conversion steps failed above, return a bad request response.
+    if(invalidParams)
+    {
+        Serial.println("Asset API - handleSetSensorTime - invalid metadata parameters - exit");
 
         CoreHandlerResponse response;
-        response.statusCode = HTTP_OK_CODE;
+        response.statusCode = HTTP_BAD_REQUEST_CODE;
         response.contentType = HTTP_RESPONSE_CONTENT_TYPE_APPLICATION_JSON;
-        response.returnContent = this->getMetadataJson("updated", metadataParams);
+        response.returnContent = this->getErrorJsonDocument(HTTP_BAD_REQUEST_CODE, "BadRequest", "You provided invalid parameters for the Switch Information!");
+        
+        Serial.println("Asset API - handleSetSensorTime - exit");
         return response;
-    });
-    Serial.println("Asset API - handleUpdateInfo - exit");
+    }
+
+    // Validation succeeded, now let's set the time. It goes through the clock discipline, which would
+    // otherwise overwrite it with its own time on the next sync.
+    Serial.println("Asset API - handleSetSensorTime - setting time...");
+    tmElements_t timeElements;
+    timeElements.Second = sec;
+    timeElements.Minute = min;
+    timeElements.Hour = hour;
+    timeElements.Day = day;
+    timeElements.Month = month;
+    timeElements.Year = CalendarYrToTm(year);
+    MszClockDiscipline::step((uint64_t)makeTime(timeElements) * 1000);
+
+    // Now get the time in ticks and return that value to the client for confirmation.
+    time_t currentTime = now();
+
+    // Provide responses back to the client.
+    Serial.println("Asset API - handleSetSensorTime - returning response...");
+    CoreHandlerResponse response;
+    response.statusCode = HTTP_OK_CODE;
+    response.contentType = HTTP_RESPONSE_CONTENT_TYPE_APPLICATION_JSON;
+    response.returnContent = String(currentTime);
+    return response;
 }
 
-void MszAssetApiBase::handleSetSensorTime()
+CoreHandlerResponse MszAssetApiBase::handleGetMetrics()
 {
-    Serial.println("Asset API - handleSetSensorTime - enter");
-    performAuthorizedAction([this]() -> CoreHandlerResponse {
-
-        Serial.println("Asset API - handleSetSensorTime - validating prameters...");
-        bool invalidParams = false;
-        String paramHourString = this->getQueryStringParam(MszAssetApiBase::PARAM_HOUR);
-        String paramMinuteString = this->getQueryStringParam(MszAssetApiBase::PARAM_MINUTE);
-        String paramSecondString = this->getQueryStringParam(MszAssetApiBase::PARAM_SECOND);
-        String paramDayString = this->getQueryStringParam(MszAssetApiBase::PARAM_DAY);
-        String paramMonthString = this->getQueryStringParam(MszAssetApiBase::PARAM_MONTH);
-        String paramYearString = this->getQueryStringParam(MszAssetApiBase::PARAM_YEAR);
-
-        // Check if any parameters are missing.
-        if ( (paramHourString == nullptr) || (paramMinuteString == nullptr) || (paramSecondString == nullptr) || (paramDayString == nullptr) || (paramMonthString == nullptr) || (paramYearString == nullptr) || 
-             (paramHourString == "") || (paramMinuteString == "") || (paramSecondString == "") || (paramDayString == "") || (paramMonthString == "") || (paramYearString == "") )
+    Serial.println("Asset API - handleGetMetrics - enter");
+    // Gauges are sampled on scrape, keeping the heap walk out of every other request.
+    this->sampleSystemMetrics();
+
+    CoreHandlerResponse response;
+    response.statusCode = HTTP_OK_CODE;
+    response.contentType = HTTP_RESPONSE_CONTENT_TYPE_PROMETHEUS;
+    response.streamContent = [](Print &output) {
+        MszMetricsRegistry::writePrometheus(output);
+    };
+    return response;
+}
+
+CoreHandlerResponse MszAssetApiBase::handleGetLoopStats()
+{
+    Serial.println("Asset API - handleGetLoopStats - enter");
+    JsonDocument statsDoc(&this->requestArena);
+    statsDoc["budgetMicros"] = MszLoopProfiler::getBudgetMicros();
+    statsDoc["overBudgetCount"] = MszLoopProfiler::getOverBudgetCount();
+    this->addLoopPhaseStats(statsDoc["iteration"].to<JsonObject>(), MszLoopProfiler::getIteration());
+    JsonArray phasesArray = statsDoc["phases"].to<JsonArray>();
+    for (int i = 0; i < MszLoopProfiler::getPhaseCount(); i++)
+    {
+        this->addLoopPhaseStats(phasesArray.add<JsonObject>(), MszLoopProfiler::getPhase(i));
+    }
+
+    bool asMsgPack = (this->responseFormat == ResponseFormat::MessagePack);
+    CoreHandlerResponse response;
+    response.statusCode = HTTP_OK_CODE;
+    response.contentType = (asMsgPack ? HTTP_RESPONSE_CONTENT_TYPE_APPLICATION_MSGPACK : HTTP_RESPONSE_CONTENT_TYPE_APPLICATION_JSON);
+    response.streamContent = [this, statsDoc, asMsgPack](Print &output) mutable {
+        if (asMsgPack)
+        {
+            serializeMsgPack(statsDoc, output);
+        }
+        else
+        {
+            this->writeJsonDocument(statsDoc, output);
+        }
+    };
+    return response;
+}
+
+CoreHandlerResponse MszAssetApiBase::handleResetLoopStats()
+{
+    Serial.println("Asset API - handleResetLoopStats - enter");
+    MszLoopProfiler::reset();
+
+    CoreHandlerResponse response;
+    response.statusCode = HTTP_OK_CODE;
+    response.contentType = HTTP_RESPONSE_CONTENT_TYPE_APPLICATION_JSON;
+    response.returnContent = "{\"status\":\"reset\"}";
+    return response;
+}
+
+void MszAssetApiBase::sendServerTimingHeader()
+{
+    // Sending happens after the headers are out, so the socket write time cannot be part of the header.
+    static const char *const STAGE_NAMES[(int)RequestStage::Count] = {"auth", "storage", "rf", "serialize", "handler"};
+
+    char headerValue[(int)RequestStage::Count * 32];
+    size_t length = 0;
+    headerValue[0] = '\0';
+    for (int i = 0; i < (int)RequestStage::Count; i++)
+    {
+        if (!this->requestTimings.stageMeasured[i])
+        {
+            continue;
+        }
+        uint32_t stageMicros = this->requestTimings.stageMicros[i];
+        length += snprintf(headerValue + length, sizeof(headerValue) - length, "%s%s;dur=%u.%03u",
+                           (length > 0 ? ", " : ""), STAGE_NAMES[i], (unsigned)(stageMicros / 1000), (unsigned)(stageMicros % 1000));
+        if (length >= sizeof(headerValue))
         {
-            Serial.println("Asset API - handleSetSensorTime - missing parameters - exit");
-            invalidParams = true;
+            break;
         }
+    }
 
-        // Now convert all parameters into integers.
-        int hour, min, sec, day, month, year;
-        std::istringstream intStreamConverter(paramHourString.c_str());
-        intStreamConverter >> std::noskipws >> hour;
-        invalidParams = invalidParams || intStreamConverter.fail();
-        intStreamConverter.clear();
-        intStreamConverter.str(paramMinuteString.c_str());
-        intStreamConverter >> std::noskipws >> min;
-        invalidParams = invalidParams || intStreamConverter.fail();
-        intStreamConverter.clear();
-        intStreamConverter.str(paramSecondString.c_str());
-        intStreamConverter >> std::noskipws >> sec;
-        invalidParams = invalidParams || intStreamConverter.fail();
-        intStreamConverter.clear();
-        intStreamConverter.str(paramDayString.c_str());
-        intStreamConverter >> std::noskipws >> day;
-        invalidParams = invalidParams || intStreamConverter.fail();
-        intStreamConverter.clear();
-        intStreamConverter.str(paramMonthString.c_str());
-        intStreamConverter >> std::noskipws >> month;
-        invalidParams = invalidParams || intStreamConverter.fail();
-        intStreamConverter.clear();
-        intStreamConverter.str(paramYearString.c_str());
-        intStreamConverter >> std::noskipws >> year;
-        invalidParams = invalidParams || intStreamConverter.fail();
-
-        // If any of the conversion steps failed above, return a bad request response.
-        if(invalidParams)
+    if (length > 0)
+    {
+        this->sendHttpHeader(MszAssetApiBase::HEADER_SERVER_TIMING, headerValue);
+    }
+}
+
+void MszAssetApiBase::addLoopPhaseStats(JsonObject phaseObject, const MszLoopPhaseStats &stats)
+{
+    phaseObject["name"] = stats.name;
+    phaseObject["count"] = stats.count;
+    phaseObject["minMicros"] = stats.minMicros;
+    phaseObject["maxMicros"] = stats.maxMicros;
+    phaseObject["avgMicros"] = (stats.count > 0 ? (uint32_t)(stats.sumMicros / stats.count) : 0);
+    phaseObject["p50Micros"] = stats.getPercentile(50);
+    phaseObject["p90Micros"] = stats.getPercentile(90);
+    phaseObject["p99Micros"] = stats.getPercentile(99);
+
+    // Histogram as pairs of bucket upper bound and count, leaving out empty buckets to keep the response small.
+    JsonArray histogramArray = phaseObject["histogram"].to<JsonArray>();
+    for (int bucket = 0; bucket < MszLoopPhaseStats::HISTOGRAM_BUCKETS; bucket++)
+    {
+        if (stats.histogram[bucket] > 0)
         {
-            Serial.println("Asset API - handleSetSensorTime - invalid metadata parameters - exit");
-
-            CoreHandlerResponse response;
-            response.statusCode = HTTP_BAD_REQUEST_CODE;
-            response.contentType = HTTP_RESPONSE_CONTENT_TYPE_APPLICATION_JSON;
-            response.returnContent = this->getErrorJsonDocument(HTTP_BAD_REQUEST_CODE, "BadRequest", "You provided invalid parameters for the Switch Information!");
-            
-            Serial.println("Asset API - handleSetSensorTime - exit");
-            return response;
+            JsonArray bucketArray = histogramArray.add<JsonArray>();
+            bucketArray.add(stats.getBucketUpperBound(bucket));
+            bucketArray.add(stats.histogram[bucket]);
         }
+    }
+}
 
-        // Validation succeeded, now let's set the time.
-        Serial.println("Asset API - handleSetSensorTime - setting time...");
-        setTime(hour, min, sec, day, month, year);
+MszAssetApiBase::EndpointMetrics *MszAssetApiBase::getEndpointMetrics()
+{
+    char labels[MAX_METRIC_LABELS_LENGTH + 1];
+    snprintf(labels, sizeof(labels), "method=\"%s\",path=\"%s\"", this->getRequestMethod(), this->getRequestPath().c_str());
 
-        // Now get the time in ticks and return that value to the client for confirmation.
-        time_t currentTime = now();
+    for (int i = 0; i < this->endpointMetricsCount; i++)
+    {
+        if (strcmp(this->endpointMetrics[i].labels, labels) == 0)
+        {
+            return &this->endpointMetrics[i];
+        }
+    }
 
-        // Provide responses back to the client.
-        Serial.println("Asset API - handleSetSensorTime - returning response...");
-        CoreHandlerResponse response;
-        response.statusCode = HTTP_OK_CODE;
-        response.contentType = HTTP_RESPONSE_CONTENT_TYPE_APPLICATION_JSON;
-        response.returnContent = String(currentTime);
-        return response;
-    });
-    Serial.println("Asset API - handleSetSensorTime - exit");
+    // Only routed requests reach a handler, so the table is bounded by the number of routes.
+    if (this->endpointMetricsCount >= MAX_ENDPOINT_METRICS)
+    {
+        return NULL;
+    }
+    EndpointMetrics &metrics = this->endpointMetrics[this->endpointMetricsCount++];
+    strcpy(metrics.labels, labels);
+    metrics.requests = MszMetricsRegistry::registerCounter("asset_http_requests_total", "HTTP requests handled per endpoint.", labels);
+    metrics.latency = MszMetricsRegistry::registerHistogram("asset_http_request_duration_seconds", "HTTP handler latency including sending the response.", labels);
+    return &metrics;
 }
 
 bool MszAssetApiBase::getMetadataParams(AssetMetadataParams &metadataParams)
@@ -355,16 +722,14 @@ bool MszAssetApiBase::getMetadataParams(AssetMetadataParams &metadataParams)
     return true;
 }
 
-String MszAssetApiBase::getMetadataJson(String status, AssetMetadataParams &params)
+void MszAssetApiBase::writeMetadataJson(Print &output, const char *status, const AssetMetadataParams &params)
 {
-    String jsonResp;
-    JsonDocument responseDoc;
+    JsonDocument responseDoc(&this->requestArena);
     responseDoc["status"] = status;
     responseDoc["sensorName"] = params.sensorName;
     responseDoc["sensorLocation"] = params.sensorLocation;
     responseDoc["sensorMqttServer"] = params.sensorMqttServer;
     responseDoc["sensorMqttPort"] = params.sensorMqttPort;
     responseDoc["sensorMqttUsername"] = params.sensorMqttUsername;
-    serializeJsonPretty(responseDoc, jsonResp);
-    return jsonResp;
+    this->writeJsonDocument(responseDoc, output);
 }
\ No newline at end of file
@@ -4,22 +4,41 @@
 #include <Arduino.h>
 #include <ArduinoJson.h>
 #include <TimeLib.h>
+#include "AssetClockDiscipline.h"
 #include "SecretHandler.h"
 #include "AssetApiBaseData.h"
+#include "AssetApiRoutes.h"
+#include "AssetApiResponseWriter.h"
+#include "AssetResourceVersions.h"
+#include "GzipStreamWriter.h"
+#include "AssetMetrics.h"
+#include "AssetLoopProfiler.h"
+#include "AssetRequestArena.h"
+#include "AssetRateLimiter.h"
 
 #define HTTP_OK_CODE 200
+#define HTTP_NOT_MODIFIED_CODE 304
 #define HTTP_BAD_REQUEST_CODE 400
 #define HTTP_UNAUTHORIZED_CODE 401
 #define HTTP_NOT_FOUND_CODE 404
+#define HTTP_TOO_MANY_REQUESTS_CODE 429
 #define HTTP_INTERNAL_SERVER_ERROR_CODE 500
+#define HTTP_SERVICE_UNAVAILABLE_CODE 503
 #define HTTP_RESPONSE_CONTENT_TYPE_TEXT_PLAIN "text/plain"
 #define HTTP_RESPONSE_CONTENT_TYPE_APPLICATION_JSON "application/json"
+#define HTTP_RESPONSE_CONTENT_TYPE_APPLICATION_MSGPACK "application/msgpack"
+#define HTTP_RESPONSE_CONTENT_TYPE_PROMETHEUS "text/plain; version=0.0.4"
+
+#define MAX_ENDPOINT_METRICS 16
+#define ASSET_API_ROUTE_SLOTS 16
 
 /// @class MszAssetApiBase
 /// @brief Base class for the asset web API based on a simple web server.
 /// @details This class provides the base functionality I use across all Web APIs on my assets, especially authorization and token validation.
 class MszAssetApiBase
 {
+    friend class MszChunkedResponseWriter;
+
 public:
     MszAssetApiBase();
     MszAssetApiBase(short secretId, int serverPort);
@@ -28,11 +47,28 @@ public:
     void begin(MszSecretHandler *secretHandler);
     void loop();
 
+    // Updates the heap and uptime gauges, called on every scrape of /metrics and periodically by the assets.
+    void sampleSystemMetrics();
+
     static constexpr const char *API_ENDPOINT_INFO = "/info";
     static constexpr const char *API_ENDPOINT_UPDATEINFO = "/updateinfo";
     static constexpr const char *API_ENDPOINT_SETTIME = "/settime";
+    static constexpr const char *API_ENDPOINT_METRICS = "/metrics";
+    static constexpr const char *API_ENDPOINT_LOOPSTATS = "/loopstats";
+
+    // Routes every asset serves, derived classes look up their own table first and fall back to this one.
+    static const MszApiRoute ROUTES[];
+    static const MszApiRouteTable<ASSET_API_ROUTE_SLOTS> ROUTE_TABLE;
 
     static constexpr const char *HEADER_AUTHORIZATION = "Authorization";
+    static constexpr const char *HEADER_ACCEPT = "Accept";
+    static constexpr const char *HEADER_ACCEPT_ENCODING = "Accept-Encoding";
+    static constexpr const char *HEADER_CONTENT_ENCODING = "Content-Encoding";
+    static constexpr const char *HEADER_VARY = "Vary";
+    static constexpr const char *HEADER_ETAG = "ETag";
+    static constexpr const char *HEADER_IF_NONE_MATCH = "If-None-Match";
+    static constexpr const char *HEADER_SERVER_TIMING = "Server-Timing";
+    static constexpr const char *HEADER_RETRY_AFTER = "Retry-After";
     static constexpr const char *PARAM_SENSOR_NAME = "name";
     static constexpr const char *PARAM_SENSOR_LOCATION = "location";
     static constexpr const char *PARAM_SENSOR_MQTT_SERVER = "mqttserver";
@@ -49,46 +85,105 @@ public:
 
     static const int TOKEN_EXPIRATION_SECONDS = 60;
 
+    // Smaller responses fit into a single packet anyway, compressing them is not worth the CPU time.
+    static const size_t COMPRESSION_MIN_RESPONSE_SIZE = 512;
+
 protected:
     // Basic members.
     bool logLoopDone = false;
     int serverPort = 80;
     short secretId = 0;
+    ResponseFormat responseFormat = ResponseFormat::JsonCompact;
+    bool acceptsGzip = false;
+
+    // Stage timings of the current request, handlers add storage and RF time for the Server-Timing header.
+    RequestTimings requestTimings;
+
+    // Headers beyond Authorization the web server backends need to collect for the base class.
+    static const char *COLLECTED_HTTP_HEADERS[];
+    static const size_t COLLECTED_HTTP_HEADERS_COUNT;
 
     // Passed in as a pointer as created outside of the scope of an instance of this class.
     MszSecretHandler *secretHandler;
 
+    // Request metrics, one entry per method and path seen, created on the first request to an endpoint.
+    struct EndpointMetrics
+    {
+        char labels[MAX_METRIC_LABELS_LENGTH + 1];
+        MszCounter *requests;
+        MszHistogram *latency;
+    };
+    EndpointMetrics endpointMetrics[MAX_ENDPOINT_METRICS];
+    int endpointMetricsCount = 0;
+    MszCounter *authFailuresMetric = NULL;
+    MszCounter *rateLimitedMetric = NULL;
+    MszGauge *freeHeapMetric = NULL;
+    MszGauge *largestFreeBlockMetric = NULL;
+    MszGauge *uptimeMetric = NULL;
+    MszGauge *requestArenaHighWaterMetric = NULL;
+    MszCounter *requestArenaOverflowsMetric = NULL;
+    uint32_t requestArenaOverflowsReported = 0;
+
+    // Admission control, requests beyond the limits are answered with 429 before they are routed or authorized.
+    MszRateLimiter rateLimiter;
+
+    // Backs the JsonDocuments and temporary buffers of the handlers, reset after every response.
+    MszRequestArena requestArena;
+
+    // Called by the web server backends for every request, answers with 404 if no route matches.
+    void dispatchRequest();
+    virtual const MszApiRoute *findRoute(MszHttpMethod method, const char *path);
+
     // Authorization related methods re-used across all implementations.
     bool authorize();
-    void performAuthorizedAction(std::function<CoreHandlerResponse()> action);
+    // With a resourceId, a GET is answered with 304 before the handler runs if the client's If-None-Match matches.
+    void performRoute(const MszApiRoute &route);
     bool validateAuthorizationToken(int timestamp, String token, String signature);
     String getErrorJsonDocument(int errorCode, String errorTitle, String errorMessage);
 
+    // Content negotiation: the format is determined once per request before the action is performed.
+    ResponseFormat negotiateResponseFormat();
+    String serializeJsonDocument(JsonDocument &document);
+    size_t writeJsonDocument(JsonDocument &document, Print &output);
+
+    // Sends a response either as a whole or streamed in chunks if the response has a streamContent writer.
+    // Streamed responses and responses above COMPRESSION_MIN_RESPONSE_SIZE are gzip-compressed if the client accepts it.
+    void sendResponse(const CoreHandlerResponse &response);
+
     /*
      * Web API Handler Methods provided to all derived implementations.
      */
-    void handleGetInfo();
-    void handleUpdateInfo();
-    void handleSetSensorTime();
+    CoreHandlerResponse handleGetInfo();
+    CoreHandlerResponse handleUpdateInfo();
+    CoreHandlerResponse handleSetSensorTime();
+    CoreHandlerResponse handleGetMetrics();
+    CoreHandlerResponse handleGetLoopStats();
+    CoreHandlerResponse handleResetLoopStats();
 
     /*
      * These are the methods that need to be provided by each, library specific implementation.
      */
-    virtual void beginCfg() = 0;        // Called by derived classes to customize endpoint registration and do pre-serve configuration.
-    virtual void beginServe() = 0;      // Called by derived classes to launch the web server implementation.
+    virtual void beginCfg() = 0;        // Called by derived classes to do pre-serve configuration.
+    virtual void beginServe() = 0;      // Called by derived classes to launch the web server, routing all requests to dispatchRequest().
     virtual void handleClient() = 0;
-    virtual void registerGetEndpoint(String endPoint, std::function<void()> handler) = 0;
-    virtual void registerPostEndpoint(String endPoint, std::function<void()> handler) = 0;
-    virtual void registerPutEndpoint(String endPoint, std::function<void()> handler) = 0;
-    virtual void registerDeleteEndpoint(String endPoint, std::function<void()> handler) = 0;
     virtual String getQueryStringParam(String paramName) = 0;
     virtual String getHttpHeader(String headerName) = 0;
-    virtual void sendResponseData(CoreHandlerResponse responseData) = 0;
+    virtual const char *getRequestMethod() = 0;
+    virtual String getRequestPath() = 0;
+    virtual uint32_t getRemoteAddress() = 0;
+    virtual void sendHttpHeader(const char *headerName, const char *headerValue) = 0;
+    virtual void sendResponseData(const CoreHandlerResponse &responseData) = 0;
+    virtual void beginChunkedResponse(int statusCode, const char *contentType) = 0;
+    virtual void sendResponseChunk(const char *data, size_t length) = 0;
+    virtual void endChunkedResponse() = 0;
 
 private:
     // Private helper methods.
     bool getMetadataParams(AssetMetadataParams &metadataParams);
-    String getMetadataJson(String status, AssetMetadataParams &params);
+    void writeMetadataJson(Print &output, const char *status, const AssetMetadataParams &params);
+    EndpointMetrics *getEndpointMetrics();
+    void addLoopPhaseStats(JsonObject phaseObject, const MszLoopPhaseStats &stats);
+    void sendServerTimingHeader();
 };
 
 #endif // MSZ_ASSETAPIBASE
\ No newline at end of file
@@ -1,20 +1,45 @@
 #include "AssetApiBaseData.h"
+#include "AssetResourceVersions.h"
+#include "AssetWriteBehindStore.h"
 
-#include <SPIFFS.h>
+MSZ_RECORD_DEFINE(AssetMetadataParams, ASSET_METADATA_RECORD_VERSION, ASSET_METADATA_RECORD_FIELDS)
+
+void RequestTimings::reset()
+{
+    memset(this->stageMicros, 0, sizeof(this->stageMicros));
+    memset(this->stageMeasured, 0, sizeof(this->stageMeasured));
+}
+
+void RequestTimings::add(RequestStage stage, uint32_t durationMicros)
+{
+    this->stageMicros[(int)stage] += durationMicros;
+    this->stageMeasured[(int)stage] = true;
+}
+
+void RequestTimings::addSince(RequestStage stage, unsigned long startMicros)
+{
+    this->add(stage, micros() - startMicros);
+}
+
+uint32_t RequestTimings::getTotalMicros() const
+{
+    uint32_t total = 0;
+    for (int i = 0; i < (int)RequestStage::Count; i++)
+    {
+        total += this->stageMicros[i];
+    }
+    return total;
+}
 
 AssetBaseRepository::AssetBaseRepository()
 {
     Serial.println("AssetBaseRepository::AssetBaseRepository - enter");
 
-    if (!SPIFFS.begin())
+    // Mounted once and kept mounted, formatting or migrating SPIFFS on the first start if needed.
+    if (MszWriteBehindStore::getFileSystem() == NULL)
     {
-        Serial.println("Failed to mount file system, formatting...");
-        SPIFFS.format();
-        if(!SPIFFS.begin())
-        {
-            Serial.println("Failed to mount file system, aborting...");
-            return;
-        }
+        Serial.println("Failed to mount file system, aborting...");
+        return;
     }
 
     Serial.println("AssetBaseRepository::AssetBaseRepository - exit");
@@ -22,7 +47,6 @@ AssetBaseRepository::AssetBaseRepository()
 
 AssetBaseRepository::~AssetBaseRepository()
 {
-    SPIFFS.end();
 }
 
 AssetMetadataParams AssetBaseRepository::loadMetadata()
@@ -30,21 +54,15 @@ AssetMetadataParams AssetBaseRepository::loadMetadata()
     Serial.println("AssetBaseRepository::loadMetadata - enter");
 
     AssetMetadataParams metadata;
-    File file = SPIFFS.open(ASSET_METADATA_FILENAME, "r");
-    if (file)
-    {
-        file.readBytes((char *)&metadata, sizeof(metadata));
-        file.close();
-    }
-    else
+    metadata.sensorName[0] = '\0';
+    metadata.sensorLocation[0] = '\0';
+    metadata.sensorMqttServer[0] = '\0';
+    metadata.sensorMqttUsername[0] = '\0';
+    metadata.sensorMqttPassword[0] = '\0';
+    metadata.sensorMqttPort = 0;
+    if (!MszWriteBehindStore::readRecord(ASSET_METADATA_FILENAME, metadata))
     {
         Serial.println("AssetBaseRepository::loadMetadata - failed to open file - returning defaults");
-        metadata.sensorName[0] = '\0';
-        metadata.sensorLocation[0] = '\0';
-        metadata.sensorMqttServer[0] = '\0';
-        metadata.sensorMqttUsername[0] = '\0';
-        metadata.sensorMqttPassword[0] = '\0';
-        metadata.sensorMqttPort = 0;
     }
 
     Serial.println("AssetBaseRepository::loadMetadata - sensorName = " + String(metadata.sensorName));
@@ -58,17 +76,15 @@ bool AssetBaseRepository::saveMetadata(AssetMetadataParams metadata)
 {
     Serial.println("AssetBaseRepository::saveMetadata - enter");
 
-    bool succeeded = false;
-    File file = SPIFFS.open(ASSET_METADATA_FILENAME, "w");
-    if (file)
+    // Staged for the next group commit, reads see the new metadata right away.
+    bool succeeded = MszWriteBehindStore::writeRecord(ASSET_METADATA_FILENAME, metadata);
+    if (succeeded)
     {
-        file.write((const uint8_t *)&metadata, sizeof(metadata));
-        file.close();
-        succeeded = true;
+        MszResourceVersions::bump(MszResourceVersions::RESOURCE_METADATA);
     }
     else
     {
-        Serial.println("AssetBaseRepository::saveMetadata - failed to open file");
+        Serial.println("AssetBaseRepository::saveMetadata - failed to stage file");
     }
 
     Serial.println("AssetBaseRepository::saveMetadata - exit");
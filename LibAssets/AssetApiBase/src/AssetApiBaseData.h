@@ -2,6 +2,7 @@
 #define MSZ_ASSETAPIBASEDATA_H
 
 #include <Arduino.h>
+#include <functional>
 
 #define MAX_SENSOR_NAME_LENGTH 32
 #define MAX_SENSOR_LOCATION_LENGTH 64
@@ -9,13 +10,52 @@
 #define MAX_MQTT_USERNAME 64
 #define MAX_MQTT_PASSWORD 64
 
+/// @brief Formats the API can serialize response documents into.
+/// @details Negotiated per request from the Accept header. MessagePack is only produced by handlers returning bulk data,
+///          all others fall back to compact JSON when MessagePack is requested.
+enum class ResponseFormat
+{
+    JsonCompact,
+    JsonPretty,
+    MessagePack
+};
+
+/// @brief Stages of a request reported in the Server-Timing response header.
+/// @details Handler is the part of the action not attributed to any of the other stages.
+enum class RequestStage
+{
+    Auth,
+    Storage,
+    Rf,
+    Serialize,
+    Handler,
+    Count
+};
+
+/// @brief Per-request stage durations in microseconds.
+/// @details Reset at the start of every request. A stage can be added several times per request and accumulates,
+///          stages never added are left out of the Server-Timing header.
+struct RequestTimings
+{
+    uint32_t stageMicros[(int)RequestStage::Count];
+    bool stageMeasured[(int)RequestStage::Count];
+
+    void reset();
+    void add(RequestStage stage, uint32_t durationMicros);
+    void addSince(RequestStage stage, unsigned long startMicros);
+    uint32_t getTotalMicros() const;
+};
+
 /// @brief Response struct for the core handler methods.
 /// @details This struct encapsulates the responses the returned by the core methods for the library specific methods.
+///          If streamContent is set, the body is written by that function directly to the client using chunked
+///          transfer encoding and returnContent is ignored. Use that for responses that can grow large.
 struct CoreHandlerResponse
 {
     int statusCode;
     String contentType;
     String returnContent;
+    std::function<void(Print &output)> streamContent;
 };
 
 /// @brief Defines the parameters for the metadata
@@ -30,6 +70,16 @@ struct AssetMetadataParams
   char sensorMqttPassword[MAX_MQTT_PASSWORD+1];
 };
 
+// Stored fields of AssetMetadataParams, the codec is generated from them with MSZ_RECORD_DEFINE.
+#define ASSET_METADATA_RECORD_VERSION 1
+#define ASSET_METADATA_RECORD_FIELDS(FIELD) \
+  FIELD(1, String, sensorName)              \
+  FIELD(2, String, sensorLocation)          \
+  FIELD(3, String, sensorMqttServer)        \
+  FIELD(4, Int, sensorMqttPort)             \
+  FIELD(5, String, sensorMqttUsername)      \
+  FIELD(6, String, sensorMqttPassword)
+
 /// @brief Base repository for assets
 /// @details Defines the base class for a repository implementation
 class AssetBaseRepository
@@ -0,0 +1,52 @@
+#include "AssetApiResponseWriter.h"
+#include "AssetApiBase.h"
+
+MszChunkedResponseWriter::MszChunkedResponseWriter(MszAssetApiBase *api)
+{
+    this->api = api;
+}
+
+size_t MszChunkedResponseWriter::write(uint8_t c)
+{
+    if (this->bufferLength >= RESPONSE_CHUNK_BUFFER_SIZE)
+    {
+        this->flushChunk();
+    }
+    this->buffer[this->bufferLength++] = c;
+    this->bytesWritten++;
+    return 1;
+}
+
+size_t MszChunkedResponseWriter::write(const uint8_t *buffer, size_t size)
+{
+    size_t remaining = size;
+    while (remaining > 0)
+    {
+        if (this->bufferLength >= RESPONSE_CHUNK_BUFFER_SIZE)
+        {
+            this->flushChunk();
+        }
+
+        size_t toCopy = RESPONSE_CHUNK_BUFFER_SIZE - this->bufferLength;
+        if (toCopy > remaining)
+        {
+            toCopy = remaining;
+        }
+        memcpy(this->buffer + this->bufferLength, buffer, toCopy);
+        this->bufferLength += toCopy;
+        buffer += toCopy;
+        remaining -= toCopy;
+    }
+    this->bytesWritten += size;
+    return size;
+}
+
+void MszChunkedResponseWriter::flushChunk()
+{
+    // Never send an empty chunk since that would terminate the chunked response on the wire.
+    if (this->bufferLength > 0)
+    {
+        this->api->sendResponseChunk((const char *)this->buffer, this->bufferLength);
+        this->bufferLength = 0;
+    }
+}
@@ -0,0 +1,32 @@
+#ifndef MSZ_ASSETAPIRESPONSEWRITER_H
+#define MSZ_ASSETAPIRESPONSEWRITER_H
+
+#include <Arduino.h>
+
+#define RESPONSE_CHUNK_BUFFER_SIZE 256
+
+class MszAssetApiBase;
+
+/// @class MszChunkedResponseWriter
+/// @brief Print implementation used for streaming responses with chunked transfer encoding.
+/// @details Content written to this writer is collected in a small, fixed buffer which is handed over to the
+///          web server backend whenever it is full. That way the full response never needs to be materialized in memory.
+class MszChunkedResponseWriter : public Print
+{
+public:
+    MszChunkedResponseWriter(MszAssetApiBase *api);
+
+    virtual size_t write(uint8_t c) override;
+    virtual size_t write(const uint8_t *buffer, size_t size) override;
+
+    void flushChunk();
+    size_t getBytesWritten() const { return this->bytesWritten; }
+
+private:
+    MszAssetApiBase *api;
+    size_t bufferLength = 0;
+    size_t bytesWritten = 0;
+    uint8_t buffer[RESPONSE_CHUNK_BUFFER_SIZE];
+};
+
+#endif // MSZ_ASSETAPIRESPONSEWRITER_H
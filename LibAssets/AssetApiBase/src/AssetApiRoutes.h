@@ -0,0 +1,179 @@
+#ifndef MSZ_ASSETAPIROUTES_H
+#define MSZ_ASSETAPIROUTES_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "AssetApiBaseData.h"
+
+/*
+ * Compile-time route tables of the asset web APIs. Each API class defines its routes as a constexpr array and a
+ * table built from it at compile time: a seed is searched for which the FNV-1a hashes of method and path of all
+ * routes fall into distinct slots, so a request is dispatched with one hash, one slot lookup and one string
+ * compare, calling the handler through a plain member function pointer.
+ */
+#define API_ROUTE_NO_SEED 0xFFFFFFFFu
+
+// Seeds tried before giving up, bounded by the constexpr recursion depth of the compilers.
+#define API_ROUTE_MAX_SEEDS 256
+
+class MszAssetApiBase;
+
+/// @brief HTTP methods the asset APIs serve.
+enum class MszHttpMethod : uint8_t
+{
+    Get,
+    Post,
+    Put,
+    Delete,
+    Other
+};
+
+/// @brief Handlers of derived classes are cast to this type, they are only ever called on their own class.
+typedef CoreHandlerResponse (MszAssetApiBase::*MszApiHandler)();
+
+/// @brief A route of the web API, the handler is called for method and path once the request is authorized.
+struct MszApiRoute
+{
+    MszHttpMethod method;
+    const char *path;
+    MszApiHandler handler;
+    bool requiresAuth;
+    short resourceId; // With a resource, GETs carry an ETag and are answered with 304 if it matches.
+};
+
+static constexpr uint32_t API_ROUTE_FNV_OFFSET = 2166136261u;
+static constexpr uint32_t API_ROUTE_FNV_PRIME = 16777619u;
+
+constexpr uint32_t mszRouteHashPath(const char *path, uint32_t hash)
+{
+    return (*path == '\0') ? hash : mszRouteHashPath(path + 1, (hash ^ (uint8_t)*path) * API_ROUTE_FNV_PRIME);
+}
+
+constexpr uint32_t mszRouteHash(MszHttpMethod method, const char *path, uint32_t seed)
+{
+    return mszRouteHashPath(path, ((API_ROUTE_FNV_OFFSET ^ seed) ^ (uint8_t)method) * API_ROUTE_FNV_PRIME);
+}
+
+/// @brief Same hash as mszRouteHash() as a loop, for the paths of incoming requests.
+inline uint32_t mszRouteHashRuntime(MszHttpMethod method, const char *path, uint32_t seed)
+{
+    uint32_t hash = ((API_ROUTE_FNV_OFFSET ^ seed) ^ (uint8_t)method) * API_ROUTE_FNV_PRIME;
+    for (; *path != '\0'; path++)
+    {
+        hash = (hash ^ (uint8_t)*path) * API_ROUTE_FNV_PRIME;
+    }
+    return hash;
+}
+
+inline MszHttpMethod mszParseHttpMethod(const char *method)
+{
+    if (strcmp(method, "GET") == 0)
+    {
+        return MszHttpMethod::Get;
+    }
+    if (strcmp(method, "POST") == 0)
+    {
+        return MszHttpMethod::Post;
+    }
+    if (strcmp(method, "PUT") == 0)
+    {
+        return MszHttpMethod::Put;
+    }
+    if (strcmp(method, "DELETE") == 0)
+    {
+        return MszHttpMethod::Delete;
+    }
+    return MszHttpMethod::Other;
+}
+
+/*
+ * The seed search and slot assignment, recursive to stay within what C++11 allows in constexpr functions.
+ */
+constexpr size_t mszRouteSlot(const MszApiRoute *routes, size_t index, uint32_t seed, size_t slotCount)
+{
+    return mszRouteHash(routes[index].method, routes[index].path, seed) & (slotCount - 1);
+}
+
+constexpr bool mszRouteSlotUnique(const MszApiRoute *routes, size_t count, uint32_t seed, size_t slotCount, size_t index, size_t other)
+{
+    return (other >= count) ? true
+                            : (mszRouteSlot(routes, index, seed, slotCount) != mszRouteSlot(routes, other, seed, slotCount) &&
+                               mszRouteSlotUnique(routes, count, seed, slotCount, index, other + 1));
+}
+
+constexpr bool mszRouteSeedPerfect(const MszApiRoute *routes, size_t count, uint32_t seed, size_t slotCount, size_t index)
+{
+    return (index >= count) ? true
+                            : (mszRouteSlotUnique(routes, count, seed, slotCount, index, index + 1) &&
+                               mszRouteSeedPerfect(routes, count, seed, slotCount, index + 1));
+}
+
+constexpr uint32_t mszFindRouteSeed(const MszApiRoute *routes, size_t count, size_t slotCount, uint32_t seed)
+{
+    return (seed >= API_ROUTE_MAX_SEEDS) ? API_ROUTE_NO_SEED
+           : mszRouteSeedPerfect(routes, count, seed, slotCount, 0) ? seed
+                                                                    : mszFindRouteSeed(routes, count, slotCount, seed + 1);
+}
+
+constexpr int8_t mszRouteAtSlot(const MszApiRoute *routes, size_t count, uint32_t seed, size_t slotCount, size_t slot, size_t index)
+{
+    return (index >= count) ? -1
+           : (mszRouteSlot(routes, index, seed, slotCount) == slot) ? (int8_t)index
+                                                                     : mszRouteAtSlot(routes, count, seed, slotCount, slot, index + 1);
+}
+
+template <size_t... Indices>
+struct MszIndexSequence
+{
+};
+
+template <size_t Count, size_t... Indices>
+struct MszMakeIndexSequence : MszMakeIndexSequence<Count - 1, Count - 1, Indices...>
+{
+};
+
+template <size_t... Indices>
+struct MszMakeIndexSequence<0, Indices...>
+{
+    typedef MszIndexSequence<Indices...> type;
+};
+
+/// @class MszApiRouteTable
+/// @brief Perfect hash table over a route array, SlotCount is a power of two of about twice the routes.
+template <size_t SlotCount>
+struct MszApiRouteTable
+{
+    static_assert((SlotCount & (SlotCount - 1)) == 0, "The slot count of a route table must be a power of two.");
+
+    const MszApiRoute *routes;
+    size_t routeCount;
+    uint32_t seed;
+    int8_t slots[SlotCount];
+
+    const MszApiRoute *find(MszHttpMethod method, const char *path) const
+    {
+        int8_t index = this->slots[mszRouteHashRuntime(method, path, this->seed) & (SlotCount - 1)];
+        if (index < 0 || this->routes[index].method != method || strcmp(this->routes[index].path, path) != 0)
+        {
+            return NULL;
+        }
+        return &this->routes[index];
+    }
+};
+
+template <size_t SlotCount, size_t... Slots>
+constexpr MszApiRouteTable<SlotCount> mszMakeRouteTable(const MszApiRoute *routes, size_t count, uint32_t seed, MszIndexSequence<Slots...>)
+{
+    return MszApiRouteTable<SlotCount>{routes, count, seed, {mszRouteAtSlot(routes, count, seed, SlotCount, Slots, 0)...}};
+}
+
+/// @brief Builds the table at compile time, check the result with a static_assert on seed != API_ROUTE_NO_SEED.
+template <size_t SlotCount>
+constexpr MszApiRouteTable<SlotCount> mszMakeRouteTable(const MszApiRoute *routes, size_t count)
+{
+    return mszMakeRouteTable<SlotCount>(routes, count, mszFindRouteSeed(routes, count, SlotCount, 0),
+                                        typename MszMakeIndexSequence<SlotCount>::type());
+}
+
+#endif // MSZ_ASSETAPIROUTES_H
@@ -0,0 +1,352 @@
+#ifndef MSZ_ASSETAPISERVER_H
+#define MSZ_ASSETAPISERVER_H
+
+#include <utility>
+#include "AssetApiBase.h"
+#if defined(ESP32)
+#include <WebServer.h>
+#elif defined(ESP8266)
+#include <ESP8266WebServer.h>
+#endif
+#if defined(MSZ_HTTP_KEEPALIVE)
+#include <AssetHttpServer.h>
+#endif
+#if defined(MSZ_HTTP_ASYNC) || !(defined(ESP32) || defined(ESP8266))
+#include <AssetAsyncHttpServer.h>
+#endif
+
+/*
+ * Web server backends of the asset APIs. A backend is a policy with a Server type and static functions mapping the
+ * request and response methods of MszAssetApiBase onto that server. MszAssetApiServer combines an API class, which
+ * only declares its routes and handlers, with a backend at compile time.
+ */
+
+#if defined(ESP32) || defined(ESP8266)
+
+/// @brief Backend for the Arduino WebServer of the ESP32 and the ESP8266WebServer, which share their interface.
+template <class TServer>
+struct MszWebServerBackend
+{
+    typedef TServer Server;
+
+    template <class THandler>
+    static void begin(Server &server, THandler handler, const char **collectedHeaders, size_t collectedHeadersCount)
+    {
+        // Every request goes through the route table, the WebServer only parses and answers.
+        server.onNotFound(handler);
+        server.collectHeaders(collectedHeaders, collectedHeadersCount);
+        server.begin();
+    }
+
+    static void handleClient(Server &server)
+    {
+        server.handleClient();
+    }
+
+    static String arg(Server &server, const String &name)
+    {
+        return server.arg(name.c_str());
+    }
+
+    static String header(Server &server, const String &name)
+    {
+        return server.header(name.c_str());
+    }
+
+    static const char *method(Server &server)
+    {
+        switch (server.method())
+        {
+        case HTTP_GET:
+            return "GET";
+        case HTTP_POST:
+            return "POST";
+        case HTTP_PUT:
+            return "PUT";
+        case HTTP_DELETE:
+            return "DELETE";
+        default:
+            return "OTHER";
+        }
+    }
+
+    static String uri(Server &server)
+    {
+        return server.uri();
+    }
+
+    static uint32_t remoteAddress(Server &server)
+    {
+        return (uint32_t)server.client().remoteIP();
+    }
+
+    static void sendHeader(Server &server, const char *name, const char *value)
+    {
+        server.sendHeader(name, value);
+    }
+
+    static void send(Server &server, const CoreHandlerResponse &response)
+    {
+        server.send(response.statusCode, response.contentType, response.returnContent);
+    }
+
+    static void beginChunked(Server &server, int statusCode, const char *contentType)
+    {
+        // An unknown content length makes the WebServer use chunked transfer encoding for HTTP/1.1 clients.
+        server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+        server.send(statusCode, contentType, "");
+    }
+
+    static void sendChunk(Server &server, const char *data, size_t length)
+    {
+        server.sendContent(data, length);
+    }
+
+    static void endChunked(Server &server)
+    {
+        server.sendContent("");
+    }
+};
+
+#endif // ESP32 || ESP8266
+
+#if defined(MSZ_HTTP_KEEPALIVE)
+
+/// @brief Backend for MszHttpServer, persistent connections and pipelining on ESP32 and ESP8266.
+struct MszHttpServerBackend
+{
+    typedef MszHttpServer Server;
+
+    template <class THandler>
+    static void begin(Server &server, THandler handler, const char **collectedHeaders, size_t collectedHeadersCount)
+    {
+        // All headers of a request stay available, there is nothing to collect upfront.
+        server.onRequest(handler);
+        server.begin();
+    }
+
+    static void handleClient(Server &server)
+    {
+        server.handleClient();
+    }
+
+    static String arg(Server &server, const String &name)
+    {
+        return server.arg(name.c_str());
+    }
+
+    static String header(Server &server, const String &name)
+    {
+        return server.header(name.c_str());
+    }
+
+    static const char *method(Server &server)
+    {
+        return server.method();
+    }
+
+    static String uri(Server &server)
+    {
+        return server.uri();
+    }
+
+    static uint32_t remoteAddress(Server &server)
+    {
+        return server.remoteAddress();
+    }
+
+    static void sendHeader(Server &server, const char *name, const char *value)
+    {
+        server.sendHeader(name, value);
+    }
+
+    static void send(Server &server, const CoreHandlerResponse &response)
+    {
+        server.send(response.statusCode, response.contentType.c_str(), response.returnContent);
+    }
+
+    static void beginChunked(Server &server, int statusCode, const char *contentType)
+    {
+        server.beginChunked(statusCode, contentType);
+    }
+
+    static void sendChunk(Server &server, const char *data, size_t length)
+    {
+        server.sendChunk(data, length);
+    }
+
+    static void endChunked(Server &server)
+    {
+        server.endChunked();
+    }
+};
+
+#endif // MSZ_HTTP_KEEPALIVE
+
+#if defined(MSZ_HTTP_ASYNC) || !(defined(ESP32) || defined(ESP8266))
+
+/// @brief Backend for MszAsyncHttpServer, on lwIP sockets on the ESP32 and on POSIX sockets for native builds.
+struct MszAsyncHttpServerBackend
+{
+    typedef MszAsyncHttpServer Server;
+
+    template <class THandler>
+    static void begin(Server &server, THandler handler, const char **collectedHeaders, size_t collectedHeadersCount)
+    {
+        // All headers of a request stay available, there is nothing to collect upfront.
+        server.onRequest(handler);
+        if (!server.begin())
+        {
+            Serial.println("MszAsyncHttpServerBackend::begin - failed to listen");
+        }
+    }
+
+    static void handleClient(Server &server)
+    {
+        // Never waits, the scheduler calls this on every pass anyway.
+        server.poll(0);
+    }
+
+    static String arg(Server &server, const String &name)
+    {
+        return String(server.arg(name.c_str()).c_str());
+    }
+
+    static String header(Server &server, const String &name)
+    {
+        return String(server.header(name.c_str()).c_str());
+    }
+
+    static const char *method(Server &server)
+    {
+        return server.method();
+    }
+
+    static String uri(Server &server)
+    {
+        return String(server.uri().c_str());
+    }
+
+    static uint32_t remoteAddress(Server &server)
+    {
+        return server.remoteAddress();
+    }
+
+    static void sendHeader(Server &server, const char *name, const char *value)
+    {
+        server.sendHeader(name, value);
+    }
+
+    static void send(Server &server, const CoreHandlerResponse &response)
+    {
+        server.send(response.statusCode, response.contentType.c_str(), response.returnContent.c_str(), response.returnContent.length());
+    }
+
+    static void beginChunked(Server &server, int statusCode, const char *contentType)
+    {
+        server.beginChunked(statusCode, contentType);
+    }
+
+    static void sendChunk(Server &server, const char *data, size_t length)
+    {
+        server.sendChunk(data, length);
+    }
+
+    static void endChunked(Server &server)
+    {
+        server.endChunked();
+    }
+};
+
+#endif // MSZ_HTTP_ASYNC || native
+
+// The backend selected by the build flags, native builds without an ESP core serve with the async backend.
+#if defined(MSZ_HTTP_ASYNC) || !(defined(ESP32) || defined(ESP8266))
+typedef MszAsyncHttpServerBackend MszDefaultApiBackend;
+#elif defined(MSZ_HTTP_KEEPALIVE)
+typedef MszHttpServerBackend MszDefaultApiBackend;
+#elif defined(ESP32)
+typedef MszWebServerBackend<WebServer> MszDefaultApiBackend;
+#else
+typedef MszWebServerBackend<ESP8266WebServer> MszDefaultApiBackend;
+#endif
+
+/// @class MszAssetApiServer
+/// @brief An asset API served by a web server backend, e.g. MszAssetApiServer<MszSwitchWebApi> for the build's default.
+/// @details Takes the constructor arguments of the API class, the server listens on the API's serverPort. The class
+///          is final, so the backend functions are resolved at compile time and inlined into the overrides below.
+template <class TApi, class TBackend = MszDefaultApiBackend>
+class MszAssetApiServer final : public TApi
+{
+public:
+    template <typename... TArgs>
+    MszAssetApiServer(TArgs &&...args)
+        : TApi(std::forward<TArgs>(args)...), server(this->serverPort)
+    {
+    }
+
+protected:
+    typename TBackend::Server server;
+
+    virtual void beginServe() override
+    {
+        TBackend::begin(this->server, [this]() { this->dispatchRequest(); }, TApi::COLLECTED_HTTP_HEADERS, TApi::COLLECTED_HTTP_HEADERS_COUNT);
+    }
+
+    virtual void handleClient() override
+    {
+        TBackend::handleClient(this->server);
+    }
+
+    virtual String getQueryStringParam(String paramName) override
+    {
+        return TBackend::arg(this->server, paramName);
+    }
+
+    virtual String getHttpHeader(String headerName) override
+    {
+        return TBackend::header(this->server, headerName);
+    }
+
+    virtual const char *getRequestMethod() override
+    {
+        return TBackend::method(this->server);
+    }
+
+    virtual String getRequestPath() override
+    {
+        return TBackend::uri(this->server);
+    }
+
+    virtual uint32_t getRemoteAddress() override
+    {
+        return TBackend::remoteAddress(this->server);
+    }
+
+    virtual void sendHttpHeader(const char *headerName, const char *headerValue) override
+    {
+        TBackend::sendHeader(this->server, headerName, headerValue);
+    }
+
+    virtual void sendResponseData(const CoreHandlerResponse &responseData) override
+    {
+        TBackend::send(this->server, responseData);
+    }
+
+    virtual void beginChunkedResponse(int statusCode, const char *contentType) override
+    {
+        TBackend::beginChunked(this->server, statusCode, contentType);
+    }
+
+    virtual void sendResponseChunk(const char *data, size_t length) override
+    {
+        TBackend::sendChunk(this->server, data, length);
+    }
+
+    virtual void endChunkedResponse() override
+    {
+        TBackend::endChunked(this->server);
+    }
+};
+
+#endif // MSZ_ASSETAPISERVER_H
@@ -0,0 +1,160 @@
+#include "AssetRateLimiter.h"
+
+static_assert((RATE_LIMIT_MAX_CLIENTS & (RATE_LIMIT_MAX_CLIENTS - 1)) == 0, "RATE_LIMIT_MAX_CLIENTS must be a power of two.");
+static_assert(RATE_LIMIT_MAX_CLIENTS >= MszRateLimiter::PROBE_COUNT, "RATE_LIMIT_MAX_CLIENTS must cover the probe window.");
+
+MszRateLimiter::MszRateLimiter()
+{
+    for (int i = 0; i < RATE_LIMIT_MAX_CLIENTS; i++)
+    {
+        this->clients[i].inUse = false;
+    }
+    this->configure(RATE_LIMIT_CLIENT_REQUESTS_PER_MINUTE, RATE_LIMIT_CLIENT_BURST,
+                    RATE_LIMIT_GLOBAL_REQUESTS_PER_MINUTE, RATE_LIMIT_GLOBAL_BURST);
+}
+
+void MszRateLimiter::configure(uint16_t clientRequestsPerMinute, uint16_t clientBurst, uint16_t globalRequestsPerMinute, uint16_t globalBurst)
+{
+    this->clientRequestsPerMinute = clientRequestsPerMinute;
+    this->clientBurst = clientBurst;
+    this->globalRequestsPerMinute = globalRequestsPerMinute;
+    this->globalBurst = globalBurst;
+
+    // Start with full buckets, tracked clients get theirs refilled on their next request.
+    this->globalBucket.units = (uint32_t)globalBurst * TOKEN_UNITS;
+    this->globalBucket.lastRefillMillis = millis();
+}
+
+uint32_t MszRateLimiter::admit(uint32_t address, uint32_t nowMillis)
+{
+    // Without an address, e.g. on backends that do not know it, only the global bucket applies.
+    ClientEntry *client = (address != 0) ? this->findClient(address, nowMillis, true) : NULL;
+    if (client != NULL)
+    {
+        client->lastSeenMillis = nowMillis;
+        int32_t penaltyLeftMillis = (int32_t)(client->penaltyUntilMillis - nowMillis);
+        if (penaltyLeftMillis > 0)
+        {
+            return ((uint32_t)penaltyLeftMillis + 999) / 1000;
+        }
+        refill(client->bucket, this->clientRequestsPerMinute, this->clientBurst, nowMillis);
+        if (this->clientRequestsPerMinute > 0 && client->bucket.units < TOKEN_UNITS)
+        {
+            return getRetryAfterSeconds(client->bucket, this->clientRequestsPerMinute);
+        }
+    }
+
+    refill(this->globalBucket, this->globalRequestsPerMinute, this->globalBurst, nowMillis);
+    if (this->globalRequestsPerMinute > 0 && this->globalBucket.units < TOKEN_UNITS)
+    {
+        return getRetryAfterSeconds(this->globalBucket, this->globalRequestsPerMinute);
+    }
+
+    // Tokens are only taken once both buckets admit the request.
+    if (client != NULL && this->clientRequestsPerMinute > 0)
+    {
+        client->bucket.units -= TOKEN_UNITS;
+    }
+    if (this->globalRequestsPerMinute > 0)
+    {
+        this->globalBucket.units -= TOKEN_UNITS;
+    }
+    return 0;
+}
+
+void MszRateLimiter::reportAuthFailure(uint32_t address, uint32_t nowMillis)
+{
+    ClientEntry *client = this->findClient(address, nowMillis, false);
+    if (client == NULL)
+    {
+        return;
+    }
+    client->authFailures++;
+    if (client->authFailures >= RATE_LIMIT_AUTH_FAILURES)
+    {
+        Serial.println("MszRateLimiter::reportAuthFailure - too many failed authorizations, client in penalty box");
+        client->penaltyUntilMillis = nowMillis + RATE_LIMIT_PENALTY_SECONDS * 1000UL;
+        client->authFailures = 0;
+    }
+}
+
+void MszRateLimiter::reportAuthSuccess(uint32_t address)
+{
+    ClientEntry *client = this->findClient(address, 0, false);
+    if (client != NULL)
+    {
+        client->authFailures = 0;
+    }
+}
+
+MszRateLimiter::ClientEntry *MszRateLimiter::findClient(uint32_t address, uint32_t nowMillis, bool create)
+{
+    if (address == 0)
+    {
+        return NULL;
+    }
+
+    // Fibonacci hashing spreads addresses of one subnet, which only differ in their last byte, over the table.
+    uint32_t start = (address * 2654435761u) >> 16;
+    ClientEntry *victim = NULL;
+    for (int probe = 0; probe < PROBE_COUNT; probe++)
+    {
+        ClientEntry &entry = this->clients[(start + probe) & (RATE_LIMIT_MAX_CLIENTS - 1)];
+        if (!entry.inUse)
+        {
+            if (victim == NULL || victim->inUse)
+            {
+                victim = &entry;
+            }
+            continue;
+        }
+        if (entry.address == address)
+        {
+            return &entry;
+        }
+
+        // Replace the least recently seen client, clients in the penalty box only if all of the window are.
+        if (victim == NULL)
+        {
+            victim = &entry;
+        }
+        else if (victim->inUse)
+        {
+            bool entryPenalized = (int32_t)(entry.penaltyUntilMillis - nowMillis) > 0;
+            bool victimPenalized = (int32_t)(victim->penaltyUntilMillis - nowMillis) > 0;
+            if ((victimPenalized && !entryPenalized) ||
+                (victimPenalized == entryPenalized && (nowMillis - entry.lastSeenMillis) > (nowMillis - victim->lastSeenMillis)))
+            {
+                victim = &entry;
+            }
+        }
+    }
+
+    if (!create)
+    {
+        return NULL;
+    }
+    victim->inUse = true;
+    victim->address = address;
+    victim->bucket.units = (uint32_t)this->clientBurst * TOKEN_UNITS;
+    victim->bucket.lastRefillMillis = nowMillis;
+    victim->lastSeenMillis = nowMillis;
+    victim->penaltyUntilMillis = nowMillis;
+    victim->authFailures = 0;
+    return victim;
+}
+
+void MszRateLimiter::refill(TokenBucket &bucket, uint16_t requestsPerMinute, uint16_t burst, uint32_t nowMillis)
+{
+    // A token is TOKEN_UNITS, so a rate per minute adds exactly requestsPerMinute units per millisecond.
+    uint64_t units = bucket.units + (uint64_t)(nowMillis - bucket.lastRefillMillis) * requestsPerMinute;
+    uint64_t capacity = (uint64_t)burst * TOKEN_UNITS;
+    bucket.units = (uint32_t)((units < capacity) ? units : capacity);
+    bucket.lastRefillMillis = nowMillis;
+}
+
+uint32_t MszRateLimiter::getRetryAfterSeconds(const TokenBucket &bucket, uint16_t requestsPerMinute)
+{
+    uint32_t missingMillis = (TOKEN_UNITS - bucket.units + requestsPerMinute - 1) / requestsPerMinute;
+    return (missingMillis + 999) / 1000;
+}
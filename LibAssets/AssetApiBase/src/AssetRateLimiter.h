@@ -0,0 +1,81 @@
+#ifndef MSZ_ASSETRATELIMITER_H
+#define MSZ_ASSETRATELIMITER_H
+
+#include <Arduino.h>
+
+// Clients tracked at once, a power of two. Beyond that the least recently seen client of a probe window is replaced.
+#ifndef RATE_LIMIT_MAX_CLIENTS
+#define RATE_LIMIT_MAX_CLIENTS 16
+#endif
+#ifndef RATE_LIMIT_CLIENT_REQUESTS_PER_MINUTE
+#define RATE_LIMIT_CLIENT_REQUESTS_PER_MINUTE 120
+#endif
+#ifndef RATE_LIMIT_CLIENT_BURST
+#define RATE_LIMIT_CLIENT_BURST 10
+#endif
+#ifndef RATE_LIMIT_GLOBAL_REQUESTS_PER_MINUTE
+#define RATE_LIMIT_GLOBAL_REQUESTS_PER_MINUTE 600
+#endif
+#ifndef RATE_LIMIT_GLOBAL_BURST
+#define RATE_LIMIT_GLOBAL_BURST 30
+#endif
+// Failed authorizations in a row after which a client is rejected for RATE_LIMIT_PENALTY_SECONDS.
+#ifndef RATE_LIMIT_AUTH_FAILURES
+#define RATE_LIMIT_AUTH_FAILURES 5
+#endif
+#ifndef RATE_LIMIT_PENALTY_SECONDS
+#define RATE_LIMIT_PENALTY_SECONDS 60
+#endif
+
+/// @class MszRateLimiter
+/// @brief Admission control of the asset APIs with token buckets per client address and for the whole device.
+/// @details Checked before a request is routed or authorized, so a flood is turned away before it costs an HMAC.
+///          Clients live in a fixed table, looked up within a fixed probe window, so every check takes constant
+///          time and memory. Clients failing authorization too often sit in a penalty box and are rejected outright.
+class MszRateLimiter
+{
+public:
+    MszRateLimiter();
+
+    // A rate of 0 turns the bucket off, the burst is the number of requests admitted at once after a quiet period.
+    void configure(uint16_t clientRequestsPerMinute, uint16_t clientBurst, uint16_t globalRequestsPerMinute, uint16_t globalBurst);
+
+    // Takes a token from the client's and the global bucket. Returns 0 if admitted, else the seconds to retry after.
+    uint32_t admit(uint32_t address, uint32_t nowMillis);
+
+    void reportAuthFailure(uint32_t address, uint32_t nowMillis);
+    void reportAuthSuccess(uint32_t address);
+
+    static const uint32_t TOKEN_UNITS = 60000; // One token in requests-per-minute times milliseconds.
+    static const int PROBE_COUNT = 4;
+
+private:
+    struct TokenBucket
+    {
+        uint32_t units;
+        uint32_t lastRefillMillis;
+    };
+
+    struct ClientEntry
+    {
+        uint32_t address;
+        TokenBucket bucket;
+        uint32_t lastSeenMillis;
+        uint32_t penaltyUntilMillis;
+        uint8_t authFailures;
+        bool inUse;
+    };
+
+    uint16_t clientRequestsPerMinute;
+    uint16_t clientBurst;
+    uint16_t globalRequestsPerMinute;
+    uint16_t globalBurst;
+    TokenBucket globalBucket;
+    ClientEntry clients[RATE_LIMIT_MAX_CLIENTS];
+
+    ClientEntry *findClient(uint32_t address, uint32_t nowMillis, bool create);
+    static void refill(TokenBucket &bucket, uint16_t requestsPerMinute, uint16_t burst, uint32_t nowMillis);
+    static uint32_t getRetryAfterSeconds(const TokenBucket &bucket, uint16_t requestsPerMinute);
+};
+
+#endif // MSZ_ASSETRATELIMITER_H
@@ -0,0 +1,130 @@
+#include <stdlib.h>
+#include <string.h>
+#include "AssetRequestArena.h"
+
+MszRequestArena::MszRequestArena()
+{
+    this->used = 0;
+    this->lastBlockOffset = NO_BLOCK;
+    this->highWater = 0;
+    this->overflowCount = 0;
+}
+
+void *MszRequestArena::allocate(size_t size)
+{
+    size_t blockOffset = this->used + ALIGNMENT;
+    size_t blockEnd = blockOffset + alignUp(size);
+    if (blockEnd > REQUEST_ARENA_SIZE)
+    {
+        this->overflowCount++;
+        return malloc(size);
+    }
+
+    *(size_t *)(this->buffer + this->used) = size;
+    this->used = blockEnd;
+    this->lastBlockOffset = blockOffset;
+    if (this->used > this->highWater)
+    {
+        this->highWater = this->used;
+    }
+    return this->buffer + blockOffset;
+}
+
+void MszRequestArena::deallocate(void *pointer)
+{
+    if (pointer == NULL)
+    {
+        return;
+    }
+    if (!this->owns(pointer))
+    {
+        free(pointer);
+        return;
+    }
+
+    // Only the most recent block is given back right away, all others go with reset().
+    if ((uint8_t *)pointer == this->buffer + this->lastBlockOffset)
+    {
+        this->used = this->lastBlockOffset - ALIGNMENT;
+        this->lastBlockOffset = NO_BLOCK;
+    }
+}
+
+void *MszRequestArena::reallocate(void *pointer, size_t newSize)
+{
+    if (pointer == NULL)
+    {
+        return this->allocate(newSize);
+    }
+    if (!this->owns(pointer))
+    {
+        return realloc(pointer, newSize);
+    }
+
+    // The most recent block grows and shrinks in place as long as the arena has room.
+    if ((uint8_t *)pointer == this->buffer + this->lastBlockOffset && this->lastBlockOffset + alignUp(newSize) <= REQUEST_ARENA_SIZE)
+    {
+        *(size_t *)((uint8_t *)pointer - ALIGNMENT) = newSize;
+        this->used = this->lastBlockOffset + alignUp(newSize);
+        if (this->used > this->highWater)
+        {
+            this->highWater = this->used;
+        }
+        return pointer;
+    }
+
+    size_t oldSize = this->getBlockSize(pointer);
+    void *newPointer = this->allocate(newSize);
+    if (newPointer != NULL)
+    {
+        memcpy(newPointer, pointer, (oldSize < newSize) ? oldSize : newSize);
+    }
+    return newPointer;
+}
+
+char *MszRequestArena::copyString(const char *value, size_t length)
+{
+    char *copy = (char *)this->allocate(length + 1);
+    if (copy != NULL)
+    {
+        memcpy(copy, value, length);
+        copy[length] = '\0';
+    }
+    return copy;
+}
+
+void MszRequestArena::reset()
+{
+    this->used = 0;
+    this->lastBlockOffset = NO_BLOCK;
+}
+
+size_t MszRequestArena::getUsed() const
+{
+    return this->used;
+}
+
+size_t MszRequestArena::getHighWater() const
+{
+    return this->highWater;
+}
+
+uint32_t MszRequestArena::getOverflowCount() const
+{
+    return this->overflowCount;
+}
+
+bool MszRequestArena::owns(const void *pointer) const
+{
+    return (const uint8_t *)pointer >= this->buffer && (const uint8_t *)pointer < this->buffer + REQUEST_ARENA_SIZE;
+}
+
+size_t MszRequestArena::getBlockSize(const void *pointer) const
+{
+    return *(const size_t *)((const uint8_t *)pointer - ALIGNMENT);
+}
+
+size_t MszRequestArena::alignUp(size_t size)
+{
+    return (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+}
@@ -0,0 +1,54 @@
+#ifndef MSZ_ASSETREQUESTARENA_H
+#define MSZ_ASSETREQUESTARENA_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+#ifndef REQUEST_ARENA_SIZE
+#define REQUEST_ARENA_SIZE 8192
+#endif
+
+/// @class MszRequestArena
+/// @brief Bump allocator for the short-lived memory of one request, released in one step after the response.
+/// @details Handlers pass it to their JsonDocuments and take temporary buffers from it, so a request no longer leaves
+///          holes of freed blocks between long-lived heap objects. Blocks are not freed one by one: only the most
+///          recent block can shrink, grow in place or be released, which is how ArduinoJson grows its pools. When the
+///          arena is full, allocations fall back to the heap and are counted as overflows.
+class MszRequestArena : public ArduinoJson::Allocator
+{
+public:
+    MszRequestArena();
+
+    void *allocate(size_t size) override;
+    void deallocate(void *pointer) override;
+    void *reallocate(void *pointer, size_t newSize) override;
+
+    // Zero-terminated copy of length characters of value, valid until reset(). Pass it to deallocate() when done, in
+    // case it overflowed to the heap. NULL if even the heap is out.
+    char *copyString(const char *value, size_t length);
+
+    // Releases everything allocated from the arena, heap fallbacks must have been deallocated already.
+    void reset();
+
+    size_t getUsed() const;
+    size_t getHighWater() const;
+    uint32_t getOverflowCount() const;
+
+    static const size_t ALIGNMENT = 8;
+
+private:
+    static const size_t NO_BLOCK = (size_t)-1;
+
+    // Each block is preceded by its size, so blocks that cannot grow in place can be copied.
+    alignas(ALIGNMENT) uint8_t buffer[REQUEST_ARENA_SIZE];
+    size_t used;
+    size_t lastBlockOffset;
+    size_t highWater;
+    uint32_t overflowCount;
+
+    bool owns(const void *pointer) const;
+    size_t getBlockSize(const void *pointer) const;
+    static size_t alignUp(size_t size);
+};
+
+#endif // MSZ_ASSETREQUESTARENA_H
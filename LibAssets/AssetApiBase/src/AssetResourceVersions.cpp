@@ -0,0 +1,38 @@
+#include "AssetResourceVersions.h"
+
+uint32_t MszResourceVersions::bootId = 0;
+uint32_t MszResourceVersions::generations[MszResourceVersions::MAX_RESOURCES] = {0};
+
+void MszResourceVersions::bump(short resourceId)
+{
+    if (resourceId >= 0 && resourceId < MAX_RESOURCES)
+    {
+        generations[resourceId]++;
+    }
+}
+
+uint32_t MszResourceVersions::getGeneration(short resourceId)
+{
+    if (resourceId >= 0 && resourceId < MAX_RESOURCES)
+    {
+        return generations[resourceId];
+    }
+    return 0;
+}
+
+String MszResourceVersions::getETag(short resourceId, const char *variant)
+{
+    if (bootId == 0)
+    {
+#if defined(ESP32)
+        bootId = esp_random();
+#elif defined(ESP8266)
+        bootId = ESP.random();
+#endif
+        bootId |= 1;
+    }
+
+    char etag[40];
+    snprintf(etag, sizeof(etag), "\"%08x-%d-%u-%s\"", (unsigned int)bootId, resourceId, (unsigned int)getGeneration(resourceId), variant);
+    return String(etag);
+}
@@ -0,0 +1,28 @@
+#ifndef MSZ_ASSETRESOURCEVERSIONS_H
+#define MSZ_ASSETRESOURCEVERSIONS_H
+
+#include <Arduino.h>
+
+/// @class MszResourceVersions
+/// @brief Generation counters for resources served by the asset APIs, used for ETags and conditional GETs.
+/// @details Repositories bump a resource's generation whenever they write it. The ETag combines a random boot id
+///          with the generation, so ETags handed out before a reboot never match after it.
+class MszResourceVersions
+{
+public:
+    static const short MAX_RESOURCES = 8;
+    static const short NO_RESOURCE = -1;
+
+    static const short RESOURCE_METADATA = 0;
+    static const short RESOURCE_FIRST_ASSET_SPECIFIC = 1;
+
+    static void bump(short resourceId);
+    static uint32_t getGeneration(short resourceId);
+    static String getETag(short resourceId, const char *variant);
+
+private:
+    static uint32_t bootId;
+    static uint32_t generations[MAX_RESOURCES];
+};
+
+#endif // MSZ_ASSETRESOURCEVERSIONS_H
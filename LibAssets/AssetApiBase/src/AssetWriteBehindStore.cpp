@@ -0,0 +1,527 @@
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#if defined(ESP32)
+#include <LittleFS.h>
+#include <SPIFFS.h>
+#include <Preferences.h>
+#elif defined(ESP8266)
+#include <LittleFS.h>
+#endif
+#include "AssetWriteBehindStore.h"
+
+#if defined(ESP32) || defined(ESP8266)
+static MszArduinoFileSystem<decltype(LittleFS)> primaryFileSystem(LittleFS, "LittleFS");
+#else
+static MszPosixFileSystem primaryFileSystem(WRITE_BEHIND_POSIX_ROOT);
+#endif
+#if defined(ESP32)
+// Former firmware versions kept their files on SPIFFS, in the partition LittleFS uses now.
+static MszArduinoFileSystem<decltype(SPIFFS)> legacyFileSystem(SPIFFS, "SPIFFS");
+#endif
+
+MszWriteBehindStore::PendingRecord MszWriteBehindStore::records[WRITE_BEHIND_MAX_RECORDS];
+int MszWriteBehindStore::recordCount = 0;
+uint32_t MszWriteBehindStore::firstStagedMillis = 0;
+uint32_t MszWriteBehindStore::lastStagedMillis = 0;
+MszFlash *MszWriteBehindStore::kvFlash = NULL;
+MszKvStore *MszWriteBehindStore::kvStore = NULL;
+MszFileSystem *MszWriteBehindStore::fileSystem = NULL;
+
+bool MszWriteBehindStore::write(const char *path, const void *data, size_t length)
+{
+    uint8_t *copy = (uint8_t *)malloc((length > 0) ? length : 1);
+    if (copy == NULL)
+    {
+        // Without RAM for a copy, write through after what is pending, which may hold an older version of the record.
+        Serial.println("MszWriteBehindStore::write - out of memory, writing through " + String(path));
+        PendingRecord direct;
+        strncpy(direct.path, path, WRITE_BEHIND_MAX_PATH_LENGTH);
+        direct.path[WRITE_BEHIND_MAX_PATH_LENGTH] = '\0';
+        direct.data = (uint8_t *)data;
+        direct.length = length;
+        direct.remove = false;
+        return flush() && commitRecord(direct);
+    }
+    memcpy(copy, data, length);
+
+    PendingRecord *record = stage(path);
+    if (record == NULL)
+    {
+        free(copy);
+        return false;
+    }
+    free(record->data);
+    record->data = copy;
+    record->length = length;
+    record->remove = false;
+    return true;
+}
+
+bool MszWriteBehindStore::remove(const char *path)
+{
+    PendingRecord *record = stage(path);
+    if (record == NULL)
+    {
+        return false;
+    }
+    free(record->data);
+    record->data = NULL;
+    record->length = 0;
+    record->remove = true;
+    return true;
+}
+
+size_t MszWriteBehindStore::read(const char *path, void *data, size_t length)
+{
+    PendingRecord *record = findRecord(path);
+    if (record != NULL)
+    {
+        size_t readLength = (record->length < length) ? record->length : length;
+        if (readLength > 0)
+        {
+            memcpy(data, record->data, readLength);
+        }
+        return readLength;
+    }
+
+    MszKvStore *store = getKvStore();
+    if (store != NULL && store->contains(path))
+    {
+        return store->get(path, data, length);
+    }
+
+    // Written before the store existed, moved into it on the next update.
+    MszFileSystem *files = getFileSystem();
+    return (files != NULL) ? files->read(path, 0, data, length) : 0;
+}
+
+bool MszWriteBehindStore::exists(const char *path)
+{
+    PendingRecord *record = findRecord(path);
+    if (record != NULL)
+    {
+        return !record->remove;
+    }
+    MszKvStore *store = getKvStore();
+    if (store != NULL && store->contains(path))
+    {
+        return true;
+    }
+    MszFileSystem *files = getFileSystem();
+    return files != NULL && files->exists(path);
+}
+
+void MszWriteBehindStore::forEachPath(const char *prefix, std::function<void(const char *path)> visitor)
+{
+    MszKvStore *store = getKvStore();
+    if (store != NULL)
+    {
+        store->forEachKey(prefix, [&visitor](const char *key) {
+            // Pending records are visited below, including pending removals would resurrect them.
+            if (findRecord(key) == NULL)
+            {
+                visitor(key);
+            }
+        });
+    }
+
+    size_t prefixLength = strlen(prefix);
+    for (int i = 0; i < recordCount; i++)
+    {
+        if (!records[i].remove && strncmp(records[i].path, prefix, prefixLength) == 0)
+        {
+            visitor(records[i].path);
+        }
+    }
+}
+
+void MszWriteBehindStore::loop()
+{
+    if (recordCount == 0)
+    {
+        return;
+    }
+    uint32_t nowMillis = millis();
+    if ((nowMillis - lastStagedMillis) >= WRITE_BEHIND_DEBOUNCE_MS || (nowMillis - firstStagedMillis) >= WRITE_BEHIND_MAX_DELAY_MS)
+    {
+        flush();
+    }
+}
+
+bool MszWriteBehindStore::flush()
+{
+    if (recordCount == 0)
+    {
+        return true;
+    }
+
+    Serial.println("MszWriteBehindStore::flush - committing " + String(recordCount) + " records");
+    int committed = 0;
+    while (committed < recordCount && commitRecord(records[committed]))
+    {
+        free(records[committed].data);
+        committed++;
+    }
+
+    // Records after a failed one stay pending in order, the next loop() retries them.
+    memmove(records, records + committed, (recordCount - committed) * sizeof(PendingRecord));
+    recordCount -= committed;
+    if (recordCount > 0)
+    {
+        Serial.println("MszWriteBehindStore::flush - failed to commit " + String(records[0].path) + ", keeping " + String(recordCount) + " records pending");
+        firstStagedMillis = millis();
+        lastStagedMillis = firstStagedMillis;
+    }
+    return recordCount == 0;
+}
+
+int MszWriteBehindStore::getPendingCount()
+{
+    return recordCount;
+}
+
+MszWriteBehindStore::PendingRecord *MszWriteBehindStore::stage(const char *path)
+{
+    if (strlen(path) > WRITE_BEHIND_MAX_PATH_LENGTH)
+    {
+        Serial.println("MszWriteBehindStore::stage - path too long: " + String(path));
+        return NULL;
+    }
+
+    uint32_t nowMillis = millis();
+    PendingRecord *record = findRecord(path);
+    if (record == NULL)
+    {
+        if (recordCount >= WRITE_BEHIND_MAX_RECORDS && !flush())
+        {
+            Serial.println("MszWriteBehindStore::stage - no room for " + String(path));
+            return NULL;
+        }
+        if (recordCount == 0)
+        {
+            firstStagedMillis = nowMillis;
+        }
+        record = &records[recordCount++];
+        strcpy(record->path, path);
+        record->data = NULL;
+        record->length = 0;
+        record->remove = false;
+    }
+    lastStagedMillis = nowMillis;
+    return record;
+}
+
+MszWriteBehindStore::PendingRecord *MszWriteBehindStore::findRecord(const char *path)
+{
+    for (int i = 0; i < recordCount; i++)
+    {
+        if (strcmp(records[i].path, path) == 0)
+        {
+            return &records[i];
+        }
+    }
+    return NULL;
+}
+
+bool MszWriteBehindStore::commitRecord(const PendingRecord &record)
+{
+    MszFileSystem *files = getFileSystem();
+    if (files == NULL)
+    {
+        Serial.println("MszWriteBehindStore::commitRecord - failed to mount file system");
+        return false;
+    }
+
+    MszKvStore *store = getKvStore();
+    if (store == NULL)
+    {
+        Serial.println("MszWriteBehindStore::commitRecord - no key-value store for " + String(record.path));
+        return false;
+    }
+
+    bool committed = record.remove ? store->remove(record.path) : store->put(record.path, record.data, record.length);
+    if (!committed)
+    {
+        Serial.println("MszWriteBehindStore::commitRecord - failed to commit " + String(record.path));
+        return false;
+    }
+    // A file of the same path is from before the store and superseded now.
+    return !files->exists(record.path) || files->remove(record.path);
+}
+
+MszKvStore *MszWriteBehindStore::getKvStore()
+{
+    // Mounting first, a migration creates the store and puts the records of SPIFFS into it before anything reads it.
+    MszFileSystem *files = getFileSystem();
+    if (kvStore == NULL && !createKvStore(files))
+    {
+        Serial.println("MszWriteBehindStore::getKvStore - no partition and no file system for the store");
+        return NULL;
+    }
+    if (!kvStore->isMounted())
+    {
+        if (!kvStore->mount())
+        {
+            return NULL;
+        }
+#if defined(ESP32)
+        restoreMigratedRecords(kvStore);
+#endif
+    }
+    return kvStore;
+}
+
+bool MszWriteBehindStore::createKvStore(MszFileSystem *files)
+{
+    // The partition if there is one, an image file on files otherwise. Without files only the partition will do.
+#if defined(ESP32)
+    MszPartitionFlash *partitionFlash = new MszPartitionFlash(WRITE_BEHIND_KV_PARTITION);
+    if (partitionFlash->isAvailable())
+    {
+        kvFlash = partitionFlash;
+    }
+    else
+    {
+        delete partitionFlash;
+    }
+#endif
+    if (kvFlash == NULL)
+    {
+        if (files == NULL)
+        {
+            return false;
+        }
+        MszFileFlash *fileFlash = new MszFileFlash(*files, WRITE_BEHIND_KV_IMAGE_PATH, WRITE_BEHIND_KV_IMAGE_PAGE_SIZE, WRITE_BEHIND_KV_IMAGE_PAGES);
+        if (!fileFlash->begin())
+        {
+            Serial.println("MszWriteBehindStore::createKvStore - failed to create the store image");
+            delete fileFlash;
+            return false;
+        }
+        kvFlash = fileFlash;
+    }
+    kvStore = new MszKvStore(*kvFlash);
+    return true;
+}
+
+MszFileSystem *MszWriteBehindStore::getFileSystem()
+{
+    if (fileSystem == NULL)
+    {
+        fileSystem = mountFileSystem();
+    }
+    return fileSystem;
+}
+
+MszFileSystem *MszWriteBehindStore::mountFileSystem()
+{
+    if (primaryFileSystem.begin())
+    {
+        return &primaryFileSystem;
+    }
+
+#if defined(ESP32)
+    if (legacyFileSystem.begin())
+    {
+        return migrateFileSystem();
+    }
+#endif
+
+    Serial.println("MszWriteBehindStore::mountFileSystem - failed to mount " + String(primaryFileSystem.getName()) + ", formatting...");
+    if (!primaryFileSystem.format() || !primaryFileSystem.begin())
+    {
+        Serial.println("MszWriteBehindStore::mountFileSystem - failed to mount file system, aborting...");
+        return NULL;
+    }
+    return &primaryFileSystem;
+}
+
+#if defined(ESP32)
+MszFileSystem *MszWriteBehindStore::migrateFileSystem()
+{
+    Serial.println("MszWriteBehindStore::migrateFileSystem - enter");
+
+    struct MigratedRecord
+    {
+        String path;
+        uint8_t *data;
+        size_t length;
+    };
+    std::vector<MigratedRecord> migrated;
+    size_t totalLength = 0;
+    bool fits = true;
+    auto keep = [&migrated, &totalLength, &fits](const String &path, size_t length) -> uint8_t * {
+        totalLength += length;
+        uint8_t *data = (totalLength <= WRITE_BEHIND_MIGRATION_MAX_BYTES) ? (uint8_t *)malloc((length > 0) ? length : 1) : NULL;
+        if (data == NULL || path.length() > WRITE_BEHIND_MAX_PATH_LENGTH)
+        {
+            free(data);
+            fits = false;
+            return NULL;
+        }
+        migrated.push_back({path, data, length});
+        return data;
+    };
+
+    // The store image first, its records supersede files of the same path.
+    if (legacyFileSystem.getSize(WRITE_BEHIND_KV_IMAGE_PATH) == WRITE_BEHIND_KV_IMAGE_PAGE_SIZE * WRITE_BEHIND_KV_IMAGE_PAGES)
+    {
+        MszFileFlash legacyFlash(legacyFileSystem, WRITE_BEHIND_KV_IMAGE_PATH, WRITE_BEHIND_KV_IMAGE_PAGE_SIZE, WRITE_BEHIND_KV_IMAGE_PAGES);
+        MszKvStore *legacyStore = new MszKvStore(legacyFlash);
+        if (legacyStore->mount())
+        {
+            std::vector<String> keys;
+            legacyStore->forEachKey("", [&keys](const char *key) {
+                keys.push_back(String(key));
+            });
+            for (size_t i = 0; i < keys.size() && fits; i++)
+            {
+                size_t length = legacyStore->getLength(keys[i].c_str());
+                uint8_t *data = keep(keys[i], length);
+                fits = (data != NULL) && legacyStore->get(keys[i].c_str(), data, length) == length;
+            }
+        }
+        delete legacyStore;
+    }
+
+    std::vector<String> paths;
+    legacyFileSystem.forEachFile([&paths](const char *path) {
+        paths.push_back(String(path));
+    });
+    for (size_t i = 0; i < paths.size() && fits; i++)
+    {
+        bool superseded = paths[i] == WRITE_BEHIND_KV_IMAGE_PATH;
+        for (size_t j = 0; j < migrated.size() && !superseded; j++)
+        {
+            superseded = migrated[j].path == paths[i];
+        }
+        if (!superseded)
+        {
+            size_t length = legacyFileSystem.getSize(paths[i].c_str());
+            uint8_t *data = keep(paths[i], length);
+            fits = (data != NULL) && legacyFileSystem.read(paths[i].c_str(), 0, data, length) == length;
+        }
+    }
+
+    MszFileSystem *mounted = NULL;
+    if (!fits)
+    {
+        // Nothing is lost this way, the next start tries again.
+        Serial.println("MszWriteBehindStore::migrateFileSystem - records do not fit into RAM, staying on SPIFFS");
+        mounted = &legacyFileSystem;
+    }
+    else
+    {
+        // Formatting erases the only copy on flash, so the records are kept outside of the partition first: in the
+        // store if it has a partition of its own, in NVS otherwise until the store on LittleFS took them.
+        bool kept = true;
+        bool partitionStore = createKvStore(NULL) && kvStore->mount();
+        if (partitionStore)
+        {
+            for (size_t i = 0; i < migrated.size() && kept; i++)
+            {
+                kept = kvStore->put(migrated[i].path.c_str(), migrated[i].data, migrated[i].length);
+            }
+        }
+        else
+        {
+            // The count is written last, records of an interrupted attempt are never restored.
+            Preferences staged;
+            kept = staged.begin(WRITE_BEHIND_MIGRATION_NAMESPACE, false) && staged.clear();
+            for (size_t i = 0; i < migrated.size() && kept; i++)
+            {
+                String index = String((unsigned int)i);
+                kept = staged.putString(("p" + index).c_str(), migrated[i].path) == migrated[i].path.length() &&
+                       (migrated[i].length == 0 || staged.putBytes(("d" + index).c_str(), migrated[i].data, migrated[i].length) == migrated[i].length);
+            }
+            kept = kept && staged.putUInt("count", (uint32_t)migrated.size()) > 0;
+            if (!kept)
+            {
+                staged.clear();
+            }
+            staged.end();
+        }
+
+        if (!kept)
+        {
+            // Nothing is lost this way either, the next start tries again.
+            Serial.println("MszWriteBehindStore::migrateFileSystem - failed to keep the records outside of SPIFFS, staying on SPIFFS");
+            mounted = &legacyFileSystem;
+        }
+        else
+        {
+            Serial.println("MszWriteBehindStore::migrateFileSystem - formatting LittleFS, moving " + String(migrated.size()) + " records");
+            legacyFileSystem.end();
+            if (primaryFileSystem.format() && primaryFileSystem.begin())
+            {
+                mounted = &primaryFileSystem;
+                fileSystem = mounted;
+                // Mounting the store on LittleFS moves the staged records into it.
+                if (!partitionStore && getKvStore() == NULL)
+                {
+                    Serial.println("MszWriteBehindStore::migrateFileSystem - failed to create the store, records stay staged");
+                }
+            }
+            else
+            {
+                Serial.println("MszWriteBehindStore::migrateFileSystem - failed to format LittleFS, aborting...");
+            }
+        }
+    }
+
+    for (size_t i = 0; i < migrated.size(); i++)
+    {
+        free(migrated[i].data);
+    }
+    Serial.println("MszWriteBehindStore::migrateFileSystem - exit");
+    return mounted;
+}
+
+void MszWriteBehindStore::restoreMigratedRecords(MszKvStore *store)
+{
+    Preferences staged;
+    if (!staged.begin(WRITE_BEHIND_MIGRATION_NAMESPACE, false))
+    {
+        return;
+    }
+    uint32_t count = staged.getUInt("count", 0);
+    bool restored = true;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        String pathKey = "p" + String(i);
+        String dataKey = "d" + String(i);
+        String path = staged.getString(pathKey.c_str());
+        if (path.length() == 0)
+        {
+            continue;
+        }
+
+        // The store was empty when the records were staged, a record it has now is newer than the staged one.
+        bool moved = store->contains(path.c_str());
+        if (!moved)
+        {
+            size_t length = staged.getBytesLength(dataKey.c_str());
+            uint8_t *data = (uint8_t *)malloc((length > 0) ? length : 1);
+            moved = data != NULL && staged.getBytes(dataKey.c_str(), data, length) == length && store->put(path.c_str(), data, length);
+            free(data);
+        }
+        if (moved)
+        {
+            staged.remove(pathKey.c_str());
+            staged.remove(dataKey.c_str());
+        }
+        else
+        {
+            Serial.println("MszWriteBehindStore::restoreMigratedRecords - failed to move " + path + ", retrying on the next start");
+            restored = false;
+        }
+    }
+    if (count > 0 && restored)
+    {
+        Serial.println("MszWriteBehindStore::restoreMigratedRecords - moved " + String(count) + " records from NVS");
+        staged.clear();
+    }
+    staged.end();
+}
+#endif // ESP32
@@ -0,0 +1,131 @@
+#ifndef MSZ_ASSETWRITEBEHINDSTORE_H
+#define MSZ_ASSETWRITEBEHINDSTORE_H
+
+#include <Arduino.h>
+#include <functional>
+#include <AssetFileSystem.h>
+#include <AssetKvStore.h>
+#include <AssetRecordCodec.h>
+
+// Records with updates pending at once, staging another one commits the pending ones right away.
+#ifndef WRITE_BEHIND_MAX_RECORDS
+#define WRITE_BEHIND_MAX_RECORDS 40
+#endif
+// Pending updates are committed once no further update came in for this long...
+#ifndef WRITE_BEHIND_DEBOUNCE_MS
+#define WRITE_BEHIND_DEBOUNCE_MS 2000
+#endif
+// ...or at the latest this long after the first of them, so a steady stream of updates still reaches the flash.
+#ifndef WRITE_BEHIND_MAX_DELAY_MS
+#define WRITE_BEHIND_MAX_DELAY_MS 10000
+#endif
+#define WRITE_BEHIND_MAX_PATH_LENGTH KV_MAX_KEY_LENGTH
+// Data partition holding the key-value store, without one it lives in an image file on the file system.
+#define WRITE_BEHIND_KV_PARTITION "kvstore"
+#define WRITE_BEHIND_KV_IMAGE_PATH "/kvstore"
+#define WRITE_BEHIND_KV_IMAGE_PAGE_SIZE 4096
+#define WRITE_BEHIND_KV_IMAGE_PAGES 32
+// RAM the records of a SPIFFS from former firmware may take while they are moved to LittleFS, larger ones stay on SPIFFS.
+#ifndef WRITE_BEHIND_MIGRATION_MAX_BYTES
+#define WRITE_BEHIND_MIGRATION_MAX_BYTES 32768
+#endif
+// NVS namespace keeping the records of a migration while LittleFS is formatted, if the store has no partition.
+#define WRITE_BEHIND_MIGRATION_NAMESPACE "mszmigration"
+// Directory of the host holding the files in native builds.
+#ifndef WRITE_BEHIND_POSIX_ROOT
+#define WRITE_BEHIND_POSIX_ROOT "data"
+#endif
+
+/// @class MszWriteBehindStore
+/// @brief Write-behind layer between the repositories and flash, taking flash writes off the request path.
+/// @details Repositories stage the whole new content of a record by its path, updates of the same record within the
+///          debounce window replace each other in RAM. loop() commits all pending records in one batch, in the order
+///          they were first staged, and keeps them pending from the first failure on. Records are committed to a
+///          MszKvStore, so an update is one CRC-checked append instead of rewriting a file. Reads see staged content
+///          first, then the store, then files of the same path written before the store existed; committing a path
+///          removes its old file. Callers needing durability, e.g. before a restart, call flush().
+///          The store owns the file system: LittleFS on the devices, a directory in native builds. On ESP32, a SPIFFS
+///          left by former firmware in the same partition is migrated once: its records are read into RAM and put
+///          into the store if it has a partition of its own, or staged in NVS otherwise, before the partition is
+///          formatted with LittleFS. Staged records move into the store when it is mounted and stay in NVS until
+///          they did, so a failed put is retried on the next start.
+class MszWriteBehindStore
+{
+public:
+    // Stages length bytes as the new content of the record at path, replacing what is pending for it.
+    static bool write(const char *path, const void *data, size_t length);
+    // Stages removing the record at path, committed after the records staged before.
+    static bool remove(const char *path);
+
+    // Reads up to length bytes of the record at path, staged content first. Returns the bytes read, 0 if there is none.
+    static size_t read(const char *path, void *data, size_t length);
+    static bool exists(const char *path);
+    // Calls visitor for the paths of all records starting with prefix, staged or committed to the store.
+    static void forEachPath(const char *prefix, std::function<void(const char *path)> visitor);
+
+    // Stages a struct with a codec from MSZ_RECORD_DEFINE in its compact encoding.
+    template <typename T>
+    static bool writeRecord(const char *path, const T &value)
+    {
+        uint8_t buffer[MSZ_RECORD_BUFFER_SIZE(T)];
+        size_t length = encodeRecord(value, buffer, sizeof(buffer));
+        return length > 0 && write(path, buffer, length);
+    }
+
+    // Reads a struct staged by writeRecord(), fields not stored keep the values of value. A raw struct dump from
+    // before the encoding existed is staged again encoded, so stored records migrate the first time they are read.
+    template <typename T>
+    static bool readRecord(const char *path, T &value)
+    {
+        uint8_t buffer[MSZ_RECORD_BUFFER_SIZE(T)];
+        size_t length = read(path, buffer, sizeof(buffer));
+        MszRecordFormat format = decodeRecord(buffer, length, value);
+        if (format == MszRecordFormat::Raw)
+        {
+            Serial.println("MszWriteBehindStore::readRecord - migrating raw record " + String(path));
+            writeRecord(path, value);
+        }
+        return format != MszRecordFormat::Invalid;
+    }
+
+    // Background step, commits the pending records once the debounce window or the maximum delay has passed.
+    static void loop();
+    // Commits all pending records now, returns false if one failed, it and the ones after it stay pending.
+    static bool flush();
+
+    static int getPendingCount();
+
+    // Mounts the file system on first use, migrating SPIFFS if needed. NULL if none can be mounted.
+    static MszFileSystem *getFileSystem();
+
+private:
+    struct PendingRecord
+    {
+        char path[WRITE_BEHIND_MAX_PATH_LENGTH + 1];
+        uint8_t *data;
+        size_t length;
+        bool remove;
+    };
+
+    // Kept in the order the records were first staged.
+    static PendingRecord records[WRITE_BEHIND_MAX_RECORDS];
+    static int recordCount;
+    static uint32_t firstStagedMillis;
+    static uint32_t lastStagedMillis;
+    static MszFlash *kvFlash;
+    static MszKvStore *kvStore;
+    static MszFileSystem *fileSystem;
+
+    static PendingRecord *stage(const char *path);
+    static PendingRecord *findRecord(const char *path);
+    static bool commitRecord(const PendingRecord &record);
+    static MszKvStore *getKvStore();
+    static bool createKvStore(MszFileSystem *files);
+    static MszFileSystem *mountFileSystem();
+#if defined(ESP32)
+    static MszFileSystem *migrateFileSystem();
+    static void restoreMigratedRecords(MszKvStore *store);
+#endif
+};
+
+#endif // MSZ_ASSETWRITEBEHINDSTORE_H
@@ -0,0 +1,129 @@
+#include "AssetClockDiscipline.h"
+
+bool MszClockDiscipline::synchronized = false;
+uint32_t MszClockDiscipline::anchorLocalMillis = 0;
+uint64_t MszClockDiscipline::anchorUnixMillis = 0;
+int32_t MszClockDiscipline::slewMillis = 0;
+float MszClockDiscipline::driftPpm = 0.0f;
+uint32_t MszClockDiscipline::lastBeaconLocalMillis = 0;
+int32_t MszClockDiscipline::lastOffsetMillis = 0;
+
+void MszClockDiscipline::applyBeacon(uint64_t unixMillis)
+{
+    if (!synchronized)
+    {
+        step(unixMillis);
+        return;
+    }
+
+    uint32_t localMillis = millis();
+    uint32_t anchorElapsed = localMillis - anchorLocalMillis;
+    int64_t offset = (int64_t)(unixMillis - getUnixMillisAt(localMillis));
+    if (offset > (int64_t)STEP_THRESHOLD_MS || offset < -(int64_t)STEP_THRESHOLD_MS)
+    {
+        Serial.println("MszClockDiscipline::applyBeacon - offset " + String((long)offset) + "ms, stepping");
+        step(unixMillis);
+        lastOffsetMillis = (int32_t)(offset > INT32_MAX ? INT32_MAX : (offset < INT32_MIN ? INT32_MIN : offset));
+        return;
+    }
+    lastOffsetMillis = (int32_t)offset;
+
+    // What is left after the slew still pending from the previous beacon is the drift since that beacon.
+    uint32_t beaconInterval = localMillis - lastBeaconLocalMillis;
+    int32_t pendingSlew = slewMillis - getAppliedSlew(anchorElapsed);
+    if (beaconInterval >= MIN_DRIFT_INTERVAL_MS)
+    {
+        driftPpm += DRIFT_GAIN * (float)(offset - pendingSlew) * 1000000.0f / (float)beaconInterval;
+        if (driftPpm > MAX_DRIFT_PPM)
+        {
+            driftPpm = MAX_DRIFT_PPM;
+        }
+        else if (driftPpm < -MAX_DRIFT_PPM)
+        {
+            driftPpm = -MAX_DRIFT_PPM;
+        }
+    }
+
+    // Continue from the current time and slew in the whole offset, it includes the pending slew.
+    anchorUnixMillis = getUnixMillisAt(localMillis);
+    anchorLocalMillis = localMillis;
+    slewMillis = (int32_t)offset;
+    lastBeaconLocalMillis = localMillis;
+}
+
+void MszClockDiscipline::step(uint64_t unixMillis)
+{
+    uint32_t localMillis = millis();
+    anchorUnixMillis = unixMillis;
+    anchorLocalMillis = localMillis;
+    slewMillis = 0;
+    lastBeaconLocalMillis = localMillis;
+    setTime((time_t)(unixMillis / 1000));
+
+    if (!synchronized)
+    {
+        synchronized = true;
+        setSyncProvider(MszClockDiscipline::getUnixTime);
+        setSyncInterval(SYNC_INTERVAL_SECONDS);
+    }
+}
+
+bool MszClockDiscipline::isSynchronized()
+{
+    return synchronized;
+}
+
+uint64_t MszClockDiscipline::getUnixMillis()
+{
+    uint32_t localMillis = millis();
+    if (localMillis - anchorLocalMillis >= REANCHOR_INTERVAL_MS)
+    {
+        reanchor(localMillis);
+    }
+    return getUnixMillisAt(localMillis);
+}
+
+time_t MszClockDiscipline::getUnixTime()
+{
+    return (time_t)(getUnixMillis() / 1000);
+}
+
+float MszClockDiscipline::getDriftPpm()
+{
+    return driftPpm;
+}
+
+int32_t MszClockDiscipline::getLastOffsetMillis()
+{
+    return lastOffsetMillis;
+}
+
+uint64_t MszClockDiscipline::getUnixMillisAt(uint32_t localMillis)
+{
+    uint32_t elapsed = localMillis - anchorLocalMillis;
+    int64_t driftCorrection = (int64_t)((float)elapsed * driftPpm / 1000000.0f);
+    return anchorUnixMillis + elapsed + driftCorrection + getAppliedSlew(elapsed);
+}
+
+int32_t MszClockDiscipline::getAppliedSlew(uint32_t elapsedMillis)
+{
+    int32_t maxSlew = (int32_t)(((uint64_t)elapsedMillis * SLEW_RATE_PPM) / 1000000);
+    if (slewMillis > maxSlew)
+    {
+        return maxSlew;
+    }
+    if (slewMillis < -maxSlew)
+    {
+        return -maxSlew;
+    }
+    return slewMillis;
+}
+
+void MszClockDiscipline::reanchor(uint32_t localMillis)
+{
+    // millis() wraps after 49 days, move the anchor forward long before and keep the slew still pending.
+    uint64_t unixMillis = getUnixMillisAt(localMillis);
+    slewMillis -= getAppliedSlew(localMillis - anchorLocalMillis);
+    anchorUnixMillis = unixMillis;
+    anchorLocalMillis = localMillis;
+}
@@ -0,0 +1,48 @@
+#ifndef MSZ_ASSETCLOCKDISCIPLINE_H
+#define MSZ_ASSETCLOCKDISCIPLINE_H
+
+#include <Arduino.h>
+#include <TimeLib.h>
+
+/// @class MszClockDiscipline
+/// @brief Keeps the time of an asset in line with time beacons, in between beacons it corrects the drift of millis().
+/// @details The time is an anchor (unix time at a millis() value) plus the elapsed millis corrected by the estimated
+///          drift. The first beacon and beacons further off than STEP_THRESHOLD_MS step the time. All others are
+///          slewed in at most SLEW_RATE_PPM, so the time never jumps and never runs backwards. Between two beacons
+///          at least MIN_DRIFT_INTERVAL_MS apart, the offset left after the slew estimates the drift.
+///          Once synchronized, the clock is TimeLib's sync provider, so now() follows it everywhere.
+class MszClockDiscipline
+{
+public:
+    static void applyBeacon(uint64_t unixMillis);
+    static void step(uint64_t unixMillis);
+
+    static bool isSynchronized();
+    static uint64_t getUnixMillis();
+    static time_t getUnixTime();
+    static float getDriftPpm();
+    static int32_t getLastOffsetMillis();
+
+    static const uint32_t STEP_THRESHOLD_MS = 2000;
+    static const uint32_t SLEW_RATE_PPM = 5000;
+    static const uint32_t MIN_DRIFT_INTERVAL_MS = 60000;
+    static const uint32_t REANCHOR_INTERVAL_MS = 86400000;
+    static const int SYNC_INTERVAL_SECONDS = 10;
+    static constexpr float MAX_DRIFT_PPM = 500.0f;
+    static constexpr float DRIFT_GAIN = 0.5f;
+
+private:
+    static bool synchronized;
+    static uint32_t anchorLocalMillis;
+    static uint64_t anchorUnixMillis;
+    static int32_t slewMillis;
+    static float driftPpm;
+    static uint32_t lastBeaconLocalMillis;
+    static int32_t lastOffsetMillis;
+
+    static uint64_t getUnixMillisAt(uint32_t localMillis);
+    static int32_t getAppliedSlew(uint32_t elapsedMillis);
+    static void reanchor(uint32_t localMillis);
+};
+
+#endif // MSZ_ASSETCLOCKDISCIPLINE_H
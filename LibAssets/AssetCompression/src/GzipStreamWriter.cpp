@@ -0,0 +1,319 @@
+#include "GzipStreamWriter.h"
+
+// Base values and extra bits of the deflate length codes 257..285 (RFC 1951, section 3.2.5).
+static const uint16_t LENGTH_BASE[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const uint8_t LENGTH_EXTRA[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+
+// Base values and extra bits of the distance codes needed for a window of up to 1 KB.
+static const uint16_t DISTANCE_BASE[20] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769};
+static const uint8_t DISTANCE_EXTRA[20] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8};
+
+// CRC-32 lookup table processing one nibble at a time to keep the table small.
+static const uint32_t CRC_TABLE[16] = {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C};
+
+MszGzipStreamWriter::MszGzipStreamWriter(Print &output) : output(output)
+{
+    for (int i = 0; i < HASH_SIZE; i++)
+    {
+        this->head[i] = NO_POSITION;
+    }
+    for (int i = 0; i < WINDOW_SIZE; i++)
+    {
+        this->prev[i] = NO_POSITION;
+    }
+}
+
+size_t MszGzipStreamWriter::write(uint8_t c)
+{
+    return this->write(&c, 1);
+}
+
+size_t MszGzipStreamWriter::write(const uint8_t *buffer, size_t size)
+{
+    if (this->finished)
+    {
+        return 0;
+    }
+    this->writeHeader();
+
+    this->updateCrc(buffer, size);
+    this->bytesIn += size;
+
+    size_t remaining = size;
+    while (remaining > 0)
+    {
+        size_t toCopy = (2 * WINDOW_SIZE) - this->windowFill;
+        if (toCopy > remaining)
+        {
+            toCopy = remaining;
+        }
+        memcpy(this->window + this->windowFill, buffer, toCopy);
+        this->windowFill += toCopy;
+        buffer += toCopy;
+        remaining -= toCopy;
+
+        if (this->windowFill == (2 * WINDOW_SIZE))
+        {
+            this->compress(false);
+            this->slideWindow();
+        }
+    }
+    return size;
+}
+
+void MszGzipStreamWriter::finish()
+{
+    if (this->finished)
+    {
+        return;
+    }
+    this->writeHeader();
+    this->finished = true;
+
+    // Compress the remaining input, end the content block and append an empty final block.
+    this->compress(true);
+    this->writeSymbol(256);
+    this->writeBits(1, 1);
+    this->writeBits(1, 2);
+    this->writeSymbol(256);
+    if (this->bitCount > 0)
+    {
+        this->writeByte(this->bitBuffer & 0xFF);
+        this->bitBuffer = 0;
+        this->bitCount = 0;
+    }
+
+    // gzip trailer: CRC-32 and input size, both little endian.
+    uint32_t finalCrc = this->crc ^ 0xFFFFFFFF;
+    uint32_t inputSize = (uint32_t)this->bytesIn;
+    for (int i = 0; i < 4; i++)
+    {
+        this->writeByte((finalCrc >> (8 * i)) & 0xFF);
+    }
+    for (int i = 0; i < 4; i++)
+    {
+        this->writeByte((inputSize >> (8 * i)) & 0xFF);
+    }
+    this->flushOutput();
+}
+
+void MszGzipStreamWriter::writeHeader()
+{
+    // Written on first use such that the writer can be created before the response headers are sent.
+    if (this->headerWritten)
+    {
+        return;
+    }
+    this->headerWritten = true;
+
+    // gzip member header: magic, deflate, no flags, no modification time, unknown OS.
+    const uint8_t gzipHeader[10] = {0x1F, 0x8B, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF};
+    for (size_t i = 0; i < sizeof(gzipHeader); i++)
+    {
+        this->writeByte(gzipHeader[i]);
+    }
+
+    // All content goes into one non-final block with fixed Huffman codes, finish() appends an empty final block.
+    this->writeBits(0, 1);
+    this->writeBits(1, 2);
+}
+
+void MszGzipStreamWriter::compress(bool flush)
+{
+    // Without flush, keep enough lookahead such that every match can reach its maximum length.
+    int limit = flush ? this->windowFill : this->windowFill - MAX_MATCH;
+    while (this->windowPos < limit)
+    {
+        int matchDistance = 0;
+        int matchLength = this->findMatch(this->windowPos, matchDistance);
+        if (matchLength >= MIN_MATCH)
+        {
+            this->emitMatch(matchLength, matchDistance);
+            for (int i = 0; i < matchLength; i++)
+            {
+                this->insertHash(this->windowPos + i);
+            }
+            this->windowPos += matchLength;
+        }
+        else
+        {
+            this->emitLiteral(this->window[this->windowPos]);
+            this->insertHash(this->windowPos);
+            this->windowPos++;
+        }
+    }
+}
+
+void MszGzipStreamWriter::slideWindow()
+{
+    memmove(this->window, this->window + WINDOW_SIZE, WINDOW_SIZE);
+    this->windowFill -= WINDOW_SIZE;
+    this->windowPos -= WINDOW_SIZE;
+
+    for (int i = 0; i < HASH_SIZE; i++)
+    {
+        this->head[i] = (this->head[i] == NO_POSITION || this->head[i] < WINDOW_SIZE) ? NO_POSITION : this->head[i] - WINDOW_SIZE;
+    }
+    for (int i = 0; i < WINDOW_SIZE; i++)
+    {
+        this->prev[i] = (this->prev[i] == NO_POSITION || this->prev[i] < WINDOW_SIZE) ? NO_POSITION : this->prev[i] - WINDOW_SIZE;
+    }
+}
+
+void MszGzipStreamWriter::insertHash(int pos)
+{
+    if (pos + MIN_MATCH > this->windowFill)
+    {
+        return;
+    }
+    int hash = ((this->window[pos] << 6) ^ (this->window[pos + 1] << 3) ^ this->window[pos + 2]) & (HASH_SIZE - 1);
+    this->prev[pos & (WINDOW_SIZE - 1)] = this->head[hash];
+    this->head[hash] = pos;
+}
+
+int MszGzipStreamWriter::findMatch(int pos, int &matchDistance)
+{
+    if (pos + MIN_MATCH > this->windowFill)
+    {
+        return 0;
+    }
+
+    int maxLength = this->windowFill - pos;
+    if (maxLength > MAX_MATCH)
+    {
+        maxLength = MAX_MATCH;
+    }
+
+    int hash = ((this->window[pos] << 6) ^ (this->window[pos + 1] << 3) ^ this->window[pos + 2]) & (HASH_SIZE - 1);
+    int candidate = this->head[hash];
+    int bestLength = 0;
+    for (int chain = 0; chain < MAX_CHAIN && candidate != NO_POSITION; chain++)
+    {
+        if (candidate >= pos || (pos - candidate) > WINDOW_SIZE)
+        {
+            break;
+        }
+
+        int length = 0;
+        while (length < maxLength && this->window[candidate + length] == this->window[pos + length])
+        {
+            length++;
+        }
+        if (length > bestLength)
+        {
+            bestLength = length;
+            matchDistance = pos - candidate;
+            if (length == maxLength)
+            {
+                break;
+            }
+        }
+
+        // Chains only ever point backwards, anything else is a stale entry from an overwritten slot.
+        int next = this->prev[candidate & (WINDOW_SIZE - 1)];
+        if (next == NO_POSITION || next >= candidate)
+        {
+            break;
+        }
+        candidate = next;
+    }
+    return bestLength;
+}
+
+void MszGzipStreamWriter::emitLiteral(uint8_t literal)
+{
+    this->writeSymbol(literal);
+}
+
+void MszGzipStreamWriter::emitMatch(int length, int distance)
+{
+    int lengthCode = 28;
+    while (LENGTH_BASE[lengthCode] > length)
+    {
+        lengthCode--;
+    }
+    this->writeSymbol(257 + lengthCode);
+    this->writeBits(length - LENGTH_BASE[lengthCode], LENGTH_EXTRA[lengthCode]);
+
+    int distanceCode = 19;
+    while (DISTANCE_BASE[distanceCode] > distance)
+    {
+        distanceCode--;
+    }
+    this->writeHuffmanCode(distanceCode, 5);
+    this->writeBits(distance - DISTANCE_BASE[distanceCode], DISTANCE_EXTRA[distanceCode]);
+}
+
+void MszGzipStreamWriter::writeSymbol(int symbol)
+{
+    // Fixed Huffman code of the literal/length alphabet (RFC 1951, section 3.2.6).
+    if (symbol <= 143)
+    {
+        this->writeHuffmanCode(0x30 + symbol, 8);
+    }
+    else if (symbol <= 255)
+    {
+        this->writeHuffmanCode(0x190 + (symbol - 144), 9);
+    }
+    else if (symbol <= 279)
+    {
+        this->writeHuffmanCode(symbol - 256, 7);
+    }
+    else
+    {
+        this->writeHuffmanCode(0xC0 + (symbol - 280), 8);
+    }
+}
+
+void MszGzipStreamWriter::writeHuffmanCode(uint32_t code, int length)
+{
+    // Huffman codes are packed starting with their most significant bit.
+    uint32_t reversed = 0;
+    for (int i = 0; i < length; i++)
+    {
+        reversed = (reversed << 1) | ((code >> i) & 1);
+    }
+    this->writeBits(reversed, length);
+}
+
+void MszGzipStreamWriter::writeBits(uint32_t value, int count)
+{
+    this->bitBuffer |= (value << this->bitCount);
+    this->bitCount += count;
+    while (this->bitCount >= 8)
+    {
+        this->writeByte(this->bitBuffer & 0xFF);
+        this->bitBuffer >>= 8;
+        this->bitCount -= 8;
+    }
+}
+
+void MszGzipStreamWriter::writeByte(uint8_t value)
+{
+    this->outputBuffer[this->outputLength++] = value;
+    if (this->outputLength >= OUTPUT_BUFFER_SIZE)
+    {
+        this->flushOutput();
+    }
+}
+
+void MszGzipStreamWriter::flushOutput()
+{
+    if (this->outputLength > 0)
+    {
+        this->output.write(this->outputBuffer, this->outputLength);
+        this->bytesOut += this->outputLength;
+        this->outputLength = 0;
+    }
+}
+
+void MszGzipStreamWriter::updateCrc(const uint8_t *data, size_t length)
+{
+    for (size_t i = 0; i < length; i++)
+    {
+        this->crc = CRC_TABLE[(this->crc ^ data[i]) & 0x0F] ^ (this->crc >> 4);
+        this->crc = CRC_TABLE[(this->crc ^ (data[i] >> 4)) & 0x0F] ^ (this->crc >> 4);
+    }
+}
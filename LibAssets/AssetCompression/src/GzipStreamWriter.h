@@ -0,0 +1,70 @@
+#ifndef MSZ_GZIPSTREAMWRITER_H
+#define MSZ_GZIPSTREAMWRITER_H
+
+#include <Arduino.h>
+
+/// @class MszGzipStreamWriter
+/// @brief Print implementation compressing everything written to it into a gzip stream.
+/// @details Deflate with fixed Huffman codes and a 1 KB sliding window. The whole state lives in this object
+///          (4720 bytes on the ESP32 and ESP8266), independent of how much data is compressed, so allocate it on
+///          the heap rather than the stack. Call finish() once all content is written to emit the gzip trailer.
+class MszGzipStreamWriter : public Print
+{
+public:
+    MszGzipStreamWriter(Print &output);
+
+    virtual size_t write(uint8_t c) override;
+    virtual size_t write(const uint8_t *buffer, size_t size) override;
+
+    void finish();
+
+    size_t getBytesIn() const { return this->bytesIn; }
+    size_t getBytesOut() const { return this->bytesOut; }
+
+    static const int WINDOW_BITS = 10;
+    static const int WINDOW_SIZE = (1 << WINDOW_BITS);
+    static const int HASH_BITS = 8;
+    static const int HASH_SIZE = (1 << HASH_BITS);
+    static const int MIN_MATCH = 3;
+    static const int MAX_MATCH = 258;
+    static const int MAX_CHAIN = 8;
+    static const int OUTPUT_BUFFER_SIZE = 64;
+
+private:
+    static const uint16_t NO_POSITION = 0xFFFF;
+
+    Print &output;
+    bool headerWritten = false;
+    bool finished = false;
+    uint32_t crc = 0xFFFFFFFF;
+    size_t bytesIn = 0;
+    size_t bytesOut = 0;
+
+    // Sliding window: the first half is history, the second half is filled with new input.
+    uint8_t window[2 * WINDOW_SIZE];
+    int windowFill = 0;
+    int windowPos = 0;
+    uint16_t head[HASH_SIZE];
+    uint16_t prev[WINDOW_SIZE];
+
+    uint32_t bitBuffer = 0;
+    int bitCount = 0;
+    uint8_t outputBuffer[OUTPUT_BUFFER_SIZE];
+    int outputLength = 0;
+
+    void writeHeader();
+    void compress(bool flush);
+    void slideWindow();
+    void insertHash(int pos);
+    int findMatch(int pos, int &matchDistance);
+    void emitLiteral(uint8_t literal);
+    void emitMatch(int length, int distance);
+    void writeSymbol(int symbol);
+    void writeBits(uint32_t value, int count);
+    void writeHuffmanCode(uint32_t code, int length);
+    void writeByte(uint8_t value);
+    void flushOutput();
+    void updateCrc(const uint8_t *data, size_t length);
+};
+
+#endif // MSZ_GZIPSTREAMWRITER_H
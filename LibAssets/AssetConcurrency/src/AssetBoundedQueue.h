@@ -0,0 +1,61 @@
+#ifndef MSZ_ASSETBOUNDEDQUEUE_H
+#define MSZ_ASSETBOUNDEDQUEUE_H
+
+#include <Arduino.h>
+#include <atomic>
+#include <mutex>
+
+/// @class MszBoundedQueue
+/// @brief Fixed-capacity FIFO queue for passing messages between tasks running on different cores.
+/// @details Items are copied in and out under a mutex that is held for one copy only, nothing is allocated after
+///          construction. Apart from that short wait for the lock, neither side waits for the other: pushing to a
+///          full queue drops the item and counts it, so a stalled consumer cannot hold up time-critical producers
+///          such as the radio, and popping from an empty queue returns false.
+template <typename T, size_t Capacity>
+class MszBoundedQueue
+{
+public:
+    bool tryPush(const T &item)
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        if (this->count >= Capacity)
+        {
+            this->droppedCount.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        this->items[(this->head + this->count) % Capacity] = item;
+        this->count++;
+        return true;
+    }
+
+    bool tryPop(T &item)
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        if (this->count == 0)
+        {
+            return false;
+        }
+        item = this->items[this->head];
+        this->head = (this->head + 1) % Capacity;
+        this->count--;
+        return true;
+    }
+
+    size_t size()
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        return this->count;
+    }
+
+    size_t capacity() const { return Capacity; }
+    uint32_t getDroppedCount() const { return this->droppedCount.load(std::memory_order_relaxed); }
+
+private:
+    std::mutex mutex;
+    T items[Capacity];
+    size_t head = 0;
+    size_t count = 0;
+    std::atomic<uint32_t> droppedCount{0};
+};
+
+#endif // MSZ_ASSETBOUNDEDQUEUE_H
@@ -0,0 +1,51 @@
+#include <Arduino.h>
+
+#include "AssetCoreTask.h"
+
+#if defined(ESP32)
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#elif !defined(ESP8266)
+#include <chrono>
+#include <thread>
+#endif
+
+bool MszCoreTask::start(const char *name, std::function<void()> loopBody, int core, uint32_t stackSize, unsigned int priority)
+{
+    Serial.println("MszCoreTask::start - starting task " + String(name) + " on core " + String(core));
+
+    // Owned by the task from here on, tasks run until the device restarts.
+    std::function<void()> *body = new std::function<void()>(loopBody);
+
+#if defined(ESP32)
+    BaseType_t result = xTaskCreatePinnedToCore(MszCoreTask::run, name, stackSize, body, priority, NULL, core);
+    if (result != pdPASS)
+    {
+        Serial.println("MszCoreTask::start - failed to create task " + String(name));
+        delete body;
+        return false;
+    }
+    return true;
+#elif defined(ESP8266)
+    Serial.println("MszCoreTask::start - tasks are not supported on this platform");
+    delete body;
+    return false;
+#else
+    std::thread(MszCoreTask::run, body).detach();
+    return true;
+#endif
+}
+
+void MszCoreTask::run(void *taskParameter)
+{
+    std::function<void()> *body = static_cast<std::function<void()> *>(taskParameter);
+    for (;;)
+    {
+        (*body)();
+#if defined(ESP32)
+        vTaskDelay(1);
+#elif !defined(ESP8266)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+#endif
+    }
+}
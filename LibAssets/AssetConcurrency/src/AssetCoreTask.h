@@ -0,0 +1,34 @@
+#ifndef MSZ_ASSETCORETASK_H
+#define MSZ_ASSETCORETASK_H
+
+#include <Arduino.h>
+#include <functional>
+
+// Core assignment for the dual-core mode. The WiFi stack runs on core 0 on the ESP32,
+// hence network work stays there and time-critical radio and sensor work goes to core 1.
+#define MSZ_NETWORK_CORE 0
+#define MSZ_REALTIME_CORE 1
+
+#if defined(MSZ_DUAL_CORE) && defined(ESP8266)
+#error "MSZ_DUAL_CORE requires a dual-core target such as the ESP32."
+#endif
+
+/// @class MszCoreTask
+/// @brief Starts a task pinned to a core that calls its body over and over, like the Arduino loop() does.
+/// @details Uses FreeRTOS tasks on the ESP32 and a detached std::thread on host builds, where the core is ignored.
+///          The body should not block for long. The task yields for one tick after every call so that the idle
+///          task and its watchdog get their share of the core.
+class MszCoreTask
+{
+public:
+    static const uint32_t DEFAULT_STACK_SIZE = 8192;
+    static const unsigned int DEFAULT_PRIORITY = 1;
+
+    static bool start(const char *name, std::function<void()> loopBody, int core,
+                      uint32_t stackSize = DEFAULT_STACK_SIZE, unsigned int priority = DEFAULT_PRIORITY);
+
+private:
+    static void run(void *taskParameter);
+};
+
+#endif // MSZ_ASSETCORETASK_H
@@ -0,0 +1,68 @@
+#ifndef MSZ_ASSETSPSCRING_H
+#define MSZ_ASSETSPSCRING_H
+
+#include <Arduino.h>
+#include <atomic>
+
+/// @class MszSpscRing
+/// @brief Lock-free ring buffer for exactly one producer and one consumer, e.g. a timer callback and the loop.
+/// @details The producer only writes the head and the consumer only writes the tail, so neither side ever waits and
+///          the producer may run in interrupt or timer context. Capacity must be a power of two. Pushing to a full
+///          ring drops the new item and increments the overflow counter, the items already queued are kept.
+template <typename T, size_t Capacity>
+class MszSpscRing
+{
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    // Both indexes start at startIndex and only ever grow, wrapping around at SIZE_MAX. Tests start them just below
+    // it to run across the wrap-around.
+    explicit MszSpscRing(size_t startIndex = 0) : head(startIndex), tail(startIndex) {}
+
+    bool tryPush(const T &item)
+    {
+        size_t head = this->head.load(std::memory_order_relaxed);
+        if (head - this->tail.load(std::memory_order_acquire) >= Capacity)
+        {
+            this->overflowCount.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        this->items[head & (Capacity - 1)] = item;
+        this->head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool tryPop(T &item)
+    {
+        size_t tail = this->tail.load(std::memory_order_relaxed);
+        if (tail == this->head.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+        item = this->items[tail & (Capacity - 1)];
+        this->tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Pops up to maxItems at once, returns the number of items popped.
+    size_t popBatch(T *batch, size_t maxItems)
+    {
+        size_t popped = 0;
+        while (popped < maxItems && this->tryPop(batch[popped]))
+        {
+            popped++;
+        }
+        return popped;
+    }
+
+    size_t capacity() const { return Capacity; }
+    uint32_t getOverflowCount() const { return this->overflowCount.load(std::memory_order_relaxed); }
+
+private:
+    T items[Capacity];
+    std::atomic<size_t> head;
+    std::atomic<size_t> tail;
+    std::atomic<uint32_t> overflowCount{0};
+};
+
+#endif // MSZ_ASSETSPSCRING_H
@@ -0,0 +1,608 @@
+// The ESP8266 core has no BSD sockets, the library still builds there for MszHttpServer.
+#if !defined(ESP8266)
+
+#include "AssetAsyncHttpServer.h"
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <fcntl.h>
+#include <unistd.h>
+#if defined(ESP32)
+#include <lwip/sockets.h>
+#else
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+MszAsyncHttpServer::MszAsyncHttpServer(uint16_t port)
+{
+    this->port = port;
+    this->listenFd = -1;
+    this->nextGeneration = 1;
+    this->current = NULL;
+    this->requestMethod[0] = '\0';
+    for (int i = 0; i < MAX_ASYNC_HTTP_CONNECTIONS; i++)
+    {
+        this->connections[i].fd = -1;
+        this->connections[i].generation = 0;
+        this->connections[i].length = 0;
+        this->connections[i].outputSent = 0;
+        this->connections[i].deferred = false;
+        this->connections[i].moreRequests = false;
+    }
+}
+
+MszAsyncHttpServer::~MszAsyncHttpServer()
+{
+    for (int i = 0; i < MAX_ASYNC_HTTP_CONNECTIONS; i++)
+    {
+        if (this->connections[i].fd >= 0)
+        {
+            this->closeConnection(this->connections[i]);
+        }
+    }
+    if (this->listenFd >= 0)
+    {
+        close(this->listenFd);
+    }
+}
+
+bool MszAsyncHttpServer::begin()
+{
+    this->listenFd = socket(AF_INET, SOCK_STREAM, 0);
+    if (this->listenFd < 0)
+    {
+        return false;
+    }
+
+    int enable = 1;
+    setsockopt(this->listenFd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(this->port);
+    if (bind(this->listenFd, (struct sockaddr *)&address, sizeof(address)) != 0 ||
+        listen(this->listenFd, MAX_ASYNC_HTTP_CONNECTIONS) != 0 ||
+        !setNonBlocking(this->listenFd))
+    {
+        close(this->listenFd);
+        this->listenFd = -1;
+        return false;
+    }
+    return true;
+}
+
+void MszAsyncHttpServer::onRequest(MszAsyncHttpHandler handler)
+{
+    this->requestHandler = handler;
+}
+
+void MszAsyncHttpServer::poll(int timeoutMillis)
+{
+    if (this->listenFd < 0)
+    {
+        return;
+    }
+
+    fd_set readSet;
+    fd_set writeSet;
+    FD_ZERO(&readSet);
+    FD_ZERO(&writeSet);
+    FD_SET(this->listenFd, &readSet);
+    int maxFd = this->listenFd;
+    for (int i = 0; i < MAX_ASYNC_HTTP_CONNECTIONS; i++)
+    {
+        Connection &connection = this->connections[i];
+        if (connection.fd < 0)
+        {
+            continue;
+        }
+        if (!connection.closing && !connection.peerClosed && connection.length < HTTP_MAX_REQUEST_LENGTH)
+        {
+            FD_SET(connection.fd, &readSet);
+        }
+        if (connection.outputSent < connection.output.size())
+        {
+            FD_SET(connection.fd, &writeSet);
+        }
+        // Pipelined requests left over from the last poll are already buffered, no socket event announces them.
+        if (connection.moreRequests)
+        {
+            timeoutMillis = 0;
+        }
+        if (connection.fd > maxFd)
+        {
+            maxFd = connection.fd;
+        }
+    }
+
+    struct timeval timeout;
+    timeout.tv_sec = timeoutMillis / 1000;
+    timeout.tv_usec = (timeoutMillis % 1000) * 1000;
+    int ready = select(maxFd + 1, &readSet, &writeSet, NULL, &timeout);
+    if (ready < 0)
+    {
+        return;
+    }
+
+    // Connections accepted now are not in the sets yet, their first data is read on the next poll.
+    if (FD_ISSET(this->listenFd, &readSet))
+    {
+        this->acceptConnections();
+    }
+
+    for (int i = 0; i < MAX_ASYNC_HTTP_CONNECTIONS; i++)
+    {
+        Connection &connection = this->connections[i];
+        if (connection.fd < 0)
+        {
+            continue;
+        }
+        int fd = connection.fd;
+        if (FD_ISSET(fd, &writeSet))
+        {
+            this->flush(connection);
+        }
+        if (connection.fd >= 0 && FD_ISSET(fd, &readSet))
+        {
+            this->receive(connection);
+        }
+        if (connection.fd >= 0)
+        {
+            this->serveRequests(connection);
+        }
+        if (connection.fd >= 0)
+        {
+            this->checkTimeouts(connection);
+        }
+    }
+}
+
+void MszAsyncHttpServer::acceptConnections()
+{
+    while (true)
+    {
+        struct sockaddr_in remote;
+        socklen_t remoteLength = sizeof(remote);
+        int fd = accept(this->listenFd, (struct sockaddr *)&remote, &remoteLength);
+        if (fd < 0)
+        {
+            return;
+        }
+
+        Connection *free = NULL;
+        for (int i = 0; i < MAX_ASYNC_HTTP_CONNECTIONS && free == NULL; i++)
+        {
+            if (this->connections[i].fd < 0)
+            {
+                free = &this->connections[i];
+            }
+        }
+        if (free == NULL || !setNonBlocking(fd))
+        {
+            const char *response = "HTTP/1.1 503 Service Unavailable\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+            ::send(fd, response, strlen(response), MSG_NOSIGNAL);
+            close(fd);
+            continue;
+        }
+
+        int enable = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+        free->fd = fd;
+        free->generation = this->nextGeneration++;
+        free->remoteAddress = remote.sin_addr.s_addr;
+        free->length = 0;
+        free->output.clear();
+        free->outputSent = 0;
+        free->pendingHeaders.clear();
+        free->lastActivityMillis = getMillis();
+        free->requestCount = 0;
+        free->responseStarted = false;
+        free->chunked = false;
+        free->deferred = false;
+        free->closeAfterResponse = false;
+        free->closing = false;
+        free->peerClosed = false;
+        free->moreRequests = false;
+    }
+}
+
+void MszAsyncHttpServer::receive(Connection &connection)
+{
+    int received = recv(connection.fd, connection.buffer + connection.length, HTTP_MAX_REQUEST_LENGTH - connection.length, 0);
+    if (received > 0)
+    {
+        connection.length += received;
+        connection.lastActivityMillis = getMillis();
+    }
+    else if (received == 0)
+    {
+        connection.peerClosed = true;
+    }
+    else if (errno != EAGAIN && errno != EWOULDBLOCK)
+    {
+        this->closeConnection(connection);
+    }
+}
+
+void MszAsyncHttpServer::serveRequests(Connection &connection)
+{
+    connection.moreRequests = false;
+    for (int served = 0; served < MAX_REQUESTS_PER_POLL; served++)
+    {
+        if (connection.deferred || connection.closing ||
+            connection.output.size() - connection.outputSent > OUTPUT_HIGH_WATER_LENGTH)
+        {
+            break;
+        }
+
+        int consumed = httpParseRequest(connection.buffer, connection.length, this->request);
+        if (consumed == HTTP_PARSE_INCOMPLETE)
+        {
+            break;
+        }
+        if (consumed < 0)
+        {
+            int statusCode = (consumed == HTTP_PARSE_TOO_LARGE) ? HTTP_PAYLOAD_TOO_LARGE_CODE : HTTP_BAD_REQUEST_CODE;
+            char response[96];
+            snprintf(response, sizeof(response), "HTTP/1.1 %d %s\r\nContent-Length: 0\r\nConnection: close\r\n\r\n", statusCode, httpStatusText(statusCode));
+            this->append(connection, response, strlen(response));
+            connection.closing = true;
+            break;
+        }
+
+        connection.requestCount++;
+        connection.http11 = this->request.http11;
+        connection.closeAfterResponse = !this->request.keepAlive || connection.requestCount >= MAX_REQUESTS_PER_CONNECTION;
+        connection.responseStarted = false;
+        connection.chunked = false;
+        connection.pendingHeaders.clear();
+
+        this->current = &connection;
+        this->dispatch();
+        this->current = NULL;
+        if (connection.fd < 0)
+        {
+            return;
+        }
+
+        connection.length -= consumed;
+        memmove(connection.buffer, connection.buffer + consumed, connection.length);
+        if (!connection.deferred)
+        {
+            this->finishResponse(connection);
+        }
+        connection.moreRequests = (served == MAX_REQUESTS_PER_POLL - 1 && connection.length > 0);
+    }
+    this->flush(connection);
+}
+
+void MszAsyncHttpServer::dispatch()
+{
+    const char *buffer = this->current->buffer;
+    httpCopySpan(buffer, this->request.method, this->requestMethod, MAX_ASYNC_HTTP_METHOD_LENGTH);
+    if (this->requestHandler)
+    {
+        this->requestHandler();
+        return;
+    }
+    std::string message = "Not found: " + this->uri();
+    this->send(HTTP_NOT_FOUND_CODE, "text/plain", message.c_str(), message.length());
+}
+
+void MszAsyncHttpServer::finishResponse(Connection &connection)
+{
+    Connection *previous = this->current;
+    this->current = &connection;
+    if (!connection.responseStarted)
+    {
+        const char *message = "No response";
+        this->send(HTTP_INTERNAL_SERVER_ERROR_CODE, "text/plain", message, strlen(message));
+    }
+    else if (connection.chunked)
+    {
+        this->endChunked();
+    }
+    this->current = previous;
+
+    if (connection.fd >= 0 && connection.closeAfterResponse)
+    {
+        connection.closing = true;
+    }
+}
+
+const char *MszAsyncHttpServer::method()
+{
+    return this->requestMethod;
+}
+
+std::string MszAsyncHttpServer::uri()
+{
+    if (this->current == NULL)
+    {
+        return std::string();
+    }
+    return std::string(this->current->buffer + this->request.path.offset, this->request.path.length);
+}
+
+std::string MszAsyncHttpServer::arg(const char *name)
+{
+    char value[MAX_ASYNC_HTTP_VALUE_LENGTH];
+    if (this->current == NULL || !httpGetParam(this->current->buffer, this->request, name, value, sizeof(value)))
+    {
+        return std::string();
+    }
+    return std::string(value);
+}
+
+std::string MszAsyncHttpServer::header(const char *name)
+{
+    char value[MAX_ASYNC_HTTP_VALUE_LENGTH];
+    if (this->current == NULL || !httpGetHeader(this->current->buffer, this->request, name, value, sizeof(value)))
+    {
+        return std::string();
+    }
+    return std::string(value);
+}
+
+uint32_t MszAsyncHttpServer::remoteAddress()
+{
+    return (this->current == NULL) ? 0 : this->current->remoteAddress;
+}
+
+void MszAsyncHttpServer::sendHeader(const char *name, const char *value)
+{
+    if (this->current == NULL)
+    {
+        return;
+    }
+    this->current->pendingHeaders.append(name).append(": ").append(value).append("\r\n");
+}
+
+void MszAsyncHttpServer::send(int statusCode, const char *contentType, const char *content, size_t length)
+{
+    if (this->current == NULL || this->current->fd < 0 || this->current->responseStarted)
+    {
+        return;
+    }
+    Connection &connection = *this->current;
+    this->appendHead(connection, statusCode, contentType, (long)length);
+    this->append(connection, content, length);
+}
+
+void MszAsyncHttpServer::beginChunked(int statusCode, const char *contentType)
+{
+    if (this->current == NULL || this->current->fd < 0 || this->current->responseStarted)
+    {
+        return;
+    }
+    this->current->chunked = true;
+    this->appendHead(*this->current, statusCode, contentType, -1);
+}
+
+void MszAsyncHttpServer::sendChunk(const char *data, size_t length)
+{
+    // An empty chunk would end the response early.
+    if (this->current == NULL || this->current->fd < 0 || !this->current->chunked || length == 0)
+    {
+        return;
+    }
+    Connection &connection = *this->current;
+    if (connection.http11)
+    {
+        char size[12];
+        snprintf(size, sizeof(size), "%X\r\n", (unsigned int)length);
+        this->append(connection, size, strlen(size));
+        this->append(connection, data, length);
+        this->append(connection, "\r\n", 2);
+    }
+    else
+    {
+        this->append(connection, data, length);
+    }
+}
+
+void MszAsyncHttpServer::endChunked()
+{
+    if (this->current == NULL || this->current->fd < 0 || !this->current->chunked)
+    {
+        return;
+    }
+    if (this->current->http11)
+    {
+        this->append(*this->current, "0\r\n\r\n", 5);
+    }
+    this->current->chunked = false;
+}
+
+MszAsyncResponseHandle MszAsyncHttpServer::defer()
+{
+    // The request is gone once the handler returns, a deferring handler copies what it needs beforehand.
+    MszAsyncResponseHandle handle = {-1, 0};
+    if (this->current == NULL || this->current->responseStarted)
+    {
+        return handle;
+    }
+    this->current->deferred = true;
+    this->current->deferredSinceMillis = getMillis();
+    handle.slot = (int)(this->current - this->connections);
+    handle.generation = this->current->generation;
+    return handle;
+}
+
+bool MszAsyncHttpServer::completeDeferred(MszAsyncResponseHandle handle, int statusCode, const char *contentType, const char *content, size_t length)
+{
+    if (handle.slot < 0 || handle.slot >= MAX_ASYNC_HTTP_CONNECTIONS)
+    {
+        return false;
+    }
+    Connection &connection = this->connections[handle.slot];
+    if (connection.fd < 0 || connection.generation != handle.generation || !connection.deferred)
+    {
+        return false;
+    }
+
+    Connection *previous = this->current;
+    this->current = &connection;
+    connection.deferred = false;
+    this->send(statusCode, contentType, content, length);
+    this->current = previous;
+    this->finishResponse(connection);
+    if (connection.fd >= 0)
+    {
+        this->flush(connection);
+    }
+    return true;
+}
+
+int MszAsyncHttpServer::getOpenConnections()
+{
+    int open = 0;
+    for (int i = 0; i < MAX_ASYNC_HTTP_CONNECTIONS; i++)
+    {
+        if (this->connections[i].fd >= 0)
+        {
+            open++;
+        }
+    }
+    return open;
+}
+
+void MszAsyncHttpServer::append(Connection &connection, const char *data, size_t length)
+{
+    // A client not reading its responses must not exhaust the heap, it loses its connection instead.
+    if (connection.output.size() - connection.outputSent + length > ASYNC_HTTP_MAX_OUTPUT_LENGTH)
+    {
+        this->closeConnection(connection);
+        return;
+    }
+    connection.output.append(data, length);
+}
+
+void MszAsyncHttpServer::appendHead(Connection &connection, int statusCode, const char *contentType, long contentLength)
+{
+    connection.responseStarted = true;
+
+    // HTTP/1.0 clients cannot read chunked responses, the end of the connection ends those responses instead.
+    if (contentLength < 0 && !connection.http11)
+    {
+        connection.closeAfterResponse = true;
+    }
+
+    char head[192];
+    int headLength = snprintf(head, sizeof(head), "HTTP/1.1 %d %s\r\nContent-Type: %s\r\n", statusCode, httpStatusText(statusCode), contentType);
+    if (contentLength >= 0)
+    {
+        headLength += snprintf(head + headLength, sizeof(head) - headLength, "Content-Length: %ld\r\n", contentLength);
+    }
+    else if (connection.http11)
+    {
+        headLength += snprintf(head + headLength, sizeof(head) - headLength, "Transfer-Encoding: chunked\r\n");
+    }
+    if (connection.closeAfterResponse)
+    {
+        headLength += snprintf(head + headLength, sizeof(head) - headLength, "Connection: close\r\n");
+    }
+    else
+    {
+        headLength += snprintf(head + headLength, sizeof(head) - headLength, "Connection: keep-alive\r\nKeep-Alive: timeout=%u, max=%d\r\n",
+                               (unsigned int)(IDLE_TIMEOUT_MS / 1000), MAX_REQUESTS_PER_CONNECTION - connection.requestCount);
+    }
+    if (headLength >= (int)sizeof(head))
+    {
+        headLength = sizeof(head) - 1;
+    }
+    this->append(connection, head, headLength);
+    if (connection.fd >= 0)
+    {
+        this->append(connection, connection.pendingHeaders.c_str(), connection.pendingHeaders.length());
+    }
+    if (connection.fd >= 0)
+    {
+        this->append(connection, "\r\n", 2);
+    }
+    connection.pendingHeaders.clear();
+}
+
+void MszAsyncHttpServer::flush(Connection &connection)
+{
+    while (connection.outputSent < connection.output.size())
+    {
+        int sent = ::send(connection.fd, connection.output.data() + connection.outputSent, connection.output.size() - connection.outputSent, MSG_NOSIGNAL);
+        if (sent > 0)
+        {
+            connection.outputSent += sent;
+            connection.lastActivityMillis = getMillis();
+        }
+        else if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            return;
+        }
+        else
+        {
+            this->closeConnection(connection);
+            return;
+        }
+    }
+    connection.output.clear();
+    connection.outputSent = 0;
+    if (connection.closing)
+    {
+        this->closeConnection(connection);
+    }
+}
+
+void MszAsyncHttpServer::checkTimeouts(Connection &connection)
+{
+    uint32_t nowMillis = getMillis();
+    if (connection.deferred)
+    {
+        if (nowMillis - connection.deferredSinceMillis > DEFERRED_TIMEOUT_MS)
+        {
+            MszAsyncResponseHandle handle = {(int)(&connection - this->connections), connection.generation};
+            const char *message = "Deferred response timed out";
+            this->completeDeferred(handle, HTTP_SERVICE_UNAVAILABLE_CODE, "text/plain", message, strlen(message));
+        }
+        return;
+    }
+
+    // Covers idle connections as well as clients that stopped reading their responses.
+    bool outputPending = connection.outputSent < connection.output.size();
+    if ((connection.peerClosed && !outputPending && httpParseRequest(connection.buffer, connection.length, this->request) <= 0) ||
+        nowMillis - connection.lastActivityMillis > IDLE_TIMEOUT_MS)
+    {
+        this->closeConnection(connection);
+    }
+}
+
+void MszAsyncHttpServer::closeConnection(Connection &connection)
+{
+    close(connection.fd);
+    connection.fd = -1;
+    connection.length = 0;
+    std::string().swap(connection.output);
+    connection.outputSent = 0;
+    connection.pendingHeaders.clear();
+    connection.deferred = false;
+}
+
+uint32_t MszAsyncHttpServer::getMillis()
+{
+    return (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool MszAsyncHttpServer::setNonBlocking(int fd)
+{
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+#endif // !ESP8266
@@ -0,0 +1,140 @@
+#ifndef MSZ_ASSETASYNCHTTPSERVER_H
+#define MSZ_ASSETASYNCHTTPSERVER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <functional>
+#include "AssetHttpParser.h"
+
+#if defined(MSZ_HTTP_ASYNC) && defined(ESP8266)
+#error "MSZ_HTTP_ASYNC requires BSD sockets, which the ESP8266 core does not provide."
+#endif
+
+/*
+ * Event-driven web server on non-blocking BSD sockets, lwIP's on the ESP32 and POSIX sockets on Linux. It does not
+ * depend on Arduino, so it builds natively for load tests, e.g.:
+ *   g++ -std=c++17 -ILibAssets/AssetHttpServer/src LibAssets/AssetHttpServer/src/AssetHttpParser.cpp
+ *       LibAssets/AssetHttpServer/src/AssetAsyncHttpServer.cpp <server main>.cpp
+ */
+
+// lwIP of the ESP32 has 10 sockets by default, the UDP command server and MQTT need theirs as well.
+#ifndef MAX_ASYNC_HTTP_CONNECTIONS
+#if defined(ESP32)
+#define MAX_ASYNC_HTTP_CONNECTIONS 5
+#else
+#define MAX_ASYNC_HTTP_CONNECTIONS 16
+#endif
+#endif
+#ifndef ASYNC_HTTP_MAX_OUTPUT_LENGTH
+#define ASYNC_HTTP_MAX_OUTPUT_LENGTH 32768
+#endif
+#define MAX_ASYNC_HTTP_METHOD_LENGTH 8
+#define MAX_ASYNC_HTTP_VALUE_LENGTH 256
+
+typedef std::function<void()> MszAsyncHttpHandler;
+
+/// @brief Identifies a deferred response, stays valid until the response is completed or the connection is gone.
+struct MszAsyncResponseHandle
+{
+    int slot;
+    uint32_t generation;
+};
+
+/// @class MszAsyncHttpServer
+/// @brief Web server serving many connections at once without ever blocking the loop.
+/// @details poll() waits at most the given time for socket events with select(), accepts connections, reads what
+///          arrived and writes what the sockets take. Responses are buffered per connection and flushed as the
+///          client reads them, so a slow or stalled client only holds its own connection. Pipelined requests of a
+///          connection are served in order, each one only after the response to the previous one was produced.
+///          A handler that cannot answer right away calls defer() and completes the response later with
+///          completeDeferred(), the connection serves no further requests until then.
+class MszAsyncHttpServer
+{
+public:
+    MszAsyncHttpServer(uint16_t port = 80);
+    ~MszAsyncHttpServer();
+
+    bool begin();
+    void poll(int timeoutMillis = 0);
+    // All requests go to the one handler, which routes them on its own.
+    void onRequest(MszAsyncHttpHandler handler);
+
+    // Current request, valid inside a handler.
+    const char *method();
+    std::string uri();
+    std::string arg(const char *name);
+    std::string header(const char *name);
+    uint32_t remoteAddress(); // IPv4 address of the client, 0 outside of a request.
+
+    // Response to the current request, sendHeader() adds headers to the next response sent.
+    void sendHeader(const char *name, const char *value);
+    void send(int statusCode, const char *contentType, const char *content, size_t length);
+    void beginChunked(int statusCode, const char *contentType);
+    void sendChunk(const char *data, size_t length);
+    void endChunked();
+
+    MszAsyncResponseHandle defer();
+    bool completeDeferred(MszAsyncResponseHandle handle, int statusCode, const char *contentType, const char *content, size_t length);
+
+    int getOpenConnections();
+
+    static const uint32_t IDLE_TIMEOUT_MS = 5000;
+    static const uint32_t DEFERRED_TIMEOUT_MS = 10000;
+    static const int MAX_REQUESTS_PER_CONNECTION = 100;
+    static const int MAX_REQUESTS_PER_POLL = 4;
+
+    // No further pipelined requests are served while more than this is waiting to be sent.
+    static const size_t OUTPUT_HIGH_WATER_LENGTH = 4096;
+
+protected:
+    struct Connection
+    {
+        int fd;
+        uint32_t generation;
+        uint32_t remoteAddress;
+        char buffer[HTTP_MAX_REQUEST_LENGTH];
+        size_t length;
+        std::string output;
+        size_t outputSent;
+        std::string pendingHeaders;
+        uint32_t lastActivityMillis;
+        uint32_t deferredSinceMillis;
+        int requestCount;
+        bool http11;
+        bool responseStarted;
+        bool chunked;
+        bool deferred;
+        bool closeAfterResponse;
+        bool closing;
+        bool peerClosed;
+        bool moreRequests;
+    };
+
+    uint16_t port;
+    int listenFd;
+    uint32_t nextGeneration;
+    MszAsyncHttpHandler requestHandler;
+    Connection connections[MAX_ASYNC_HTTP_CONNECTIONS];
+
+    // State of the request currently being handled.
+    Connection *current;
+    HttpRequest request;
+    char requestMethod[MAX_ASYNC_HTTP_METHOD_LENGTH];
+
+    void acceptConnections();
+    void receive(Connection &connection);
+    void serveRequests(Connection &connection);
+    void dispatch();
+    void finishResponse(Connection &connection);
+    void append(Connection &connection, const char *data, size_t length);
+    void appendHead(Connection &connection, int statusCode, const char *contentType, long contentLength);
+    void flush(Connection &connection);
+    void checkTimeouts(Connection &connection);
+    void closeConnection(Connection &connection);
+
+    static uint32_t getMillis();
+    static bool setNonBlocking(int fd);
+};
+
+#endif // MSZ_ASSETASYNCHTTPSERVER_H
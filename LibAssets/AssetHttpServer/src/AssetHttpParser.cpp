@@ -0,0 +1,333 @@
+#include "AssetHttpParser.h"
+#include <string.h>
+
+static char httpToLower(char c)
+{
+    return (c >= 'A' && c <= 'Z') ? (char)(c - 'A' + 'a') : c;
+}
+
+static size_t httpFindLineEnd(const char *buffer, size_t from, size_t to)
+{
+    for (size_t i = from; i + 1 < to; i++)
+    {
+        if (buffer[i] == '\r' && buffer[i + 1] == '\n')
+        {
+            return i;
+        }
+    }
+    return to;
+}
+
+static bool httpSpanContains(const char *buffer, HttpSpan span, const char *token)
+{
+    size_t tokenLength = strlen(token);
+    for (size_t i = 0; i + tokenLength <= span.length; i++)
+    {
+        size_t j = 0;
+        while (j < tokenLength && httpToLower(buffer[span.offset + i + j]) == token[j])
+        {
+            j++;
+        }
+        if (j == tokenLength)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static int httpHexValue(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    c = httpToLower(c);
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    return -1;
+}
+
+int httpParseRequest(const char *buffer, size_t length, HttpRequest &request)
+{
+    // Nothing is parsed before the whole header arrived, most requests of the assets fit into a single packet.
+    size_t headerEnd = 0;
+    for (size_t i = 0; i + 3 < length; i++)
+    {
+        if (buffer[i] == '\r' && buffer[i + 1] == '\n' && buffer[i + 2] == '\r' && buffer[i + 3] == '\n')
+        {
+            headerEnd = i + 4;
+            break;
+        }
+    }
+    if (headerEnd == 0)
+    {
+        return (length >= HTTP_MAX_REQUEST_LENGTH) ? HTTP_PARSE_TOO_LARGE : HTTP_PARSE_INCOMPLETE;
+    }
+    if (headerEnd > HTTP_MAX_REQUEST_LENGTH)
+    {
+        return HTTP_PARSE_TOO_LARGE;
+    }
+
+    memset(&request, 0, sizeof(request));
+
+    // Request line: METHOD SP target SP HTTP/1.x
+    size_t lineEnd = httpFindLineEnd(buffer, 0, headerEnd);
+    size_t pos = 0;
+    while (pos < lineEnd && buffer[pos] >= 'A' && buffer[pos] <= 'Z')
+    {
+        pos++;
+    }
+    if (pos == 0 || pos > 7 || pos >= lineEnd || buffer[pos] != ' ')
+    {
+        return HTTP_PARSE_ERROR;
+    }
+    request.method = {0, (uint16_t)pos};
+
+    size_t targetStart = pos + 1;
+    size_t targetEnd = targetStart;
+    while (targetEnd < lineEnd && buffer[targetEnd] != ' ')
+    {
+        targetEnd++;
+    }
+    if (targetEnd == targetStart || buffer[targetStart] != '/' || targetEnd >= lineEnd)
+    {
+        return HTTP_PARSE_ERROR;
+    }
+    size_t versionStart = targetEnd + 1;
+    if (lineEnd - versionStart != 8 || strncmp(buffer + versionStart, "HTTP/1.", 7) != 0)
+    {
+        return HTTP_PARSE_ERROR;
+    }
+    if (buffer[versionStart + 7] == '1')
+    {
+        request.http11 = true;
+    }
+    else if (buffer[versionStart + 7] != '0')
+    {
+        return HTTP_PARSE_ERROR;
+    }
+
+    size_t queryStart = targetStart;
+    while (queryStart < targetEnd && buffer[queryStart] != '?')
+    {
+        queryStart++;
+    }
+    request.path = {(uint16_t)targetStart, (uint16_t)(queryStart - targetStart)};
+    if (queryStart < targetEnd)
+    {
+        request.query = {(uint16_t)(queryStart + 1), (uint16_t)(targetEnd - queryStart - 1)};
+    }
+
+    // Header lines: name ":" OWS value OWS
+    size_t contentLength = 0;
+    bool hasContentLength = false;
+    bool connectionClose = false;
+    bool connectionKeepAlive = false;
+    pos = lineEnd + 2;
+    while (pos < headerEnd - 2)
+    {
+        lineEnd = httpFindLineEnd(buffer, pos, headerEnd);
+        size_t colon = pos;
+        while (colon < lineEnd && buffer[colon] != ':')
+        {
+            colon++;
+        }
+        if (colon == pos || colon >= lineEnd)
+        {
+            return HTTP_PARSE_ERROR;
+        }
+        size_t valueStart = colon + 1;
+        while (valueStart < lineEnd && (buffer[valueStart] == ' ' || buffer[valueStart] == '\t'))
+        {
+            valueStart++;
+        }
+        size_t valueEnd = lineEnd;
+        while (valueEnd > valueStart && (buffer[valueEnd - 1] == ' ' || buffer[valueEnd - 1] == '\t'))
+        {
+            valueEnd--;
+        }
+        HttpSpan name = {(uint16_t)pos, (uint16_t)(colon - pos)};
+        HttpSpan value = {(uint16_t)valueStart, (uint16_t)(valueEnd - valueStart)};
+
+        if (httpSpanEquals(buffer, name, "Content-Length"))
+        {
+            // A repeated Content-Length is a request smuggling vector, RFC 9112 section 6.3 treats it as an error.
+            if (value.length == 0 || hasContentLength)
+            {
+                return HTTP_PARSE_ERROR;
+            }
+            hasContentLength = true;
+            for (size_t i = valueStart; i < valueEnd; i++)
+            {
+                if (buffer[i] < '0' || buffer[i] > '9')
+                {
+                    return HTTP_PARSE_ERROR;
+                }
+                contentLength = contentLength * 10 + (buffer[i] - '0');
+                if (contentLength > HTTP_MAX_REQUEST_LENGTH)
+                {
+                    return HTTP_PARSE_TOO_LARGE;
+                }
+            }
+        }
+        else if (httpSpanEquals(buffer, name, "Transfer-Encoding"))
+        {
+            return HTTP_PARSE_ERROR;
+        }
+        else if (httpSpanEquals(buffer, name, "Connection"))
+        {
+            connectionClose = httpSpanContains(buffer, value, "close");
+            connectionKeepAlive = httpSpanContains(buffer, value, "keep-alive");
+        }
+        else if (httpSpanEquals(buffer, name, "Content-Type"))
+        {
+            request.formBody = httpSpanContains(buffer, value, "application/x-www-form-urlencoded");
+        }
+
+        // Headers beyond HTTP_MAX_HEADERS are still interpreted above, just not available to the handlers.
+        if (request.headerCount < HTTP_MAX_HEADERS)
+        {
+            request.headerNames[request.headerCount] = name;
+            request.headerValues[request.headerCount] = value;
+            request.headerCount++;
+        }
+        pos = lineEnd + 2;
+    }
+
+    if (headerEnd + contentLength > HTTP_MAX_REQUEST_LENGTH)
+    {
+        return HTTP_PARSE_TOO_LARGE;
+    }
+    if (headerEnd + contentLength > length)
+    {
+        return HTTP_PARSE_INCOMPLETE;
+    }
+    request.body = {(uint16_t)headerEnd, (uint16_t)contentLength};
+    request.keepAlive = request.http11 ? !connectionClose : connectionKeepAlive;
+    return (int)(headerEnd + contentLength);
+}
+
+void httpCopySpan(const char *buffer, HttpSpan span, char *out, size_t outSize)
+{
+    if (outSize == 0)
+    {
+        return;
+    }
+    size_t length = (span.length < outSize - 1) ? span.length : outSize - 1;
+    memcpy(out, buffer + span.offset, length);
+    out[length] = '\0';
+}
+
+bool httpSpanEquals(const char *buffer, HttpSpan span, const char *value)
+{
+    size_t valueLength = strlen(value);
+    if (span.length != valueLength)
+    {
+        return false;
+    }
+    for (size_t i = 0; i < valueLength; i++)
+    {
+        if (httpToLower(buffer[span.offset + i]) != httpToLower(value[i]))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool httpGetHeader(const char *buffer, const HttpRequest &request, const char *name, char *out, size_t outSize)
+{
+    for (int i = 0; i < request.headerCount; i++)
+    {
+        if (httpSpanEquals(buffer, request.headerNames[i], name))
+        {
+            httpCopySpan(buffer, request.headerValues[i], out, outSize);
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool httpFindParam(const char *buffer, HttpSpan params, const char *name, char *out, size_t outSize)
+{
+    size_t nameLength = strlen(name);
+    size_t pos = params.offset;
+    size_t end = params.offset + params.length;
+    while (pos < end)
+    {
+        size_t pairEnd = pos;
+        while (pairEnd < end && buffer[pairEnd] != '&')
+        {
+            pairEnd++;
+        }
+        size_t keyEnd = pos;
+        while (keyEnd < pairEnd && buffer[keyEnd] != '=')
+        {
+            keyEnd++;
+        }
+
+        if (keyEnd - pos == nameLength && strncmp(buffer + pos, name, nameLength) == 0)
+        {
+            // URL-decode the value, '+' is a space in query strings and form bodies.
+            size_t written = 0;
+            size_t i = (keyEnd < pairEnd) ? keyEnd + 1 : pairEnd;
+            while (i < pairEnd && written + 1 < outSize)
+            {
+                char c = buffer[i];
+                if (c == '%' && i + 2 < pairEnd && httpHexValue(buffer[i + 1]) >= 0 && httpHexValue(buffer[i + 2]) >= 0)
+                {
+                    c = (char)(httpHexValue(buffer[i + 1]) * 16 + httpHexValue(buffer[i + 2]));
+                    i += 2;
+                }
+                else if (c == '+')
+                {
+                    c = ' ';
+                }
+                out[written++] = c;
+                i++;
+            }
+            if (outSize > 0)
+            {
+                out[written] = '\0';
+            }
+            return true;
+        }
+        pos = pairEnd + 1;
+    }
+    return false;
+}
+
+bool httpGetParam(const char *buffer, const HttpRequest &request, const char *name, char *out, size_t outSize)
+{
+    if (httpFindParam(buffer, request.query, name, out, outSize))
+    {
+        return true;
+    }
+    return request.formBody && httpFindParam(buffer, request.body, name, out, outSize);
+}
+
+const char *httpStatusText(int statusCode)
+{
+    switch (statusCode)
+    {
+    case 200:
+        return "OK";
+    case 304:
+        return "Not Modified";
+    case 400:
+        return "Bad Request";
+    case 401:
+        return "Unauthorized";
+    case 404:
+        return "Not Found";
+    case 413:
+        return "Payload Too Large";
+    case 429:
+        return "Too Many Requests";
+    case 500:
+        return "Internal Server Error";
+    case 503:
+        return "Service Unavailable";
+    default:
+        return "Unknown";
+    }
+}
@@ -0,0 +1,71 @@
+#ifndef MSZ_ASSETHTTPPARSER_H
+#define MSZ_ASSETHTTPPARSER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Parser for HTTP/1.0 and HTTP/1.1 requests shared by the web server backends of the assets. It works on the
+ * receive buffer of a connection and does not copy anything, a parsed request refers to ranges of that buffer.
+ * Requests with a Content-Length body are supported, chunked request bodies are not.
+ */
+#ifndef HTTP_MAX_REQUEST_LENGTH
+#define HTTP_MAX_REQUEST_LENGTH 1024
+#endif
+#define HTTP_MAX_HEADERS 16
+
+#define HTTP_PARSE_INCOMPLETE 0
+#define HTTP_PARSE_ERROR -1
+#define HTTP_PARSE_TOO_LARGE -2
+
+// Same values as the codes of the web API, the server needs the ones it answers with on its own.
+#define HTTP_BAD_REQUEST_CODE 400
+#define HTTP_NOT_FOUND_CODE 404
+#define HTTP_PAYLOAD_TOO_LARGE_CODE 413
+#define HTTP_INTERNAL_SERVER_ERROR_CODE 500
+#define HTTP_SERVICE_UNAVAILABLE_CODE 503
+
+/// @brief A range of the receive buffer a parsed request refers to.
+struct HttpSpan
+{
+    uint16_t offset;
+    uint16_t length;
+};
+
+/// @brief A request parsed from a receive buffer, valid as long as the buffer is not modified.
+struct HttpRequest
+{
+    HttpSpan method;
+    HttpSpan path;
+    HttpSpan query;
+    HttpSpan body;
+    HttpSpan headerNames[HTTP_MAX_HEADERS];
+    HttpSpan headerValues[HTTP_MAX_HEADERS];
+    int headerCount;
+    bool http11;
+    bool keepAlive;
+    bool formBody;
+};
+
+/// @brief Parses the first request in the buffer.
+/// @return The number of bytes the request takes in the buffer, the next pipelined request starts there.
+///         HTTP_PARSE_INCOMPLETE if more data is needed, HTTP_PARSE_ERROR for malformed requests and
+///         HTTP_PARSE_TOO_LARGE for requests that do not fit into HTTP_MAX_REQUEST_LENGTH.
+int httpParseRequest(const char *buffer, size_t length, HttpRequest &request);
+
+/// @brief Copies a span into out as a zero-terminated string, truncated to outSize - 1 characters.
+void httpCopySpan(const char *buffer, HttpSpan span, char *out, size_t outSize);
+
+/// @brief Compares a span with a string, ignoring the case of ASCII letters.
+bool httpSpanEquals(const char *buffer, HttpSpan span, const char *value);
+
+/// @brief Finds a header by its case-insensitive name and copies its value into out.
+bool httpGetHeader(const char *buffer, const HttpRequest &request, const char *name, char *out, size_t outSize);
+
+/// @brief Finds a parameter in the query string or a form-encoded body and copies its URL-decoded value into out.
+bool httpGetParam(const char *buffer, const HttpRequest &request, const char *name, char *out, size_t outSize);
+
+/// @brief Returns the reason phrase for the status codes the assets use.
+const char *httpStatusText(int statusCode);
+
+#endif // MSZ_ASSETHTTPPARSER_H
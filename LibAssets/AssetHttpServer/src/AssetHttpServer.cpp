@@ -0,0 +1,345 @@
+#include "AssetHttpServer.h"
+
+#if defined(ESP32) || defined(ESP8266)
+
+MszHttpServer::MszHttpServer(int port)
+    : server(port)
+{
+    this->current = NULL;
+    this->responseSent = false;
+    this->chunked = false;
+    this->closeAfterResponse = false;
+    this->requestMethod[0] = '\0';
+    for (int i = 0; i < MAX_HTTP_CONNECTIONS; i++)
+    {
+        this->connections[i].inUse = false;
+        this->connections[i].length = 0;
+        this->connections[i].requestCount = 0;
+        this->connections[i].lastActivityMillis = 0;
+    }
+
+    this->openConnectionsMetric = MszMetricsRegistry::registerGauge("http_connections_open", "HTTP connections currently kept open.");
+    this->rejectedConnectionsMetric = MszMetricsRegistry::registerCounter("http_connections_rejected_total", "HTTP connections answered with 503 because all connection slots were in use.");
+    this->reusedConnectionsMetric = MszMetricsRegistry::registerCounter("http_connection_reuses_total", "HTTP requests served on a connection kept open from a previous request.");
+}
+
+void MszHttpServer::begin()
+{
+    Serial.println("MszHttpServer::begin - serving with keep-alive, up to " + String(MAX_HTTP_CONNECTIONS) + " connections");
+    this->server.begin();
+    this->server.setNoDelay(true);
+}
+
+void MszHttpServer::onRequest(MszHttpHandler handler)
+{
+    this->requestHandler = handler;
+}
+
+void MszHttpServer::handleClient()
+{
+    this->acceptConnections();
+    for (int i = 0; i < MAX_HTTP_CONNECTIONS; i++)
+    {
+        if (this->connections[i].inUse)
+        {
+            this->serveConnection(this->connections[i]);
+        }
+    }
+    this->openConnectionsMetric->set(this->countOpenConnections());
+}
+
+void MszHttpServer::acceptConnections()
+{
+    WiFiClient client = this->server.accept();
+    while (client)
+    {
+        Connection *free = NULL;
+        for (int i = 0; i < MAX_HTTP_CONNECTIONS && free == NULL; i++)
+        {
+            if (!this->connections[i].inUse)
+            {
+                free = &this->connections[i];
+            }
+        }
+
+        if (free == NULL)
+        {
+            this->rejectedConnectionsMetric->increment();
+            this->sendError(client, HTTP_SERVICE_UNAVAILABLE_CODE);
+            client.stop();
+        }
+        else
+        {
+            client.setNoDelay(true);
+            free->client = client;
+            free->inUse = true;
+            free->length = 0;
+            free->requestCount = 0;
+            free->lastActivityMillis = millis();
+        }
+        client = this->server.accept();
+    }
+}
+
+void MszHttpServer::serveConnection(Connection &connection)
+{
+    int available = connection.client.available();
+    size_t space = HTTP_MAX_REQUEST_LENGTH - connection.length;
+    if (available > 0 && space > 0)
+    {
+        int readLength = connection.client.read((uint8_t *)connection.buffer + connection.length, ((size_t)available < space) ? (size_t)available : space);
+        if (readLength > 0)
+        {
+            connection.length += readLength;
+            connection.lastActivityMillis = millis();
+        }
+    }
+
+    // Pipelined requests are all in the buffer already, they are served strictly in the order they arrived.
+    for (int served = 0; served < MAX_REQUESTS_PER_PASS; served++)
+    {
+        int consumed = httpParseRequest(connection.buffer, connection.length, this->request);
+        if (consumed == HTTP_PARSE_INCOMPLETE)
+        {
+            break;
+        }
+        if (consumed < 0)
+        {
+            this->sendError(connection.client, (consumed == HTTP_PARSE_TOO_LARGE) ? HTTP_PAYLOAD_TOO_LARGE_CODE : HTTP_BAD_REQUEST_CODE);
+            this->closeConnection(connection);
+            return;
+        }
+
+        if (connection.requestCount > 0)
+        {
+            this->reusedConnectionsMetric->increment();
+        }
+        this->current = &connection;
+        this->pendingHeaders = "";
+        this->responseSent = false;
+        this->chunked = false;
+        this->closeAfterResponse = !this->request.keepAlive || connection.requestCount + 1 >= MAX_REQUESTS_PER_CONNECTION;
+        this->dispatch();
+        if (!this->responseSent)
+        {
+            this->send(HTTP_INTERNAL_SERVER_ERROR_CODE, "text/plain", "No response");
+        }
+        this->current = NULL;
+
+        connection.requestCount++;
+        connection.length -= consumed;
+        memmove(connection.buffer, connection.buffer + consumed, connection.length);
+        connection.lastActivityMillis = millis();
+        if (this->closeAfterResponse)
+        {
+            this->closeConnection(connection);
+            return;
+        }
+    }
+
+    if ((!connection.client.connected() && connection.client.available() == 0) ||
+        millis() - connection.lastActivityMillis > IDLE_TIMEOUT_MS)
+    {
+        this->closeConnection(connection);
+    }
+}
+
+void MszHttpServer::dispatch()
+{
+    const char *buffer = this->current->buffer;
+    httpCopySpan(buffer, this->request.method, this->requestMethod, MAX_HTTP_METHOD_LENGTH);
+    if (this->requestHandler)
+    {
+        this->requestHandler();
+        return;
+    }
+    this->send(HTTP_NOT_FOUND_CODE, "text/plain", "Not found: " + this->uri());
+}
+
+const char *MszHttpServer::method()
+{
+    return this->requestMethod;
+}
+
+uint32_t MszHttpServer::remoteAddress()
+{
+    return (this->current == NULL) ? 0 : (uint32_t)this->current->client.remoteIP();
+}
+
+String MszHttpServer::uri()
+{
+    if (this->current == NULL)
+    {
+        return String();
+    }
+    char path[MAX_HTTP_VALUE_LENGTH];
+    httpCopySpan(this->current->buffer, this->request.path, path, sizeof(path));
+    return String(path);
+}
+
+String MszHttpServer::arg(const char *name)
+{
+    char value[MAX_HTTP_VALUE_LENGTH];
+    if (this->current == NULL || !httpGetParam(this->current->buffer, this->request, name, value, sizeof(value)))
+    {
+        return String();
+    }
+    return String(value);
+}
+
+String MszHttpServer::header(const char *name)
+{
+    char value[MAX_HTTP_VALUE_LENGTH];
+    if (this->current == NULL || !httpGetHeader(this->current->buffer, this->request, name, value, sizeof(value)))
+    {
+        return String();
+    }
+    return String(value);
+}
+
+void MszHttpServer::sendHeader(const char *name, const char *value)
+{
+    this->pendingHeaders += name;
+    this->pendingHeaders += ": ";
+    this->pendingHeaders += value;
+    this->pendingHeaders += "\r\n";
+}
+
+void MszHttpServer::send(int statusCode, const char *contentType, const String &content)
+{
+    if (this->current == NULL || this->responseSent)
+    {
+        return;
+    }
+    String head = this->buildHead(statusCode, contentType, content.length());
+    if (content.length() <= MAX_COALESCED_BODY_LENGTH)
+    {
+        head += content;
+        this->current->client.write((const uint8_t *)head.c_str(), head.length());
+    }
+    else
+    {
+        this->current->client.write((const uint8_t *)head.c_str(), head.length());
+        this->current->client.write((const uint8_t *)content.c_str(), content.length());
+    }
+}
+
+void MszHttpServer::beginChunked(int statusCode, const char *contentType)
+{
+    if (this->current == NULL || this->responseSent)
+    {
+        return;
+    }
+    this->chunked = true;
+    String head = this->buildHead(statusCode, contentType, -1);
+    this->current->client.write((const uint8_t *)head.c_str(), head.length());
+}
+
+void MszHttpServer::sendChunk(const char *data, size_t length)
+{
+    // An empty chunk would end the response early.
+    if (this->current == NULL || !this->chunked || length == 0)
+    {
+        return;
+    }
+    if (this->request.http11)
+    {
+        char size[12];
+        snprintf(size, sizeof(size), "%X\r\n", (unsigned int)length);
+        this->current->client.write((const uint8_t *)size, strlen(size));
+        this->current->client.write((const uint8_t *)data, length);
+        this->current->client.write((const uint8_t *)"\r\n", 2);
+    }
+    else
+    {
+        this->current->client.write((const uint8_t *)data, length);
+    }
+}
+
+void MszHttpServer::endChunked()
+{
+    if (this->current == NULL || !this->chunked)
+    {
+        return;
+    }
+    if (this->request.http11)
+    {
+        this->current->client.write((const uint8_t *)"0\r\n\r\n", 5);
+    }
+    this->chunked = false;
+}
+
+String MszHttpServer::buildHead(int statusCode, const char *contentType, long contentLength)
+{
+    this->responseSent = true;
+
+    // HTTP/1.0 clients cannot read chunked responses, the end of the connection ends those responses instead.
+    if (contentLength < 0 && !this->request.http11)
+    {
+        this->closeAfterResponse = true;
+    }
+
+    String head;
+    head.reserve(160 + this->pendingHeaders.length());
+    head = "HTTP/1.1 ";
+    head += statusCode;
+    head += " ";
+    head += httpStatusText(statusCode);
+    head += "\r\nContent-Type: ";
+    head += contentType;
+    if (contentLength >= 0)
+    {
+        head += "\r\nContent-Length: ";
+        head += contentLength;
+    }
+    else if (this->request.http11)
+    {
+        head += "\r\nTransfer-Encoding: chunked";
+    }
+    if (this->closeAfterResponse)
+    {
+        head += "\r\nConnection: close\r\n";
+    }
+    else
+    {
+        head += "\r\nConnection: keep-alive\r\nKeep-Alive: timeout=";
+        head += (int)(IDLE_TIMEOUT_MS / 1000);
+        head += ", max=";
+        head += MAX_REQUESTS_PER_CONNECTION - this->current->requestCount - 1;
+        head += "\r\n";
+    }
+    head += this->pendingHeaders;
+    head += "\r\n";
+    this->pendingHeaders = "";
+    return head;
+}
+
+void MszHttpServer::sendError(WiFiClient &client, int statusCode)
+{
+    String response = "HTTP/1.1 " + String(statusCode) + " " + String(httpStatusText(statusCode)) +
+                      "\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+    client.write((const uint8_t *)response.c_str(), response.length());
+}
+
+void MszHttpServer::closeConnection(Connection &connection)
+{
+    connection.client.stop();
+    connection.inUse = false;
+    connection.length = 0;
+    connection.requestCount = 0;
+}
+
+int MszHttpServer::countOpenConnections()
+{
+    int open = 0;
+    for (int i = 0; i < MAX_HTTP_CONNECTIONS; i++)
+    {
+        if (this->connections[i].inUse)
+        {
+            open++;
+        }
+    }
+    return open;
+}
+
+#endif // ESP32 || ESP8266
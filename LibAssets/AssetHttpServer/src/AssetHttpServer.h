@@ -0,0 +1,103 @@
+#ifndef MSZ_ASSETHTTPSERVER_H
+#define MSZ_ASSETHTTPSERVER_H
+
+// Serves on the WiFiServer of the ESP cores, native builds use MszAsyncHttpServer instead.
+#if defined(ESP32) || defined(ESP8266)
+
+#include <Arduino.h>
+#include <functional>
+#if defined(ESP32)
+#include <WiFi.h>
+#else
+#include <ESP8266WiFi.h>
+#endif
+#include "AssetMetrics.h"
+#include "AssetHttpParser.h"
+
+#ifndef MAX_HTTP_CONNECTIONS
+#define MAX_HTTP_CONNECTIONS 4
+#endif
+#define MAX_HTTP_METHOD_LENGTH 8
+#define MAX_HTTP_VALUE_LENGTH 256
+
+typedef std::function<void()> MszHttpHandler;
+
+/// @class MszHttpServer
+/// @brief Web server with persistent HTTP/1.1 connections, the keep-alive alternative to the Arduino WebServer.
+/// @details Keeps up to MAX_HTTP_CONNECTIONS connections open, a connection idle for longer than IDLE_TIMEOUT_MS is
+///          closed and further clients are answered with 503 while all slots are in use. Requests a client sends
+///          without waiting for the responses (pipelining) are served in the order they arrived, at most
+///          MAX_REQUESTS_PER_PASS per connection on one call of handleClient() to keep the loop responsive.
+///          Handlers access the current request and send their response through the methods below, like they
+///          do with the WebServer.
+class MszHttpServer
+{
+public:
+    MszHttpServer(int port = 80);
+
+    void begin();
+    void handleClient();
+    // All requests go to the one handler, which routes them on its own.
+    void onRequest(MszHttpHandler handler);
+
+    // Current request.
+    const char *method();
+    String uri();
+    String arg(const char *name);
+    String header(const char *name);
+    uint32_t remoteAddress(); // IPv4 address of the client, 0 outside of a request.
+
+    // Response to the current request, sendHeader() adds headers to the next response sent.
+    void sendHeader(const char *name, const char *value);
+    void send(int statusCode, const char *contentType, const String &content);
+    void beginChunked(int statusCode, const char *contentType);
+    void sendChunk(const char *data, size_t length);
+    void endChunked();
+
+    static const uint32_t IDLE_TIMEOUT_MS = 5000;
+    static const int MAX_REQUESTS_PER_CONNECTION = 100;
+    static const int MAX_REQUESTS_PER_PASS = 4;
+
+    // Header and body of small responses go out in a single write and thus a single packet.
+    static const size_t MAX_COALESCED_BODY_LENGTH = 1024;
+
+protected:
+    struct Connection
+    {
+        bool inUse;
+        WiFiClient client;
+        char buffer[HTTP_MAX_REQUEST_LENGTH];
+        size_t length;
+        uint32_t lastActivityMillis;
+        int requestCount;
+    };
+
+    WiFiServer server;
+    MszHttpHandler requestHandler;
+    Connection connections[MAX_HTTP_CONNECTIONS];
+
+    // State of the request currently being handled.
+    Connection *current;
+    HttpRequest request;
+    char requestMethod[MAX_HTTP_METHOD_LENGTH];
+    String pendingHeaders;
+    bool responseSent;
+    bool chunked;
+    bool closeAfterResponse;
+
+    MszGauge *openConnectionsMetric;
+    MszCounter *rejectedConnectionsMetric;
+    MszCounter *reusedConnectionsMetric;
+
+    void acceptConnections();
+    void serveConnection(Connection &connection);
+    void dispatch();
+    String buildHead(int statusCode, const char *contentType, long contentLength);
+    void sendError(WiFiClient &client, int statusCode);
+    void closeConnection(Connection &connection);
+    int countOpenConnections();
+};
+
+#endif // ESP32 || ESP8266
+
+#endif // MSZ_ASSETHTTPSERVER_H
@@ -0,0 +1,115 @@
+#include <Arduino.h>
+
+#include "AssetLoopProfiler.h"
+
+MszLoopPhaseStats MszLoopProfiler::phases[MszLoopProfiler::MAX_PHASES];
+MszLoopPhaseStats MszLoopProfiler::iteration;
+int MszLoopProfiler::phaseCount = 0;
+uint32_t MszLoopProfiler::budgetMicros = 0;
+uint32_t MszLoopProfiler::overBudgetCount = 0;
+unsigned long MszLoopProfiler::iterationStartMicros = 0;
+unsigned long MszLoopProfiler::phaseStartMicros = 0;
+
+void MszLoopPhaseStats::record(uint32_t micros)
+{
+    if (this->count == 0 || micros < this->minMicros)
+    {
+        this->minMicros = micros;
+    }
+    if (micros > this->maxMicros)
+    {
+        this->maxMicros = micros;
+    }
+    this->count++;
+    this->sumMicros += micros;
+
+    int bucket = (micros == 0 ? 0 : 32 - __builtin_clz(micros));
+    this->histogram[bucket < HISTOGRAM_BUCKETS ? bucket : HISTOGRAM_BUCKETS - 1]++;
+}
+
+void MszLoopPhaseStats::reset()
+{
+    this->count = 0;
+    this->minMicros = 0;
+    this->maxMicros = 0;
+    this->sumMicros = 0;
+    memset(this->histogram, 0, sizeof(this->histogram));
+}
+
+uint32_t MszLoopPhaseStats::getPercentile(int percent) const
+{
+    if (this->count == 0)
+    {
+        return 0;
+    }
+
+    uint32_t target = (uint32_t)(((uint64_t)this->count * percent + 99) / 100);
+    uint32_t seen = 0;
+    for (int bucket = 0; bucket < HISTOGRAM_BUCKETS; bucket++)
+    {
+        seen += this->histogram[bucket];
+        if (seen >= target)
+        {
+            uint32_t upperBound = this->getBucketUpperBound(bucket);
+            return upperBound < this->maxMicros ? upperBound : this->maxMicros;
+        }
+    }
+    return this->maxMicros;
+}
+
+uint32_t MszLoopPhaseStats::getBucketUpperBound(int bucket) const
+{
+    if (bucket >= HISTOGRAM_BUCKETS - 1)
+    {
+        return UINT32_MAX;
+    }
+    return (1UL << bucket) - 1;
+}
+
+void MszLoopProfiler::setup(const char *const phaseNames[], int phaseCount, uint32_t budgetMicros)
+{
+    MszLoopProfiler::phaseCount = (phaseCount < MAX_PHASES ? phaseCount : MAX_PHASES);
+    for (int i = 0; i < MszLoopProfiler::phaseCount; i++)
+    {
+        phases[i].name = phaseNames[i];
+    }
+    iteration.name = "iteration";
+    MszLoopProfiler::budgetMicros = budgetMicros;
+    reset();
+}
+
+void MszLoopProfiler::beginIteration()
+{
+    iterationStartMicros = micros();
+    phaseStartMicros = iterationStartMicros;
+}
+
+void MszLoopProfiler::endPhase(int phaseId)
+{
+    unsigned long nowMicros = micros();
+    if (phaseId >= 0 && phaseId < phaseCount)
+    {
+        phases[phaseId].record(nowMicros - phaseStartMicros);
+    }
+    phaseStartMicros = nowMicros;
+}
+
+void MszLoopProfiler::endIteration()
+{
+    uint32_t iterationMicros = micros() - iterationStartMicros;
+    iteration.record(iterationMicros);
+    if (budgetMicros > 0 && iterationMicros > budgetMicros)
+    {
+        overBudgetCount++;
+    }
+}
+
+void MszLoopProfiler::reset()
+{
+    for (int i = 0; i < phaseCount; i++)
+    {
+        phases[i].reset();
+    }
+    iteration.reset();
+    overBudgetCount = 0;
+}
@@ -0,0 +1,75 @@
+#ifndef MSZ_ASSETLOOPPROFILER_H
+#define MSZ_ASSETLOOPPROFILER_H
+
+#include <Arduino.h>
+
+/*
+ * The profiler is only compiled into the loop when MSZ_LOOP_PROFILER is defined in the build flags,
+ * otherwise the macros below expand to no-ops and the loop is not touched at all.
+ */
+#if defined(MSZ_LOOP_PROFILER)
+#define MSZ_LOOP_PROFILER_SETUP(phaseNames, phaseCount, budgetMicros) MszLoopProfiler::setup(phaseNames, phaseCount, budgetMicros)
+#define MSZ_LOOP_PROFILER_BEGIN() MszLoopProfiler::beginIteration()
+#define MSZ_LOOP_PROFILER_PHASE(phaseId) MszLoopProfiler::endPhase(phaseId)
+#define MSZ_LOOP_PROFILER_END() MszLoopProfiler::endIteration()
+#else
+#define MSZ_LOOP_PROFILER_SETUP(phaseNames, phaseCount, budgetMicros) ((void)0)
+#define MSZ_LOOP_PROFILER_BEGIN() ((void)0)
+#define MSZ_LOOP_PROFILER_PHASE(phaseId) ((void)0)
+#define MSZ_LOOP_PROFILER_END() ((void)0)
+#endif
+
+/// @class MszLoopPhaseStats
+/// @brief Duration statistics of one loop phase with a power-of-two histogram in microseconds.
+/// @details Bucket 0 holds zero durations, bucket b holds durations from 2^(b-1) to 2^b - 1 microseconds and the last
+///          bucket everything above. Percentiles are reported as the upper bound of the bucket they fall into.
+class MszLoopPhaseStats
+{
+public:
+    static const int HISTOGRAM_BUCKETS = 24;
+
+    void record(uint32_t micros);
+    void reset();
+    uint32_t getPercentile(int percent) const;
+    uint32_t getBucketUpperBound(int bucket) const;
+
+    const char *name = "";
+    uint32_t count = 0;
+    uint32_t minMicros = 0;
+    uint32_t maxMicros = 0;
+    uint64_t sumMicros = 0;
+    uint32_t histogram[HISTOGRAM_BUCKETS] = {0};
+};
+
+/// @class MszLoopProfiler
+/// @brief Measures how long each phase of the Arduino loop() takes and how often an iteration exceeds its budget.
+/// @details Only ever called from the loop task, hence no synchronization. Each phase costs one micros() call and
+///          a few additions, use the MSZ_LOOP_PROFILER_* macros so that builds without the profiler pay nothing.
+class MszLoopProfiler
+{
+public:
+    static const int MAX_PHASES = 6;
+
+    static void setup(const char *const phaseNames[], int phaseCount, uint32_t budgetMicros);
+    static void beginIteration();
+    static void endPhase(int phaseId);
+    static void endIteration();
+    static void reset();
+
+    static int getPhaseCount() { return phaseCount; }
+    static const MszLoopPhaseStats &getPhase(int phaseId) { return phases[phaseId]; }
+    static const MszLoopPhaseStats &getIteration() { return iteration; }
+    static uint32_t getBudgetMicros() { return budgetMicros; }
+    static uint32_t getOverBudgetCount() { return overBudgetCount; }
+
+private:
+    static MszLoopPhaseStats phases[MAX_PHASES];
+    static MszLoopPhaseStats iteration;
+    static int phaseCount;
+    static uint32_t budgetMicros;
+    static uint32_t overBudgetCount;
+    static unsigned long iterationStartMicros;
+    static unsigned long phaseStartMicros;
+};
+
+#endif // MSZ_ASSETLOOPPROFILER_H
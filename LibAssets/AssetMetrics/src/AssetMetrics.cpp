@@ -0,0 +1,192 @@
+#include <Arduino.h>
+
+#include "AssetMetrics.h"
+
+const uint32_t MszHistogram::BUCKET_BOUNDS_MICROS[MszHistogram::BUCKET_COUNT] = {
+    100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 1000000};
+
+MszMetricsRegistry::MetricEntry MszMetricsRegistry::entries[MszMetricsRegistry::MAX_METRICS];
+int MszMetricsRegistry::entryCount = 0;
+
+MszCounter MszMetricsRegistry::counters[MszMetricsRegistry::MAX_COUNTERS];
+MszGauge MszMetricsRegistry::gauges[MszMetricsRegistry::MAX_GAUGES];
+MszHistogram MszMetricsRegistry::histograms[MszMetricsRegistry::MAX_HISTOGRAMS];
+int MszMetricsRegistry::counterCount = 0;
+int MszMetricsRegistry::gaugeCount = 0;
+int MszMetricsRegistry::histogramCount = 0;
+
+MszCounter MszMetricsRegistry::sinkCounter;
+MszGauge MszMetricsRegistry::sinkGauge;
+MszHistogram MszMetricsRegistry::sinkHistogram;
+
+void MszHistogram::observe(uint32_t micros)
+{
+    int index = 0;
+    while (index < BUCKET_COUNT && micros > BUCKET_BOUNDS_MICROS[index])
+    {
+        index++;
+    }
+    this->buckets[index].fetch_add(1, std::memory_order_relaxed);
+    this->count.fetch_add(1, std::memory_order_relaxed);
+    this->sumMicros.fetch_add(micros, std::memory_order_relaxed);
+}
+
+MszCounter *MszMetricsRegistry::registerCounter(const char *name, const char *help, const char *labels)
+{
+    if (counterCount >= MAX_COUNTERS || !addEntry(MetricType::Counter, name, help, labels, &counters[counterCount]))
+    {
+        Serial.println("MszMetricsRegistry::registerCounter - registry full, metric not exported");
+        return &sinkCounter;
+    }
+    return &counters[counterCount++];
+}
+
+MszGauge *MszMetricsRegistry::registerGauge(const char *name, const char *help, const char *labels)
+{
+    if (gaugeCount >= MAX_GAUGES || !addEntry(MetricType::Gauge, name, help, labels, &gauges[gaugeCount]))
+    {
+        Serial.println("MszMetricsRegistry::registerGauge - registry full, metric not exported");
+        return &sinkGauge;
+    }
+    return &gauges[gaugeCount++];
+}
+
+MszHistogram *MszMetricsRegistry::registerHistogram(const char *name, const char *help, const char *labels)
+{
+    if (histogramCount >= MAX_HISTOGRAMS || !addEntry(MetricType::Histogram, name, help, labels, &histograms[histogramCount]))
+    {
+        Serial.println("MszMetricsRegistry::registerHistogram - registry full, metric not exported");
+        return &sinkHistogram;
+    }
+    return &histograms[histogramCount++];
+}
+
+bool MszMetricsRegistry::addEntry(MetricType type, const char *name, const char *help, const char *labels, void *metric)
+{
+    if (entryCount >= MAX_METRICS)
+    {
+        return false;
+    }
+
+    MetricEntry &entry = entries[entryCount];
+    entry.type = type;
+    entry.help = help;
+    strncpy(entry.name, name, MAX_METRIC_NAME_LENGTH);
+    entry.name[MAX_METRIC_NAME_LENGTH] = '\0';
+    strncpy(entry.labels, labels != nullptr ? labels : "", MAX_METRIC_LABELS_LENGTH);
+    entry.labels[MAX_METRIC_LABELS_LENGTH] = '\0';
+    entry.metric = metric;
+    entryCount++;
+    return true;
+}
+
+void MszMetricsRegistry::writePrometheus(Print &output)
+{
+    // Lines end with a bare LF, Prometheus rejects the CR println() would add.
+    // The text format also requires all samples of a metric family to follow its HELP and TYPE lines, but per-endpoint
+    // metrics get registered lazily and interleaved with others. So each family is written when its first entry is seen.
+    for (int i = 0; i < entryCount; i++)
+    {
+        bool alreadyWritten = false;
+        for (int j = 0; j < i && !alreadyWritten; j++)
+        {
+            alreadyWritten = strcmp(entries[j].name, entries[i].name) == 0;
+        }
+        if (alreadyWritten)
+        {
+            continue;
+        }
+
+        const MetricEntry &family = entries[i];
+        output.print("# HELP ");
+        output.print(family.name);
+        output.print(' ');
+        output.print(family.help);
+        output.print('\n');
+        output.print("# TYPE ");
+        output.print(family.name);
+        output.print(family.type == MetricType::Counter ? " counter\n" : family.type == MetricType::Gauge ? " gauge\n" : " histogram\n");
+
+        for (int k = i; k < entryCount; k++)
+        {
+            const MetricEntry &entry = entries[k];
+            if (strcmp(entry.name, family.name) != 0)
+            {
+                continue;
+            }
+
+            if (entry.type == MetricType::Counter)
+            {
+                writeSample(output, entry.name, "", entry.labels, nullptr);
+                output.print(static_cast<MszCounter *>(entry.metric)->get());
+                output.print('\n');
+            }
+            else if (entry.type == MetricType::Gauge)
+            {
+                writeSample(output, entry.name, "", entry.labels, nullptr);
+                output.print(static_cast<MszGauge *>(entry.metric)->get());
+                output.print('\n');
+            }
+            else
+            {
+                const MszHistogram *histogram = static_cast<MszHistogram *>(entry.metric);
+                uint32_t cumulative = 0;
+                char bucketLabel[24];
+                for (int b = 0; b < MszHistogram::BUCKET_COUNT; b++)
+                {
+                    cumulative += histogram->getBucket(b);
+                    uint32_t bound = MszHistogram::BUCKET_BOUNDS_MICROS[b];
+                    snprintf(bucketLabel, sizeof(bucketLabel), "le=\"%u.%06u\"",
+                             (unsigned)(bound / 1000000), (unsigned)(bound % 1000000));
+                    writeSample(output, entry.name, "_bucket", entry.labels, bucketLabel);
+                    output.print(cumulative);
+                    output.print('\n');
+                }
+                cumulative += histogram->getBucket(MszHistogram::BUCKET_COUNT);
+                writeSample(output, entry.name, "_bucket", entry.labels, "le=\"+Inf\"");
+                output.print(cumulative);
+                output.print('\n');
+                writeSample(output, entry.name, "_sum", entry.labels, nullptr);
+                writeSeconds(output, histogram->getSumMicros());
+                output.print('\n');
+                writeSample(output, entry.name, "_count", entry.labels, nullptr);
+                output.print(histogram->getCount());
+                output.print('\n');
+            }
+        }
+    }
+}
+
+void MszMetricsRegistry::writeSample(Print &output, const char *name, const char *suffix, const char *labels, const char *extraLabel)
+{
+    output.print(name);
+    output.print(suffix);
+
+    bool hasLabels = labels[0] != '\0';
+    bool hasExtraLabel = extraLabel != nullptr;
+    if (hasLabels || hasExtraLabel)
+    {
+        output.print('{');
+        if (hasLabels)
+        {
+            output.print(labels);
+        }
+        if (hasLabels && hasExtraLabel)
+        {
+            output.print(',');
+        }
+        if (hasExtraLabel)
+        {
+            output.print(extraLabel);
+        }
+        output.print('}');
+    }
+    output.print(' ');
+}
+
+void MszMetricsRegistry::writeSeconds(Print &output, uint32_t micros)
+{
+    char seconds[16];
+    snprintf(seconds, sizeof(seconds), "%u.%06u", (unsigned)(micros / 1000000), (unsigned)(micros % 1000000));
+    output.print(seconds);
+}
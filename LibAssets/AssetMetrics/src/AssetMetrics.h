@@ -0,0 +1,111 @@
+#ifndef MSZ_ASSETMETRICS_H
+#define MSZ_ASSETMETRICS_H
+
+#include <Arduino.h>
+#include <atomic>
+
+#define MAX_METRIC_NAME_LENGTH 63
+#define MAX_METRIC_LABELS_LENGTH 47
+
+/// @class MszCounter
+/// @brief Monotonic counter, updating it is a single relaxed atomic add.
+class MszCounter
+{
+public:
+    void increment(uint32_t amount = 1) { this->value.fetch_add(amount, std::memory_order_relaxed); }
+    uint32_t get() const { return this->value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint32_t> value{0};
+};
+
+/// @class MszGauge
+/// @brief Value that can go up and down such as free heap, updating it is a single relaxed atomic store.
+class MszGauge
+{
+public:
+    void set(int32_t newValue) { this->value.store(newValue, std::memory_order_relaxed); }
+    int32_t get() const { return this->value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<int32_t> value{0};
+};
+
+/// @class MszHistogram
+/// @brief Latency histogram with fixed buckets in microseconds.
+/// @details Observing a value scans the few bucket bounds and does three relaxed atomic adds. The sum is kept in
+///          32 bit microseconds and wraps after about 71 minutes of accumulated time, which Prometheus treats like a reset.
+class MszHistogram
+{
+public:
+    static const int BUCKET_COUNT = 12;
+    static const uint32_t BUCKET_BOUNDS_MICROS[BUCKET_COUNT];
+
+    void observe(uint32_t micros);
+    uint32_t getBucket(int index) const { return this->buckets[index].load(std::memory_order_relaxed); }
+    uint32_t getCount() const { return this->count.load(std::memory_order_relaxed); }
+    uint32_t getSumMicros() const { return this->sumMicros.load(std::memory_order_relaxed); }
+
+private:
+    // The last bucket holds all observations above the largest bound (+Inf).
+    std::atomic<uint32_t> buckets[BUCKET_COUNT + 1] = {};
+    std::atomic<uint32_t> count{0};
+    std::atomic<uint32_t> sumMicros{0};
+};
+
+/// @class MszMetricsRegistry
+/// @brief Fixed-size registry of all metrics of an asset, exported in the Prometheus text format.
+/// @details Metrics are registered once during setup and live for the lifetime of the firmware. When the registry
+///          is full, registration returns a shared sink metric which is never exported, so callers never need null checks.
+class MszMetricsRegistry
+{
+public:
+    static const int MAX_COUNTERS = 32;
+    static const int MAX_GAUGES = 8;
+    static const int MAX_HISTOGRAMS = 16;
+
+    static MszCounter *registerCounter(const char *name, const char *help, const char *labels = "");
+    static MszGauge *registerGauge(const char *name, const char *help, const char *labels = "");
+    static MszHistogram *registerHistogram(const char *name, const char *help, const char *labels = "");
+
+    static void writePrometheus(Print &output);
+
+private:
+    enum class MetricType
+    {
+        Counter,
+        Gauge,
+        Histogram
+    };
+
+    struct MetricEntry
+    {
+        MetricType type;
+        const char *help;
+        char name[MAX_METRIC_NAME_LENGTH + 1];
+        char labels[MAX_METRIC_LABELS_LENGTH + 1];
+        void *metric;
+    };
+
+    static const int MAX_METRICS = MAX_COUNTERS + MAX_GAUGES + MAX_HISTOGRAMS;
+
+    static MetricEntry entries[MAX_METRICS];
+    static int entryCount;
+
+    static MszCounter counters[MAX_COUNTERS];
+    static MszGauge gauges[MAX_GAUGES];
+    static MszHistogram histograms[MAX_HISTOGRAMS];
+    static int counterCount;
+    static int gaugeCount;
+    static int histogramCount;
+
+    static MszCounter sinkCounter;
+    static MszGauge sinkGauge;
+    static MszHistogram sinkHistogram;
+
+    static bool addEntry(MetricType type, const char *name, const char *help, const char *labels, void *metric);
+    static void writeSample(Print &output, const char *name, const char *suffix, const char *labels, const char *extraLabel);
+    static void writeSeconds(Print &output, uint32_t micros);
+};
+
+#endif // MSZ_ASSETMETRICS_H
@@ -0,0 +1,264 @@
+#include "Arduino.h"
+
+// Only for native builds, the ESP cores bring their own.
+#if !defined(ESP32) && !defined(ESP8266)
+
+#include <ctype.h>
+
+HardwareSerial Serial;
+EspClass ESP;
+
+static unsigned long long virtualMicros = 0;
+
+String::String(double value, unsigned int decimalPlaces)
+{
+    char buffer[64];
+    snprintf(buffer, sizeof(buffer), "%.*f", (int)decimalPlaces, value);
+    this->value = buffer;
+}
+
+bool String::reserve(unsigned int size)
+{
+    this->value.reserve(size);
+    return true;
+}
+
+bool String::concat(const String &other)
+{
+    this->value += other.value;
+    return true;
+}
+
+bool String::concat(const char *other)
+{
+    if (other == NULL)
+    {
+        return false;
+    }
+    this->value += other;
+    return true;
+}
+
+bool String::concat(const char *other, unsigned int length)
+{
+    if (other == NULL)
+    {
+        return false;
+    }
+    this->value.append(other, length);
+    return true;
+}
+
+bool String::concat(char other)
+{
+    this->value += other;
+    return true;
+}
+
+int String::indexOf(char character, unsigned int fromIndex) const
+{
+    size_t position = this->value.find(character, fromIndex);
+    return position != std::string::npos ? (int)position : -1;
+}
+
+int String::indexOf(const String &other, unsigned int fromIndex) const
+{
+    size_t position = this->value.find(other.value, fromIndex);
+    return position != std::string::npos ? (int)position : -1;
+}
+
+String String::substring(unsigned int beginIndex) const
+{
+    return this->substring(beginIndex, this->value.length());
+}
+
+String String::substring(unsigned int beginIndex, unsigned int endIndex) const
+{
+    if (beginIndex > endIndex)
+    {
+        unsigned int swap = beginIndex;
+        beginIndex = endIndex;
+        endIndex = swap;
+    }
+    if (beginIndex >= this->value.length())
+    {
+        return String();
+    }
+    if (endIndex > this->value.length())
+    {
+        endIndex = this->value.length();
+    }
+    return String(this->value.substr(beginIndex, endIndex - beginIndex));
+}
+
+bool String::startsWith(const String &prefix) const
+{
+    return this->value.compare(0, prefix.value.length(), prefix.value) == 0;
+}
+
+bool String::endsWith(const String &suffix) const
+{
+    return this->value.length() >= suffix.value.length() &&
+           this->value.compare(this->value.length() - suffix.value.length(), suffix.value.length(), suffix.value) == 0;
+}
+
+void String::toCharArray(char *buffer, unsigned int bufferSize) const
+{
+    if (bufferSize == 0 || buffer == NULL)
+    {
+        return;
+    }
+    size_t length = this->value.length() < bufferSize - 1 ? this->value.length() : bufferSize - 1;
+    memcpy(buffer, this->value.c_str(), length);
+    buffer[length] = '\0';
+}
+
+void String::toLowerCase()
+{
+    for (size_t i = 0; i < this->value.length(); i++)
+    {
+        this->value[i] = tolower((unsigned char)this->value[i]);
+    }
+}
+
+void String::toUpperCase()
+{
+    for (size_t i = 0; i < this->value.length(); i++)
+    {
+        this->value[i] = toupper((unsigned char)this->value[i]);
+    }
+}
+
+void String::trim()
+{
+    size_t begin = this->value.find_first_not_of(" \t\r\n");
+    if (begin == std::string::npos)
+    {
+        this->value.clear();
+        return;
+    }
+    size_t end = this->value.find_last_not_of(" \t\r\n");
+    this->value = this->value.substr(begin, end - begin + 1);
+}
+
+String &String::operator+=(const String &other)
+{
+    this->concat(other);
+    return *this;
+}
+
+String &String::operator+=(const char *other)
+{
+    this->concat(other);
+    return *this;
+}
+
+String &String::operator+=(char other)
+{
+    this->concat(other);
+    return *this;
+}
+
+String operator+(const String &left, const String &right)
+{
+    String result(left);
+    result.concat(right);
+    return result;
+}
+
+String operator+(const String &left, const char *right)
+{
+    String result(left);
+    result.concat(right);
+    return result;
+}
+
+String operator+(const char *left, const String &right)
+{
+    String result(left);
+    result.concat(right);
+    return result;
+}
+
+String operator+(const String &left, char right)
+{
+    String result(left);
+    result.concat(right);
+    return result;
+}
+
+size_t Print::write(const uint8_t *buffer, size_t size)
+{
+    size_t written = 0;
+    while (written < size && this->write(buffer[written]) == 1)
+    {
+        written++;
+    }
+    return written;
+}
+
+size_t Print::printf(const char *format, ...)
+{
+    char buffer[256];
+    va_list arguments;
+    va_start(arguments, format);
+    int length = vsnprintf(buffer, sizeof(buffer), format, arguments);
+    va_end(arguments);
+    if (length < 0)
+    {
+        return 0;
+    }
+    return this->write((const uint8_t *)buffer, (size_t)length < sizeof(buffer) ? length : sizeof(buffer) - 1);
+}
+
+size_t Stream::readBytes(char *buffer, size_t length)
+{
+    size_t count = 0;
+    int value;
+    while (count < length && (value = this->read()) >= 0)
+    {
+        buffer[count++] = (char)value;
+    }
+    return count;
+}
+
+unsigned long millis()
+{
+    return (unsigned long)(virtualMicros / 1000);
+}
+
+unsigned long micros()
+{
+    return (unsigned long)virtualMicros;
+}
+
+void delay(unsigned long ms)
+{
+    virtualMicros += (unsigned long long)ms * 1000;
+}
+
+void delayMicroseconds(unsigned int us)
+{
+    virtualMicros += us;
+}
+
+void yield()
+{
+}
+
+long random(long maxValue)
+{
+    return maxValue > 0 ? rand() % maxValue : 0;
+}
+
+long random(long minValue, long maxValue)
+{
+    return maxValue > minValue ? minValue + random(maxValue - minValue) : minValue;
+}
+
+void randomSeed(unsigned long seed)
+{
+    srand(seed);
+}
+
+#endif // !ESP32 && !ESP8266
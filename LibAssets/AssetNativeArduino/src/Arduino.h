@@ -0,0 +1,186 @@
+#ifndef MSZ_NATIVE_ARDUINO_H
+#define MSZ_NATIVE_ARDUINO_H
+
+/*
+ * The parts of the Arduino core the asset libraries use, for native builds on the host, e.g. the unit tests and
+ * benchmarks in LibAssets/test. Time is virtual: millis() and micros() start at 0 and only move on with delay() and
+ * delayMicroseconds(), so tests control the clock of the code under test. Serial output is discarded.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdarg.h>
+#include <string>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+class __FlashStringHelper;
+#define F(string_literal) (string_literal)
+
+/// @class String
+/// @brief Arduino String on top of std::string.
+class String
+{
+public:
+    String() {}
+    String(const char *value) : value(value != NULL ? value : "") {}
+    String(const std::string &value) : value(value) {}
+    explicit String(char value) : value(1, value) {}
+    String(int value) : value(std::to_string(value)) {}
+    String(unsigned int value) : value(std::to_string(value)) {}
+    String(long value) : value(std::to_string(value)) {}
+    String(unsigned long value) : value(std::to_string(value)) {}
+    String(long long value) : value(std::to_string(value)) {}
+    String(unsigned long long value) : value(std::to_string(value)) {}
+    String(double value, unsigned int decimalPlaces = 2);
+
+    const char *c_str() const { return this->value.c_str(); }
+    unsigned int length() const { return this->value.length(); }
+    bool reserve(unsigned int size);
+
+    bool concat(const String &other);
+    bool concat(const char *other);
+    bool concat(const char *other, unsigned int length);
+    bool concat(char other);
+
+    int indexOf(char character, unsigned int fromIndex = 0) const;
+    int indexOf(const String &other, unsigned int fromIndex = 0) const;
+    String substring(unsigned int beginIndex) const;
+    String substring(unsigned int beginIndex, unsigned int endIndex) const;
+    bool equals(const String &other) const { return this->value == other.value; }
+    bool equalsIgnoreCase(const String &other) const { return strcasecmp(this->c_str(), other.c_str()) == 0; }
+    bool startsWith(const String &prefix) const;
+    bool endsWith(const String &suffix) const;
+    void toCharArray(char *buffer, unsigned int bufferSize) const;
+    long toInt() const { return atol(this->c_str()); }
+    void toLowerCase();
+    void toUpperCase();
+    void trim();
+
+    char operator[](unsigned int index) const { return index < this->value.length() ? this->value[index] : '\0'; }
+    String &operator+=(const String &other);
+    String &operator+=(const char *other);
+    String &operator+=(char other);
+    bool operator==(const String &other) const { return this->value == other.value; }
+    // Like on the devices, a NULL C string equals the empty String.
+    bool operator==(const char *other) const { return other != NULL ? this->value == other : this->value.empty(); }
+    bool operator!=(const String &other) const { return !(*this == other); }
+    bool operator!=(const char *other) const { return !(*this == other); }
+    bool operator<(const String &other) const { return this->value < other.value; }
+
+private:
+    std::string value;
+};
+
+String operator+(const String &left, const String &right);
+String operator+(const String &left, const char *right);
+String operator+(const char *left, const String &right);
+String operator+(const String &left, char right);
+
+class Print;
+
+/// @class Printable
+/// @brief Objects that can print themselves.
+class Printable
+{
+public:
+    virtual ~Printable() {}
+    virtual size_t printTo(Print &output) const = 0;
+};
+
+/// @class Print
+/// @brief Byte sink with the print functions of the Arduino core.
+class Print
+{
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t value) = 0;
+    virtual size_t write(const uint8_t *buffer, size_t size);
+    size_t write(const char *text) { return text != NULL ? this->write((const uint8_t *)text, strlen(text)) : 0; }
+    size_t write(const char *buffer, size_t size) { return this->write((const uint8_t *)buffer, size); }
+    virtual void flush() {}
+
+    size_t print(const char *text) { return this->write(text); }
+    size_t print(const String &text) { return this->write((const uint8_t *)text.c_str(), text.length()); }
+    size_t print(char value) { return this->write((uint8_t)value); }
+    size_t print(int value) { return this->print(String(value)); }
+    size_t print(unsigned int value) { return this->print(String(value)); }
+    size_t print(long value) { return this->print(String(value)); }
+    size_t print(unsigned long value) { return this->print(String(value)); }
+    size_t print(long long value) { return this->print(String(value)); }
+    size_t print(unsigned long long value) { return this->print(String(value)); }
+    size_t print(double value, int decimalPlaces = 2) { return this->print(String(value, decimalPlaces)); }
+    size_t print(const Printable &value) { return value.printTo(*this); }
+    size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+    size_t println() { return this->write("\r\n"); }
+    template <typename T>
+    size_t println(const T &value)
+    {
+        size_t written = this->print(value);
+        return written + this->println();
+    }
+};
+
+/// @class Stream
+/// @brief Byte source, nothing to read unless a derived class provides it.
+class Stream : public Print
+{
+public:
+    virtual int available() { return 0; }
+    virtual int read() { return -1; }
+    virtual int peek() { return -1; }
+    size_t readBytes(char *buffer, size_t length);
+    size_t readBytes(uint8_t *buffer, size_t length) { return this->readBytes((char *)buffer, length); }
+    void setTimeout(unsigned long timeoutMs) {}
+};
+
+/// @class HardwareSerial
+/// @brief Serial port that discards its output, the libraries log far too much for the test output.
+class HardwareSerial : public Stream
+{
+public:
+    void begin(unsigned long baudRate) {}
+    void end() {}
+    virtual size_t write(uint8_t value) override { return 1; }
+    virtual size_t write(const uint8_t *buffer, size_t size) override { return size; }
+    using Print::write;
+    operator bool() const { return true; }
+};
+
+extern HardwareSerial Serial;
+
+/// @class EspClass
+/// @brief System information of the ESP cores, the host reports no heap.
+class EspClass
+{
+public:
+    uint32_t getFreeHeap() { return 0; }
+    uint32_t getMaxAllocHeap() { return 0; }
+    uint32_t getMaxFreeBlockSize() { return 0; }
+    void restart() {}
+};
+
+extern EspClass ESP;
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+
+long random(long maxValue);
+long random(long minValue, long maxValue);
+void randomSeed(unsigned long seed);
+
+#define LOW 0x0
+#define HIGH 0x1
+#define INPUT 0x0
+#define OUTPUT 0x1
+
+#endif // MSZ_NATIVE_ARDUINO_H
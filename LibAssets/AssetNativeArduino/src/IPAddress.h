@@ -0,0 +1,34 @@
+#ifndef MSZ_NATIVE_IPADDRESS_H
+#define MSZ_NATIVE_IPADDRESS_H
+
+#include "Arduino.h"
+
+/// @class IPAddress
+/// @brief IPv4 address like the one of the Arduino cores: four bytes in network order, converting to a uint32_t with
+///        the first byte in the lowest bits on little-endian hosts, as on the devices.
+class IPAddress
+{
+public:
+    IPAddress() : address(0) {}
+    IPAddress(uint8_t first, uint8_t second, uint8_t third, uint8_t fourth)
+    {
+        uint8_t bytes[4] = {first, second, third, fourth};
+        memcpy(&this->address, bytes, sizeof(bytes));
+    }
+    IPAddress(uint32_t address) : address(address) {}
+
+    operator uint32_t() const { return this->address; }
+    uint8_t operator[](int index) const { return ((const uint8_t *)&this->address)[index]; }
+
+    String toString() const
+    {
+        char text[16];
+        snprintf(text, sizeof(text), "%u.%u.%u.%u", (*this)[0], (*this)[1], (*this)[2], (*this)[3]);
+        return String(text);
+    }
+
+private:
+    uint32_t address;
+};
+
+#endif // MSZ_NATIVE_IPADDRESS_H
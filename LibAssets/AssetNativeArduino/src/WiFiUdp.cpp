@@ -0,0 +1,140 @@
+#include "WiFiUdp.h"
+
+// Only for native builds, the ESP cores bring their own.
+#if !defined(ESP32) && !defined(ESP8266)
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+WiFiUDP::WiFiUDP()
+{
+    this->fd = -1;
+    this->receiveLength = 0;
+    this->receivePosition = 0;
+    this->remotePortNumber = 0;
+    this->sendLength = 0;
+    this->sendPort = 0;
+}
+
+WiFiUDP::~WiFiUDP()
+{
+    this->stop();
+}
+
+uint8_t WiFiUDP::begin(uint16_t port)
+{
+    this->stop();
+    this->fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (this->fd < 0)
+    {
+        return 0;
+    }
+    int enable = 1;
+    setsockopt(this->fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+    setsockopt(this->fd, SOL_SOCKET, SO_BROADCAST, &enable, sizeof(enable));
+
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(port);
+    int flags = fcntl(this->fd, F_GETFL, 0);
+    if (bind(this->fd, (struct sockaddr *)&address, sizeof(address)) != 0 || flags < 0 ||
+        fcntl(this->fd, F_SETFL, flags | O_NONBLOCK) != 0)
+    {
+        this->stop();
+        return 0;
+    }
+    return 1;
+}
+
+void WiFiUDP::stop()
+{
+    if (this->fd >= 0)
+    {
+        close(this->fd);
+        this->fd = -1;
+    }
+    this->receiveLength = 0;
+    this->receivePosition = 0;
+}
+
+int WiFiUDP::parsePacket()
+{
+    this->receiveLength = 0;
+    this->receivePosition = 0;
+    if (this->fd < 0)
+    {
+        return 0;
+    }
+
+    struct sockaddr_in sender;
+    socklen_t senderLength = sizeof(sender);
+    ssize_t received = recvfrom(this->fd, this->receiveBuffer, sizeof(this->receiveBuffer), 0, (struct sockaddr *)&sender, &senderLength);
+    if (received <= 0)
+    {
+        return 0;
+    }
+    this->receiveLength = received;
+    // The address stays in network order, the byte order IPAddress keeps.
+    this->remoteAddress = IPAddress((uint32_t)sender.sin_addr.s_addr);
+    this->remotePortNumber = ntohs(sender.sin_port);
+    return (int)received;
+}
+
+int WiFiUDP::available()
+{
+    return (int)(this->receiveLength - this->receivePosition);
+}
+
+int WiFiUDP::read(uint8_t *buffer, size_t length)
+{
+    size_t remaining = this->receiveLength - this->receivePosition;
+    size_t copied = (length < remaining) ? length : remaining;
+    memcpy(buffer, this->receiveBuffer + this->receivePosition, copied);
+    this->receivePosition += copied;
+    return (int)copied;
+}
+
+int WiFiUDP::beginPacket(IPAddress address, uint16_t port)
+{
+    this->sendAddress = address;
+    this->sendPort = port;
+    this->sendLength = 0;
+    return this->fd >= 0 ? 1 : 0;
+}
+
+size_t WiFiUDP::write(uint8_t value)
+{
+    return this->write(&value, 1);
+}
+
+size_t WiFiUDP::write(const uint8_t *buffer, size_t length)
+{
+    size_t space = sizeof(this->sendBuffer) - this->sendLength;
+    size_t copied = (length < space) ? length : space;
+    memcpy(this->sendBuffer + this->sendLength, buffer, copied);
+    this->sendLength += copied;
+    return copied;
+}
+
+int WiFiUDP::endPacket()
+{
+    if (this->fd < 0)
+    {
+        return 0;
+    }
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = (uint32_t)this->sendAddress;
+    address.sin_port = htons(this->sendPort);
+    ssize_t sent = sendto(this->fd, this->sendBuffer, this->sendLength, 0, (struct sockaddr *)&address, sizeof(address));
+    this->sendLength = 0;
+    return sent >= 0 ? 1 : 0;
+}
+
+#endif // !ESP32 && !ESP8266
@@ -0,0 +1,49 @@
+#ifndef MSZ_NATIVE_WIFIUDP_H
+#define MSZ_NATIVE_WIFIUDP_H
+
+#include "Arduino.h"
+#include "IPAddress.h"
+
+// Largest datagram a native WiFiUDP receives, like the single Ethernet frame the ESP cores buffer.
+#define NATIVE_UDP_BUFFER_SIZE 1500
+
+/// @class WiFiUDP
+/// @brief The WiFiUDP of the ESP cores on a non-blocking POSIX socket, so the UDP code runs on the host over loopback.
+/// @details parsePacket() receives the next datagram into a buffer that read() consumes, a datagram that was not
+///          read completely is discarded by the next parsePacket(). Sending collects the datagram between
+///          beginPacket() and endPacket().
+class WiFiUDP
+{
+public:
+    WiFiUDP();
+    ~WiFiUDP();
+
+    uint8_t begin(uint16_t port);
+    void stop();
+
+    int parsePacket();
+    int available();
+    int read(uint8_t *buffer, size_t length);
+    IPAddress remoteIP() const { return this->remoteAddress; }
+    uint16_t remotePort() const { return this->remotePortNumber; }
+
+    int beginPacket(IPAddress address, uint16_t port);
+    size_t write(uint8_t value);
+    size_t write(const uint8_t *buffer, size_t length);
+    int endPacket();
+
+private:
+    int fd;
+    uint8_t receiveBuffer[NATIVE_UDP_BUFFER_SIZE];
+    size_t receiveLength;
+    size_t receivePosition;
+    IPAddress remoteAddress;
+    uint16_t remotePortNumber;
+
+    uint8_t sendBuffer[NATIVE_UDP_BUFFER_SIZE];
+    size_t sendLength;
+    IPAddress sendAddress;
+    uint16_t sendPort;
+};
+
+#endif // MSZ_NATIVE_WIFIUDP_H
@@ -0,0 +1,309 @@
+#include <Arduino.h>
+
+#include "AssetScheduler.h"
+
+MszScheduler::MszScheduler(MszSchedulerClock clock)
+{
+    this->clock = clock;
+    for (int i = 0; i < SCHEDULER_WHEEL_SLOTS; i++)
+    {
+        this->slotHeads[i] = NO_TASK;
+    }
+    this->lastProcessedMs = this->clock();
+}
+
+int MszScheduler::addPeriodicTask(const char *name, std::function<void()> callback, unsigned long periodMs, uint8_t priority, unsigned long deadlineMs)
+{
+    return this->addTask(name, callback, (periodMs > 0 ? periodMs : 1), this->clock() + periodMs, priority, deadlineMs, false);
+}
+
+int MszScheduler::addOneShotTask(const char *name, std::function<void()> callback, unsigned long delayMs, uint8_t priority, unsigned long deadlineMs)
+{
+    return this->addTask(name, callback, 0, this->clock() + delayMs, priority, deadlineMs, false);
+}
+
+int MszScheduler::addContinuousTask(const char *name, std::function<void()> callback, uint8_t priority)
+{
+    return this->addTask(name, callback, 0, 0, priority, 0, true);
+}
+
+int MszScheduler::addTask(const char *name, std::function<void()> callback, unsigned long periodMs, unsigned long firstRunMs,
+                          uint8_t priority, unsigned long deadlineMs, bool continuous)
+{
+    if (this->taskCount >= MAX_SCHEDULER_TASKS)
+    {
+        Serial.println("MszScheduler::addTask - maximum number of tasks reached, not adding " + String(name));
+        return NO_TASK;
+    }
+
+    int taskId = this->taskCount++;
+    SchedulerTask &task = this->tasks[taskId];
+    task.name = name;
+    task.callback = callback;
+    task.periodMs = periodMs;
+    task.nextRunMs = firstRunMs;
+    task.deadlineMs = deadlineMs;
+    task.priority = priority;
+    task.continuous = continuous;
+    task.enabled = true;
+    task.inWheel = false;
+    task.nextInSlot = NO_TASK;
+
+    char labels[MAX_METRIC_LABELS_LENGTH + 1];
+    snprintf(labels, sizeof(labels), "task=\"%s\"", name);
+    task.deadlineMissesMetric = MszMetricsRegistry::registerCounter("scheduler_deadline_misses_total", "Task runs that started later than their deadline.", labels);
+
+    if (!continuous)
+    {
+        this->insertIntoWheel(taskId);
+    }
+    return taskId;
+}
+
+bool MszScheduler::setTaskPeriod(int taskId, unsigned long periodMs)
+{
+    if (taskId < 0 || taskId >= this->taskCount || this->tasks[taskId].continuous || periodMs == 0)
+    {
+        return false;
+    }
+
+    SchedulerTask &task = this->tasks[taskId];
+    if (task.periodMs == periodMs)
+    {
+        return true;
+    }
+    task.periodMs = periodMs;
+
+    // A waiting task is moved to the new period right away, a running task picks it up when it is rescheduled.
+    if (task.inWheel)
+    {
+        this->removeFromWheel(taskId);
+        task.nextRunMs = this->clock() + periodMs;
+        this->insertIntoWheel(taskId);
+    }
+    return true;
+}
+
+bool MszScheduler::scheduleTask(int taskId, unsigned long delayMs)
+{
+    if (taskId < 0 || taskId >= this->taskCount || this->tasks[taskId].continuous)
+    {
+        return false;
+    }
+
+    SchedulerTask &task = this->tasks[taskId];
+    if (task.inWheel)
+    {
+        this->removeFromWheel(taskId);
+    }
+    this->readyMask &= ~(1UL << taskId);
+    task.enabled = true;
+    task.nextRunMs = this->clock() + delayMs;
+    this->insertIntoWheel(taskId);
+    return true;
+}
+
+bool MszScheduler::setTaskEnabled(int taskId, bool enabled)
+{
+    if (taskId < 0 || taskId >= this->taskCount)
+    {
+        return false;
+    }
+
+    SchedulerTask &task = this->tasks[taskId];
+    if (task.enabled == enabled)
+    {
+        return true;
+    }
+
+    task.enabled = enabled;
+    if (!enabled)
+    {
+        if (task.inWheel)
+        {
+            this->removeFromWheel(taskId);
+        }
+        this->readyMask &= ~(1UL << taskId);
+    }
+    else if (!task.continuous)
+    {
+        task.nextRunMs = this->clock() + task.periodMs;
+        this->insertIntoWheel(taskId);
+    }
+    return true;
+}
+
+int MszScheduler::runPending()
+{
+    unsigned long nowMs = this->clock();
+    this->collectDueTasks(nowMs);
+    for (int i = 0; i < this->taskCount; i++)
+    {
+        if (this->tasks[i].continuous && this->tasks[i].enabled)
+        {
+            this->readyMask |= (1UL << i);
+        }
+    }
+
+    // Tasks becoming due while this pass runs, e.g. because a callback scheduled them, wait for the next pass.
+    uint32_t runMask = this->readyMask;
+    this->readyMask = 0;
+
+    int tasksRun = 0;
+    int taskId;
+    while ((taskId = this->takeHighestPriorityTask(runMask)) != NO_TASK)
+    {
+        this->runTask(taskId);
+        tasksRun++;
+    }
+    return tasksRun;
+}
+
+void MszScheduler::insertIntoWheel(int taskId)
+{
+    SchedulerTask &task = this->tasks[taskId];
+
+    // Anything due at or before the last processed slot would only be found a full wheel turn later.
+    if ((long)(this->lastProcessedMs - task.nextRunMs) >= 0)
+    {
+        this->readyMask |= (1UL << taskId);
+        return;
+    }
+
+    int slot = task.nextRunMs % SCHEDULER_WHEEL_SLOTS;
+    task.nextInSlot = this->slotHeads[slot];
+    this->slotHeads[slot] = taskId;
+    task.inWheel = true;
+}
+
+void MszScheduler::removeFromWheel(int taskId)
+{
+    SchedulerTask &task = this->tasks[taskId];
+    int *link = &this->slotHeads[task.nextRunMs % SCHEDULER_WHEEL_SLOTS];
+    while (*link != NO_TASK)
+    {
+        if (*link == taskId)
+        {
+            *link = task.nextInSlot;
+            break;
+        }
+        link = &this->tasks[*link].nextInSlot;
+    }
+    task.nextInSlot = NO_TASK;
+    task.inWheel = false;
+}
+
+void MszScheduler::collectDueTasks(unsigned long nowMs)
+{
+    unsigned long elapsedMs = nowMs - this->lastProcessedMs;
+    if (elapsedMs >= SCHEDULER_WHEEL_SLOTS)
+    {
+        for (int slot = 0; slot < SCHEDULER_WHEEL_SLOTS; slot++)
+        {
+            this->collectDueTasksInSlot(slot, nowMs);
+        }
+    }
+    else
+    {
+        for (unsigned long tickMs = this->lastProcessedMs + 1; tickMs != nowMs + 1; tickMs++)
+        {
+            this->collectDueTasksInSlot(tickMs % SCHEDULER_WHEEL_SLOTS, nowMs);
+        }
+    }
+    this->lastProcessedMs = nowMs;
+}
+
+void MszScheduler::collectDueTasksInSlot(int slot, unsigned long nowMs)
+{
+    // Slots are shared by all times modulo the wheel size, tasks further ahead stay for a later turn.
+    int *link = &this->slotHeads[slot];
+    while (*link != NO_TASK)
+    {
+        int taskId = *link;
+        SchedulerTask &task = this->tasks[taskId];
+        if ((long)(nowMs - task.nextRunMs) >= 0)
+        {
+            *link = task.nextInSlot;
+            task.nextInSlot = NO_TASK;
+            task.inWheel = false;
+            this->readyMask |= (1UL << taskId);
+        }
+        else
+        {
+            link = &task.nextInSlot;
+        }
+    }
+}
+
+int MszScheduler::takeHighestPriorityTask(uint32_t &taskMask)
+{
+    int selectedTaskId = NO_TASK;
+    for (int i = 0; i < this->taskCount; i++)
+    {
+        if ((taskMask & (1UL << i)) && (selectedTaskId == NO_TASK || this->tasks[i].priority < this->tasks[selectedTaskId].priority))
+        {
+            selectedTaskId = i;
+        }
+    }
+    if (selectedTaskId != NO_TASK)
+    {
+        taskMask &= ~(1UL << selectedTaskId);
+    }
+    return selectedTaskId;
+}
+
+void MszScheduler::runTask(int taskId)
+{
+    SchedulerTask &task = this->tasks[taskId];
+    if (!task.enabled)
+    {
+        return;
+    }
+
+    unsigned long startMs = this->clock();
+    if (!task.continuous)
+    {
+        unsigned long latenessMs = ((long)(startMs - task.nextRunMs) > 0 ? startMs - task.nextRunMs : 0);
+        if (latenessMs > task.stats.maxLatenessMs)
+        {
+            task.stats.maxLatenessMs = latenessMs;
+        }
+        if (task.deadlineMs > 0 && latenessMs > task.deadlineMs)
+        {
+            task.stats.deadlineMisses++;
+            task.deadlineMissesMetric->increment();
+        }
+    }
+
+    unsigned long startMicros = micros();
+    task.callback();
+    unsigned long runtimeMicros = micros() - startMicros;
+    task.stats.runs++;
+    if (runtimeMicros > task.stats.maxRuntimeMicros)
+    {
+        task.stats.maxRuntimeMicros = runtimeMicros;
+    }
+
+    // Reschedule periodic tasks unless the callback disabled or rescheduled the task itself.
+    bool rescheduledByCallback = task.inWheel || (this->readyMask & (1UL << taskId));
+    if (task.continuous || !task.enabled || rescheduledByCallback)
+    {
+        return;
+    }
+    if (task.periodMs == 0)
+    {
+        task.enabled = false;
+        return;
+    }
+
+    // Keep the period phase-stable, but skip periods that passed entirely instead of running the task back to back.
+    task.nextRunMs += task.periodMs;
+    unsigned long nowMs = this->clock();
+    if ((long)(nowMs - task.nextRunMs) >= 0)
+    {
+        unsigned long skippedPeriods = (nowMs - task.nextRunMs) / task.periodMs + 1;
+        task.stats.skippedPeriods += skippedPeriods;
+        task.nextRunMs += skippedPeriods * task.periodMs;
+    }
+    this->insertIntoWheel(taskId);
+}
@@ -0,0 +1,89 @@
+#ifndef MSZ_ASSETSCHEDULER_H
+#define MSZ_ASSETSCHEDULER_H
+
+#include <Arduino.h>
+#include <functional>
+#include "AssetMetrics.h"
+
+#define MAX_SCHEDULER_TASKS 16
+#define SCHEDULER_WHEEL_SLOTS 64
+
+/// @brief Clock the scheduler runs on in milliseconds, millis() on the device and a virtual clock in host tests.
+typedef unsigned long (*MszSchedulerClock)();
+
+/// @brief Statistics the scheduler keeps for every task.
+struct SchedulerTaskStats
+{
+    uint32_t runs = 0;
+    uint32_t deadlineMisses = 0;
+    uint32_t skippedPeriods = 0;
+    unsigned long maxLatenessMs = 0;
+    unsigned long maxRuntimeMicros = 0;
+};
+
+/// @class MszScheduler
+/// @brief Cooperative scheduler for periodic, one-shot and continuous tasks called from the Arduino loop().
+/// @details Timed tasks sit in a hashed timer wheel with one millisecond slots, so runPending() only looks at the
+///          slots that passed since its last call instead of at every task. Due tasks run in priority order, lower
+///          numbers first. Continuous tasks are due on every call and are meant for polling, e.g. the web server.
+///          A task that starts later than its deadline after becoming due counts as a deadline miss.
+class MszScheduler
+{
+public:
+    static const int NO_TASK = -1;
+    static const uint8_t PRIORITY_HIGH = 0;
+    static const uint8_t PRIORITY_NORMAL = 1;
+    static const uint8_t PRIORITY_LOW = 2;
+
+    MszScheduler(MszSchedulerClock clock = millis);
+
+    int addPeriodicTask(const char *name, std::function<void()> callback, unsigned long periodMs, uint8_t priority, unsigned long deadlineMs = 0);
+    int addOneShotTask(const char *name, std::function<void()> callback, unsigned long delayMs, uint8_t priority, unsigned long deadlineMs = 0);
+    int addContinuousTask(const char *name, std::function<void()> callback, uint8_t priority);
+
+    bool setTaskPeriod(int taskId, unsigned long periodMs);
+    bool scheduleTask(int taskId, unsigned long delayMs);
+    bool setTaskEnabled(int taskId, bool enabled);
+
+    // Runs all tasks due by now, returns the number of tasks run.
+    int runPending();
+
+    int getTaskCount() const { return this->taskCount; }
+    const char *getTaskName(int taskId) const { return this->tasks[taskId].name; }
+    const SchedulerTaskStats &getTaskStats(int taskId) const { return this->tasks[taskId].stats; }
+
+private:
+    struct SchedulerTask
+    {
+        const char *name;
+        std::function<void()> callback;
+        unsigned long periodMs;
+        unsigned long nextRunMs;
+        unsigned long deadlineMs;
+        uint8_t priority;
+        bool continuous;
+        bool enabled;
+        bool inWheel;
+        int nextInSlot;
+        SchedulerTaskStats stats;
+        MszCounter *deadlineMissesMetric;
+    };
+
+    MszSchedulerClock clock;
+    SchedulerTask tasks[MAX_SCHEDULER_TASKS];
+    int taskCount = 0;
+    int slotHeads[SCHEDULER_WHEEL_SLOTS];
+    unsigned long lastProcessedMs;
+    uint32_t readyMask = 0;
+
+    int addTask(const char *name, std::function<void()> callback, unsigned long periodMs, unsigned long firstRunMs,
+                uint8_t priority, unsigned long deadlineMs, bool continuous);
+    void insertIntoWheel(int taskId);
+    void removeFromWheel(int taskId);
+    void collectDueTasks(unsigned long nowMs);
+    void collectDueTasksInSlot(int slot, unsigned long nowMs);
+    int takeHighestPriorityTask(uint32_t &taskMask);
+    void runTask(int taskId);
+};
+
+#endif // MSZ_ASSETSCHEDULER_H
@@ -0,0 +1,159 @@
+#include "AssetFileSystem.h"
+
+#if !defined(ESP32) && !defined(ESP8266)
+
+#include <dirent.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+MszPosixFileSystem::MszPosixFileSystem(const char *rootDirectory)
+{
+    this->rootDirectory = rootDirectory;
+}
+
+bool MszPosixFileSystem::begin()
+{
+    struct stat status;
+    return stat(this->rootDirectory, &status) == 0 && S_ISDIR(status.st_mode);
+}
+
+void MszPosixFileSystem::end()
+{
+}
+
+bool MszPosixFileSystem::format()
+{
+    struct stat status;
+    if (stat(this->rootDirectory, &status) != 0)
+    {
+        return mkdir(this->rootDirectory, 0755) == 0;
+    }
+
+    // Removing entries while readdir() walks the directory may skip or repeat others, so collect them first.
+    std::vector<std::string> paths;
+    this->forEachFile([&paths](const char *path) {
+        paths.push_back(path);
+    });
+    bool succeeded = true;
+    for (const std::string &path : paths)
+    {
+        succeeded = this->remove(path.c_str()) && succeeded;
+    }
+    return succeeded;
+}
+
+bool MszPosixFileSystem::exists(const char *path)
+{
+    char hostPath[FILE_SYSTEM_MAX_PATH_LENGTH + 1];
+    struct stat status;
+    return this->getHostPath(path, hostPath, sizeof(hostPath)) && stat(hostPath, &status) == 0 && S_ISREG(status.st_mode);
+}
+
+bool MszPosixFileSystem::remove(const char *path)
+{
+    char hostPath[FILE_SYSTEM_MAX_PATH_LENGTH + 1];
+    return this->getHostPath(path, hostPath, sizeof(hostPath)) && unlink(hostPath) == 0;
+}
+
+size_t MszPosixFileSystem::getSize(const char *path)
+{
+    char hostPath[FILE_SYSTEM_MAX_PATH_LENGTH + 1];
+    struct stat status;
+    if (!this->getHostPath(path, hostPath, sizeof(hostPath)) || stat(hostPath, &status) != 0 || !S_ISREG(status.st_mode))
+    {
+        return 0;
+    }
+    return status.st_size;
+}
+
+size_t MszPosixFileSystem::read(const char *path, size_t offset, void *data, size_t length)
+{
+    char hostPath[FILE_SYSTEM_MAX_PATH_LENGTH + 1];
+    FILE *file = this->getHostPath(path, hostPath, sizeof(hostPath)) ? fopen(hostPath, "rb") : NULL;
+    if (file == NULL)
+    {
+        return 0;
+    }
+    size_t readLength = (fseek(file, offset, SEEK_SET) == 0) ? fread(data, 1, length, file) : 0;
+    fclose(file);
+    return readLength;
+}
+
+bool MszPosixFileSystem::write(const char *path, const void *data, size_t length)
+{
+    char hostPath[FILE_SYSTEM_MAX_PATH_LENGTH + 1];
+    FILE *file = this->getHostPath(path, hostPath, sizeof(hostPath)) ? fopen(hostPath, "wb") : NULL;
+    if (file == NULL)
+    {
+        return false;
+    }
+    size_t written = fwrite(data, 1, length, file);
+    return fclose(file) == 0 && written == length;
+}
+
+bool MszPosixFileSystem::writeAt(const char *path, size_t offset, const void *data, size_t length)
+{
+    char hostPath[FILE_SYSTEM_MAX_PATH_LENGTH + 1];
+    if (!this->getHostPath(path, hostPath, sizeof(hostPath)))
+    {
+        return false;
+    }
+    FILE *file = fopen(hostPath, "r+b");
+    if (file == NULL)
+    {
+        file = fopen(hostPath, "w+b");
+    }
+    if (file == NULL)
+    {
+        return false;
+    }
+    size_t written = (fseek(file, offset, SEEK_SET) == 0) ? fwrite(data, 1, length, file) : 0;
+    return fclose(file) == 0 && written == length;
+}
+
+void MszPosixFileSystem::forEachFile(std::function<void(const char *path)> visitor)
+{
+    DIR *directory = opendir(this->rootDirectory);
+    if (directory == NULL)
+    {
+        return;
+    }
+    char path[FILE_SYSTEM_MAX_PATH_LENGTH + 1];
+    for (struct dirent *entry = readdir(directory); entry != NULL; entry = readdir(directory))
+    {
+        // Names longer than a device path are skipped, no path of this file system can refer to them.
+        size_t nameLength = strlen(entry->d_name);
+        if (entry->d_name[0] == '.' || nameLength + 1 > FILE_SYSTEM_MAX_PATH_LENGTH)
+        {
+            continue;
+        }
+        path[0] = '/';
+        memcpy(path + 1, entry->d_name, nameLength + 1);
+        if (this->exists(path))
+        {
+            visitor(path);
+        }
+    }
+    closedir(directory);
+}
+
+const char *MszPosixFileSystem::getName() const
+{
+    return "posix";
+}
+
+bool MszPosixFileSystem::getHostPath(const char *path, char *hostPath, size_t length) const
+{
+    // Only files in the root directory, like on the devices.
+    if (path[0] != '/' || strchr(path + 1, '/') != NULL)
+    {
+        return false;
+    }
+    return (size_t)snprintf(hostPath, length, "%s%s", this->rootDirectory, path) < length;
+}
+
+#endif // !ESP32 && !ESP8266
@@ -0,0 +1,197 @@
+#ifndef MSZ_ASSETFILESYSTEM_H
+#define MSZ_ASSETFILESYSTEM_H
+
+#include <Arduino.h>
+#include <functional>
+#if defined(ESP32) || defined(ESP8266)
+#include <FS.h>
+#endif
+
+#define FILE_SYSTEM_MAX_PATH_LENGTH 127
+
+/// @class MszFileSystem
+/// @brief File system the assets keep their data in, independent of the backend.
+/// @details Every operation opens and closes the file, callers never hold a file handle. Paths start with a '/', the
+///          backends keep all files in the root directory.
+class MszFileSystem
+{
+public:
+    virtual ~MszFileSystem() {}
+
+    // Mounts the file system, false if the storage does not hold one of this kind.
+    virtual bool begin() = 0;
+    virtual void end() = 0;
+    // Erases the storage and creates an empty file system of this kind, it is not mounted afterwards.
+    virtual bool format() = 0;
+
+    virtual bool exists(const char *path) = 0;
+    virtual bool remove(const char *path) = 0;
+    // Size of the file, 0 if it does not exist.
+    virtual size_t getSize(const char *path) = 0;
+    // Reads up to length bytes from offset on. Returns the bytes read, 0 if the file does not exist.
+    virtual size_t read(const char *path, size_t offset, void *data, size_t length) = 0;
+    // Replaces the content of the file, creating it if needed.
+    virtual bool write(const char *path, const void *data, size_t length) = 0;
+    // Writes into the file from offset on, creating it if needed. The offset must not be beyond the end of the file.
+    virtual bool writeAt(const char *path, size_t offset, const void *data, size_t length) = 0;
+    // Calls visitor with the path of each file, the visitor must not modify the file system.
+    virtual void forEachFile(std::function<void(const char *path)> visitor) = 0;
+
+    virtual const char *getName() const = 0;
+};
+
+#if defined(ESP32) || defined(ESP8266)
+
+/// @class MszArduinoFileSystem
+/// @brief Backend for the file systems of the Arduino cores, e.g. LittleFS and SPIFFS.
+/// @details FsType is the class of the file system object, decltype(LittleFS) picks the one of the platform: the
+///          ESP32 core derives a class per file system from fs::FS, the ESP8266 core mounts fs::FS itself.
+template <typename FsType>
+class MszArduinoFileSystem : public MszFileSystem
+{
+public:
+    MszArduinoFileSystem(FsType &fileSystem, const char *name) : fileSystem(fileSystem)
+    {
+        this->name = name;
+    }
+
+    virtual bool begin() override
+    {
+        return this->fileSystem.begin();
+    }
+
+    virtual void end() override
+    {
+        this->fileSystem.end();
+    }
+
+    virtual bool format() override
+    {
+        return this->fileSystem.format();
+    }
+
+    virtual bool exists(const char *path) override
+    {
+        return this->fileSystem.exists(path);
+    }
+
+    virtual bool remove(const char *path) override
+    {
+        return this->fileSystem.remove(path);
+    }
+
+    virtual size_t getSize(const char *path) override
+    {
+        if (!this->fileSystem.exists(path))
+        {
+            return 0;
+        }
+        File file = this->fileSystem.open(path, "r");
+        size_t size = file ? file.size() : 0;
+        file.close();
+        return size;
+    }
+
+    virtual size_t read(const char *path, size_t offset, void *data, size_t length) override
+    {
+        if (!this->fileSystem.exists(path))
+        {
+            return 0;
+        }
+        File file = this->fileSystem.open(path, "r");
+        if (!file)
+        {
+            return 0;
+        }
+        size_t readLength = file.seek(offset) ? file.readBytes((char *)data, length) : 0;
+        file.close();
+        return readLength;
+    }
+
+    virtual bool write(const char *path, const void *data, size_t length) override
+    {
+        File file = this->fileSystem.open(path, "w");
+        if (!file)
+        {
+            return false;
+        }
+        size_t written = file.write((const uint8_t *)data, length);
+        file.close();
+        return written == length;
+    }
+
+    virtual bool writeAt(const char *path, size_t offset, const void *data, size_t length) override
+    {
+        File file = this->fileSystem.open(path, this->fileSystem.exists(path) ? "r+" : "w");
+        if (!file || !file.seek(offset))
+        {
+            return false;
+        }
+        size_t written = file.write((const uint8_t *)data, length);
+        file.close();
+        return written == length;
+    }
+
+    virtual void forEachFile(std::function<void(const char *path)> visitor) override
+    {
+        File root = this->fileSystem.open("/", "r");
+        if (!root)
+        {
+            return;
+        }
+        for (File file = root.openNextFile(); file; file = root.openNextFile())
+        {
+            if (!file.isDirectory())
+            {
+                // Depending on core and file system, the name comes with or without the leading '/'.
+                const char *fileName = file.name();
+                String path = (fileName[0] == '/') ? String(fileName) : "/" + String(fileName);
+                file.close();
+                visitor(path.c_str());
+            }
+        }
+        root.close();
+    }
+
+    virtual const char *getName() const override
+    {
+        return this->name;
+    }
+
+private:
+    FsType &fileSystem;
+    const char *name;
+};
+
+#else
+
+/// @class MszPosixFileSystem
+/// @brief Backend for native builds keeping the files in a directory of the host.
+class MszPosixFileSystem : public MszFileSystem
+{
+public:
+    MszPosixFileSystem(const char *rootDirectory);
+
+    virtual bool begin() override;
+    virtual void end() override;
+    virtual bool format() override;
+
+    virtual bool exists(const char *path) override;
+    virtual bool remove(const char *path) override;
+    virtual size_t getSize(const char *path) override;
+    virtual size_t read(const char *path, size_t offset, void *data, size_t length) override;
+    virtual bool write(const char *path, const void *data, size_t length) override;
+    virtual bool writeAt(const char *path, size_t offset, const void *data, size_t length) override;
+    virtual void forEachFile(std::function<void(const char *path)> visitor) override;
+
+    virtual const char *getName() const override;
+
+private:
+    const char *rootDirectory;
+
+    bool getHostPath(const char *path, char *hostPath, size_t length) const;
+};
+
+#endif // ESP32 || ESP8266
+
+#endif // MSZ_ASSETFILESYSTEM_H
@@ -0,0 +1,232 @@
+#include <stdlib.h>
+#include <string.h>
+#include "AssetFlash.h"
+
+// Chunk size for filling erased pages into flash image files.
+#define FILE_FLASH_CHUNK_SIZE 256
+
+#if !defined(ESP32) && !defined(ESP8266)
+
+MszSimulatedFlash::MszSimulatedFlash(size_t pageSize, size_t pageCount)
+{
+    this->pageSize = pageSize;
+    this->pageCount = pageCount;
+    this->cells = (uint8_t *)malloc(pageSize * pageCount);
+    this->eraseCounts = (uint32_t *)calloc(pageCount, sizeof(uint32_t));
+    this->programmedBytes = 0;
+    this->readBytes = 0;
+    this->powerFailArmed = false;
+    this->powerFailBudget = 0;
+    if (this->cells != NULL)
+    {
+        memset(this->cells, FLASH_ERASED_BYTE, pageSize * pageCount);
+    }
+}
+
+MszSimulatedFlash::~MszSimulatedFlash()
+{
+    free(this->cells);
+    free(this->eraseCounts);
+}
+
+size_t MszSimulatedFlash::getPageSize() const
+{
+    return this->pageSize;
+}
+
+size_t MszSimulatedFlash::getPageCount() const
+{
+    return this->pageCount;
+}
+
+bool MszSimulatedFlash::read(size_t offset, void *data, size_t length)
+{
+    if (this->cells == NULL || offset + length > this->pageSize * this->pageCount)
+    {
+        return false;
+    }
+    memcpy(data, this->cells + offset, length);
+    this->readBytes += length;
+    return true;
+}
+
+bool MszSimulatedFlash::program(size_t offset, const void *data, size_t length)
+{
+    if (this->cells == NULL || offset + length > this->pageSize * this->pageCount)
+    {
+        return false;
+    }
+    const uint8_t *bytes = (const uint8_t *)data;
+    for (size_t i = 0; i < length; i++)
+    {
+        if (this->powerFailArmed)
+        {
+            if (this->powerFailBudget == 0)
+            {
+                return false;
+            }
+            this->powerFailBudget--;
+        }
+        this->cells[offset + i] &= bytes[i];
+        this->programmedBytes++;
+    }
+    return true;
+}
+
+bool MszSimulatedFlash::erasePage(size_t page)
+{
+    if (this->cells == NULL || page >= this->pageCount || (this->powerFailArmed && this->powerFailBudget == 0))
+    {
+        return false;
+    }
+    memset(this->cells + page * this->pageSize, FLASH_ERASED_BYTE, this->pageSize);
+    this->eraseCounts[page]++;
+    return true;
+}
+
+void MszSimulatedFlash::failAfterProgrammedBytes(size_t budget)
+{
+    this->powerFailArmed = true;
+    this->powerFailBudget = budget;
+}
+
+void MszSimulatedFlash::restorePower()
+{
+    this->powerFailArmed = false;
+}
+
+uint32_t MszSimulatedFlash::getEraseCount(size_t page) const
+{
+    return (page < this->pageCount) ? this->eraseCounts[page] : 0;
+}
+
+uint32_t MszSimulatedFlash::getTotalEraseCount() const
+{
+    uint32_t total = 0;
+    for (size_t i = 0; i < this->pageCount; i++)
+    {
+        total += this->eraseCounts[i];
+    }
+    return total;
+}
+
+size_t MszSimulatedFlash::getProgrammedBytes() const
+{
+    return this->programmedBytes;
+}
+
+size_t MszSimulatedFlash::getReadBytes() const
+{
+    return this->readBytes;
+}
+
+#endif // !ESP32 && !ESP8266
+
+#if defined(ESP32)
+
+MszPartitionFlash::MszPartitionFlash(const char *partitionLabel)
+{
+    this->partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, partitionLabel);
+}
+
+bool MszPartitionFlash::isAvailable() const
+{
+    return this->partition != NULL;
+}
+
+size_t MszPartitionFlash::getPageSize() const
+{
+    return SPI_FLASH_SEC_SIZE;
+}
+
+size_t MszPartitionFlash::getPageCount() const
+{
+    return (this->partition != NULL) ? this->partition->size / SPI_FLASH_SEC_SIZE : 0;
+}
+
+bool MszPartitionFlash::read(size_t offset, void *data, size_t length)
+{
+    return this->partition != NULL && esp_partition_read(this->partition, offset, data, length) == ESP_OK;
+}
+
+bool MszPartitionFlash::program(size_t offset, const void *data, size_t length)
+{
+    return this->partition != NULL && esp_partition_write(this->partition, offset, data, length) == ESP_OK;
+}
+
+bool MszPartitionFlash::erasePage(size_t page)
+{
+    return this->partition != NULL && esp_partition_erase_range(this->partition, page * SPI_FLASH_SEC_SIZE, SPI_FLASH_SEC_SIZE) == ESP_OK;
+}
+
+#endif // ESP32
+
+MszFileFlash::MszFileFlash(MszFileSystem &fileSystem, const char *path, size_t pageSize, size_t pageCount)
+    : fileSystem(fileSystem)
+{
+    this->path = path;
+    this->pageSize = pageSize;
+    this->pageCount = pageCount;
+}
+
+bool MszFileFlash::begin()
+{
+    if (this->fileSystem.exists(this->path))
+    {
+        if (this->fileSystem.getSize(this->path) == this->pageSize * this->pageCount)
+        {
+            return true;
+        }
+        Serial.println("MszFileFlash::begin - image has the wrong size, recreating " + String(this->path));
+    }
+
+    if (!this->fileSystem.write(this->path, NULL, 0))
+    {
+        Serial.println("MszFileFlash::begin - failed to create " + String(this->path));
+        return false;
+    }
+    for (size_t page = 0; page < this->pageCount; page++)
+    {
+        if (!this->erasePage(page))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t MszFileFlash::getPageSize() const
+{
+    return this->pageSize;
+}
+
+size_t MszFileFlash::getPageCount() const
+{
+    return this->pageCount;
+}
+
+bool MszFileFlash::read(size_t offset, void *data, size_t length)
+{
+    return this->fileSystem.read(this->path, offset, data, length) == length;
+}
+
+bool MszFileFlash::program(size_t offset, const void *data, size_t length)
+{
+    return this->fileSystem.writeAt(this->path, offset, data, length);
+}
+
+bool MszFileFlash::erasePage(size_t page)
+{
+    // While begin() creates the image, each page is written right at the end of the file, growing it page by page.
+    uint8_t erased[FILE_FLASH_CHUNK_SIZE];
+    memset(erased, FLASH_ERASED_BYTE, sizeof(erased));
+    for (size_t written = 0; written < this->pageSize; written += FILE_FLASH_CHUNK_SIZE)
+    {
+        size_t chunk = (this->pageSize - written < sizeof(erased)) ? this->pageSize - written : sizeof(erased);
+        if (!this->fileSystem.writeAt(this->path, page * this->pageSize + written, erased, chunk))
+        {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,119 @@
+#ifndef MSZ_ASSETFLASH_H
+#define MSZ_ASSETFLASH_H
+
+#include <Arduino.h>
+#include "AssetFileSystem.h"
+#if defined(ESP32)
+#include <esp_partition.h>
+#endif
+
+#define FLASH_ERASED_BYTE 0xFF
+
+/// @class MszFlash
+/// @brief Flash region as the key-value store sees it: pages erased as a whole, programming only clears bits.
+/// @details Offsets are relative to the start of the region. Erased bytes read FLASH_ERASED_BYTE, a byte programmed
+///          once must not be programmed again before its page is erased.
+class MszFlash
+{
+public:
+    virtual ~MszFlash() {}
+
+    virtual size_t getPageSize() const = 0;
+    virtual size_t getPageCount() const = 0;
+
+    virtual bool read(size_t offset, void *data, size_t length) = 0;
+    virtual bool program(size_t offset, const void *data, size_t length) = 0;
+    virtual bool erasePage(size_t page) = 0;
+};
+
+#if !defined(ESP32) && !defined(ESP8266)
+
+/// @class MszSimulatedFlash
+/// @brief Flash in RAM for host builds, enforcing NOR semantics and counting the operations for benchmarks.
+/// @details Programming ANDs the data into the cells like NOR flash does. failAfterProgrammedBytes() simulates a
+///          power loss: once the budget is used up, a program operation stops in the middle and fails, as do all
+///          after it, which leaves torn writes behind for the store to recover from.
+class MszSimulatedFlash : public MszFlash
+{
+public:
+    MszSimulatedFlash(size_t pageSize, size_t pageCount);
+    virtual ~MszSimulatedFlash();
+
+    virtual size_t getPageSize() const override;
+    virtual size_t getPageCount() const override;
+
+    virtual bool read(size_t offset, void *data, size_t length) override;
+    virtual bool program(size_t offset, const void *data, size_t length) override;
+    virtual bool erasePage(size_t page) override;
+
+    void failAfterProgrammedBytes(size_t budget);
+    void restorePower();
+
+    uint32_t getEraseCount(size_t page) const;
+    uint32_t getTotalEraseCount() const;
+    size_t getProgrammedBytes() const;
+    size_t getReadBytes() const;
+
+private:
+    size_t pageSize;
+    size_t pageCount;
+    uint8_t *cells;
+    uint32_t *eraseCounts;
+    size_t programmedBytes;
+    size_t readBytes;
+    bool powerFailArmed;
+    size_t powerFailBudget;
+};
+
+#endif // !ESP32 && !ESP8266
+
+#if defined(ESP32)
+
+/// @class MszPartitionFlash
+/// @brief Raw flash of a data partition of the ESP32, e.g. a line "kvstore, data, 0x40, , 128K," in the partition table.
+class MszPartitionFlash : public MszFlash
+{
+public:
+    MszPartitionFlash(const char *partitionLabel);
+
+    bool isAvailable() const;
+
+    virtual size_t getPageSize() const override;
+    virtual size_t getPageCount() const override;
+
+    virtual bool read(size_t offset, void *data, size_t length) override;
+    virtual bool program(size_t offset, const void *data, size_t length) override;
+    virtual bool erasePage(size_t page) override;
+
+private:
+    const esp_partition_t *partition;
+};
+
+#endif // ESP32
+
+/// @class MszFileFlash
+/// @brief Flash image in a file of a file system, for devices without a partition of their own for the store.
+/// @details The file is created with all pages erased on begin(). The file system does its own wear leveling below,
+///          the store still gets the same torn write protection as on raw flash.
+class MszFileFlash : public MszFlash
+{
+public:
+    MszFileFlash(MszFileSystem &fileSystem, const char *path, size_t pageSize, size_t pageCount);
+
+    bool begin();
+
+    virtual size_t getPageSize() const override;
+    virtual size_t getPageCount() const override;
+
+    virtual bool read(size_t offset, void *data, size_t length) override;
+    virtual bool program(size_t offset, const void *data, size_t length) override;
+    virtual bool erasePage(size_t page) override;
+
+private:
+    MszFileSystem &fileSystem;
+    const char *path;
+    size_t pageSize;
+    size_t pageCount;
+};
+
+#endif // MSZ_ASSETFLASH_H
@@ -0,0 +1,737 @@
+#include <stddef.h>
+#include <string.h>
+#include "AssetKvStore.h"
+
+// Chunk size for comparing, checking and copying record data.
+#define KV_CHUNK_SIZE 64
+// Compaction rounds one append may run before the store is considered full.
+#define KV_MAX_COMPACTION_ROUNDS 4
+
+// CRC-32 lookup table processing one nibble at a time to keep the table small.
+static const uint32_t CRC_TABLE[16] = {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C};
+
+MszKvStore::MszKvStore(MszFlash &flash) : flash(flash)
+{
+    this->mounted = false;
+    this->pageSize = 0;
+    this->pageCount = 0;
+    this->activePage = -1;
+    this->nextSequence = 0;
+    this->compacting = false;
+    this->keyCount = 0;
+    memset(this->index, 0, sizeof(this->index));
+}
+
+bool MszKvStore::mount()
+{
+    this->mounted = false;
+    this->pageSize = this->flash.getPageSize();
+    this->pageCount = this->flash.getPageCount();
+    if (this->pageCount > KV_MAX_PAGES)
+    {
+        this->pageCount = KV_MAX_PAGES;
+    }
+    if (this->pageCount < 3 || this->pageSize < 256 || this->pageSize > 0xFFFF)
+    {
+        Serial.println("MszKvStore::mount - unsupported flash geometry");
+        return false;
+    }
+    this->activePage = -1;
+    this->nextSequence = 0;
+    this->compacting = false;
+    this->keyCount = 0;
+    memset(this->index, 0, sizeof(this->index));
+
+    uint16_t order[KV_MAX_PAGES];
+    size_t usedCount = 0;
+    for (size_t page = 0; page < this->pageCount; page++)
+    {
+        PageHeader header;
+        if (!this->flash.read(this->flashOffset(page, 0), &header, sizeof(header)))
+        {
+            Serial.println("MszKvStore::mount - failed to read page " + String(page));
+            return false;
+        }
+        uint32_t crc = this->updateCrc(0xFFFFFFFF, &header, offsetof(PageHeader, crc)) ^ 0xFFFFFFFF;
+        if (header.magic != PAGE_MAGIC || header.crc != crc)
+        {
+            // Never formatted, or the erase or the header write before was interrupted.
+            if (!this->formatPage(page, 0))
+            {
+                return false;
+            }
+            continue;
+        }
+
+        PageInfo &info = this->pages[page];
+        info.sequence = header.sequence;
+        info.eraseCount = header.eraseCount;
+        info.writeOffset = sizeof(PageHeader);
+        info.liveBytes = 0;
+        if (header.sequence == NO_SEQUENCE)
+        {
+            info.state = PageState::Free;
+            // A free page must be erased behind its header, writes into it may have begun before its sequence was set.
+            uint8_t firstByte;
+            if (!this->flash.read(this->flashOffset(page, sizeof(PageHeader)), &firstByte, 1))
+            {
+                return false;
+            }
+            if (firstByte != FLASH_ERASED_BYTE && !this->formatPage(page, header.eraseCount + 1))
+            {
+                return false;
+            }
+            continue;
+        }
+
+        info.state = PageState::Full;
+        if (header.sequence >= this->nextSequence)
+        {
+            this->nextSequence = header.sequence + 1;
+        }
+        // Insertion sort by sequence, records of later pages override those of earlier ones.
+        size_t position = usedCount++;
+        while (position > 0 && this->pages[order[position - 1]].sequence > header.sequence)
+        {
+            order[position] = order[position - 1];
+            position--;
+        }
+        order[position] = page;
+    }
+
+    for (size_t i = 0; i < usedCount; i++)
+    {
+        this->scanPage(order[i]);
+    }
+    if (usedCount > 0 && this->pages[order[usedCount - 1]].writeOffset < this->pageSize)
+    {
+        this->activePage = order[usedCount - 1];
+        this->pages[this->activePage].state = PageState::Active;
+    }
+
+    this->mounted = true;
+    Serial.println("MszKvStore::mount - " + String(this->keyCount) + " keys, " + String(this->getFreePageCount()) + " free pages");
+    return true;
+}
+
+bool MszKvStore::isMounted() const
+{
+    return this->mounted;
+}
+
+bool MszKvStore::put(const char *key, const void *value, size_t length)
+{
+    size_t keyLength = strlen(key);
+    if (!this->mounted || keyLength == 0 || keyLength > KV_MAX_KEY_LENGTH || length > this->getMaxValueLength())
+    {
+        Serial.println("MszKvStore::put - rejected " + String(key));
+        return false;
+    }
+
+    size_t recordSize = this->alignRecord(sizeof(RecordHeader) + keyLength + length);
+    int slot = this->findSlot(key, keyLength);
+    if (slot >= 0 && this->index[slot].size == recordSize && this->valueEquals(this->index[slot], value, length))
+    {
+        // Unchanged values cost no flash write.
+        return true;
+    }
+    if (slot < 0 && this->keyCount >= KV_MAX_KEYS)
+    {
+        Serial.println("MszKvStore::put - no room for key " + String(key));
+        return false;
+    }
+
+    uint16_t page;
+    uint16_t offset;
+    if (!this->append(key, keyLength, 0, value, length, page, offset))
+    {
+        return false;
+    }
+    this->setLocation(key, keyLength, page, offset, recordSize);
+    return true;
+}
+
+size_t MszKvStore::get(const char *key, void *value, size_t length)
+{
+    int slot = this->findSlot(key, strlen(key));
+    if (slot < 0)
+    {
+        return 0;
+    }
+    const IndexEntry &entry = this->index[slot];
+    RecordHeader header;
+    if (!this->flash.read(this->flashOffset(entry.page, entry.offset), &header, sizeof(header)))
+    {
+        return 0;
+    }
+    size_t readLength = (header.valueLength < length) ? header.valueLength : length;
+    if (readLength > 0 && !this->flash.read(this->flashOffset(entry.page, entry.offset + sizeof(header) + header.keyLength), value, readLength))
+    {
+        return 0;
+    }
+    return readLength;
+}
+
+size_t MszKvStore::getLength(const char *key)
+{
+    int slot = this->findSlot(key, strlen(key));
+    RecordHeader header;
+    if (slot < 0 || !this->flash.read(this->flashOffset(this->index[slot].page, this->index[slot].offset), &header, sizeof(header)))
+    {
+        return 0;
+    }
+    return header.valueLength;
+}
+
+bool MszKvStore::contains(const char *key)
+{
+    return this->findSlot(key, strlen(key)) >= 0;
+}
+
+bool MszKvStore::remove(const char *key)
+{
+    size_t keyLength = strlen(key);
+    int slot = this->findSlot(key, keyLength);
+    if (slot < 0)
+    {
+        return this->mounted;
+    }
+
+    // The tombstone hides records of the key on older pages until compaction has dropped them.
+    uint16_t page;
+    uint16_t offset;
+    if (!this->append(key, keyLength, RECORD_FLAG_DELETED, NULL, 0, page, offset))
+    {
+        return false;
+    }
+    // Compaction during the append may have moved the slot.
+    this->removeSlot(this->findSlot(key, keyLength));
+    return true;
+}
+
+void MszKvStore::forEachKey(const char *prefix, std::function<void(const char *key)> visitor)
+{
+    size_t prefixLength = strlen(prefix);
+    for (int slot = 0; slot < INDEX_SLOTS; slot++)
+    {
+        if (this->index[slot].hash == 0)
+        {
+            continue;
+        }
+        RecordHeader header;
+        char key[KV_MAX_KEY_LENGTH + 1];
+        if (this->readRecordStart(this->index[slot].page, this->index[slot].offset, header, key) && strncmp(key, prefix, prefixLength) == 0)
+        {
+            visitor(key);
+        }
+    }
+}
+
+int MszKvStore::getKeyCount() const
+{
+    return this->keyCount;
+}
+
+int MszKvStore::getFreePageCount() const
+{
+    int count = 0;
+    for (size_t page = 0; page < this->pageCount; page++)
+    {
+        if (this->pages[page].state == PageState::Free)
+        {
+            count++;
+        }
+    }
+    return count;
+}
+
+uint32_t MszKvStore::getMinEraseCount() const
+{
+    uint32_t minimum = 0xFFFFFFFF;
+    for (size_t page = 0; page < this->pageCount; page++)
+    {
+        if (this->pages[page].eraseCount < minimum)
+        {
+            minimum = this->pages[page].eraseCount;
+        }
+    }
+    return (this->pageCount > 0) ? minimum : 0;
+}
+
+uint32_t MszKvStore::getMaxEraseCount() const
+{
+    uint32_t maximum = 0;
+    for (size_t page = 0; page < this->pageCount; page++)
+    {
+        if (this->pages[page].eraseCount > maximum)
+        {
+            maximum = this->pages[page].eraseCount;
+        }
+    }
+    return maximum;
+}
+
+size_t MszKvStore::getMaxValueLength() const
+{
+    // A record with the longest key has to fit into an empty page.
+    size_t length = (this->pageSize - sizeof(PageHeader) - sizeof(RecordHeader) - KV_MAX_KEY_LENGTH) & ~(size_t)3;
+    return (length < 0xFFFF) ? length : 0xFFFF;
+}
+
+bool MszKvStore::formatPage(size_t page, uint32_t eraseCount)
+{
+    PageInfo &info = this->pages[page];
+    info.sequence = NO_SEQUENCE;
+    info.eraseCount = eraseCount;
+    info.writeOffset = this->pageSize;
+    info.liveBytes = 0;
+    // Until the header is written the page is neither free nor usable for records.
+    info.state = PageState::Full;
+
+    PageHeader header;
+    header.magic = PAGE_MAGIC;
+    header.eraseCount = eraseCount;
+    header.crc = this->updateCrc(0xFFFFFFFF, &header, offsetof(PageHeader, crc)) ^ 0xFFFFFFFF;
+    if (!this->flash.erasePage(page) || !this->flash.program(this->flashOffset(page, 0), &header, offsetof(PageHeader, sequence)))
+    {
+        Serial.println("MszKvStore::formatPage - failed to format page " + String(page));
+        return false;
+    }
+    info.writeOffset = sizeof(PageHeader);
+    info.state = PageState::Free;
+    return true;
+}
+
+bool MszKvStore::ensureRoom(size_t recordSize)
+{
+    if (this->activePage >= 0 && this->pages[this->activePage].writeOffset + recordSize <= this->pageSize)
+    {
+        return true;
+    }
+    if (this->activePage >= 0)
+    {
+        this->pages[this->activePage].state = PageState::Full;
+        this->activePage = -1;
+    }
+
+    if (!this->compacting)
+    {
+        // The last free page is kept for compaction, which copies into it and frees its victim in turn.
+        for (int round = 0; round < KV_MAX_COMPACTION_ROUNDS && this->getFreePageCount() < 2; round++)
+        {
+            if (!this->compact())
+            {
+                break;
+            }
+            if (this->activePage >= 0 && this->pages[this->activePage].writeOffset + recordSize <= this->pageSize)
+            {
+                return true;
+            }
+            if (this->activePage >= 0)
+            {
+                this->pages[this->activePage].state = PageState::Full;
+                this->activePage = -1;
+            }
+        }
+        if (this->getFreePageCount() < 2)
+        {
+            Serial.println("MszKvStore::ensureRoom - store is full");
+            return false;
+        }
+    }
+    return this->openPage();
+}
+
+bool MszKvStore::openPage()
+{
+    int page = -1;
+    for (size_t i = 0; i < this->pageCount; i++)
+    {
+        if (this->pages[i].state == PageState::Free && (page < 0 || this->pages[i].eraseCount < this->pages[page].eraseCount))
+        {
+            page = i;
+        }
+    }
+    if (page < 0)
+    {
+        return false;
+    }
+
+    uint32_t sequence = this->nextSequence;
+    if (!this->flash.program(this->flashOffset(page, offsetof(PageHeader, sequence)), &sequence, sizeof(sequence)))
+    {
+        Serial.println("MszKvStore::openPage - failed to open page " + String(page));
+        this->pages[page].state = PageState::Full;
+        this->pages[page].writeOffset = this->pageSize;
+        return false;
+    }
+    this->nextSequence++;
+    this->pages[page].sequence = sequence;
+    this->pages[page].state = PageState::Active;
+    this->activePage = page;
+    return true;
+}
+
+bool MszKvStore::compact()
+{
+    int victim = this->selectCompactionVictim();
+    if (victim < 0)
+    {
+        return false;
+    }
+
+    this->compacting = true;
+    bool success = true;
+    bool keepTombstones = this->hasOlderPage(victim);
+    size_t offset = sizeof(PageHeader);
+    while (success && offset + sizeof(RecordHeader) <= this->pages[victim].writeOffset)
+    {
+        RecordHeader header;
+        char key[KV_MAX_KEY_LENGTH + 1];
+        if (!this->readRecordStart(victim, offset, header, key))
+        {
+            // End of the records, or the torn one the page was sealed at.
+            break;
+        }
+        size_t recordSize = this->alignRecord(sizeof(RecordHeader) + header.keyLength + header.valueLength);
+        int slot = this->findSlot(key, header.keyLength);
+        uint16_t newPage;
+        uint16_t newOffset;
+        if (!(header.flags & RECORD_FLAG_DELETED))
+        {
+            if (slot >= 0 && this->index[slot].page == victim && this->index[slot].offset == offset)
+            {
+                success = this->copyRecord(victim, offset, recordSize, newPage, newOffset);
+                if (success)
+                {
+                    this->pages[victim].liveBytes -= recordSize;
+                    this->pages[newPage].liveBytes += recordSize;
+                    this->index[slot].page = newPage;
+                    this->index[slot].offset = newOffset;
+                }
+            }
+        }
+        else if (slot < 0 && keepTombstones && this->checkRecord(victim, offset, header, key))
+        {
+            success = this->copyRecord(victim, offset, recordSize, newPage, newOffset);
+        }
+        offset += recordSize;
+    }
+
+    // All live records are on other pages now, erasing the victim loses nothing even if the erase is interrupted.
+    success = success && this->formatPage(victim, this->pages[victim].eraseCount + 1);
+    this->compacting = false;
+    if (!success)
+    {
+        Serial.println("MszKvStore::compact - failed to compact page " + String(victim));
+    }
+    return success;
+}
+
+int MszKvStore::selectCompactionVictim()
+{
+    uint32_t maxEraseCount = this->getMaxEraseCount();
+    int coldest = -1;
+    int victim = -1;
+    size_t victimGarbage = 0;
+    for (size_t page = 0; page < this->pageCount; page++)
+    {
+        const PageInfo &info = this->pages[page];
+        if (info.state != PageState::Full || info.sequence == NO_SEQUENCE)
+        {
+            continue;
+        }
+        if (maxEraseCount - info.eraseCount >= KV_WEAR_LEVELING_DELTA && (coldest < 0 || info.eraseCount < this->pages[coldest].eraseCount))
+        {
+            coldest = page;
+        }
+        size_t garbage = info.writeOffset - sizeof(PageHeader) - info.liveBytes;
+        if (garbage > victimGarbage || (garbage > 0 && garbage == victimGarbage && info.eraseCount < this->pages[victim].eraseCount))
+        {
+            victim = page;
+            victimGarbage = garbage;
+        }
+    }
+    // Static data pins its page at a low erase count, moving it away lets that page take its share of the erases.
+    return (coldest >= 0) ? coldest : victim;
+}
+
+bool MszKvStore::append(const char *key, size_t keyLength, uint8_t flags, const void *value, size_t valueLength, uint16_t &page, uint16_t &offset)
+{
+    size_t recordSize = this->alignRecord(sizeof(RecordHeader) + keyLength + valueLength);
+    if (!this->ensureRoom(recordSize))
+    {
+        return false;
+    }
+
+    RecordHeader header;
+    header.keyLength = keyLength;
+    header.flags = flags;
+    header.valueLength = valueLength;
+    uint32_t crc = this->updateCrc(0xFFFFFFFF, &header, offsetof(RecordHeader, crc));
+    crc = this->updateCrc(crc, key, keyLength);
+    header.crc = this->updateCrc(crc, value, valueLength) ^ 0xFFFFFFFF;
+
+    page = this->activePage;
+    offset = this->pages[page].writeOffset;
+    // The space is taken even if programming fails, a torn record must not be programmed over.
+    this->pages[page].writeOffset += recordSize;
+    bool success = this->flash.program(this->flashOffset(page, offset), &header, sizeof(header)) &&
+                   this->flash.program(this->flashOffset(page, offset + sizeof(header)), key, keyLength) &&
+                   (valueLength == 0 || this->flash.program(this->flashOffset(page, offset + sizeof(header) + keyLength), value, valueLength));
+    if (!success)
+    {
+        Serial.println("MszKvStore::append - failed to write record at page " + String(page));
+        this->pages[page].writeOffset = this->pageSize;
+        this->pages[page].state = PageState::Full;
+        this->activePage = -1;
+    }
+    return success;
+}
+
+bool MszKvStore::copyRecord(uint16_t page, uint16_t offset, size_t recordSize, uint16_t &newPage, uint16_t &newOffset)
+{
+    if (!this->ensureRoom(recordSize))
+    {
+        return false;
+    }
+    newPage = this->activePage;
+    newOffset = this->pages[newPage].writeOffset;
+    this->pages[newPage].writeOffset += recordSize;
+
+    // The CRC does not cover the location, so records are copied as they are.
+    uint8_t chunk[KV_CHUNK_SIZE];
+    for (size_t copied = 0; copied < recordSize; copied += sizeof(chunk))
+    {
+        size_t length = (recordSize - copied < sizeof(chunk)) ? recordSize - copied : sizeof(chunk);
+        if (!this->flash.read(this->flashOffset(page, offset + copied), chunk, length) ||
+            !this->flash.program(this->flashOffset(newPage, newOffset + copied), chunk, length))
+        {
+            Serial.println("MszKvStore::copyRecord - failed to copy record to page " + String(newPage));
+            this->pages[newPage].writeOffset = this->pageSize;
+            this->pages[newPage].state = PageState::Full;
+            this->activePage = -1;
+            return false;
+        }
+    }
+    return true;
+}
+
+void MszKvStore::scanPage(size_t page)
+{
+    size_t offset = sizeof(PageHeader);
+    while (offset + sizeof(RecordHeader) <= this->pageSize)
+    {
+        RecordHeader header;
+        char key[KV_MAX_KEY_LENGTH + 1];
+        if (!this->flash.read(this->flashOffset(page, offset), &header, sizeof(header)) || header.keyLength == FLASH_ERASED_BYTE)
+        {
+            break;
+        }
+        size_t recordSize = this->alignRecord(sizeof(RecordHeader) + header.keyLength + header.valueLength);
+        if (!this->readRecordStart(page, offset, header, key) || offset + recordSize > this->pageSize ||
+            !this->checkRecord(page, offset, header, key))
+        {
+            // A torn record, nothing after it on this page can be trusted, so the page takes no further writes.
+            Serial.println("MszKvStore::scanPage - sealing page " + String(page) + " at invalid record " + String(offset));
+            offset = this->pageSize;
+            break;
+        }
+
+        if (header.flags & RECORD_FLAG_DELETED)
+        {
+            int slot = this->findSlot(key, header.keyLength);
+            if (slot >= 0)
+            {
+                this->removeSlot(slot);
+            }
+        }
+        else
+        {
+            this->setLocation(key, header.keyLength, page, offset, recordSize);
+        }
+        offset += recordSize;
+    }
+    this->pages[page].writeOffset = offset;
+}
+
+bool MszKvStore::readRecordStart(size_t page, size_t offset, RecordHeader &header, char *key)
+{
+    if (!this->flash.read(this->flashOffset(page, offset), &header, sizeof(header)) ||
+        header.keyLength == 0 || header.keyLength > KV_MAX_KEY_LENGTH ||
+        !this->flash.read(this->flashOffset(page, offset + sizeof(header)), key, header.keyLength))
+    {
+        return false;
+    }
+    key[header.keyLength] = '\0';
+    return true;
+}
+
+bool MszKvStore::checkRecord(size_t page, size_t offset, const RecordHeader &header, const char *key)
+{
+    uint32_t crc = this->updateCrc(0xFFFFFFFF, &header, offsetof(RecordHeader, crc));
+    crc = this->updateCrc(crc, key, header.keyLength);
+    uint8_t chunk[KV_CHUNK_SIZE];
+    size_t valueOffset = offset + sizeof(RecordHeader) + header.keyLength;
+    for (size_t checked = 0; checked < header.valueLength; checked += sizeof(chunk))
+    {
+        size_t length = (header.valueLength - checked < sizeof(chunk)) ? header.valueLength - checked : sizeof(chunk);
+        if (!this->flash.read(this->flashOffset(page, valueOffset + checked), chunk, length))
+        {
+            return false;
+        }
+        crc = this->updateCrc(crc, chunk, length);
+    }
+    return (crc ^ 0xFFFFFFFF) == header.crc;
+}
+
+bool MszKvStore::valueEquals(const IndexEntry &entry, const void *value, size_t length)
+{
+    RecordHeader header;
+    if (!this->flash.read(this->flashOffset(entry.page, entry.offset), &header, sizeof(header)) || header.valueLength != length)
+    {
+        return false;
+    }
+    const uint8_t *bytes = (const uint8_t *)value;
+    uint8_t chunk[KV_CHUNK_SIZE];
+    size_t valueOffset = entry.offset + sizeof(RecordHeader) + header.keyLength;
+    for (size_t compared = 0; compared < length; compared += sizeof(chunk))
+    {
+        size_t chunkLength = (length - compared < sizeof(chunk)) ? length - compared : sizeof(chunk);
+        if (!this->flash.read(this->flashOffset(entry.page, valueOffset + compared), chunk, chunkLength) ||
+            memcmp(chunk, bytes + compared, chunkLength) != 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool MszKvStore::hasOlderPage(size_t page) const
+{
+    for (size_t i = 0; i < this->pageCount; i++)
+    {
+        if (this->pages[i].state != PageState::Free && this->pages[i].sequence != NO_SEQUENCE && this->pages[i].sequence < this->pages[page].sequence)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+int MszKvStore::findSlot(const char *key, size_t keyLength)
+{
+    if (keyLength == 0 || keyLength > KV_MAX_KEY_LENGTH)
+    {
+        return -1;
+    }
+    uint32_t hash = this->hashKey(key, keyLength);
+    for (int probe = 0, slot = hash & (INDEX_SLOTS - 1); probe < INDEX_SLOTS; probe++, slot = (slot + 1) & (INDEX_SLOTS - 1))
+    {
+        if (this->index[slot].hash == 0)
+        {
+            return -1;
+        }
+        if (this->index[slot].hash != hash)
+        {
+            continue;
+        }
+        // Hashes may collide, the key on flash decides.
+        RecordHeader header;
+        char storedKey[KV_MAX_KEY_LENGTH + 1];
+        if (this->readRecordStart(this->index[slot].page, this->index[slot].offset, header, storedKey) &&
+            header.keyLength == keyLength && memcmp(storedKey, key, keyLength) == 0)
+        {
+            return slot;
+        }
+    }
+    return -1;
+}
+
+void MszKvStore::setLocation(const char *key, size_t keyLength, uint16_t page, uint16_t offset, size_t recordSize)
+{
+    int slot = this->findSlot(key, keyLength);
+    if (slot >= 0)
+    {
+        this->pages[this->index[slot].page].liveBytes -= this->index[slot].size;
+    }
+    else
+    {
+        if (this->keyCount >= KV_MAX_KEYS)
+        {
+            Serial.println("MszKvStore::setLocation - index full, dropping key " + String(key));
+            return;
+        }
+        uint32_t hash = this->hashKey(key, keyLength);
+        slot = hash & (INDEX_SLOTS - 1);
+        while (this->index[slot].hash != 0)
+        {
+            slot = (slot + 1) & (INDEX_SLOTS - 1);
+        }
+        this->index[slot].hash = hash;
+        this->keyCount++;
+    }
+    this->index[slot].page = page;
+    this->index[slot].offset = offset;
+    this->index[slot].size = recordSize;
+    this->pages[page].liveBytes += recordSize;
+}
+
+void MszKvStore::removeSlot(int slot)
+{
+    if (slot < 0)
+    {
+        return;
+    }
+    this->pages[this->index[slot].page].liveBytes -= this->index[slot].size;
+    this->index[slot].hash = 0;
+    this->keyCount--;
+
+    // Backward shift deletion: entries after the gap move up unless their home slot lies behind it.
+    int gap = slot;
+    for (int next = (slot + 1) & (INDEX_SLOTS - 1); this->index[next].hash != 0; next = (next + 1) & (INDEX_SLOTS - 1))
+    {
+        int home = this->index[next].hash & (INDEX_SLOTS - 1);
+        bool homeAfterGap = (gap <= next) ? (gap < home && home <= next) : (gap < home || home <= next);
+        if (!homeAfterGap)
+        {
+            this->index[gap] = this->index[next];
+            this->index[next].hash = 0;
+            gap = next;
+        }
+    }
+}
+
+size_t MszKvStore::flashOffset(size_t page, size_t offset) const
+{
+    return page * this->pageSize + offset;
+}
+
+uint32_t MszKvStore::hashKey(const char *key, size_t keyLength)
+{
+    // FNV-1a, 0 is reserved for empty slots.
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < keyLength; i++)
+    {
+        hash = (hash ^ (uint8_t)key[i]) * 16777619u;
+    }
+    return (hash != 0) ? hash : 1;
+}
+
+size_t MszKvStore::alignRecord(size_t size)
+{
+    return (size + 3) & ~(size_t)3;
+}
+
+uint32_t MszKvStore::updateCrc(uint32_t crc, const void *data, size_t length)
+{
+    const uint8_t *bytes = (const uint8_t *)data;
+    for (size_t i = 0; i < length; i++)
+    {
+        crc = CRC_TABLE[(crc ^ bytes[i]) & 0x0F] ^ (crc >> 4);
+        crc = CRC_TABLE[(crc ^ (bytes[i] >> 4)) & 0x0F] ^ (crc >> 4);
+    }
+    return crc;
+}
@@ -0,0 +1,136 @@
+#ifndef MSZ_ASSETKVSTORE_H
+#define MSZ_ASSETKVSTORE_H
+
+#include <Arduino.h>
+#include <functional>
+#include "AssetFlash.h"
+
+// Keys the RAM index holds, the index itself has twice as many slots.
+#ifndef KV_MAX_KEYS
+#define KV_MAX_KEYS 128
+#endif
+#define KV_MAX_KEY_LENGTH 79
+#define KV_MAX_PAGES 64
+// A page erased this many times less than the most worn one gets its data moved, so it joins the rotation again.
+#ifndef KV_WEAR_LEVELING_DELTA
+#define KV_WEAR_LEVELING_DELTA 32
+#endif
+
+/// @class MszKvStore
+/// @brief Append-only key-value store on flash pages with CRC-checked records and a RAM index built at mount.
+/// @details Every put() appends a record to the active page, the newest valid record of a key wins, so an update
+///          replaces the old value atomically: a torn write fails its CRC and the previous record stays in effect.
+///          Pages are ordered by a sequence number in their header, which also keeps their erase count. Once only
+///          one free page is left, compaction copies the live records of the page with the most garbage into it
+///          and erases that page. New pages are taken least worn first, pages falling far behind in erase count get
+///          their cold data moved. The index maps key hashes to record locations, lookups take one hash probe and
+///          one read of the record.
+class MszKvStore
+{
+public:
+    MszKvStore(MszFlash &flash);
+
+    // Scans all pages and builds the index, formats pages that do not hold a valid header.
+    bool mount();
+    bool isMounted() const;
+
+    bool put(const char *key, const void *value, size_t length);
+    // Reads up to length bytes of the value. Returns the bytes read, 0 if the key does not exist.
+    size_t get(const char *key, void *value, size_t length);
+    // Length of the value, 0 if the key does not exist.
+    size_t getLength(const char *key);
+    bool contains(const char *key);
+    bool remove(const char *key);
+
+    // Calls visitor for all keys starting with prefix, the visitor must not modify the store.
+    void forEachKey(const char *prefix, std::function<void(const char *key)> visitor);
+
+    int getKeyCount() const;
+    int getFreePageCount() const;
+    uint32_t getMinEraseCount() const;
+    uint32_t getMaxEraseCount() const;
+    size_t getMaxValueLength() const;
+
+    static const uint32_t PAGE_MAGIC = 0x4B565331; // "KVS1"
+    static const uint32_t NO_SEQUENCE = 0xFFFFFFFF;
+    static const uint8_t RECORD_FLAG_DELETED = 0x01;
+
+private:
+    struct PageHeader
+    {
+        uint32_t magic;
+        uint32_t eraseCount;
+        uint32_t crc; // Over magic and eraseCount, the sequence is programmed later when the page is opened.
+        uint32_t sequence;
+    };
+
+    struct RecordHeader
+    {
+        uint8_t keyLength; // FLASH_ERASED_BYTE marks the free space after the last record of a page.
+        uint8_t flags;
+        uint16_t valueLength;
+        uint32_t crc; // Over keyLength, flags, valueLength, key and value.
+    };
+
+    enum class PageState : uint8_t
+    {
+        Free,
+        Active,
+        Full
+    };
+
+    struct PageInfo
+    {
+        uint32_t sequence;
+        uint32_t eraseCount;
+        uint16_t writeOffset;
+        uint16_t liveBytes;
+        PageState state;
+    };
+
+    struct IndexEntry
+    {
+        uint32_t hash; // 0 marks an empty slot.
+        uint16_t page;
+        uint16_t offset;
+        uint16_t size; // Of the whole record including its padding.
+    };
+
+    static const int INDEX_SLOTS = 2 * KV_MAX_KEYS;
+    static_assert((INDEX_SLOTS & (INDEX_SLOTS - 1)) == 0, "KV_MAX_KEYS must be a power of two.");
+
+    MszFlash &flash;
+    bool mounted;
+    size_t pageSize;
+    size_t pageCount;
+    PageInfo pages[KV_MAX_PAGES];
+    int activePage;
+    uint32_t nextSequence;
+    bool compacting;
+    IndexEntry index[INDEX_SLOTS];
+    int keyCount;
+
+    bool formatPage(size_t page, uint32_t eraseCount);
+    bool ensureRoom(size_t recordSize);
+    bool openPage();
+    bool compact();
+    int selectCompactionVictim();
+    bool append(const char *key, size_t keyLength, uint8_t flags, const void *value, size_t valueLength, uint16_t &page, uint16_t &offset);
+    bool copyRecord(uint16_t page, uint16_t offset, size_t recordSize, uint16_t &newPage, uint16_t &newOffset);
+    void scanPage(size_t page);
+    bool readRecordStart(size_t page, size_t offset, RecordHeader &header, char *key);
+    bool checkRecord(size_t page, size_t offset, const RecordHeader &header, const char *key);
+    bool valueEquals(const IndexEntry &entry, const void *value, size_t length);
+    bool hasOlderPage(size_t page) const;
+
+    int findSlot(const char *key, size_t keyLength);
+    void setLocation(const char *key, size_t keyLength, uint16_t page, uint16_t offset, size_t recordSize);
+    void removeSlot(int slot);
+    size_t flashOffset(size_t page, size_t offset) const;
+
+    static uint32_t hashKey(const char *key, size_t keyLength);
+    static size_t alignRecord(size_t size);
+    static uint32_t updateCrc(uint32_t crc, const void *data, size_t length);
+};
+
+#endif // MSZ_ASSETKVSTORE_H
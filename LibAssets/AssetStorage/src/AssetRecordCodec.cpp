@@ -0,0 +1,213 @@
+#include "AssetRecordCodec.h"
+
+// Nested lengths are reserved as two varint bytes, a zero padded varint is still valid when the length is shorter.
+#define NESTED_LENGTH_BYTES 2
+#define NESTED_LENGTH_MAX 0x3FFF
+
+MszRecordWriter::MszRecordWriter(uint8_t *buffer, size_t capacity)
+{
+    this->buffer = buffer;
+    this->capacity = capacity;
+    this->length = 0;
+    this->overflowed = false;
+}
+
+void MszRecordWriter::writeHeader(uint8_t version)
+{
+    uint8_t marker = MSZ_RECORD_MARKER;
+    this->writeBytes(&marker, 1);
+    this->writeVarint(version);
+}
+
+void MszRecordWriter::writeBool(uint32_t id, bool value)
+{
+    this->writeTag(id, MSZ_RECORD_WIRE_VARINT);
+    this->writeVarint(value ? 1 : 0);
+}
+
+size_t MszRecordWriter::getLength() const
+{
+    return this->overflowed ? 0 : this->length;
+}
+
+void MszRecordWriter::writeTag(uint32_t id, uint8_t wireType)
+{
+    this->writeVarint(((uint64_t)id << 3) | wireType);
+}
+
+void MszRecordWriter::writeVarint(uint64_t value)
+{
+    uint8_t bytes[10];
+    size_t count = 0;
+    do
+    {
+        bytes[count] = value & 0x7F;
+        value >>= 7;
+        if (value != 0)
+        {
+            bytes[count] |= 0x80;
+        }
+        count++;
+    } while (value != 0);
+    this->writeBytes(bytes, count);
+}
+
+void MszRecordWriter::writeBytes(const void *data, size_t length)
+{
+    if (this->overflowed || length > this->capacity - this->length)
+    {
+        this->overflowed = true;
+        return;
+    }
+    memcpy(this->buffer + this->length, data, length);
+    this->length += length;
+}
+
+size_t MszRecordWriter::beginNested()
+{
+    uint8_t placeholder[NESTED_LENGTH_BYTES] = {0x80, 0x00};
+    this->writeBytes(placeholder, sizeof(placeholder));
+    return this->length;
+}
+
+void MszRecordWriter::endNested(size_t start)
+{
+    if (this->overflowed)
+    {
+        return;
+    }
+    size_t nestedLength = this->length - start;
+    if (nestedLength > NESTED_LENGTH_MAX)
+    {
+        this->overflowed = true;
+        return;
+    }
+    this->buffer[start - 2] = 0x80 | (nestedLength & 0x7F);
+    this->buffer[start - 1] = nestedLength >> 7;
+}
+
+MszRecordReader::MszRecordReader(const uint8_t *buffer, size_t length)
+{
+    this->buffer = buffer;
+    this->length = length;
+    this->position = 0;
+    this->wireType = MSZ_RECORD_WIRE_VARINT;
+    this->error = false;
+}
+
+bool MszRecordReader::readHeader(uint8_t &version)
+{
+    uint64_t value;
+    if (this->length == 0 || this->buffer[0] != MSZ_RECORD_MARKER)
+    {
+        return false;
+    }
+    this->position = 1;
+    if (!this->readVarint(value) || value > 0xFF)
+    {
+        this->error = true;
+        return false;
+    }
+    version = value;
+    return true;
+}
+
+bool MszRecordReader::nextField(uint32_t &id)
+{
+    uint64_t tag;
+    if (this->error || this->position >= this->length || !this->readVarint(tag))
+    {
+        return false;
+    }
+    this->wireType = tag & 0x07;
+    if (this->wireType != MSZ_RECORD_WIRE_VARINT && this->wireType != MSZ_RECORD_WIRE_BYTES)
+    {
+        this->error = true;
+        return false;
+    }
+    id = tag >> 3;
+    return true;
+}
+
+void MszRecordReader::skipField()
+{
+    uint64_t value;
+    const uint8_t *data;
+    size_t dataLength;
+    if (this->wireType == MSZ_RECORD_WIRE_VARINT)
+    {
+        this->readVarint(value);
+    }
+    else
+    {
+        this->readLengthPrefixed(data, dataLength);
+    }
+}
+
+bool MszRecordReader::hasError() const
+{
+    return this->error;
+}
+
+void MszRecordReader::readBool(bool &value)
+{
+    uint64_t raw;
+    if (this->readVarintField(raw))
+    {
+        value = raw != 0;
+    }
+}
+
+bool MszRecordReader::readVarint(uint64_t &value)
+{
+    value = 0;
+    for (int shift = 0; shift < 64 && this->position < this->length; shift += 7)
+    {
+        uint8_t byte = this->buffer[this->position++];
+        value |= (uint64_t)(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0)
+        {
+            return true;
+        }
+    }
+    this->error = true;
+    return false;
+}
+
+bool MszRecordReader::readLengthPrefixed(const uint8_t *&data, size_t &length)
+{
+    uint64_t prefix;
+    if (!this->readVarint(prefix))
+    {
+        return false;
+    }
+    if (prefix > this->length - this->position)
+    {
+        this->error = true;
+        return false;
+    }
+    data = this->buffer + this->position;
+    length = prefix;
+    this->position += prefix;
+    return true;
+}
+
+bool MszRecordReader::readVarintField(uint64_t &value)
+{
+    if (this->wireType != MSZ_RECORD_WIRE_VARINT)
+    {
+        this->skipField();
+        return false;
+    }
+    return this->readVarint(value);
+}
+
+bool MszRecordReader::readBytesField(const uint8_t *&data, size_t &length)
+{
+    if (this->wireType != MSZ_RECORD_WIRE_BYTES)
+    {
+        this->skipField();
+        return false;
+    }
+    return this->readLengthPrefixed(data, length);
+}
@@ -0,0 +1,252 @@
+#ifndef MSZ_ASSETRECORDCODEC_H
+#define MSZ_ASSETRECORDCODEC_H
+
+#include <Arduino.h>
+#include <string.h>
+
+// First byte of an encoded record. A raw struct dump of a former version may start with it too, decodeRecord()
+// falls back to the raw layout when such a record does not decode and has the length of the struct.
+#define MSZ_RECORD_MARKER 0xA5
+#define MSZ_RECORD_WIRE_VARINT 0
+#define MSZ_RECORD_WIRE_BYTES 2
+// Buffer large enough for the encoded record of a struct: tags and length prefixes add a few bytes per field, the
+// strings shrink to their length.
+#define MSZ_RECORD_BUFFER_SIZE(Type) (sizeof(Type) + 128)
+
+/// @brief How a stored record was decoded.
+/// @details Raw records are struct dumps written before the encoding existed, they are read as long as the length
+///          matches the struct and should be written again encoded.
+enum class MszRecordFormat
+{
+    Invalid,
+    Encoded,
+    Raw
+};
+
+/// @class MszRecordWriter
+/// @brief Writes a record into a fixed buffer: a header with the schema version, then tagged fields.
+/// @details Tags hold the field id and the wire type, integers are varints with signed ones zigzag encoded, strings
+///          and nested records are length-prefixed. Running out of buffer is remembered, getLength() returns 0 then.
+class MszRecordWriter
+{
+public:
+    MszRecordWriter(uint8_t *buffer, size_t capacity);
+
+    void writeHeader(uint8_t version);
+    void writeBool(uint32_t id, bool value);
+
+    template <typename T>
+    void writeInt(uint32_t id, T value)
+    {
+        int64_t signedValue = value;
+        this->writeTag(id, MSZ_RECORD_WIRE_VARINT);
+        this->writeVarint(((uint64_t)signedValue << 1) ^ (uint64_t)(signedValue >> 63));
+    }
+
+    template <typename T>
+    void writeUnsigned(uint32_t id, T value)
+    {
+        this->writeTag(id, MSZ_RECORD_WIRE_VARINT);
+        this->writeVarint(value);
+    }
+
+    template <size_t N>
+    void writeString(uint32_t id, const char (&value)[N])
+    {
+        size_t length = 0;
+        while (length < N - 1 && value[length] != '\0')
+        {
+            length++;
+        }
+        this->writeTag(id, MSZ_RECORD_WIRE_BYTES);
+        this->writeVarint(length);
+        this->writeBytes(value, length);
+    }
+
+    // Writes the array as one field holding the length-prefixed elements, encoded by their own field list.
+    template <typename T, size_t N>
+    void writeRecords(uint32_t id, const T (&values)[N])
+    {
+        this->writeTag(id, MSZ_RECORD_WIRE_BYTES);
+        size_t fieldStart = this->beginNested();
+        for (size_t i = 0; i < N; i++)
+        {
+            size_t elementStart = this->beginNested();
+            encodeRecordFields(*this, values[i]);
+            this->endNested(elementStart);
+        }
+        this->endNested(fieldStart);
+    }
+
+    size_t getLength() const;
+
+private:
+    uint8_t *buffer;
+    size_t capacity;
+    size_t length;
+    bool overflowed;
+
+    void writeTag(uint32_t id, uint8_t wireType);
+    void writeVarint(uint64_t value);
+    void writeBytes(const void *data, size_t length);
+    size_t beginNested();
+    void endNested(size_t start);
+};
+
+/// @class MszRecordReader
+/// @brief Reads a record written by MszRecordWriter without copying or allocating.
+/// @details Fields are visited in stored order, unknown ids and fields with an unexpected wire type are skipped, so
+///          fields can be added and removed without breaking records stored before. Strings longer than their target
+///          are truncated. Malformed data stops the reader and sets the error flag.
+class MszRecordReader
+{
+public:
+    MszRecordReader(const uint8_t *buffer, size_t length);
+
+    bool readHeader(uint8_t &version);
+    // Moves to the next field, false at the end of the record or on malformed data.
+    bool nextField(uint32_t &id);
+    void skipField();
+    bool hasError() const;
+
+    void readBool(bool &value);
+
+    template <typename T>
+    void readInt(T &value)
+    {
+        uint64_t raw;
+        if (this->readVarintField(raw))
+        {
+            value = (T)(int64_t)((raw >> 1) ^ (~(raw & 1) + 1));
+        }
+    }
+
+    template <typename T>
+    void readUnsigned(T &value)
+    {
+        uint64_t raw;
+        if (this->readVarintField(raw))
+        {
+            value = (T)raw;
+        }
+    }
+
+    template <size_t N>
+    void readString(char (&value)[N])
+    {
+        const uint8_t *data;
+        size_t length;
+        if (this->readBytesField(data, length))
+        {
+            size_t copyLength = (length < N - 1) ? length : N - 1;
+            memcpy(value, data, copyLength);
+            value[copyLength] = '\0';
+        }
+    }
+
+    // Elements missing in the record keep their values, elements beyond the array are ignored.
+    template <typename T, size_t N>
+    void readRecords(T (&values)[N])
+    {
+        const uint8_t *data;
+        size_t length;
+        if (!this->readBytesField(data, length))
+        {
+            return;
+        }
+        MszRecordReader elements(data, length);
+        const uint8_t *elementData;
+        size_t elementLength;
+        for (size_t i = 0; i < N && elements.readLengthPrefixed(elementData, elementLength); i++)
+        {
+            MszRecordReader element(elementData, elementLength);
+            decodeRecordFields(element, values[i]);
+            this->error = this->error || element.hasError();
+        }
+        this->error = this->error || elements.hasError();
+    }
+
+private:
+    const uint8_t *buffer;
+    size_t length;
+    size_t position;
+    uint8_t wireType;
+    bool error;
+
+    bool readVarint(uint64_t &value);
+    bool readLengthPrefixed(const uint8_t *&data, size_t &length);
+    bool readVarintField(uint64_t &value);
+    bool readBytesField(const uint8_t *&data, size_t &length);
+};
+
+// Field list entries: FIELD(id, kind, member) with kind Bool, Int, Unsigned, String or Records. Ids are stored with
+// the fields and must never be reused for another meaning, the version is bumped when older firmware must not read
+// the records anymore.
+#define MSZ_RECORD_ENCODE_FIELD(id, kind, member) writer.write##kind(id, value.member);
+#define MSZ_RECORD_DECODE_FIELD(id, kind, member) \
+    case id:                                      \
+        reader.read##kind(value.member);          \
+        break;
+
+// Generates the codec of a struct from its field list, used by encodeRecord() and decodeRecord().
+#define MSZ_RECORD_DEFINE(Type, version, FIELDS)                                  \
+    static inline uint8_t getRecordVersion(const Type &)                         \
+    {                                                                             \
+        return version;                                                           \
+    }                                                                             \
+    static inline void encodeRecordFields(MszRecordWriter &writer, const Type &value) \
+    {                                                                             \
+        FIELDS(MSZ_RECORD_ENCODE_FIELD)                                           \
+    }                                                                             \
+    static inline void decodeRecordFields(MszRecordReader &reader, Type &value)   \
+    {                                                                             \
+        uint32_t id;                                                              \
+        while (reader.nextField(id))                                              \
+        {                                                                         \
+            switch (id)                                                           \
+            {                                                                     \
+                FIELDS(MSZ_RECORD_DECODE_FIELD)                                   \
+            default:                                                              \
+                reader.skipField();                                               \
+                break;                                                            \
+            }                                                                     \
+        }                                                                         \
+    }
+
+// Encodes value into buffer, returns the length of the record, 0 if it did not fit.
+template <typename T>
+size_t encodeRecord(const T &value, uint8_t *buffer, size_t capacity)
+{
+    MszRecordWriter writer(buffer, capacity);
+    writer.writeHeader(getRecordVersion(value));
+    encodeRecordFields(writer, value);
+    return writer.getLength();
+}
+
+// Decodes a stored record into value, fields missing in the record keep the values value had before.
+template <typename T>
+MszRecordFormat decodeRecord(const uint8_t *buffer, size_t length, T &value)
+{
+    MszRecordReader reader(buffer, length);
+    uint8_t version;
+    if (reader.readHeader(version))
+    {
+        T decoded = value;
+        decodeRecordFields(reader, decoded);
+        if (version <= getRecordVersion(value) && !reader.hasError())
+        {
+            value = decoded;
+            return MszRecordFormat::Encoded;
+        }
+    }
+
+    // A raw struct dump may begin with bytes that look like a header, it is only invalid if its length is off too.
+    if (length == sizeof(T))
+    {
+        memcpy((void *)&value, buffer, sizeof(T));
+        return MszRecordFormat::Raw;
+    }
+    return MszRecordFormat::Invalid;
+}
+
+#endif // MSZ_ASSETRECORDCODEC_H
@@ -0,0 +1,149 @@
+#include "AssetUdpCommandClient.h"
+
+#if !defined(ESP32) && !defined(ESP8266)
+
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+MszUdpCommandClient::MszUdpCommandClient(MszSecretHandler *secretHandler, int secretId, uint32_t clientId)
+{
+    this->secretHandler = secretHandler;
+    this->secretId = secretId;
+    this->clientId = clientId;
+    this->fd = -1;
+    this->lastSeconds = 0;
+    this->counter = 0;
+}
+
+MszUdpCommandClient::~MszUdpCommandClient()
+{
+    this->end();
+}
+
+bool MszUdpCommandClient::begin(const char *host, uint16_t port)
+{
+    this->end();
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    if (inet_pton(AF_INET, host, &address.sin_addr) != 1)
+    {
+        Serial.println("MszUdpCommandClient::begin - invalid address " + String(host));
+        return false;
+    }
+
+    // Connected, so send() needs no address and only datagrams from the asset arrive. Broadcasts need SO_BROADCAST.
+    this->fd = socket(AF_INET, SOCK_DGRAM, 0);
+    int enable = 1;
+    if (this->fd < 0 || setsockopt(this->fd, SOL_SOCKET, SO_BROADCAST, &enable, sizeof(enable)) != 0 ||
+        connect(this->fd, (struct sockaddr *)&address, sizeof(address)) != 0)
+    {
+        Serial.println("MszUdpCommandClient::begin - failed to open a socket to " + String(host));
+        this->end();
+        return false;
+    }
+    return true;
+}
+
+void MszUdpCommandClient::end()
+{
+    if (this->fd >= 0)
+    {
+        close(this->fd);
+        this->fd = -1;
+    }
+}
+
+uint64_t MszUdpCommandClient::nextNonce()
+{
+    uint32_t seconds = (uint32_t)::time(NULL);
+    if (seconds != this->lastSeconds)
+    {
+        this->lastSeconds = seconds;
+        this->counter = 0;
+    }
+    this->counter++;
+    return ((uint64_t)seconds << 32) | this->counter;
+}
+
+size_t MszUdpCommandClient::encode(uint8_t command, uint64_t nonce, const uint8_t *payload, size_t length, uint8_t *datagram)
+{
+    if (length > UDP_MAX_PAYLOAD_LENGTH)
+    {
+        return 0;
+    }
+    UdpCommandHeader header;
+    header.command = command;
+    header.clientId = this->clientId;
+    header.nonce = nonce;
+    header.payloadLength = (uint16_t)length;
+    udpWriteHeader(datagram, header);
+    if (length > 0)
+    {
+        memcpy(datagram + UDP_HEADER_LENGTH, payload, length);
+    }
+
+    // The full HMAC does not fit behind the payload of a datagram of maximum length, only its start is sent.
+    uint8_t signature[MszSecretHandler::SIGNATURE_LENGTH];
+    size_t signedLength = UDP_HEADER_LENGTH + length;
+    if (!this->secretHandler->computeSignature(this->secretId, datagram, signedLength, signature))
+    {
+        return 0;
+    }
+    memcpy(datagram + signedLength, signature, UDP_SIGNATURE_LENGTH);
+    return signedLength + UDP_SIGNATURE_LENGTH;
+}
+
+bool MszUdpCommandClient::send(uint8_t command, uint64_t nonce, const uint8_t *payload, size_t length)
+{
+    uint8_t datagram[UDP_MAX_DATAGRAM_LENGTH];
+    size_t datagramLength = this->encode(command, nonce, payload, length, datagram);
+    return this->fd >= 0 && datagramLength > 0 && ::send(this->fd, datagram, datagramLength, 0) == (ssize_t)datagramLength;
+}
+
+int MszUdpCommandClient::receive(uint8_t command, uint64_t nonce, int timeoutMillis)
+{
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    uint8_t datagram[UDP_MAX_DATAGRAM_LENGTH];
+    for (;;)
+    {
+        struct timespec current;
+        clock_gettime(CLOCK_MONOTONIC, &current);
+        long elapsedMillis = (current.tv_sec - start.tv_sec) * 1000 + (current.tv_nsec - start.tv_nsec) / 1000000;
+        struct pollfd readable = {this->fd, POLLIN, 0};
+        if (this->fd < 0 || elapsedMillis > timeoutMillis || poll(&readable, 1, timeoutMillis - elapsedMillis) <= 0)
+        {
+            return STATUS_TIMEOUT;
+        }
+        ssize_t length = recv(this->fd, datagram, sizeof(datagram), 0);
+
+        UdpCommandHeader header;
+        uint8_t signature[MszSecretHandler::SIGNATURE_LENGTH];
+        if (length <= 0 || !udpReadHeader(datagram, length, header) || header.payloadLength < 1 ||
+            header.command != (command | UDP_COMMAND_RESPONSE_FLAG) || header.clientId != this->clientId || header.nonce != nonce ||
+            !this->secretHandler->computeSignature(this->secretId, datagram, length - UDP_SIGNATURE_LENGTH, signature) ||
+            !MszSecretHandler::signaturesEqual(signature, datagram + length - UDP_SIGNATURE_LENGTH, UDP_SIGNATURE_LENGTH))
+        {
+            continue;
+        }
+        return datagram[UDP_HEADER_LENGTH];
+    }
+}
+
+int MszUdpCommandClient::request(uint8_t command, const uint8_t *payload, size_t length, int timeoutMillis)
+{
+    uint64_t nonce = this->nextNonce();
+    if (!this->send(command, nonce, payload, length))
+    {
+        return STATUS_TIMEOUT;
+    }
+    return this->receive(command, nonce, timeoutMillis);
+}
+
+#endif // !ESP32 && !ESP8266
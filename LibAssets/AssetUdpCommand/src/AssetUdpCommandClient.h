@@ -0,0 +1,50 @@
+#ifndef MSZ_ASSETUDPCOMMANDCLIENT_H
+#define MSZ_ASSETUDPCOMMANDCLIENT_H
+
+#include <Arduino.h>
+#include "SecretHandler.h"
+#include "AssetUdpProtocol.h"
+
+#if !defined(ESP32) && !defined(ESP8266)
+
+/// @class MszUdpCommandClient
+/// @brief Client of the UDP command protocol for Linux hosts, used by the native tests and the load benchmark.
+/// @details Signs with MszSecretHandler like the assets verify. Nonces are the unix seconds of the host in the upper
+///          and a counter in the lower 32 bits, the same scheme as assetUdpCommand.py. send() and receive() are
+///          separate so that several requests can be in flight, request() does both for one command.
+class MszUdpCommandClient
+{
+public:
+    static const int STATUS_TIMEOUT = -1;
+
+    MszUdpCommandClient(MszSecretHandler *secretHandler, int secretId, uint32_t clientId);
+    ~MszUdpCommandClient();
+
+    // Opens the socket, host is an IPv4 address in dotted notation, e.g. 127.0.0.1 or a broadcast address.
+    bool begin(const char *host, uint16_t port);
+    void end();
+
+    uint64_t nextNonce();
+    // Builds a signed datagram, returns its length or 0 if the payload is too long or signing failed.
+    size_t encode(uint8_t command, uint64_t nonce, const uint8_t *payload, size_t length, uint8_t *datagram);
+    // Sends a command with the given nonce, returns false if it could not be sent.
+    bool send(uint8_t command, uint64_t nonce, const uint8_t *payload, size_t length);
+    // Waits up to timeoutMillis for the response to command and nonce, returns its status or STATUS_TIMEOUT.
+    // Responses to other requests, and responses that do not verify, are skipped.
+    int receive(uint8_t command, uint64_t nonce, int timeoutMillis);
+    int request(uint8_t command, const uint8_t *payload, size_t length, int timeoutMillis);
+
+    uint32_t getClientId() const { return this->clientId; }
+
+private:
+    MszSecretHandler *secretHandler;
+    int secretId;
+    uint32_t clientId;
+    int fd;
+    uint32_t lastSeconds;
+    uint32_t counter;
+};
+
+#endif // !ESP32 && !ESP8266
+
+#endif // MSZ_ASSETUDPCOMMANDCLIENT_H
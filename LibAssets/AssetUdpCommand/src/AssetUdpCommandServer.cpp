@@ -0,0 +1,236 @@
+#include "AssetUdpCommandServer.h"
+#include <TimeLib.h>
+
+MszUdpCommandServer::MszUdpCommandServer(uint16_t port)
+{
+    this->port = port;
+    this->secretHandler = NULL;
+    this->secretId = 0;
+    this->commandCount = 0;
+    for (int i = 0; i < MAX_UDP_CLIENTS; i++)
+    {
+        this->clients[i].inUse = false;
+    }
+    this->highestTimeNonce = 0;
+
+    this->commandsMetric = MszMetricsRegistry::registerCounter("udp_commands_total", "Commands received via UDP and dispatched.");
+    this->rejectedMalformedMetric = MszMetricsRegistry::registerCounter("udp_commands_rejected_total", "Datagrams received via UDP and dropped.", "reason=\"malformed\"");
+    this->rejectedSignatureMetric = MszMetricsRegistry::registerCounter("udp_commands_rejected_total", "Datagrams received via UDP and dropped.", "reason=\"signature\"");
+    this->rejectedReplayMetric = MszMetricsRegistry::registerCounter("udp_commands_rejected_total", "Datagrams received via UDP and dropped.", "reason=\"replay\"");
+
+    this->clockOffsetMetric = MszMetricsRegistry::registerGauge("clock_beacon_offset_milliseconds", "Offset of the last time beacon to the local time.");
+    this->clockDriftMetric = MszMetricsRegistry::registerGauge("clock_drift_ppb", "Estimated drift of the local clock corrected between time beacons.");
+
+    this->registerCommand(UDP_COMMAND_TIME, [this](const uint8_t *payload, size_t length)
+                          { return this->handleTime(payload, length); });
+}
+
+void MszUdpCommandServer::begin(MszSecretHandler *secretHandler, int secretId)
+{
+    Serial.println("MszUdpCommandServer::begin - listening on UDP port " + String(this->port));
+    this->secretHandler = secretHandler;
+    this->secretId = secretId;
+    this->udp.begin(this->port);
+}
+
+bool MszUdpCommandServer::registerCommand(uint8_t command, MszUdpCommandHandler handler)
+{
+    if (this->commandCount >= MAX_UDP_COMMANDS || (command & UDP_COMMAND_RESPONSE_FLAG) != 0)
+    {
+        Serial.println("MszUdpCommandServer::registerCommand - cannot register command " + String(command));
+        return false;
+    }
+    this->commands[this->commandCount].command = command;
+    this->commands[this->commandCount].handler = handler;
+    this->commandCount++;
+    return true;
+}
+
+void MszUdpCommandServer::loop()
+{
+    if (this->secretHandler == NULL)
+    {
+        return;
+    }
+
+    // A few datagrams per pass at most, a flood must not starve the other work of the loop.
+    uint8_t datagram[UDP_MAX_DATAGRAM_LENGTH];
+    for (int i = 0; i < UDP_MAX_DATAGRAMS_PER_LOOP; i++)
+    {
+        int packetLength = this->udp.parsePacket();
+        if (packetLength <= 0)
+        {
+            return;
+        }
+        if (packetLength > UDP_MAX_DATAGRAM_LENGTH)
+        {
+            this->rejectedMalformedMetric->increment();
+            continue;
+        }
+        int readLength = this->udp.read(datagram, packetLength);
+        if (readLength > 0)
+        {
+            this->handleDatagram(datagram, readLength);
+        }
+    }
+}
+
+void MszUdpCommandServer::handleDatagram(const uint8_t *datagram, size_t length)
+{
+    // No logging on this path, at 9600 baud a single line takes longer than the whole command.
+    UdpCommandHeader header;
+    if (!udpReadHeader(datagram, length, header) || (header.command & UDP_COMMAND_RESPONSE_FLAG) != 0)
+    {
+        this->rejectedMalformedMetric->increment();
+        return;
+    }
+    if (!this->verifySignature(datagram, length - UDP_SIGNATURE_LENGTH))
+    {
+        this->rejectedSignatureMetric->increment();
+        return;
+    }
+    if (!this->acceptNonce(header, (uint32_t)now()))
+    {
+        this->rejectedReplayMetric->increment();
+        return;
+    }
+
+    this->commandsMetric->increment();
+    uint8_t status = this->dispatch(header, datagram + UDP_HEADER_LENGTH);
+    this->sendResponse(header, status);
+}
+
+bool MszUdpCommandServer::verifySignature(const uint8_t *datagram, size_t signedLength)
+{
+    uint8_t signature[MszSecretHandler::SIGNATURE_LENGTH];
+    if (!this->secretHandler->computeSignature(this->secretId, datagram, signedLength, signature))
+    {
+        return false;
+    }
+    return MszSecretHandler::signaturesEqual(signature, datagram + signedLength, UDP_SIGNATURE_LENGTH);
+}
+
+bool MszUdpCommandServer::acceptNonce(const UdpCommandHeader &header, uint32_t nowSeconds)
+{
+    // Out of order time nonces would move the clock back, whichever client sent them. One high-water mark for all
+    // clients keeps every time nonce accepted once without holding a client entry per beacon.
+    if (header.command == UDP_COMMAND_TIME)
+    {
+        if (header.nonce <= this->highestTimeNonce)
+        {
+            return false;
+        }
+        this->highestTimeNonce = header.nonce;
+        return true;
+    }
+
+    uint32_t nonceSeconds = udpNonceSeconds(header.nonce);
+    if (nonceSeconds + UDP_MAX_NONCE_AGE_SECONDS < nowSeconds || nonceSeconds > nowSeconds + UDP_MAX_NONCE_AGE_SECONDS)
+    {
+        return false;
+    }
+
+    ClientEntry *client = NULL;
+    ClientEntry *freeClient = NULL;
+    for (int i = 0; i < MAX_UDP_CLIENTS; i++)
+    {
+        ClientEntry &entry = this->clients[i];
+        if (entry.inUse && entry.clientId == header.clientId)
+        {
+            client = &entry;
+            break;
+        }
+        // A client may only be forgotten once all of its nonces are too old to be accepted anyway.
+        if (freeClient == NULL && (!entry.inUse || entry.lastNonceSeconds + UDP_MAX_NONCE_AGE_SECONDS < nowSeconds))
+        {
+            freeClient = &entry;
+        }
+    }
+
+    if (client == NULL)
+    {
+        if (freeClient == NULL)
+        {
+            return false;
+        }
+        client = freeClient;
+        client->inUse = true;
+        client->clientId = header.clientId;
+        client->highestNonce = header.nonce;
+        client->seenNonces = 1;
+        client->lastNonceSeconds = 0;
+    }
+    else if (header.nonce > client->highestNonce)
+    {
+        uint64_t shift = header.nonce - client->highestNonce;
+        client->seenNonces = (shift >= 64 ? 0 : client->seenNonces << shift) | 1;
+        client->highestNonce = header.nonce;
+    }
+    else
+    {
+        uint64_t age = client->highestNonce - header.nonce;
+        if (age >= 64 || (client->seenNonces & ((uint64_t)1 << age)) != 0)
+        {
+            return false;
+        }
+        client->seenNonces |= ((uint64_t)1 << age);
+    }
+
+    uint32_t lastSeconds = (nonceSeconds > nowSeconds ? nonceSeconds : nowSeconds);
+    if (lastSeconds > client->lastNonceSeconds)
+    {
+        client->lastNonceSeconds = lastSeconds;
+    }
+    return true;
+}
+
+uint8_t MszUdpCommandServer::dispatch(const UdpCommandHeader &header, const uint8_t *payload)
+{
+    for (int i = 0; i < this->commandCount; i++)
+    {
+        if (this->commands[i].command == header.command)
+        {
+            return this->commands[i].handler(payload, header.payloadLength);
+        }
+    }
+    return UDP_STATUS_UNKNOWN_COMMAND;
+}
+
+void MszUdpCommandServer::sendResponse(const UdpCommandHeader &request, uint8_t status)
+{
+    uint8_t response[UDP_HEADER_LENGTH + 1 + MszSecretHandler::SIGNATURE_LENGTH];
+    UdpCommandHeader header = request;
+    header.command = request.command | UDP_COMMAND_RESPONSE_FLAG;
+    header.payloadLength = 1;
+    udpWriteHeader(response, header);
+    response[UDP_HEADER_LENGTH] = status;
+
+    // The full HMAC is computed into the buffer, only its first UDP_SIGNATURE_LENGTH bytes are sent.
+    size_t signedLength = UDP_HEADER_LENGTH + 1;
+    if (!this->secretHandler->computeSignature(this->secretId, response, signedLength, response + signedLength))
+    {
+        return;
+    }
+
+    this->udp.beginPacket(this->udp.remoteIP(), this->udp.remotePort());
+    this->udp.write(response, signedLength + UDP_SIGNATURE_LENGTH);
+    this->udp.endPacket();
+}
+
+uint8_t MszUdpCommandServer::handleTime(const uint8_t *payload, size_t length)
+{
+    // Payload is the unix time in milliseconds.
+    if (length != 8)
+    {
+        return UDP_STATUS_BAD_REQUEST;
+    }
+    uint64_t unixMillis = 0;
+    for (size_t i = 0; i < 8; i++)
+    {
+        unixMillis = (unixMillis << 8) | payload[i];
+    }
+    MszClockDiscipline::applyBeacon(unixMillis);
+    this->clockOffsetMetric->set(MszClockDiscipline::getLastOffsetMillis());
+    this->clockDriftMetric->set((int32_t)(MszClockDiscipline::getDriftPpm() * 1000.0f));
+    return UDP_STATUS_OK;
+}
@@ -0,0 +1,85 @@
+#ifndef MSZ_ASSETUDPCOMMANDSERVER_H
+#define MSZ_ASSETUDPCOMMANDSERVER_H
+
+#include <Arduino.h>
+#include <functional>
+#include <WiFiUdp.h>
+#include "SecretHandler.h"
+#include "AssetMetrics.h"
+#include "AssetUdpProtocol.h"
+#include "AssetClockDiscipline.h"
+
+#define UDP_COMMAND_DEFAULT_PORT 4210
+#define MAX_UDP_COMMANDS 8
+#define MAX_UDP_CLIENTS 8
+
+/// @brief Handles the payload of a command received via UDP and returns one of the UDP_STATUS_* values.
+typedef std::function<uint8_t(const uint8_t *payload, size_t length)> MszUdpCommandHandler;
+
+/// @class MszUdpCommandServer
+/// @brief Receives signed commands via UDP, the fast path next to the HTTP API for latency-critical operations.
+/// @details Every datagram is verified with the same secret as the HTTP API before anything else happens, invalid
+///          datagrams are dropped without a response. A nonce older than UDP_MAX_NONCE_AGE_SECONDS is rejected,
+///          and a small table per client id rejects nonces seen before within a 64 nonces sliding window. Clients
+///          stay in that table until their nonces expired, so a replay never finds a client forgotten. Responses
+///          echo client id and nonce, carry a status byte and are signed the same way.
+///          The time command is built in and hands the time to MszClockDiscipline. As it is the command that sets
+///          the device time, its nonces are not checked against that time, a clock running ahead or behind would
+///          reject every correction. Instead it only accepts nonces above the highest time nonce accepted from any
+///          client, which needs no client table entry: a gateway sending each beacon with a fresh client id does
+///          not fill the table. A gateway broadcasting it syncs all assets sharing the secret with a single datagram.
+class MszUdpCommandServer
+{
+public:
+    MszUdpCommandServer(uint16_t port = UDP_COMMAND_DEFAULT_PORT);
+
+    void begin(MszSecretHandler *secretHandler, int secretId);
+    bool registerCommand(uint8_t command, MszUdpCommandHandler handler);
+    void loop();
+
+    static const uint32_t UDP_MAX_NONCE_AGE_SECONDS = 60;
+    static const int UDP_MAX_DATAGRAMS_PER_LOOP = 4;
+
+protected:
+    struct CommandEntry
+    {
+        uint8_t command;
+        MszUdpCommandHandler handler;
+    };
+
+    struct ClientEntry
+    {
+        bool inUse;
+        uint32_t clientId;
+        uint64_t highestNonce;
+        uint64_t seenNonces;
+        uint32_t lastNonceSeconds;
+    };
+
+    uint16_t port;
+    WiFiUDP udp;
+    MszSecretHandler *secretHandler;
+    int secretId;
+
+    CommandEntry commands[MAX_UDP_COMMANDS];
+    int commandCount;
+    ClientEntry clients[MAX_UDP_CLIENTS];
+    uint64_t highestTimeNonce;
+
+    MszCounter *commandsMetric;
+    MszCounter *rejectedMalformedMetric;
+    MszCounter *rejectedSignatureMetric;
+    MszCounter *rejectedReplayMetric;
+    MszGauge *clockOffsetMetric;
+    MszGauge *clockDriftMetric;
+
+    void handleDatagram(const uint8_t *datagram, size_t length);
+    bool verifySignature(const uint8_t *datagram, size_t signedLength);
+    bool acceptNonce(const UdpCommandHeader &header, uint32_t nowSeconds);
+    uint8_t dispatch(const UdpCommandHeader &header, const uint8_t *payload);
+    void sendResponse(const UdpCommandHeader &request, uint8_t status);
+
+    uint8_t handleTime(const uint8_t *payload, size_t length);
+};
+
+#endif // MSZ_ASSETUDPCOMMANDSERVER_H
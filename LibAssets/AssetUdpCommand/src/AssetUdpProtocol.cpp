@@ -0,0 +1,41 @@
+#include "AssetUdpProtocol.h"
+
+bool udpReadHeader(const uint8_t *datagram, size_t length, UdpCommandHeader &header)
+{
+    if (length < UDP_HEADER_LENGTH + UDP_SIGNATURE_LENGTH || length > UDP_MAX_DATAGRAM_LENGTH)
+    {
+        return false;
+    }
+    if (datagram[0] != UDP_PROTOCOL_MAGIC_0 || datagram[1] != UDP_PROTOCOL_MAGIC_1 || datagram[2] != UDP_PROTOCOL_VERSION)
+    {
+        return false;
+    }
+
+    header.command = datagram[3];
+    header.clientId = ((uint32_t)datagram[4] << 24) | ((uint32_t)datagram[5] << 16) | ((uint32_t)datagram[6] << 8) | datagram[7];
+    header.nonce = 0;
+    for (int i = 8; i < 16; i++)
+    {
+        header.nonce = (header.nonce << 8) | datagram[i];
+    }
+    header.payloadLength = ((uint16_t)datagram[16] << 8) | datagram[17];
+    return (size_t)UDP_HEADER_LENGTH + header.payloadLength + UDP_SIGNATURE_LENGTH == length;
+}
+
+void udpWriteHeader(uint8_t *datagram, const UdpCommandHeader &header)
+{
+    datagram[0] = UDP_PROTOCOL_MAGIC_0;
+    datagram[1] = UDP_PROTOCOL_MAGIC_1;
+    datagram[2] = UDP_PROTOCOL_VERSION;
+    datagram[3] = header.command;
+    datagram[4] = (uint8_t)(header.clientId >> 24);
+    datagram[5] = (uint8_t)(header.clientId >> 16);
+    datagram[6] = (uint8_t)(header.clientId >> 8);
+    datagram[7] = (uint8_t)header.clientId;
+    for (int i = 0; i < 8; i++)
+    {
+        datagram[15 - i] = (uint8_t)(header.nonce >> (8 * i));
+    }
+    datagram[16] = (uint8_t)(header.payloadLength >> 8);
+    datagram[17] = (uint8_t)header.payloadLength;
+}
@@ -0,0 +1,59 @@
+#ifndef MSZ_ASSETUDPPROTOCOL_H
+#define MSZ_ASSETUDPPROTOCOL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Datagram layout of the UDP command protocol, all numbers big-endian:
+ *
+ *   0  magic "MZ"          2 bytes
+ *   2  version             1 byte
+ *   3  command             1 byte, responses set UDP_COMMAND_RESPONSE_FLAG
+ *   4  client id           4 bytes, chosen randomly by the client
+ *   8  nonce               8 bytes, unix seconds in the upper and a counter in the lower 32 bits
+ *  16  payload length      2 bytes
+ *  18  payload             0 - UDP_MAX_PAYLOAD_LENGTH bytes, responses start with a UDP_STATUS_* byte
+ *      signature           8 bytes, truncated HMAC-SHA256 over all bytes before it
+ */
+#define UDP_PROTOCOL_MAGIC_0 'M'
+#define UDP_PROTOCOL_MAGIC_1 'Z'
+#define UDP_PROTOCOL_VERSION 1
+
+#define UDP_HEADER_LENGTH 18
+#define UDP_SIGNATURE_LENGTH 8
+#define UDP_MAX_PAYLOAD_LENGTH 200
+#define UDP_MAX_DATAGRAM_LENGTH (UDP_HEADER_LENGTH + UDP_MAX_PAYLOAD_LENGTH + UDP_SIGNATURE_LENGTH)
+
+#define UDP_COMMAND_RESPONSE_FLAG 0x80
+#define UDP_COMMAND_SWITCH_ON 0x01
+#define UDP_COMMAND_SWITCH_OFF 0x02
+#define UDP_COMMAND_SCENE 0x03
+#define UDP_COMMAND_TIME 0x04
+
+#define UDP_STATUS_OK 0
+#define UDP_STATUS_BAD_REQUEST 1
+#define UDP_STATUS_NOT_FOUND 2
+#define UDP_STATUS_BUSY 3
+#define UDP_STATUS_UNKNOWN_COMMAND 4
+
+/// @brief Header of a datagram of the UDP command protocol.
+struct UdpCommandHeader
+{
+    uint8_t command;
+    uint32_t clientId;
+    uint64_t nonce;
+    uint16_t payloadLength;
+};
+
+/// @brief Reads the header of a datagram, returns false if the datagram is not a valid datagram of this protocol.
+/// @details Checks magic, version and that the payload length matches the datagram length, not the signature.
+bool udpReadHeader(const uint8_t *datagram, size_t length, UdpCommandHeader &header);
+
+/// @brief Writes the header for a payload of header.payloadLength bytes, the payload follows at UDP_HEADER_LENGTH.
+void udpWriteHeader(uint8_t *datagram, const UdpCommandHeader &header);
+
+/// @brief Returns the unix seconds encoded in the upper half of a nonce.
+inline uint32_t udpNonceSeconds(uint64_t nonce) { return (uint32_t)(nonce >> 32); }
+
+#endif // MSZ_ASSETUDPPROTOCOL_H
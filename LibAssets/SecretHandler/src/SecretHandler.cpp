@@ -3,11 +3,12 @@
 #include <functional>
 
 #if defined(ESP32)
-#include <LittleFS.h>
-#include <TimeLib.h>
 #include <mbedtls/md.h>
 #elif defined(ESP8266)
-#include <FS.h>
+#include <bearssl/bearssl_hmac.h>
+#endif
+#if !defined(ESP8266)
+#include <TimeLib.h>
 #endif
 
 MszSecretHandler::MszSecretHandler()
@@ -69,13 +70,24 @@ bool MszSecretHandler::setSecret(int index, const char *secret, int secretLength
     return true;
 }
 
-#if defined(ESP32)
+bool MszSecretHandler::signaturesEqual(const uint8_t *expected, const uint8_t *actual, size_t length)
+{
+    // Compare all bytes, the time taken must not tell how many of them matched.
+    uint8_t difference = 0;
+    for (size_t i = 0; i < length; i++)
+    {
+        difference |= expected[i] ^ actual[i];
+    }
+    return difference == 0;
+}
+
+#if !defined(ESP8266)
 
 bool MszSecretHandler::validateTokenSignature(String token, long tokenTimestamp, int secretKeyIndex, String signature, int tokenExpirationSeconds)
 {
     Serial.println("Validating token signature - enter.");
 
-    if (secretKeyIndex < 0 || secretKeyIndex > MszSecretHandler::MAX_SECRETS)
+    if (secretKeyIndex < 0 || secretKeyIndex >= MszSecretHandler::MAX_SECRETS)
     {
         Serial.println("Validating token signature failed - INVALID INDEX - exit.");
         return false;
@@ -87,29 +99,18 @@ bool MszSecretHandler::validateTokenSignature(String token, long tokenTimestamp,
         return false;
     }
 
-    const char *secretKey = this->secrets[secretKeyIndex];
-
-    String tokenTimestampString = String(tokenTimestamp);
-
-    unsigned char output[32]; // Buffer to hold the HMAC output
-    mbedtls_md_context_t ctx;
-    mbedtls_md_type_t md_type = MBEDTLS_MD_SHA256;
+    // The signature is the HMAC of the token followed by the timestamp in decimal.
+    String signedContent = token + String(tokenTimestamp);
+    uint8_t output[MszSecretHandler::SIGNATURE_LENGTH];
+    this->computeSignature(secretKeyIndex, (const uint8_t *)signedContent.c_str(), signedContent.length(), output);
 
-    const size_t keyLength = strlen(secretKey);
-    mbedtls_md_init(&ctx);
-    mbedtls_md_setup(&ctx, mbedtls_md_info_from_type(md_type), 1);
-    mbedtls_md_hmac_starts(&ctx, (unsigned char *)secretKey, keyLength);
-    mbedtls_md_hmac_update(&ctx, (unsigned char *)token.c_str(), token.length());
-    mbedtls_md_hmac_update(&ctx, (unsigned char *)tokenTimestampString.c_str(), tokenTimestampString.length());
-    mbedtls_md_hmac_finish(&ctx, output);
-    mbedtls_md_free(&ctx);
-
-    char *expectedSignature = (char *)output;
     String expectedSignatureHex = toHexString(output, sizeof(output));
     Serial.println("Expected signature (hex): " + expectedSignatureHex);
     Serial.println("Actual signature (hex):   " + signature);
 
-    bool result = signature.equals(expectedSignatureHex);
+    // Compared in constant time like the binary signatures, the response time must not tell how many characters match.
+    bool result = signature.length() == expectedSignatureHex.length() &&
+                  signaturesEqual((const uint8_t *)expectedSignatureHex.c_str(), (const uint8_t *)signature.c_str(), signature.length());
     Serial.println("Signature match: " + String(result));
 
     time_t currentTime = now();
@@ -124,8 +125,47 @@ bool MszSecretHandler::validateTokenSignature(String token, long tokenTimestamp,
     return result;
 }
 
+#endif
+
+#if defined(ESP32)
+
+bool MszSecretHandler::computeSignature(int secretKeyIndex, const uint8_t *data, size_t length, uint8_t *output)
+{
+    if (secretKeyIndex < 0 || secretKeyIndex >= MszSecretHandler::MAX_SECRETS || this->secrets[secretKeyIndex] == NULL)
+    {
+        return false;
+    }
+
+    const char *secretKey = this->secrets[secretKeyIndex];
+    mbedtls_md_context_t ctx;
+    mbedtls_md_init(&ctx);
+    mbedtls_md_setup(&ctx, mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), 1);
+    mbedtls_md_hmac_starts(&ctx, (const unsigned char *)secretKey, strlen(secretKey));
+    mbedtls_md_hmac_update(&ctx, data, length);
+    mbedtls_md_hmac_finish(&ctx, output);
+    mbedtls_md_free(&ctx);
+    return true;
+}
+
 #elif defined(ESP8266)
 
+bool MszSecretHandler::computeSignature(int secretKeyIndex, const uint8_t *data, size_t length, uint8_t *output)
+{
+    if (secretKeyIndex < 0 || secretKeyIndex >= MszSecretHandler::MAX_SECRETS || this->secrets[secretKeyIndex] == NULL)
+    {
+        return false;
+    }
+
+    const char *secretKey = this->secrets[secretKeyIndex];
+    br_hmac_key_context keyContext;
+    br_hmac_context hmacContext;
+    br_hmac_key_init(&keyContext, &br_sha256_vtable, secretKey, strlen(secretKey));
+    br_hmac_init(&hmacContext, &keyContext, 0);
+    br_hmac_update(&hmacContext, data, length);
+    br_hmac_out(&hmacContext, output);
+    return true;
+}
+
 bool MszSecretHandler::validateTokenSignature(String token, long tokenTimestamp, int secretKeyIndex, String signature, int tokenExpirationSeconds)
 {
     Serial.println("Validating token signature - enter.");
@@ -134,4 +174,166 @@ bool MszSecretHandler::validateTokenSignature(String token, long tokenTimestamp,
     return true;
 }
 
-#endif
\ No newline at end of file
+#else
+
+// Native builds have no crypto library, SHA-256 (FIPS 180-4) and HMAC (RFC 2104) are implemented here so that the
+// tests and the host tools sign exactly like the devices.
+#define SHA256_BLOCK_LENGTH 64
+
+struct Sha256Context
+{
+    uint32_t state[8];
+    uint8_t block[SHA256_BLOCK_LENGTH];
+    size_t blockLength;
+    uint64_t totalLength;
+};
+
+static const uint32_t SHA256_ROUND_CONSTANTS[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+static uint32_t rotateRight(uint32_t value, int bits)
+{
+    return (value >> bits) | (value << (32 - bits));
+}
+
+static void sha256Transform(Sha256Context &context, const uint8_t *block)
+{
+    uint32_t w[64];
+    for (int i = 0; i < 16; i++)
+    {
+        w[i] = ((uint32_t)block[i * 4] << 24) | ((uint32_t)block[i * 4 + 1] << 16) | ((uint32_t)block[i * 4 + 2] << 8) | block[i * 4 + 3];
+    }
+    for (int i = 16; i < 64; i++)
+    {
+        uint32_t s0 = rotateRight(w[i - 15], 7) ^ rotateRight(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = rotateRight(w[i - 2], 17) ^ rotateRight(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint32_t a = context.state[0], b = context.state[1], c = context.state[2], d = context.state[3];
+    uint32_t e = context.state[4], f = context.state[5], g = context.state[6], h = context.state[7];
+    for (int i = 0; i < 64; i++)
+    {
+        uint32_t t1 = h + (rotateRight(e, 6) ^ rotateRight(e, 11) ^ rotateRight(e, 25)) + ((e & f) ^ (~e & g)) + SHA256_ROUND_CONSTANTS[i] + w[i];
+        uint32_t t2 = (rotateRight(a, 2) ^ rotateRight(a, 13) ^ rotateRight(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+    context.state[0] += a;
+    context.state[1] += b;
+    context.state[2] += c;
+    context.state[3] += d;
+    context.state[4] += e;
+    context.state[5] += f;
+    context.state[6] += g;
+    context.state[7] += h;
+}
+
+static void sha256Init(Sha256Context &context)
+{
+    static const uint32_t initialState[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+    memcpy(context.state, initialState, sizeof(initialState));
+    context.blockLength = 0;
+    context.totalLength = 0;
+}
+
+static void sha256Update(Sha256Context &context, const uint8_t *data, size_t length)
+{
+    context.totalLength += length;
+    for (size_t i = 0; i < length; i++)
+    {
+        context.block[context.blockLength++] = data[i];
+        if (context.blockLength == SHA256_BLOCK_LENGTH)
+        {
+            sha256Transform(context, context.block);
+            context.blockLength = 0;
+        }
+    }
+}
+
+static void sha256Finish(Sha256Context &context, uint8_t *output)
+{
+    // Padding: a 1 bit, zeros up to 8 bytes before the end of a block, then the message length in bits.
+    uint64_t bitLength = context.totalLength * 8;
+    uint8_t padding = 0x80;
+    sha256Update(context, &padding, 1);
+    padding = 0;
+    while (context.blockLength != SHA256_BLOCK_LENGTH - 8)
+    {
+        sha256Update(context, &padding, 1);
+    }
+    uint8_t lengthBytes[8];
+    for (int i = 0; i < 8; i++)
+    {
+        lengthBytes[i] = (uint8_t)(bitLength >> (56 - 8 * i));
+    }
+    sha256Update(context, lengthBytes, 8);
+    for (int i = 0; i < 8; i++)
+    {
+        output[i * 4] = (uint8_t)(context.state[i] >> 24);
+        output[i * 4 + 1] = (uint8_t)(context.state[i] >> 16);
+        output[i * 4 + 2] = (uint8_t)(context.state[i] >> 8);
+        output[i * 4 + 3] = (uint8_t)context.state[i];
+    }
+}
+
+bool MszSecretHandler::computeSignature(int secretKeyIndex, const uint8_t *data, size_t length, uint8_t *output)
+{
+    if (secretKeyIndex < 0 || secretKeyIndex >= MszSecretHandler::MAX_SECRETS || this->secrets[secretKeyIndex] == NULL)
+    {
+        return false;
+    }
+
+    // Keys longer than a block are hashed first, shorter ones are padded with zeros.
+    const char *secretKey = this->secrets[secretKeyIndex];
+    size_t keyLength = strlen(secretKey);
+    uint8_t key[SHA256_BLOCK_LENGTH];
+    memset(key, 0, sizeof(key));
+    Sha256Context context;
+    if (keyLength > SHA256_BLOCK_LENGTH)
+    {
+        sha256Init(context);
+        sha256Update(context, (const uint8_t *)secretKey, keyLength);
+        sha256Finish(context, key);
+    }
+    else
+    {
+        memcpy(key, secretKey, keyLength);
+    }
+
+    uint8_t pad[SHA256_BLOCK_LENGTH];
+    uint8_t innerHash[MszSecretHandler::SIGNATURE_LENGTH];
+    for (int i = 0; i < SHA256_BLOCK_LENGTH; i++)
+    {
+        pad[i] = key[i] ^ 0x36;
+    }
+    sha256Init(context);
+    sha256Update(context, pad, sizeof(pad));
+    sha256Update(context, data, length);
+    sha256Finish(context, innerHash);
+
+    for (int i = 0; i < SHA256_BLOCK_LENGTH; i++)
+    {
+        pad[i] = key[i] ^ 0x5c;
+    }
+    sha256Init(context);
+    sha256Update(context, pad, sizeof(pad));
+    sha256Update(context, innerHash, sizeof(innerHash));
+    sha256Finish(context, output);
+    return true;
+}
+
+#endif
@@ -24,6 +24,11 @@ public:
 
   bool validateTokenSignature(String token, long tokenTimestamp, int secretKeyIndex, String signature, int tokenExpirationSeconds);
 
+  // HMAC-SHA256 of data with the secret as key, for binary protocols. Does not log, it runs per datagram.
+  static const int SIGNATURE_LENGTH = 32;
+  bool computeSignature(int secretKeyIndex, const uint8_t *data, size_t length, uint8_t *output);
+  static bool signaturesEqual(const uint8_t *expected, const uint8_t *actual, size_t length);
+
 private:
   String toHexString(const uint8_t *input, size_t length);
 };
@@ -3,6 +3,24 @@
 
 #include "AssetApiBase.h"
 #include "AssetApiBaseData.h"
+#include "AssetApiServer.h"
+#include "AssetRequestArena.h"
+#include "AssetRateLimiter.h"
+#include "AssetWriteBehindStore.h"
+#include "AssetFileSystem.h"
+#include "AssetFlash.h"
+#include "AssetKvStore.h"
+#include "AssetRecordCodec.h"
+#include "AssetMetrics.h"
+#include "AssetLoopProfiler.h"
+#include "AssetScheduler.h"
+#include "AssetBoundedQueue.h"
+#include "AssetCoreTask.h"
+#include "AssetUdpCommandServer.h"
+#include "AssetClockDiscipline.h"
+#include "AssetHttpServer.h"
+#include "AssetAsyncHttpServer.h"
+#include "GzipStreamWriter.h"
 #include "SecretHandler.h"
 
 void setup()
@@ -0,0 +1,158 @@
+#ifndef MSZ_ASSETAPITESTBACKEND_H
+#define MSZ_ASSETAPITESTBACKEND_H
+
+#include <Arduino.h>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+#include "AssetApiBase.h"
+#include "AssetApiServer.h"
+
+/// @brief Backend for the native tests, the test hands requests in directly and inspects the recorded response.
+/// @details Same policy interface as the real backends, so MszAssetApiServer<TApi, MszTestApiBackend> runs the
+///          dispatching, authorization and response code of the assets unchanged.
+struct MszTestApiBackend
+{
+    typedef std::vector<std::pair<std::string, std::string>> Fields;
+
+    class Server
+    {
+    public:
+        Server(int port)
+        {
+            Server::current = this;
+        }
+
+        // The server of the API created last, MszAssetApiServer keeps its server protected.
+        static inline Server *current = NULL;
+
+        std::function<void()> handler;
+
+        // Request, set by the test before calling request().
+        std::string method;
+        std::string uri;
+        Fields args;
+        Fields headers;
+        uint32_t remoteAddress = 0x0100007F;
+
+        // Response of the last request.
+        int statusCode = 0;
+        std::string contentType;
+        Fields responseHeaders;
+        std::string body;
+        bool chunked = false;
+
+        void request(const char *method, const char *uri, const Fields &args = Fields(), const Fields &headers = Fields())
+        {
+            this->method = method;
+            this->uri = uri;
+            this->args = args;
+            this->headers = headers;
+            this->statusCode = 0;
+            this->contentType.clear();
+            this->responseHeaders.clear();
+            this->body.clear();
+            this->chunked = false;
+            this->handler();
+        }
+
+        std::string getResponseHeader(const char *name) const
+        {
+            return find(this->responseHeaders, name);
+        }
+
+        static std::string find(const Fields &fields, const char *name)
+        {
+            for (const auto &field : fields)
+            {
+                if (strcasecmp(field.first.c_str(), name) == 0)
+                {
+                    return field.second;
+                }
+            }
+            return std::string();
+        }
+    };
+
+    template <class THandler>
+    static void begin(Server &server, THandler handler, const char **collectedHeaders, size_t collectedHeadersCount)
+    {
+        server.handler = handler;
+    }
+
+    static void handleClient(Server &server)
+    {
+    }
+
+    static String arg(Server &server, const String &name)
+    {
+        return String(Server::find(server.args, name.c_str()));
+    }
+
+    static String header(Server &server, const String &name)
+    {
+        return String(Server::find(server.headers, name.c_str()));
+    }
+
+    static const char *method(Server &server)
+    {
+        return server.method.c_str();
+    }
+
+    static String uri(Server &server)
+    {
+        return String(server.uri);
+    }
+
+    static uint32_t remoteAddress(Server &server)
+    {
+        return server.remoteAddress;
+    }
+
+    static void sendHeader(Server &server, const char *name, const char *value)
+    {
+        server.responseHeaders.push_back(std::make_pair(std::string(name), std::string(value)));
+    }
+
+    static void send(Server &server, const CoreHandlerResponse &response)
+    {
+        server.statusCode = response.statusCode;
+        server.contentType = response.contentType.c_str();
+        server.body.assign(response.returnContent.c_str(), response.returnContent.length());
+    }
+
+    static void beginChunked(Server &server, int statusCode, const char *contentType)
+    {
+        server.statusCode = statusCode;
+        server.contentType = contentType;
+        server.chunked = true;
+    }
+
+    static void sendChunk(Server &server, const char *data, size_t length)
+    {
+        server.body.append(data, length);
+    }
+
+    static void endChunked(Server &server)
+    {
+    }
+};
+
+/// @class MszTestAssetApi
+/// @brief Asset API with only the routes all assets share, the API class the tests combine with a backend.
+class MszTestAssetApi : public MszAssetApiBase
+{
+public:
+    MszTestAssetApi(short secretId, int serverPort) : MszAssetApiBase(secretId, serverPort) {}
+
+    MszRequestArena &getRequestArena() { return this->requestArena; }
+    MszRateLimiter &getRateLimiter() { return this->rateLimiter; }
+
+protected:
+    virtual void beginCfg() override {}
+};
+
+typedef MszAssetApiServer<MszTestAssetApi, MszTestApiBackend> MszTestAssetApiServer;
+
+#endif // MSZ_ASSETAPITESTBACKEND_H
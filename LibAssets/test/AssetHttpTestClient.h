@@ -0,0 +1,200 @@
+#ifndef MSZ_ASSETHTTPTESTCLIENT_H
+#define MSZ_ASSETHTTPTESTCLIENT_H
+
+#include <functional>
+#include <string>
+#include <chrono>
+#include <errno.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+/// @brief One response read by MszHttpTestClient.
+struct MszHttpTestResponse
+{
+    int statusCode = 0;
+    std::string head;
+    std::string body;
+    bool close = false;
+};
+
+/// @brief HTTP client on a loopback socket for the native tests and benchmarks of MszAsyncHttpServer.
+/// @details With a pump the test runs the server on its own thread of control: while waiting for data the client
+///          calls the pump, which polls the server. Without one the server runs on another thread and the client
+///          just waits. Responses are read with Content-Length, chunked responses by readUntilClosed().
+class MszHttpTestClient
+{
+public:
+    MszHttpTestClient(uint16_t port, std::function<void()> pump = nullptr) : port(port), pump(pump) {}
+    ~MszHttpTestClient() { this->close(); }
+
+    // A receive buffer of a few KB makes a client that does not read stall the server after a few responses.
+    bool connect(int receiveBufferSize = 0)
+    {
+        this->close();
+        this->fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (this->fd < 0)
+        {
+            return false;
+        }
+        int enable = 1;
+        setsockopt(this->fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+        if (receiveBufferSize > 0)
+        {
+            setsockopt(this->fd, SOL_SOCKET, SO_RCVBUF, &receiveBufferSize, sizeof(receiveBufferSize));
+        }
+        struct sockaddr_in address;
+        memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = htons(this->port);
+        if (::connect(this->fd, (struct sockaddr *)&address, sizeof(address)) != 0)
+        {
+            this->close();
+            return false;
+        }
+        this->buffer.clear();
+        return true;
+    }
+
+    void close()
+    {
+        if (this->fd >= 0)
+        {
+            ::close(this->fd);
+            this->fd = -1;
+        }
+    }
+
+    // Half-closes the connection, the client still reads what the server sends.
+    void shutdownWrite()
+    {
+        shutdown(this->fd, SHUT_WR);
+    }
+
+    bool isConnected() const { return this->fd >= 0; }
+
+    static std::string request(const char *path, bool keepAlive = true)
+    {
+        return std::string("GET ") + path + " HTTP/1.1\r\nHost: 127.0.0.1\r\nConnection: " + (keepAlive ? "keep-alive" : "close") + "\r\n\r\n";
+    }
+
+    bool sendRaw(const std::string &data)
+    {
+        return this->fd >= 0 && ::send(this->fd, data.data(), data.length(), MSG_NOSIGNAL) == (ssize_t)data.length();
+    }
+
+    // Reads one response, false if none arrived within timeoutMillis or the connection ended before.
+    bool readResponse(MszHttpTestResponse &response, int timeoutMillis)
+    {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMillis);
+        size_t headEnd;
+        while ((headEnd = this->buffer.find("\r\n\r\n")) == std::string::npos)
+        {
+            if (this->receive(deadline) <= 0)
+            {
+                return false;
+            }
+        }
+        response.head = this->buffer.substr(0, headEnd + 4);
+        response.statusCode = atoi(response.head.c_str() + 9);
+        response.close = (strcasestr(response.head.c_str(), "\r\nConnection: close\r\n") != NULL);
+        const char *contentLength = strcasestr(response.head.c_str(), "\r\nContent-Length: ");
+        size_t bodyLength = (contentLength != NULL) ? strtoul(contentLength + 18, NULL, 10) : 0;
+        while (this->buffer.length() < headEnd + 4 + bodyLength)
+        {
+            if (this->receive(deadline) <= 0)
+            {
+                return false;
+            }
+        }
+        response.body = this->buffer.substr(headEnd + 4, bodyLength);
+        this->buffer.erase(0, headEnd + 4 + bodyLength);
+        return true;
+    }
+
+    // Waits for the server to end the connection, returns the bytes that arrived before or -1 on timeout.
+    long readUntilClosed(int timeoutMillis)
+    {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMillis);
+        long received = (long)this->buffer.length();
+        this->buffer.clear();
+        while (true)
+        {
+            long length = this->receive(deadline);
+            if (length == 0)
+            {
+                return received;
+            }
+            if (length < 0)
+            {
+                return -1;
+            }
+            received += length;
+            this->buffer.clear();
+        }
+    }
+
+    // Waits up to timeoutMillis and returns whether data or the end of the connection arrived meanwhile.
+    bool hasData(int timeoutMillis)
+    {
+        if (!this->buffer.empty())
+        {
+            return true;
+        }
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMillis);
+        while (std::chrono::steady_clock::now() < deadline)
+        {
+            if (this->pump)
+            {
+                this->pump();
+            }
+            struct pollfd readable = {this->fd, POLLIN, 0};
+            if (::poll(&readable, 1, this->pump ? 0 : 1) > 0)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    uint16_t port;
+    std::function<void()> pump;
+    int fd = -1;
+    std::string buffer;
+
+    // Appends what arrives to the buffer, returns its length, 0 at the end of the connection and -1 on timeout.
+    long receive(std::chrono::steady_clock::time_point deadline)
+    {
+        char data[4096];
+        while (std::chrono::steady_clock::now() < deadline)
+        {
+            if (this->pump)
+            {
+                this->pump();
+            }
+            struct pollfd readable = {this->fd, POLLIN, 0};
+            if (::poll(&readable, 1, this->pump ? 0 : 1) <= 0)
+            {
+                continue;
+            }
+            ssize_t length = recv(this->fd, data, sizeof(data), 0);
+            if (length <= 0)
+            {
+                return (length == 0 || errno == ECONNRESET) ? 0 : -1;
+            }
+            this->buffer.append(data, length);
+            return length;
+        }
+        return -1;
+    }
+};
+
+#endif // MSZ_ASSETHTTPTESTCLIENT_H
@@ -0,0 +1,128 @@
+#include <Arduino.h>
+#include <unity.h>
+#include "../AssetApiTestBackend.h"
+
+typedef MszTestApiBackend::Fields Fields;
+
+static MszSecretHandler secretHandler;
+static MszTestAssetApiServer api(0, 80);
+static MszTestApiBackend::Server &server = *MszTestApiBackend::Server::current;
+
+void setUp()
+{
+    // Admission control is covered by its own tests, here it would only turn the repeated requests away.
+    api.getRateLimiter().configure(0, 0, 0, 0);
+}
+
+void tearDown()
+{
+}
+
+static std::string getInfoETag(const Fields &headers = Fields())
+{
+    server.request("GET", "/info", Fields(), headers);
+    TEST_ASSERT_EQUAL_INT(HTTP_OK_CODE, server.statusCode);
+    std::string etag = server.getResponseHeader(MszAssetApiBase::HEADER_ETAG);
+    TEST_ASSERT_TRUE(etag.length() > 2);
+    return etag;
+}
+
+static void test_get_with_matching_etag_returns_304()
+{
+    std::string etag = getInfoETag();
+
+    server.request("GET", "/info", Fields(), {{"If-None-Match", etag}});
+    TEST_ASSERT_EQUAL_INT(HTTP_NOT_MODIFIED_CODE, server.statusCode);
+    TEST_ASSERT_EQUAL_STRING(etag.c_str(), server.getResponseHeader(MszAssetApiBase::HEADER_ETAG).c_str());
+    TEST_ASSERT_TRUE(server.body.empty());
+
+    // A list of ETags and the wildcard match as well.
+    server.request("GET", "/info", Fields(), {{"If-None-Match", "\"other\", " + etag}});
+    TEST_ASSERT_EQUAL_INT(HTTP_NOT_MODIFIED_CODE, server.statusCode);
+    server.request("GET", "/info", Fields(), {{"If-None-Match", "*"}});
+    TEST_ASSERT_EQUAL_INT(HTTP_NOT_MODIFIED_CODE, server.statusCode);
+}
+
+static void test_get_with_other_etag_returns_200()
+{
+    std::string etag = getInfoETag();
+
+    server.request("GET", "/info", Fields(), {{"If-None-Match", "\"00000000-0-0-ai\""}});
+    TEST_ASSERT_EQUAL_INT(HTTP_OK_CODE, server.statusCode);
+    TEST_ASSERT_EQUAL_STRING(etag.c_str(), server.getResponseHeader(MszAssetApiBase::HEADER_ETAG).c_str());
+}
+
+static void test_save_bumps_generation()
+{
+    std::string etag = getInfoETag();
+
+    server.request("PUT", "/updateinfo", {{"name", "pool-depth"}, {"location", "pump house"}});
+    TEST_ASSERT_EQUAL_INT(HTTP_OK_CODE, server.statusCode);
+
+    // The ETag of the former generation no longer matches, the new one does.
+    server.request("GET", "/info", Fields(), {{"If-None-Match", etag}});
+    TEST_ASSERT_EQUAL_INT(HTTP_OK_CODE, server.statusCode);
+    std::string newETag = server.getResponseHeader(MszAssetApiBase::HEADER_ETAG);
+    TEST_ASSERT_TRUE(newETag.length() > 2);
+    TEST_ASSERT_TRUE(newETag != etag);
+
+    server.request("GET", "/info", Fields(), {{"If-None-Match", newETag}});
+    TEST_ASSERT_EQUAL_INT(HTTP_NOT_MODIFIED_CODE, server.statusCode);
+}
+
+static void test_failed_save_keeps_generation()
+{
+    std::string etag = getInfoETag();
+
+    server.request("PUT", "/updateinfo", {{"name", "pool-depth"}});
+    TEST_ASSERT_EQUAL_INT(HTTP_BAD_REQUEST_CODE, server.statusCode);
+
+    server.request("GET", "/info", Fields(), {{"If-None-Match", etag}});
+    TEST_ASSERT_EQUAL_INT(HTTP_NOT_MODIFIED_CODE, server.statusCode);
+}
+
+static void test_etag_differs_by_format_and_encoding()
+{
+    std::string compact = getInfoETag();
+    std::string pretty = getInfoETag({{"Accept", "text/plain"}});
+    std::string msgpack = getInfoETag({{"Accept", "application/msgpack"}});
+    std::string gzip = getInfoETag({{"Accept-Encoding", "gzip, deflate"}});
+    std::string prettyGzip = getInfoETag({{"Accept", "text/html"}, {"Accept-Encoding", "gzip"}});
+
+    const std::string variants[] = {compact, pretty, msgpack, gzip, prettyGzip};
+    for (size_t i = 0; i < 5; i++)
+    {
+        for (size_t j = i + 1; j < 5; j++)
+        {
+            TEST_ASSERT_TRUE(variants[i] != variants[j]);
+        }
+    }
+
+    // The ETag of one representation does not validate another one.
+    server.request("GET", "/info", Fields(), {{"If-None-Match", compact}, {"Accept-Encoding", "gzip"}});
+    TEST_ASSERT_EQUAL_INT(HTTP_OK_CODE, server.statusCode);
+    TEST_ASSERT_EQUAL_STRING("gzip", server.getResponseHeader(MszAssetApiBase::HEADER_CONTENT_ENCODING).c_str());
+    server.request("GET", "/info", Fields(), {{"If-None-Match", gzip}, {"Accept-Encoding", "gzip"}});
+    TEST_ASSERT_EQUAL_INT(HTTP_NOT_MODIFIED_CODE, server.statusCode);
+}
+
+static void test_unversioned_routes_have_no_etag()
+{
+    server.request("GET", "/metrics", Fields(), {{"If-None-Match", "*"}});
+    TEST_ASSERT_EQUAL_INT(HTTP_OK_CODE, server.statusCode);
+    TEST_ASSERT_TRUE(server.getResponseHeader(MszAssetApiBase::HEADER_ETAG).empty());
+}
+
+int main(int argc, char **argv)
+{
+    api.begin(&secretHandler);
+
+    UNITY_BEGIN();
+    RUN_TEST(test_get_with_matching_etag_returns_304);
+    RUN_TEST(test_get_with_other_etag_returns_200);
+    RUN_TEST(test_save_bumps_generation);
+    RUN_TEST(test_failed_save_keeps_generation);
+    RUN_TEST(test_etag_differs_by_format_and_encoding);
+    RUN_TEST(test_unversioned_routes_have_no_etag);
+    return UNITY_END();
+}
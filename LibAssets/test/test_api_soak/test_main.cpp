@@ -0,0 +1,186 @@
+#include <Arduino.h>
+#include <unity.h>
+#include "../AssetApiTestBackend.h"
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+// Soak test of the request path: a mix of routes runs through dispatchRequest() many times over, the request arena
+// has to hold every request and the heap has to look the same at the end as after the warm-up.
+
+#ifndef SOAK_REQUESTS
+#define SOAK_REQUESTS 1000000
+#endif
+
+static const uint32_t WARMUP_REQUESTS = 10000;
+static const uint32_t REPORT_INTERVAL = SOAK_REQUESTS / 5;
+
+// Heap the soak may grow by after the warm-up, and free chunks it may add, well below any steady leak or churn.
+static const size_t HEAP_GROWTH_LIMIT = 4096;
+static const size_t FREE_CHUNK_GROWTH_LIMIT = 16;
+
+typedef MszTestApiBackend::Fields Fields;
+
+static MszSecretHandler secretHandler;
+static MszTestAssetApiServer api(0, 80);
+static MszTestApiBackend::Server &server = *MszTestApiBackend::Server::current;
+
+struct HeapSample
+{
+    size_t inUse;
+    size_t freeChunks;
+};
+
+static HeapSample sampleHeap()
+{
+#if defined(__GLIBC__)
+    struct mallinfo2 info = mallinfo2();
+    return HeapSample{info.uordblks, info.ordblks};
+#else
+    return HeapSample{0, 0};
+#endif
+}
+
+void setUp()
+{
+    api.getRateLimiter().configure(0, 0, 0, 0);
+}
+
+void tearDown()
+{
+}
+
+// One request of the mix, chosen by the request number so every run sends the same sequence.
+static void sendRequest(uint32_t number, const std::string &etag)
+{
+    switch (number % 16)
+    {
+    case 0:
+    case 1:
+    case 2:
+        server.request("GET", "/info");
+        break;
+    case 3:
+        server.request("GET", "/info", Fields(), {{"Accept", "text/html"}, {"Accept-Encoding", "gzip"}});
+        break;
+    case 4:
+        server.request("GET", "/info", Fields(), {{"Accept", "application/msgpack"}});
+        break;
+    case 5:
+    case 6:
+        server.request("GET", "/info", Fields(), {{"If-None-Match", etag}});
+        break;
+    case 7:
+    case 8:
+        server.request("GET", "/metrics");
+        break;
+    case 9:
+        server.request("GET", "/metrics", Fields(), {{"Accept-Encoding", "gzip"}});
+        break;
+    case 10:
+        server.request("PUT", "/updateinfo", {{"name", "pool-depth"}});
+        break;
+    case 11:
+        server.request("PUT", "/settime", {{"hour", "25"}});
+        break;
+    case 12:
+        server.request("GET", "/does-not-exist");
+        break;
+    case 13:
+        server.request("DELETE", "/info");
+        break;
+    case 14:
+        server.request("GET", "/info", Fields(), {{"Authorization", "1760000000|token|c2lnbmF0dXJl"}});
+        break;
+    default:
+        // Saving touches the file system, keep it to one request in a thousand like a real configuration change.
+        if (number % 1024 == 15)
+        {
+            server.request("PUT", "/updateinfo", {{"name", "pool-depth"}, {"location", number % 2048 == 15 ? "pump house" : "garden"}});
+        }
+        else
+        {
+            server.request("GET", "/info", Fields(), {{"Accept-Encoding", "gzip, deflate"}});
+        }
+        break;
+    }
+}
+
+static void test_soak_request_arena_and_heap()
+{
+    MszRequestArena &arena = api.getRequestArena();
+
+    // Written before the warm-up, so the output buffer the first message allocates is part of the baseline.
+    char message[160];
+    snprintf(message, sizeof(message), "%u requests, %u byte request arena", (unsigned int)SOAK_REQUESTS,
+             (unsigned int)REQUEST_ARENA_SIZE);
+    TEST_MESSAGE(message);
+
+    server.request("GET", "/info");
+    std::string etag = server.getResponseHeader(MszAssetApiBase::HEADER_ETAG);
+
+    HeapSample warm = {0, 0};
+    HeapSample peak = {0, 0};
+    for (uint32_t number = 0; number < SOAK_REQUESTS; number++)
+    {
+        sendRequest(number, etag);
+        TEST_ASSERT_TRUE(server.statusCode != 0);
+        if (server.statusCode == HTTP_OK_CODE && number % 1024 == 15)
+        {
+            // A save bumps the generation, the next conditional requests use the new ETag.
+            server.request("GET", "/info");
+            etag = server.getResponseHeader(MszAssetApiBase::HEADER_ETAG);
+        }
+
+        HeapSample heap = sampleHeap();
+        if (number == WARMUP_REQUESTS)
+        {
+            warm = heap;
+            peak = heap;
+        }
+        else if (number > WARMUP_REQUESTS)
+        {
+            peak.inUse = heap.inUse > peak.inUse ? heap.inUse : peak.inUse;
+            peak.freeChunks = heap.freeChunks > peak.freeChunks ? heap.freeChunks : peak.freeChunks;
+        }
+
+        if ((number + 1) % REPORT_INTERVAL == 0)
+        {
+            snprintf(message, sizeof(message), "%7u requests: arena high water %5u of %u bytes, overflows %u, heap in use %u, free chunks %u",
+                     (unsigned int)(number + 1), (unsigned int)arena.getHighWater(), (unsigned int)REQUEST_ARENA_SIZE,
+                     (unsigned int)arena.getOverflowCount(), (unsigned int)heap.inUse, (unsigned int)heap.freeChunks);
+            TEST_MESSAGE(message);
+        }
+    }
+
+    // The default arena size holds every request of the mix, nothing spilled to the heap.
+    TEST_ASSERT_EQUAL_UINT32(0, arena.getOverflowCount());
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(REQUEST_ARENA_SIZE, arena.getHighWater());
+    TEST_ASSERT_EQUAL_UINT32(0, arena.getUsed());
+
+    // The exported metrics agree with the arena.
+    server.request("GET", "/metrics");
+    snprintf(message, sizeof(message), "asset_request_arena_high_water_bytes %u\n", (unsigned int)arena.getHighWater());
+    TEST_ASSERT_TRUE(server.body.find(message) != std::string::npos);
+    TEST_ASSERT_TRUE(server.body.find("asset_request_arena_overflows_total 0\n") != std::string::npos);
+
+    // Neither the heap in use nor the number of free chunks keeps growing once the first requests warmed it up.
+#if defined(__GLIBC__)
+    snprintf(message, sizeof(message), "after warm-up: heap in use %u, free chunks %u; peak after: %u, %u",
+             (unsigned int)warm.inUse, (unsigned int)warm.freeChunks, (unsigned int)peak.inUse, (unsigned int)peak.freeChunks);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(warm.inUse + HEAP_GROWTH_LIMIT, peak.inUse);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(warm.freeChunks + FREE_CHUNK_GROWTH_LIMIT, peak.freeChunks);
+#else
+    TEST_MESSAGE("Heap statistics need glibc, only the arena was checked");
+#endif
+}
+
+int main(int argc, char **argv)
+{
+    api.begin(&secretHandler);
+
+    UNITY_BEGIN();
+    RUN_TEST(test_soak_request_arena_and_heap);
+    return UNITY_END();
+}
@@ -0,0 +1,257 @@
+#include <Arduino.h>
+#include <unity.h>
+#include <chrono>
+#include <string>
+#include "AssetAsyncHttpServer.h"
+#include "../AssetHttpTestClient.h"
+
+// MszAsyncHttpServer on a loopback listener: pipelined requests behind a deferred one, deferred requests timing out,
+// clients not reading their responses and clients half-closing their connection. The test polls the server while it
+// waits for data, so server and clients share one thread. The two timeouts make this suite take about 15 seconds.
+
+static const uint16_t TEST_PORT = 47220;
+static const int RESPONSE_TIMEOUT_MILLIS = 1000;
+static const int STREAM_CHUNKS = 64;
+static const size_t STREAM_CHUNK_LENGTH = 1024;
+static const size_t BIG_RESPONSE_LENGTH = 8000;
+
+/// @brief Exposes the output buffered for the clients to the tests.
+class TestAsyncHttpServer : public MszAsyncHttpServer
+{
+public:
+    TestAsyncHttpServer() : MszAsyncHttpServer(TEST_PORT) {}
+
+    size_t getLargestPendingOutput()
+    {
+        size_t largest = 0;
+        for (int i = 0; i < MAX_ASYNC_HTTP_CONNECTIONS; i++)
+        {
+            if (this->connections[i].fd >= 0 && this->connections[i].output.size() - this->connections[i].outputSent > largest)
+            {
+                largest = this->connections[i].output.size() - this->connections[i].outputSent;
+            }
+        }
+        return largest;
+    }
+
+    // Linux grows the send buffers of loopback connections to megabytes, lwIP gives a socket a few KB.
+    void limitSendBuffers(int length)
+    {
+        for (int i = 0; i < MAX_ASYNC_HTTP_CONNECTIONS; i++)
+        {
+            if (this->connections[i].fd >= 0)
+            {
+                setsockopt(this->connections[i].fd, SOL_SOCKET, SO_SNDBUF, &length, sizeof(length));
+            }
+        }
+    }
+};
+
+static TestAsyncHttpServer *server;
+static MszAsyncResponseHandle deferredHandle;
+static int deferredCount = 0;
+
+static void pump()
+{
+    server->poll(1);
+}
+
+// /slow defers, /big answers with BIG_RESPONSE_LENGTH bytes, /stream streams more than the output limit, every other
+// path is echoed.
+static void handleRequest()
+{
+    std::string uri = server->uri();
+    if (uri == "/slow")
+    {
+        deferredHandle = server->defer();
+        deferredCount++;
+        return;
+    }
+    if (uri == "/big")
+    {
+        std::string body(BIG_RESPONSE_LENGTH, 'b');
+        server->send(200, "text/plain", body.c_str(), body.length());
+        return;
+    }
+    if (uri == "/stream")
+    {
+        std::string chunk(STREAM_CHUNK_LENGTH, 's');
+        server->beginChunked(200, "text/plain");
+        for (int i = 0; i < STREAM_CHUNKS; i++)
+        {
+            server->sendChunk(chunk.c_str(), chunk.length());
+        }
+        server->endChunked();
+        return;
+    }
+    server->send(200, "text/plain", uri.c_str(), uri.length());
+}
+
+// Polls until the server closed every connection, false if that takes longer than timeoutMillis.
+static bool waitForNoConnections(int timeoutMillis)
+{
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMillis);
+    while (server->getOpenConnections() > 0 && std::chrono::steady_clock::now() < deadline)
+    {
+        pump();
+    }
+    return server->getOpenConnections() == 0;
+}
+
+void setUp()
+{
+    deferredHandle = {-1, 0};
+    deferredCount = 0;
+}
+
+void tearDown()
+{
+    // Every test leaves the server without connections for the next one.
+    waitForNoConnections(MszAsyncHttpServer::IDLE_TIMEOUT_MS + 1000);
+}
+
+static void test_pipelined_requests_wait_for_a_deferred_one()
+{
+    MszHttpTestClient client(TEST_PORT, pump);
+    TEST_ASSERT_TRUE(client.connect());
+    TEST_ASSERT_TRUE(client.sendRaw(MszHttpTestClient::request("/slow") + MszHttpTestClient::request("/a") +
+                                    MszHttpTestClient::request("/b", false)));
+
+    // Nothing is answered, not even the requests behind the deferred one.
+    TEST_ASSERT_FALSE(client.hasData(100));
+    TEST_ASSERT_EQUAL_INT(1, deferredCount);
+    TEST_ASSERT_TRUE(deferredHandle.slot >= 0);
+
+    TEST_ASSERT_TRUE(server->completeDeferred(deferredHandle, 200, "text/plain", "deferred", 8));
+    TEST_ASSERT_FALSE(server->completeDeferred(deferredHandle, 200, "text/plain", "twice", 5));
+    MszHttpTestResponse response;
+    TEST_ASSERT_TRUE(client.readResponse(response, RESPONSE_TIMEOUT_MILLIS));
+    TEST_ASSERT_EQUAL_STRING("deferred", response.body.c_str());
+    TEST_ASSERT_TRUE(client.readResponse(response, RESPONSE_TIMEOUT_MILLIS));
+    TEST_ASSERT_EQUAL_STRING("/a", response.body.c_str());
+    TEST_ASSERT_FALSE(response.close);
+    TEST_ASSERT_TRUE(client.readResponse(response, RESPONSE_TIMEOUT_MILLIS));
+    TEST_ASSERT_EQUAL_STRING("/b", response.body.c_str());
+    TEST_ASSERT_TRUE(response.close);
+    TEST_ASSERT_EQUAL_INT(0, client.readUntilClosed(RESPONSE_TIMEOUT_MILLIS));
+}
+
+static void test_deferred_request_times_out_into_503()
+{
+    MszHttpTestClient client(TEST_PORT, pump);
+    TEST_ASSERT_TRUE(client.connect());
+    auto start = std::chrono::steady_clock::now();
+    TEST_ASSERT_TRUE(client.sendRaw(MszHttpTestClient::request("/slow") + MszHttpTestClient::request("/after")));
+
+    MszHttpTestResponse response;
+    TEST_ASSERT_TRUE(client.readResponse(response, MszAsyncHttpServer::DEFERRED_TIMEOUT_MS + RESPONSE_TIMEOUT_MILLIS));
+    long elapsedMillis = (long)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+    TEST_ASSERT_EQUAL_INT(HTTP_SERVICE_UNAVAILABLE_CODE, response.statusCode);
+    TEST_ASSERT_EQUAL_STRING("Deferred response timed out", response.body.c_str());
+    TEST_ASSERT_TRUE(elapsedMillis >= (long)MszAsyncHttpServer::DEFERRED_TIMEOUT_MS);
+
+    // The handler learns that its response is no longer wanted, the connection serves the next request.
+    TEST_ASSERT_FALSE(server->completeDeferred(deferredHandle, 200, "text/plain", "late", 4));
+    TEST_ASSERT_TRUE(client.readResponse(response, RESPONSE_TIMEOUT_MILLIS));
+    TEST_ASSERT_EQUAL_INT(200, response.statusCode);
+    TEST_ASSERT_EQUAL_STRING("/after", response.body.c_str());
+}
+
+static void test_stream_to_a_client_not_reading_closes_at_the_output_limit()
+{
+    // The whole stream is produced in one handler call, more than the limit before anything could be flushed. Other
+    // clients are served while it is dropped.
+    MszHttpTestClient other(TEST_PORT, pump);
+    TEST_ASSERT_TRUE(other.connect());
+    MszHttpTestClient client(TEST_PORT, pump);
+    TEST_ASSERT_TRUE(client.connect(4096));
+    TEST_ASSERT_TRUE(client.sendRaw(MszHttpTestClient::request("/stream")));
+
+    TEST_ASSERT_TRUE(STREAM_CHUNKS * STREAM_CHUNK_LENGTH > ASYNC_HTTP_MAX_OUTPUT_LENGTH);
+    long received = client.readUntilClosed(RESPONSE_TIMEOUT_MILLIS);
+    TEST_ASSERT_TRUE(received >= 0);
+    TEST_ASSERT_TRUE(received < (long)ASYNC_HTTP_MAX_OUTPUT_LENGTH);
+    TEST_ASSERT_TRUE(server->getLargestPendingOutput() <= ASYNC_HTTP_MAX_OUTPUT_LENGTH);
+
+    MszHttpTestResponse response;
+    TEST_ASSERT_TRUE(other.sendRaw(MszHttpTestClient::request("/a", false)));
+    TEST_ASSERT_TRUE(other.readResponse(response, RESPONSE_TIMEOUT_MILLIS));
+    TEST_ASSERT_EQUAL_STRING("/a", response.body.c_str());
+}
+
+static void test_slow_reader_only_stalls_its_own_connection()
+{
+    // Pipelines far more than the socket buffers hold and never reads.
+    MszHttpTestClient slowReader(TEST_PORT, pump);
+    TEST_ASSERT_TRUE(slowReader.connect(4096));
+    while (server->getOpenConnections() == 0)
+    {
+        pump();
+    }
+    server->limitSendBuffers(4096);
+    std::string requests;
+    for (int i = 0; i < 200; i++)
+    {
+        requests += MszHttpTestClient::request("/big");
+    }
+    // The server reads requests only as far as HTTP_MAX_REQUEST_LENGTH, the rest stays in the socket buffers.
+    TEST_ASSERT_TRUE(slowReader.sendRaw(requests));
+
+    MszHttpTestClient other(TEST_PORT, pump);
+    TEST_ASSERT_TRUE(other.connect());
+    MszHttpTestResponse response;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 20; i++)
+    {
+        TEST_ASSERT_TRUE(other.sendRaw(MszHttpTestClient::request("/a")));
+        TEST_ASSERT_TRUE(other.readResponse(response, RESPONSE_TIMEOUT_MILLIS));
+        TEST_ASSERT_EQUAL_STRING("/a", response.body.c_str());
+        // The server stops serving the slow reader once its output reaches the high water mark.
+        TEST_ASSERT_TRUE(server->getLargestPendingOutput() <= MszAsyncHttpServer::OUTPUT_HIGH_WATER_LENGTH + BIG_RESPONSE_LENGTH + 256);
+    }
+    other.close();
+
+    // A client that stopped reading is closed like an idle one.
+    TEST_ASSERT_TRUE(waitForNoConnections(MszAsyncHttpServer::IDLE_TIMEOUT_MS + RESPONSE_TIMEOUT_MILLIS));
+    long elapsedMillis = (long)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+    TEST_ASSERT_TRUE(elapsedMillis >= (long)MszAsyncHttpServer::IDLE_TIMEOUT_MS - 100);
+}
+
+static void test_half_close_with_a_partial_request()
+{
+    // Only part of a request, then the client is done sending: the connection ends without a response.
+    MszHttpTestClient client(TEST_PORT, pump);
+    TEST_ASSERT_TRUE(client.connect());
+    TEST_ASSERT_TRUE(client.sendRaw("GET /partial HTTP/1.1\r\nHost: 127.0.0.1\r\n"));
+    TEST_ASSERT_FALSE(client.hasData(50));
+    client.shutdownWrite();
+    TEST_ASSERT_EQUAL_INT(0, client.readUntilClosed(RESPONSE_TIMEOUT_MILLIS));
+
+    // A complete request ahead of the partial one is still answered before the connection ends.
+    TEST_ASSERT_TRUE(client.connect());
+    TEST_ASSERT_TRUE(client.sendRaw(MszHttpTestClient::request("/complete") + "GET /partial HTTP/1.1\r\nHo"));
+    client.shutdownWrite();
+    MszHttpTestResponse response;
+    TEST_ASSERT_TRUE(client.readResponse(response, RESPONSE_TIMEOUT_MILLIS));
+    TEST_ASSERT_EQUAL_STRING("/complete", response.body.c_str());
+    TEST_ASSERT_EQUAL_INT(0, client.readUntilClosed(RESPONSE_TIMEOUT_MILLIS));
+    TEST_ASSERT_TRUE(waitForNoConnections(RESPONSE_TIMEOUT_MILLIS));
+}
+
+int main(int argc, char **argv)
+{
+    server = new TestAsyncHttpServer();
+    server->onRequest(handleRequest);
+    if (!server->begin())
+    {
+        return 1;
+    }
+
+    UNITY_BEGIN();
+    RUN_TEST(test_pipelined_requests_wait_for_a_deferred_one);
+    RUN_TEST(test_deferred_request_times_out_into_503);
+    RUN_TEST(test_stream_to_a_client_not_reading_closes_at_the_output_limit);
+    RUN_TEST(test_slow_reader_only_stalls_its_own_connection);
+    RUN_TEST(test_half_close_with_a_partial_request);
+    return UNITY_END();
+}
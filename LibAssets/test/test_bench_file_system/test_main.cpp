@@ -0,0 +1,153 @@
+#include <Arduino.h>
+#include <unity.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+#include "AssetFileSystem.h"
+#include "AssetFlash.h"
+
+// Latency of opening, reading and writing files with the backends that run on the host, and of the flash backends
+// MszKvStore runs on. The LittleFS and SPIFFS backends need the cores, they are measured on the devices.
+
+static const int FILE_COUNTS[] = {10, 50, 200};
+static const int OPERATIONS = 5000;
+static const size_t FILE_LENGTH = 128;
+static const size_t PAGE_SIZE = 4096;
+static const size_t PAGE_COUNT = 16;
+
+static const char *BENCH_ROOT = ".pio/bench-file-system";
+
+static uint8_t data[FILE_LENGTH];
+static uint8_t readBack[FILE_LENGTH];
+static std::vector<double> samples;
+
+struct Latency
+{
+    double p50;
+    double p99;
+};
+
+static const char *filePath(int file)
+{
+    static char path[16];
+    snprintf(path, sizeof(path), "/file%d", file);
+    return path;
+}
+
+// Times each call of operation and returns the median and the 99th percentile in microseconds.
+template <typename TOperation>
+static Latency measure(TOperation operation)
+{
+    samples.clear();
+    for (int i = 0; i < OPERATIONS; i++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        operation(i);
+        samples.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+    }
+    std::sort(samples.begin(), samples.end());
+    return {samples[OPERATIONS / 2], samples[OPERATIONS * 99 / 100]};
+}
+
+static void report(const char *name, const char *operation, int fileCount, Latency latency)
+{
+    char message[128];
+    snprintf(message, sizeof(message), "%-14s %-10s %4d files  p50 %8.2f us  p99 %8.2f us", name, operation, fileCount,
+             latency.p50, latency.p99);
+    TEST_MESSAGE(message);
+}
+
+static void reportFlash(const char *name, const char *operation, size_t length, Latency latency)
+{
+    char message[128];
+    snprintf(message, sizeof(message), "%-14s %-10s %4u bytes  p50 %8.2f us  p99 %8.2f us", name, operation,
+             (unsigned int)length, latency.p50, latency.p99);
+    TEST_MESSAGE(message);
+}
+
+void setUp()
+{
+    for (size_t i = 0; i < sizeof(data); i++)
+    {
+        data[i] = (uint8_t)(i * 31);
+    }
+}
+
+void tearDown()
+{
+}
+
+static void test_bench_posix_file_system()
+{
+    MszPosixFileSystem fileSystem(BENCH_ROOT);
+    for (int fileCount : FILE_COUNTS)
+    {
+        TEST_ASSERT_TRUE(fileSystem.format());
+        TEST_ASSERT_TRUE(fileSystem.begin());
+        for (int file = 0; file < fileCount; file++)
+        {
+            TEST_ASSERT_TRUE(fileSystem.write(filePath(file), data, sizeof(data)));
+        }
+
+        // Every operation opens and closes the file, the times include both.
+        report(fileSystem.getName(), "exists", fileCount, measure([&](int i) {
+            TEST_ASSERT_TRUE(fileSystem.exists(filePath(i % fileCount)));
+        }));
+        report(fileSystem.getName(), "missing", fileCount, measure([&](int i) {
+            TEST_ASSERT_FALSE(fileSystem.exists("/missing"));
+        }));
+        report(fileSystem.getName(), "read", fileCount, measure([&](int i) {
+            TEST_ASSERT_EQUAL_UINT32(FILE_LENGTH, fileSystem.read(filePath(i % fileCount), 0, readBack, sizeof(readBack)));
+        }));
+        report(fileSystem.getName(), "write", fileCount, measure([&](int i) {
+            TEST_ASSERT_TRUE(fileSystem.write(filePath(i % fileCount), data, sizeof(data)));
+        }));
+        report(fileSystem.getName(), "writeAt", fileCount, measure([&](int i) {
+            TEST_ASSERT_TRUE(fileSystem.writeAt(filePath(i % fileCount), i % FILE_LENGTH, data, 1));
+        }));
+    }
+
+    // format() removes every file, however many the directory holds.
+    TEST_ASSERT_TRUE(fileSystem.format());
+    int remaining = 0;
+    fileSystem.forEachFile([&remaining](const char *path) { remaining++; });
+    TEST_ASSERT_EQUAL_INT(0, remaining);
+}
+
+template <typename TFlash>
+static void benchmarkFlash(const char *name, TFlash &flash)
+{
+    size_t size = PAGE_SIZE * PAGE_COUNT;
+    reportFlash(name, "read", FILE_LENGTH, measure([&](int i) {
+        TEST_ASSERT_TRUE(flash.read((i * FILE_LENGTH) % size, readBack, sizeof(readBack)));
+    }));
+    reportFlash(name, "program", FILE_LENGTH, measure([&](int i) {
+        TEST_ASSERT_TRUE(flash.program((i * FILE_LENGTH) % size, data, sizeof(data)));
+    }));
+    reportFlash(name, "erase", PAGE_SIZE, measure([&](int i) {
+        TEST_ASSERT_TRUE(flash.erasePage(i % PAGE_COUNT));
+    }));
+}
+
+static void test_bench_flash_backends()
+{
+    MszSimulatedFlash simulated(PAGE_SIZE, PAGE_COUNT);
+    benchmarkFlash("simulated", simulated);
+
+    // The flash image reopens its file for every access, like the files above.
+    MszPosixFileSystem fileSystem(BENCH_ROOT);
+    TEST_ASSERT_TRUE(fileSystem.format());
+    TEST_ASSERT_TRUE(fileSystem.begin());
+    MszFileFlash image(fileSystem, "/flash", PAGE_SIZE, PAGE_COUNT);
+    TEST_ASSERT_TRUE(image.begin());
+    benchmarkFlash("flash image", image);
+    TEST_ASSERT_TRUE(fileSystem.format());
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_bench_posix_file_system);
+    RUN_TEST(test_bench_flash_backends);
+    return UNITY_END();
+}
@@ -0,0 +1,218 @@
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <unity.h>
+#include <chrono>
+#include <string>
+
+// Bytes on the wire and serialization time of the response formats the API negotiates from the Accept header.
+
+static const int ITERATIONS = 20000;
+
+// MAX_MEASUREMENTS_TO_KEEP_UNTIL_PURGE of the depth sensor, a full /measurements list.
+static const int MEASUREMENT_COUNT = 100;
+
+/// @brief Discards what is written, counting the bytes as the web server would send them.
+class CountingPrint : public Print
+{
+public:
+    size_t bytes = 0;
+
+    virtual size_t write(uint8_t c) override
+    {
+        this->bytes++;
+        return 1;
+    }
+
+    virtual size_t write(const uint8_t *buffer, size_t size) override
+    {
+        this->bytes += size;
+        return size;
+    }
+};
+
+/// @brief Keeps what is written, to parse a streamed response again.
+class StringPrint : public Print
+{
+public:
+    std::string content;
+
+    virtual size_t write(uint8_t c) override
+    {
+        this->content += (char)c;
+        return 1;
+    }
+};
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+// The document /info answers with.
+static void buildMetadataDocument(JsonDocument &document)
+{
+    document["status"] = "running";
+    document["sensorName"] = "pool-depth";
+    document["sensorLocation"] = "pump house";
+    document["sensorMqttServer"] = "mqtt.home.lan";
+    document["sensorMqttPort"] = 1883;
+    document["sensorMqttUsername"] = "depthsensor";
+}
+
+// Bulk data like /loopstats answers with: numbers in nested objects and arrays.
+static void buildLoopStatsDocument(JsonDocument &document)
+{
+    document["budgetMicros"] = 20000;
+    document["overBudgetCount"] = 17;
+    JsonArray phases = document["phases"].to<JsonArray>();
+    const char *names[] = {"api", "scheduler", "mqtt", "rf", "sensor", "udp", "clock", "storage"};
+    for (int i = 0; i < 8; i++)
+    {
+        JsonObject phase = phases.add<JsonObject>();
+        phase["name"] = names[i];
+        phase["count"] = 123456 + i * 1000;
+        phase["minMicros"] = 3 + i;
+        phase["maxMicros"] = 18000 + i * 97;
+        phase["avgMicros"] = 140 + i * 13;
+        phase["p50Micros"] = 120 + i * 11;
+        phase["p90Micros"] = 400 + i * 31;
+        phase["p99Micros"] = 2500 + i * 53;
+        JsonArray histogram = phase["histogram"].to<JsonArray>();
+        for (int bucket = 0; bucket < 12; bucket++)
+        {
+            JsonArray pair = histogram.add<JsonArray>();
+            pair.add(1UL << (bucket + 4));
+            pair.add(1000UL * (12 - bucket) + i);
+        }
+    }
+}
+
+// Streams the /measurements list the way the depth sensor does: one small document per measurement, framed by
+// hand because the list never exists as a whole document.
+static void streamMeasurements(Print &output, const char *format)
+{
+    bool asMsgPack = strcmp(format, "msgpack") == 0;
+    if (asMsgPack)
+    {
+        const uint8_t header[] = {0x81, 0xAC, 'm', 'e', 'a', 's', 'u', 'r', 'e', 'm', 'e', 'n', 't', 's', 0xDC,
+                                  (uint8_t)(MEASUREMENT_COUNT >> 8), (uint8_t)(MEASUREMENT_COUNT & 0xFF)};
+        output.write(header, sizeof(header));
+    }
+    else
+    {
+        output.print("{\"measurements\":[");
+    }
+
+    JsonDocument measurement;
+    for (int i = 0; i < MEASUREMENT_COUNT; i++)
+    {
+        measurement.clear();
+        measurement["measureTime"] = 1760000000UL + i * 600UL;
+        measurement["centimeters"] = 123.5f - i * 0.25f;
+        measurement["retrievedBefore"] = (i % 3 == 0);
+        if (asMsgPack)
+        {
+            serializeMsgPack(measurement, output);
+        }
+        else
+        {
+            if (i > 0)
+            {
+                output.print(',');
+            }
+            if (strcmp(format, "json-pretty") == 0)
+            {
+                serializeJsonPretty(measurement, output);
+            }
+            else
+            {
+                serializeJson(measurement, output);
+            }
+        }
+    }
+
+    if (!asMsgPack)
+    {
+        output.print("]}");
+    }
+}
+
+template <typename TSerialize>
+static void benchmarkFormat(const char *documentName, const char *formatName, TSerialize serialize, size_t &bytes)
+{
+    CountingPrint output;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < ITERATIONS; i++)
+    {
+        serialize(output);
+    }
+    double nanos = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / ITERATIONS;
+    bytes = output.bytes / ITERATIONS;
+
+    char message[128];
+    snprintf(message, sizeof(message), "%-12s %-13s %5u bytes %8.0f ns %7.1f MB/s", documentName, formatName,
+             (unsigned int)bytes, nanos, bytes * 1000.0 / nanos);
+    TEST_MESSAGE(message);
+}
+
+static void benchmarkDocument(const char *documentName, JsonDocument &document)
+{
+    size_t pretty, compact, msgpack;
+    benchmarkFormat(documentName, "json-pretty", [&document](Print &p) { serializeJsonPretty(document, p); }, pretty);
+    benchmarkFormat(documentName, "json-compact", [&document](Print &p) { serializeJson(document, p); }, compact);
+    benchmarkFormat(documentName, "msgpack", [&document](Print &p) { serializeMsgPack(document, p); }, msgpack);
+
+    TEST_ASSERT_EQUAL_UINT32(measureJsonPretty(document), pretty);
+    TEST_ASSERT_EQUAL_UINT32(measureJson(document), compact);
+    TEST_ASSERT_EQUAL_UINT32(measureMsgPack(document), msgpack);
+    TEST_ASSERT_LESS_THAN_UINT32(pretty, compact);
+    TEST_ASSERT_LESS_THAN_UINT32(compact, msgpack);
+}
+
+static void test_bench_metadata()
+{
+    JsonDocument document;
+    buildMetadataDocument(document);
+    benchmarkDocument("metadata", document);
+}
+
+static void test_bench_loopstats()
+{
+    JsonDocument document;
+    buildLoopStatsDocument(document);
+    benchmarkDocument("loopstats", document);
+}
+
+static void test_bench_measurements()
+{
+    size_t bytes[3];
+    const char *formats[] = {"json-pretty", "json-compact", "msgpack"};
+    for (int format = 0; format < 3; format++)
+    {
+        benchmarkFormat("measurements", formats[format], [&](Print &p) { streamMeasurements(p, formats[format]); }, bytes[format]);
+
+        // The hand-made framing has to give one valid document in every format.
+        StringPrint output;
+        streamMeasurements(output, formats[format]);
+        JsonDocument parsed;
+        DeserializationError error = (format == 2) ? deserializeMsgPack(parsed, output.content)
+                                                   : deserializeJson(parsed, output.content);
+        TEST_ASSERT_TRUE(error == DeserializationError::Ok);
+        TEST_ASSERT_EQUAL_INT(MEASUREMENT_COUNT, parsed["measurements"].as<JsonArray>().size());
+        TEST_ASSERT_EQUAL_UINT32(1760000000UL + 600UL, parsed["measurements"][1]["measureTime"].as<unsigned long>());
+    }
+    TEST_ASSERT_LESS_THAN_UINT32(bytes[0], bytes[1]);
+    TEST_ASSERT_LESS_THAN_UINT32(bytes[1], bytes[2]);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_bench_metadata);
+    RUN_TEST(test_bench_loopstats);
+    RUN_TEST(test_bench_measurements);
+    return UNITY_END();
+}
@@ -0,0 +1,259 @@
+#include <Arduino.h>
+#include <unity.h>
+#include <chrono>
+#include <new>
+#include <string>
+#include <vector>
+#include <zlib.h>
+#include "GzipStreamWriter.h"
+
+// Ratio, throughput and peak RAM of MszGzipStreamWriter next to zlib, the reference for what the stream could gain.
+
+static const size_t TOTAL_BYTES = 8 * 1024 * 1024;
+
+// Heap accounting of the whole test binary, so allocations the writer might make are seen too.
+static size_t heapAllocations = 0;
+
+void *operator new(size_t size)
+{
+    heapAllocations++;
+    void *pointer = malloc(size);
+    if (pointer == NULL)
+    {
+        throw std::bad_alloc();
+    }
+    return pointer;
+}
+
+// The replacements hand out malloc() memory, so free() is the matching release. GCC cannot see that through the
+// replaced operator new and warns about the pair.
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void operator delete(void *pointer) noexcept
+{
+    free(pointer);
+}
+
+void operator delete(void *pointer, size_t /* size */) noexcept
+{
+    free(pointer);
+}
+
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic pop
+#endif
+
+/// @brief Discards what is written, counting the bytes as the web server would send them.
+class CountingPrint : public Print
+{
+public:
+    size_t bytes = 0;
+
+    virtual size_t write(uint8_t /* c */) override
+    {
+        this->bytes++;
+        return 1;
+    }
+
+    virtual size_t write(const uint8_t * /* buffer */, size_t size) override
+    {
+        this->bytes += size;
+        return size;
+    }
+};
+
+// zlib allocations go through these, peak is the most zlib held at once.
+struct ZlibHeap
+{
+    size_t current = 0;
+    size_t peak = 0;
+};
+
+static voidpf zlibAlloc(voidpf opaque, uInt items, uInt size)
+{
+    ZlibHeap *heap = (ZlibHeap *)opaque;
+    size_t *block = (size_t *)malloc(sizeof(size_t) + (size_t)items * size);
+    *block = (size_t)items * size;
+    heap->current += *block;
+    heap->peak = heap->current > heap->peak ? heap->current : heap->peak;
+    return block + 1;
+}
+
+static void zlibFree(voidpf opaque, voidpf address)
+{
+    ZlibHeap *heap = (ZlibHeap *)opaque;
+    size_t *block = (size_t *)address - 1;
+    heap->current -= *block;
+    free(block);
+}
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+static void report(const char *contentName, const char *compressorName, size_t inputLength, size_t outputLength,
+                   double seconds, size_t ram)
+{
+    char message[160];
+    snprintf(message, sizeof(message), "%-8s %-22s ratio %5.3f %7.1f MB/s peak RAM %7u bytes", contentName,
+             compressorName, (double)outputLength / inputLength, TOTAL_BYTES / seconds / 1e6, (unsigned int)ram);
+    TEST_MESSAGE(message);
+}
+
+// Compresses the content over and over until TOTAL_BYTES went through, written in chunks like a chunked response.
+static size_t benchmarkWriter(const char *contentName, const std::string &content)
+{
+    size_t rounds = TOTAL_BYTES / content.size();
+    size_t outputLength = 0;
+    size_t allocationsBefore = heapAllocations;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t round = 0; round < rounds; round++)
+    {
+        CountingPrint output;
+        MszGzipStreamWriter *writer = new MszGzipStreamWriter(output);
+        for (size_t position = 0; position < content.size(); position += 512)
+        {
+            size_t length = content.size() - position < 512 ? content.size() - position : 512;
+            writer->write((const uint8_t *)content.data() + position, length);
+        }
+        writer->finish();
+        outputLength = output.bytes;
+        delete writer;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // The writer itself is the only allocation, its size is all the RAM it needs.
+    TEST_ASSERT_EQUAL_UINT32(rounds, heapAllocations - allocationsBefore);
+    report(contentName, "MszGzipStreamWriter", content.size(), outputLength, seconds * TOTAL_BYTES / (rounds * content.size()),
+           sizeof(MszGzipStreamWriter));
+    return outputLength;
+}
+
+static size_t benchmarkZlib(const char *contentName, const char *compressorName, const std::string &content, int level,
+                            int windowBits, int memLevel)
+{
+    size_t rounds = TOTAL_BYTES / content.size();
+    size_t outputLength = 0;
+    ZlibHeap heap;
+    std::vector<uint8_t> buffer(deflateBound(NULL, content.size()) + 64);
+    auto start = std::chrono::steady_clock::now();
+    for (size_t round = 0; round < rounds; round++)
+    {
+        z_stream stream = {};
+        stream.zalloc = zlibAlloc;
+        stream.zfree = zlibFree;
+        stream.opaque = &heap;
+        TEST_ASSERT_EQUAL_INT(Z_OK, deflateInit2(&stream, level, Z_DEFLATED, 16 + windowBits, memLevel, Z_DEFAULT_STRATEGY));
+        stream.next_in = (Bytef *)content.data();
+        stream.avail_in = content.size();
+        stream.next_out = buffer.data();
+        stream.avail_out = buffer.size();
+        TEST_ASSERT_EQUAL_INT(Z_STREAM_END, deflate(&stream, Z_FINISH));
+        outputLength = stream.total_out;
+        deflateEnd(&stream);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    report(contentName, compressorName, content.size(), outputLength, seconds * TOTAL_BYTES / (rounds * content.size()),
+           sizeof(z_stream) + heap.peak);
+    return outputLength;
+}
+
+static void benchmarkContent(const char *contentName, const std::string &content, double maxRatio)
+{
+    size_t written = benchmarkWriter(contentName, content);
+    benchmarkZlib(contentName, "zlib -1 32K window", content, 1, 15, 8);
+    benchmarkZlib(contentName, "zlib -6 32K window", content, 6, 15, 8);
+    benchmarkZlib(contentName, "zlib -6 1K window", content, 6, 10, 1);
+
+    TEST_ASSERT_TRUE(written <= content.size() * maxRatio + 32);
+}
+
+// What /metrics answers with, the largest text response.
+static std::string buildMetrics()
+{
+    std::string content;
+    char line[160];
+    const char *methods[] = {"GET", "PUT", "POST", "DELETE"};
+    const char *paths[] = {"/info", "/metrics", "/loopstats", "/updateinfo", "/updatemqtt", "/switch", "/time"};
+    for (int method = 0; method < 4; method++)
+    {
+        for (int path = 0; path < 7; path++)
+        {
+            snprintf(line, sizeof(line), "asset_http_requests_total{method=\"%s\",path=\"%s\"} %d\n", methods[method],
+                     paths[path], 1000 + method * 37 + path * 11);
+            content += line;
+            for (int bucket = 1; bucket <= 12; bucket++)
+            {
+                snprintf(line, sizeof(line), "asset_http_request_duration_us_bucket{path=\"%s\",le=\"%d\"} %d\n",
+                         paths[path], 1 << (bucket + 4), bucket * 83 + path);
+                content += line;
+            }
+        }
+    }
+    return content;
+}
+
+// A JSON array of readings, like the bulk data the sensors send.
+static std::string buildReadings()
+{
+    std::string content = "[";
+    char entry[128];
+    for (int i = 0; i < 300; i++)
+    {
+        snprintf(entry, sizeof(entry), "%s{\"time\":%lu,\"depth\":%d.%02d,\"temperature\":%d.%d}", i > 0 ? "," : "",
+                 1760000000UL + i * 60, 120 + (i * 7) % 13, (i * 37) % 100, 18 + (i % 5), (i * 3) % 10);
+        content += entry;
+    }
+    return content + "]";
+}
+
+static std::string buildRandom()
+{
+    std::string content(16384, '\0');
+    uint32_t state = 0x9E3779B9;
+    for (size_t i = 0; i < content.size(); i++)
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        content[i] = (char)state;
+    }
+    return content;
+}
+
+static void test_bench_metrics()
+{
+    benchmarkContent("metrics", buildMetrics(), 0.25);
+}
+
+static void test_bench_readings()
+{
+    benchmarkContent("readings", buildReadings(), 0.5);
+}
+
+static void test_bench_random()
+{
+    // Fixed Huffman codes spend 8 or 9 bits on each literal, so incompressible content grows by up to 1/8.
+    benchmarkContent("random", buildRandom(), 1.13);
+}
+
+int main(int /* argc */, char ** /* argv */)
+{
+    char message[96];
+    snprintf(message, sizeof(message), "sizeof(MszGzipStreamWriter) %u bytes on this host",
+             (unsigned int)sizeof(MszGzipStreamWriter));
+    TEST_MESSAGE(message);
+
+    UNITY_BEGIN();
+    RUN_TEST(test_bench_metrics);
+    RUN_TEST(test_bench_readings);
+    RUN_TEST(test_bench_random);
+    return UNITY_END();
+}
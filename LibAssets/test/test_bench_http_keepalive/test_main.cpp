@@ -0,0 +1,157 @@
+#include <Arduino.h>
+#include <unity.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include "AssetAsyncHttpServer.h"
+#include "../AssetHttpTestClient.h"
+
+// Requests per second of MszAsyncHttpServer on loopback with a new connection per request, one kept-alive
+// connection and requests pipelined on it, and the ratio to the first. The server polls on its own thread like the
+// loop task of an asset. assetHttpLoadTest.py measures the same modes against a device.
+
+static const uint16_t BENCH_PORT = 47221;
+static const int REQUESTS = 2000;
+static const int PIPELINE_DEPTH = 10;
+static const int RESPONSE_TIMEOUT_MILLIS = 2000;
+static const char *RESPONSE = "{\"status\":\"ok\",\"level\":42}";
+
+static double connectionPerRequestRate = 0;
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+// Runs the server on a thread until it is destroyed.
+struct ServerThread
+{
+    MszAsyncHttpServer server;
+    std::atomic<bool> running;
+    std::thread thread;
+
+    ServerThread() : server(BENCH_PORT), running(true)
+    {
+        this->server.onRequest([this]() {
+            this->server.send(200, "application/json", RESPONSE, strlen(RESPONSE));
+        });
+        TEST_ASSERT_TRUE(this->server.begin());
+        this->thread = std::thread([this]() {
+            while (this->running)
+            {
+                this->server.poll(1);
+            }
+        });
+    }
+
+    ~ServerThread()
+    {
+        this->running = false;
+        this->thread.join();
+    }
+};
+
+static void report(const char *mode, double seconds)
+{
+    double rate = REQUESTS / seconds;
+    if (connectionPerRequestRate == 0)
+    {
+        connectionPerRequestRate = rate;
+    }
+    char message[128];
+    snprintf(message, sizeof(message), "%-22s %8.0f requests/s  %5.2fx", mode, rate, rate / connectionPerRequestRate);
+    TEST_MESSAGE(message);
+}
+
+static void test_bench_connection_per_request()
+{
+    ServerThread serverThread;
+    MszHttpTestClient client(BENCH_PORT);
+    MszHttpTestResponse response;
+    std::string request = MszHttpTestClient::request("/api/level", false);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < REQUESTS; i++)
+    {
+        TEST_ASSERT_TRUE(client.connect());
+        TEST_ASSERT_TRUE(client.sendRaw(request));
+        TEST_ASSERT_TRUE(client.readResponse(response, RESPONSE_TIMEOUT_MILLIS));
+        TEST_ASSERT_EQUAL_INT(200, response.statusCode);
+        TEST_ASSERT_TRUE(response.close);
+        client.close();
+    }
+    report("connection per request", std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+}
+
+static void test_bench_keep_alive()
+{
+    ServerThread serverThread;
+    MszHttpTestClient client(BENCH_PORT);
+    MszHttpTestResponse response;
+    std::string request = MszHttpTestClient::request("/api/level");
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < REQUESTS; i++)
+    {
+        // The server ends a connection after MAX_REQUESTS_PER_CONNECTION requests.
+        if (!client.isConnected())
+        {
+            TEST_ASSERT_TRUE(client.connect());
+        }
+        TEST_ASSERT_TRUE(client.sendRaw(request));
+        TEST_ASSERT_TRUE(client.readResponse(response, RESPONSE_TIMEOUT_MILLIS));
+        TEST_ASSERT_EQUAL_INT(200, response.statusCode);
+        if (response.close)
+        {
+            client.close();
+        }
+    }
+    report("keep-alive", std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+}
+
+static void test_bench_pipelined()
+{
+    ServerThread serverThread;
+    MszHttpTestClient client(BENCH_PORT);
+    MszHttpTestResponse response;
+    std::string batch;
+    for (int i = 0; i < PIPELINE_DEPTH; i++)
+    {
+        batch += MszHttpTestClient::request("/api/level");
+    }
+
+    // MAX_REQUESTS_PER_CONNECTION is a multiple of the depth, the last response of a batch is the one closing.
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < REQUESTS; i += PIPELINE_DEPTH)
+    {
+        if (!client.isConnected())
+        {
+            TEST_ASSERT_TRUE(client.connect());
+        }
+        TEST_ASSERT_TRUE(client.sendRaw(batch));
+        for (int j = 0; j < PIPELINE_DEPTH; j++)
+        {
+            TEST_ASSERT_TRUE(client.readResponse(response, RESPONSE_TIMEOUT_MILLIS));
+            TEST_ASSERT_EQUAL_INT(200, response.statusCode);
+        }
+        if (response.close)
+        {
+            client.close();
+        }
+    }
+    char mode[32];
+    snprintf(mode, sizeof(mode), "pipelined, depth %d", PIPELINE_DEPTH);
+    report(mode, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_bench_connection_per_request);
+    RUN_TEST(test_bench_keep_alive);
+    RUN_TEST(test_bench_pipelined);
+    return UNITY_END();
+}
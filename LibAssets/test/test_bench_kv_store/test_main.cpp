@@ -0,0 +1,180 @@
+#include <Arduino.h>
+#include <unity.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "AssetFileSystem.h"
+#include "AssetKvStore.h"
+
+// MszKvStore against one file per record, the way the assets kept their settings before: flash wear per update on
+// simulated flash, and the time of an update and a lookup with both on the host file system.
+
+static const int RECORD_COUNT = 32;
+static const size_t RECORD_LENGTH = 160;
+static const int UPDATES = 20000;
+static const int LOOKUPS = 100000;
+static const size_t PAGE_SIZE = 4096;
+static const size_t PAGE_COUNT = 16;
+
+static const char *BENCH_ROOT = ".pio/bench-kv-store";
+
+static uint32_t randomState = 1;
+
+static uint32_t nextRandom()
+{
+    // xorshift32, the same sequence on every platform.
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 17;
+    randomState ^= randomState << 5;
+    return randomState;
+}
+
+static std::vector<std::string> records;
+
+static const char *recordPath(int record)
+{
+    static char path[16];
+    snprintf(path, sizeof(path), "/rec%d", record);
+    return path;
+}
+
+// Changes a byte of a random record and returns the record.
+static int changeRecord(int update)
+{
+    int record = nextRandom() % RECORD_COUNT;
+    records[record][update % RECORD_LENGTH] ^= 1;
+    return record;
+}
+
+void setUp()
+{
+    randomState = 0x9E3779B9;
+    records.assign(RECORD_COUNT, std::string());
+    for (std::string &record : records)
+    {
+        record.resize(RECORD_LENGTH);
+        for (char &character : record)
+        {
+            character = 'a' + nextRandom() % 26;
+        }
+    }
+}
+
+void tearDown()
+{
+}
+
+static void report(const char *name, double erasesPerUpdate, double bytesPerUpdate)
+{
+    char message[128];
+    snprintf(message, sizeof(message), "%-22s %6.3f page erases/update %7.1f bytes programmed/update", name,
+             erasesPerUpdate, bytesPerUpdate);
+    TEST_MESSAGE(message);
+}
+
+static void reportTime(const char *name, double putMicros, double getMicros)
+{
+    char message[128];
+    snprintf(message, sizeof(message), "%-22s %8.2f us/update %8.2f us/lookup", name, putMicros, getMicros);
+    TEST_MESSAGE(message);
+}
+
+static void test_bench_flash_wear()
+{
+    MszSimulatedFlash flash(PAGE_SIZE, PAGE_COUNT);
+    MszKvStore store(flash);
+    TEST_ASSERT_TRUE(store.mount());
+    for (int record = 0; record < RECORD_COUNT; record++)
+    {
+        TEST_ASSERT_TRUE(store.put(recordPath(record), records[record].data(), RECORD_LENGTH));
+    }
+    uint32_t erasesBefore = flash.getTotalEraseCount();
+    size_t programmedBefore = flash.getProgrammedBytes();
+    for (int update = 0; update < UPDATES; update++)
+    {
+        int record = changeRecord(update);
+        TEST_ASSERT_TRUE(store.put(recordPath(record), records[record].data(), RECORD_LENGTH));
+    }
+    double storeErases = (double)(flash.getTotalEraseCount() - erasesBefore) / UPDATES;
+    report("MszKvStore", storeErases, (double)(flash.getProgrammedBytes() - programmedBefore) / UPDATES);
+
+    // A small file is rewritten copy-on-write: its data goes to a fresh block and the old block is erased. Files do
+    // not share blocks, so every update costs an erase, the metadata commit of a real file system comes on top.
+    MszSimulatedFlash files(PAGE_SIZE, RECORD_COUNT + PAGE_COUNT);
+    std::vector<size_t> recordPage(RECORD_COUNT);
+    for (int record = 0; record < RECORD_COUNT; record++)
+    {
+        recordPage[record] = record;
+    }
+    size_t nextFreePage = RECORD_COUNT;
+    for (int update = 0; update < UPDATES; update++)
+    {
+        int record = changeRecord(update);
+        size_t page = nextFreePage;
+        TEST_ASSERT_TRUE(files.erasePage(page));
+        TEST_ASSERT_TRUE(files.program(page * PAGE_SIZE, records[record].data(), RECORD_LENGTH));
+        nextFreePage = recordPage[record];
+        recordPage[record] = page;
+    }
+    double fileErases = (double)files.getTotalEraseCount() / UPDATES;
+    report("one file per record", fileErases, (double)files.getProgrammedBytes() / UPDATES);
+
+    TEST_ASSERT_TRUE(storeErases * 10 < fileErases);
+}
+
+static void test_bench_host_time()
+{
+    MszPosixFileSystem fileSystem(BENCH_ROOT);
+    TEST_ASSERT_TRUE(fileSystem.format());
+    TEST_ASSERT_TRUE(fileSystem.begin());
+    char buffer[RECORD_LENGTH];
+
+    // The store on a flash image file, every program and erase is a write to the file.
+    MszFileFlash flash(fileSystem, "/kvstore", PAGE_SIZE, PAGE_COUNT);
+    TEST_ASSERT_TRUE(flash.begin());
+    MszKvStore store(flash);
+    TEST_ASSERT_TRUE(store.mount());
+    for (int record = 0; record < RECORD_COUNT; record++)
+    {
+        TEST_ASSERT_TRUE(store.put(recordPath(record), records[record].data(), RECORD_LENGTH));
+    }
+    auto start = std::chrono::steady_clock::now();
+    for (int update = 0; update < UPDATES; update++)
+    {
+        int record = changeRecord(update);
+        TEST_ASSERT_TRUE(store.put(recordPath(record), records[record].data(), RECORD_LENGTH));
+    }
+    double storePut = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / UPDATES;
+    start = std::chrono::steady_clock::now();
+    for (int lookup = 0; lookup < LOOKUPS; lookup++)
+    {
+        TEST_ASSERT_EQUAL_UINT32(RECORD_LENGTH, store.get(recordPath(lookup % RECORD_COUNT), buffer, sizeof(buffer)));
+    }
+    double storeGet = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / LOOKUPS;
+    reportTime("MszKvStore on a file", storePut, storeGet);
+
+    start = std::chrono::steady_clock::now();
+    for (int update = 0; update < UPDATES; update++)
+    {
+        int record = changeRecord(update);
+        TEST_ASSERT_TRUE(fileSystem.write(recordPath(record), records[record].data(), RECORD_LENGTH));
+    }
+    double filePut = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / UPDATES;
+    start = std::chrono::steady_clock::now();
+    for (int lookup = 0; lookup < LOOKUPS; lookup++)
+    {
+        TEST_ASSERT_EQUAL_UINT32(RECORD_LENGTH, fileSystem.read(recordPath(lookup % RECORD_COUNT), 0, buffer, sizeof(buffer)));
+    }
+    double fileGet = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / LOOKUPS;
+    reportTime("one file per record", filePut, fileGet);
+
+    TEST_ASSERT_TRUE(fileSystem.format());
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_bench_flash_wear);
+    RUN_TEST(test_bench_host_time);
+    return UNITY_END();
+}
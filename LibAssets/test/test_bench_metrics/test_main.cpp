@@ -0,0 +1,77 @@
+#include <Arduino.h>
+#include <unity.h>
+#include <chrono>
+#include "AssetMetrics.h"
+
+// Update cost of the metrics the request and loop paths touch on every call.
+
+static const uint32_t ITERATIONS = 20000000;
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+template <typename TUpdate>
+static void benchmarkUpdate(const char *name, TUpdate update)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < ITERATIONS; i++)
+    {
+        update(i);
+    }
+    double nanos = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / ITERATIONS;
+
+    char message[96];
+    snprintf(message, sizeof(message), "%-28s %6.2f ns/op", name, nanos);
+    TEST_MESSAGE(message);
+}
+
+static void test_bench_counter()
+{
+    MszCounter *counter = MszMetricsRegistry::registerCounter("bench_counter_total", "Benchmark counter.");
+    TEST_ASSERT_NOT_NULL(counter);
+
+    benchmarkUpdate("MszCounter::increment()", [counter](uint32_t i) { counter->increment(); });
+    benchmarkUpdate("MszCounter::increment(n)", [counter](uint32_t i) { counter->increment(i & 3); });
+    TEST_ASSERT_EQUAL_UINT32(ITERATIONS + ITERATIONS / 4 * (0 + 1 + 2 + 3), counter->get());
+}
+
+static void test_bench_gauge()
+{
+    MszGauge *gauge = MszMetricsRegistry::registerGauge("bench_gauge", "Benchmark gauge.");
+    TEST_ASSERT_NOT_NULL(gauge);
+
+    benchmarkUpdate("MszGauge::set()", [gauge](uint32_t i) { gauge->set((int32_t)i); });
+    TEST_ASSERT_EQUAL_INT32(ITERATIONS - 1, gauge->get());
+}
+
+static void test_bench_histogram()
+{
+    MszHistogram *histogram = MszMetricsRegistry::registerHistogram("bench_seconds", "Benchmark histogram.");
+    TEST_ASSERT_NOT_NULL(histogram);
+
+    // Short durations end in the first buckets, the spread covers all of them including +Inf.
+    benchmarkUpdate("MszHistogram::observe() short", [histogram](uint32_t i) { histogram->observe(i & 0x3F); });
+    benchmarkUpdate("MszHistogram::observe() spread", [histogram](uint32_t i) { histogram->observe((i * 2654435761u) >> (i & 31)); });
+
+    uint32_t total = 0;
+    for (int bucket = 0; bucket <= MszHistogram::BUCKET_COUNT; bucket++)
+    {
+        total += histogram->getBucket(bucket);
+    }
+    TEST_ASSERT_EQUAL_UINT32(2 * ITERATIONS, histogram->getCount());
+    TEST_ASSERT_EQUAL_UINT32(histogram->getCount(), total);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_bench_counter);
+    RUN_TEST(test_bench_gauge);
+    RUN_TEST(test_bench_histogram);
+    return UNITY_END();
+}
@@ -0,0 +1,130 @@
+#include <Arduino.h>
+#include <unity.h>
+#include <TimeLib.h>
+#include <time.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "SecretHandler.h"
+#include "AssetUdpCommandServer.h"
+#include "AssetUdpCommandClient.h"
+
+// Load generator for the UDP command path: MszUdpCommandClient against MszUdpCommandServer on loopback, the server
+// looping on its own thread like the loop task of an asset. Measures round trips one at a time and with several
+// commands in flight. On the host signing dominates, on the devices the radio does, the figures compare changes.
+
+static const uint16_t BENCH_PORT = 47211;
+static const int SECRET_ID = 0;
+static const char *SECRET = "pool-secret-for-the-bench";
+static const int REQUESTS = 4800;
+static const int WINDOWS[] = {1, 4, 16};
+static const int RESPONSE_TIMEOUT_MILLIS = 1000;
+
+static MszSecretHandler secretHandler;
+static std::vector<double> samples;
+
+void setUp()
+{
+    setTime((time_t)::time(NULL));
+}
+
+void tearDown()
+{
+}
+
+// Runs the server loop on a thread until it is destroyed.
+struct ServerThread
+{
+    MszUdpCommandServer server;
+    std::atomic<bool> running;
+    std::thread thread;
+
+    ServerThread() : server(BENCH_PORT), running(true)
+    {
+        this->server.registerCommand(UDP_COMMAND_SWITCH_ON, [](const uint8_t *payload, size_t length) {
+            return (uint8_t)UDP_STATUS_OK;
+        });
+        this->server.begin(&secretHandler, SECRET_ID);
+        this->thread = std::thread([this]() {
+            while (this->running)
+            {
+                this->server.loop();
+                // Nothing to do, the client needs the core.
+                std::this_thread::yield();
+            }
+        });
+    }
+
+    ~ServerThread()
+    {
+        this->running = false;
+        this->thread.join();
+    }
+};
+
+static void test_bench_round_trip()
+{
+    ServerThread serverThread;
+    MszUdpCommandClient client(&secretHandler, SECRET_ID, 1);
+    TEST_ASSERT_TRUE(client.begin("127.0.0.1", BENCH_PORT));
+
+    samples.clear();
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < REQUESTS; i++)
+    {
+        auto requestStart = std::chrono::steady_clock::now();
+        TEST_ASSERT_EQUAL_INT(UDP_STATUS_OK, client.request(UDP_COMMAND_SWITCH_ON, (const uint8_t *)"pool-pump", 9, RESPONSE_TIMEOUT_MILLIS));
+        samples.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - requestStart).count());
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::sort(samples.begin(), samples.end());
+
+    char message[128];
+    snprintf(message, sizeof(message), "round trip     %8.0f commands/s  p50 %8.2f us  p99 %8.2f us", REQUESTS / seconds,
+             samples[REQUESTS / 2], samples[REQUESTS * 99 / 100]);
+    TEST_MESSAGE(message);
+}
+
+static void test_bench_in_flight()
+{
+    ServerThread serverThread;
+    MszUdpCommandClient client(&secretHandler, SECRET_ID, 2);
+    TEST_ASSERT_TRUE(client.begin("127.0.0.1", BENCH_PORT));
+
+    // Sends a window of commands, then collects their responses, which the server sends in order.
+    for (int window : WINDOWS)
+    {
+        uint64_t nonces[16];
+        int answered = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < REQUESTS; i += window)
+        {
+            for (int j = 0; j < window; j++)
+            {
+                nonces[j] = client.nextNonce();
+                TEST_ASSERT_TRUE(client.send(UDP_COMMAND_SWITCH_ON, nonces[j], (const uint8_t *)"pool-pump", 9));
+            }
+            for (int j = 0; j < window; j++)
+            {
+                answered += (client.receive(UDP_COMMAND_SWITCH_ON, nonces[j], RESPONSE_TIMEOUT_MILLIS) == UDP_STATUS_OK) ? 1 : 0;
+            }
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        TEST_ASSERT_EQUAL_INT(REQUESTS, answered);
+
+        char message[128];
+        snprintf(message, sizeof(message), "window %2d      %8.0f commands/s", window, REQUESTS / seconds);
+        TEST_MESSAGE(message);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    secretHandler.setSecret(SECRET_ID, SECRET, strlen(SECRET));
+    UNITY_BEGIN();
+    RUN_TEST(test_bench_round_trip);
+    RUN_TEST(test_bench_in_flight);
+    return UNITY_END();
+}
@@ -0,0 +1,140 @@
+#include <Arduino.h>
+#include <unity.h>
+#include <atomic>
+#include <thread>
+#include "AssetBoundedQueue.h"
+#include "AssetCoreTask.h"
+
+// MszBoundedQueue between producers running as MszCoreTask threads and a consumer, the way the dual-core mode passes
+// measurements and transmit requests: order per producer and the accounting of dropped items.
+
+static const int PRODUCER_COUNT = 2;
+static const uint32_t ITEMS_PER_PRODUCER = 200000;
+// Pushed per call of the task body, more than the queue holds so that a busy consumer makes the producers drop.
+static const uint32_t BURST_SIZE = 1000;
+static const size_t QUEUE_CAPACITY = 64;
+
+struct TestMessage
+{
+    int producer;
+    uint32_t sequence;
+};
+
+static MszBoundedQueue<TestMessage, QUEUE_CAPACITY> queue;
+
+// State of each producer task, the tasks keep running after the test and return right away once they are done.
+struct ProducerState
+{
+    uint32_t nextSequence = 0;
+    uint32_t droppedCount = 0;
+    std::atomic<bool> isDone{false};
+};
+static ProducerState producers[PRODUCER_COUNT];
+
+static void produceBurst(int producer)
+{
+    ProducerState &state = producers[producer];
+    if (state.isDone.load(std::memory_order_acquire))
+    {
+        return;
+    }
+    for (uint32_t i = 0; i < BURST_SIZE && state.nextSequence < ITEMS_PER_PRODUCER; i++)
+    {
+        if (!queue.tryPush({producer, state.nextSequence}))
+        {
+            state.droppedCount++;
+        }
+        state.nextSequence++;
+    }
+    if (state.nextSequence == ITEMS_PER_PRODUCER)
+    {
+        state.isDone.store(true, std::memory_order_release);
+    }
+}
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+static void test_fifo_and_drop_count()
+{
+    MszBoundedQueue<TestMessage, 4> small;
+    TestMessage message;
+    TEST_ASSERT_FALSE(small.tryPop(message));
+
+    for (uint32_t i = 0; i < 6; i++)
+    {
+        TEST_ASSERT_EQUAL(i < 4, small.tryPush({0, i}));
+    }
+    TEST_ASSERT_EQUAL_UINT32(4, small.size());
+    TEST_ASSERT_EQUAL_UINT32(2, small.getDroppedCount());
+
+    // Wrapping around the array keeps the order.
+    for (uint32_t i = 0; i < 10; i++)
+    {
+        TEST_ASSERT_TRUE(small.tryPop(message));
+        TEST_ASSERT_EQUAL_UINT32(i, message.sequence);
+        TEST_ASSERT_TRUE(small.tryPush({0, i + 4}));
+    }
+    TEST_ASSERT_EQUAL_UINT32(4, small.size());
+    TEST_ASSERT_EQUAL_UINT32(2, small.getDroppedCount());
+}
+
+static void test_core_task_producers_and_consumer()
+{
+    TEST_ASSERT_TRUE(MszCoreTask::start("producer0", []() { produceBurst(0); }, MSZ_REALTIME_CORE));
+    TEST_ASSERT_TRUE(MszCoreTask::start("producer1", []() { produceBurst(1); }, MSZ_REALTIME_CORE));
+
+    uint32_t received[PRODUCER_COUNT] = {0, 0};
+    int64_t lastSequence[PRODUCER_COUNT] = {-1, -1};
+    uint32_t outOfOrder = 0;
+    TestMessage message;
+    for (;;)
+    {
+        // Checked before popping, so the queue is drained after the last push.
+        bool allDone = producers[0].isDone.load(std::memory_order_acquire) && producers[1].isDone.load(std::memory_order_acquire);
+        bool popped = false;
+        while (queue.tryPop(message))
+        {
+            popped = true;
+            outOfOrder += ((int64_t)message.sequence > lastSequence[message.producer]) ? 0 : 1;
+            lastSequence[message.producer] = message.sequence;
+            received[message.producer]++;
+        }
+        if (allDone)
+        {
+            break;
+        }
+        if (!popped)
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    uint32_t dropped = producers[0].droppedCount + producers[1].droppedCount;
+    char text[128];
+    snprintf(text, sizeof(text), "received %u and %u, dropped %u of %u", (unsigned int)received[0],
+             (unsigned int)received[1], (unsigned int)dropped, (unsigned int)(PRODUCER_COUNT * ITEMS_PER_PRODUCER));
+    TEST_MESSAGE(text);
+
+    // Every item either arrived, in the order of its producer, or was counted as dropped by the queue.
+    TEST_ASSERT_EQUAL_UINT32(0, outOfOrder);
+    for (int producer = 0; producer < PRODUCER_COUNT; producer++)
+    {
+        TEST_ASSERT_EQUAL_UINT32(ITEMS_PER_PRODUCER, received[producer] + producers[producer].droppedCount);
+    }
+    TEST_ASSERT_EQUAL_UINT32(dropped, queue.getDroppedCount());
+    TEST_ASSERT_EQUAL_UINT32(0, queue.size());
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_fifo_and_drop_count);
+    RUN_TEST(test_core_task_producers_and_consumer);
+    return UNITY_END();
+}
@@ -0,0 +1,211 @@
+#include <Arduino.h>
+#include <unity.h>
+#include <string>
+#include <vector>
+#include <zlib.h>
+#include "GzipStreamWriter.h"
+
+// Everything MszGzipStreamWriter produces must inflate with zlib to the original input, CRC and length included.
+
+/// @brief Collects the compressed stream.
+class BufferPrint : public Print
+{
+public:
+    std::vector<uint8_t> data;
+
+    virtual size_t write(uint8_t c) override
+    {
+        this->data.push_back(c);
+        return 1;
+    }
+
+    virtual size_t write(const uint8_t *buffer, size_t size) override
+    {
+        this->data.insert(this->data.end(), buffer, buffer + size);
+        return size;
+    }
+};
+
+static uint32_t randomState = 1;
+
+static uint32_t nextRandom()
+{
+    // xorshift32, the same sequence on every platform.
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 17;
+    randomState ^= randomState << 5;
+    return randomState;
+}
+
+void setUp()
+{
+    randomState = 0x9E3779B9;
+}
+
+void tearDown()
+{
+}
+
+static bool gunzip(const std::vector<uint8_t> &compressed, std::vector<uint8_t> &output)
+{
+    z_stream stream = {};
+    if (inflateInit2(&stream, 16 + MAX_WBITS) != Z_OK)
+    {
+        return false;
+    }
+    stream.next_in = (Bytef *)compressed.data();
+    stream.avail_in = compressed.size();
+    uint8_t buffer[4096];
+    int result;
+    do
+    {
+        stream.next_out = buffer;
+        stream.avail_out = sizeof(buffer);
+        result = inflate(&stream, Z_NO_FLUSH);
+        output.insert(output.end(), buffer, buffer + (sizeof(buffer) - stream.avail_out));
+    } while (result == Z_OK);
+    bool complete = (result == Z_STREAM_END && stream.avail_in == 0);
+    inflateEnd(&stream);
+    return complete;
+}
+
+// Compresses input in writes of random length up to maxWrite, 0 writes all at once, and checks the round trip.
+static void assertRoundTrip(const std::vector<uint8_t> &input, size_t maxWrite)
+{
+    BufferPrint compressed;
+    MszGzipStreamWriter *writer = new MszGzipStreamWriter(compressed);
+    size_t position = 0;
+    while (position < input.size())
+    {
+        size_t length = input.size() - position;
+        if (maxWrite > 0 && length > maxWrite)
+        {
+            length = 1 + nextRandom() % maxWrite;
+        }
+        if (length == 1 && (nextRandom() & 1))
+        {
+            writer->write(input[position]);
+        }
+        else
+        {
+            writer->write(input.data() + position, length);
+        }
+        position += length;
+    }
+    writer->finish();
+    TEST_ASSERT_EQUAL_UINT32(input.size(), writer->getBytesIn());
+    TEST_ASSERT_EQUAL_UINT32(compressed.data.size(), writer->getBytesOut());
+    delete writer;
+
+    std::vector<uint8_t> output;
+    TEST_ASSERT_TRUE_MESSAGE(gunzip(compressed.data, output), "zlib rejected the gzip stream");
+    TEST_ASSERT_EQUAL_UINT32(input.size(), output.size());
+    TEST_ASSERT_TRUE(input == output);
+}
+
+static std::vector<uint8_t> randomBytes(size_t length, uint32_t alphabet)
+{
+    std::vector<uint8_t> data(length);
+    for (size_t i = 0; i < length; i++)
+    {
+        data[i] = (uint8_t)(nextRandom() % alphabet);
+    }
+    return data;
+}
+
+// Text made of a few words, like the JSON and metrics responses: many short and mid-range matches.
+static std::vector<uint8_t> randomText(size_t length)
+{
+    static const char *words[] = {"{\"sensorName\":", "\"pool\"", ",", "asset_http_requests_total{", "method=\"GET\"",
+                                  "} ", "\n", "0.25", "depth", "\"switchName\":\"lamp\"", "[", "]", " "};
+    std::string text;
+    while (text.size() < length)
+    {
+        text += words[nextRandom() % (sizeof(words) / sizeof(words[0]))];
+    }
+    text.resize(length);
+    return std::vector<uint8_t>(text.begin(), text.end());
+}
+
+static void test_empty_input()
+{
+    assertRoundTrip(std::vector<uint8_t>(), 0);
+}
+
+static void test_single_bytes()
+{
+    for (int value = 0; value < 256; value += 51)
+    {
+        assertRoundTrip(std::vector<uint8_t>(1, (uint8_t)value), 0);
+    }
+}
+
+static void test_incompressible_input()
+{
+    for (size_t length : {1, 100, 1023, 1024, 1025, 4096, 70000})
+    {
+        assertRoundTrip(randomBytes(length, 256), 0);
+        assertRoundTrip(randomBytes(length, 256), 300);
+    }
+}
+
+static void test_long_runs()
+{
+    // Runs longer than MAX_MATCH and longer than the window.
+    for (size_t length : {3, 258, 259, 1000, 5000, 100000})
+    {
+        assertRoundTrip(std::vector<uint8_t>(length, 'a'), 0);
+        assertRoundTrip(std::vector<uint8_t>(length, 0), 17);
+    }
+}
+
+static void test_random_text()
+{
+    for (int round = 0; round < 200; round++)
+    {
+        size_t length = nextRandom() % 20000;
+        size_t maxWrite = (round % 3 == 0) ? 0 : 1 + nextRandom() % 700;
+        assertRoundTrip(randomText(length), maxWrite);
+    }
+}
+
+static void test_small_alphabets()
+{
+    // Low entropy data has matches at every distance the window allows.
+    for (int round = 0; round < 200; round++)
+    {
+        size_t length = nextRandom() % 20000;
+        uint32_t alphabet = 2 + nextRandom() % 8;
+        assertRoundTrip(randomBytes(length, alphabet), (round & 1) ? 1 + nextRandom() % 64 : 0);
+    }
+}
+
+static void test_byte_by_byte_writes()
+{
+    std::vector<uint8_t> input = randomText(6000);
+    BufferPrint compressed;
+    MszGzipStreamWriter *writer = new MszGzipStreamWriter(compressed);
+    for (uint8_t value : input)
+    {
+        writer->write(value);
+    }
+    writer->finish();
+    delete writer;
+
+    std::vector<uint8_t> output;
+    TEST_ASSERT_TRUE(gunzip(compressed.data, output));
+    TEST_ASSERT_TRUE(input == output);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_empty_input);
+    RUN_TEST(test_single_bytes);
+    RUN_TEST(test_incompressible_input);
+    RUN_TEST(test_long_runs);
+    RUN_TEST(test_random_text);
+    RUN_TEST(test_small_alphabets);
+    RUN_TEST(test_byte_by_byte_writes);
+    return UNITY_END();
+}
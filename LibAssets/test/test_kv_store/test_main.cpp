@@ -0,0 +1,248 @@
+#include <Arduino.h>
+#include <unity.h>
+#include <map>
+#include <string>
+#include "AssetKvStore.h"
+
+// MszKvStore on simulated NOR flash: random operations against a model, power cuts in the middle of writes and
+// the erase counts of the pages.
+
+typedef std::map<std::string, std::string> Model;
+
+static uint32_t randomState = 1;
+
+static uint32_t nextRandom()
+{
+    // xorshift32, the same sequence on every platform.
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 17;
+    randomState ^= randomState << 5;
+    return randomState;
+}
+
+static std::string randomValue(size_t maxLength)
+{
+    std::string value(1 + nextRandom() % maxLength, '\0');
+    for (char &character : value)
+    {
+        character = 'a' + nextRandom() % 26;
+    }
+    return value;
+}
+
+static std::string keyName(const char *prefix, uint32_t number)
+{
+    return std::string(prefix) + std::to_string(number);
+}
+
+static bool holds(MszKvStore &store, const std::string &key, const std::string &value)
+{
+    char buffer[2048];
+    size_t length = store.get(key.c_str(), buffer, sizeof(buffer));
+    return length == value.size() && memcmp(buffer, value.data(), length) == 0;
+}
+
+static void assertMatchesModel(MszKvStore &store, const Model &model)
+{
+    TEST_ASSERT_EQUAL_INT((int)model.size(), store.getKeyCount());
+    for (const auto &entry : model)
+    {
+        TEST_ASSERT_TRUE_MESSAGE(holds(store, entry.first, entry.second), entry.first.c_str());
+    }
+    int visited = 0;
+    store.forEachKey("", [&](const char *key) {
+        TEST_ASSERT_TRUE(model.count(key) == 1);
+        visited++;
+    });
+    TEST_ASSERT_EQUAL_INT((int)model.size(), visited);
+}
+
+void setUp()
+{
+    randomState = 0x9E3779B9;
+}
+
+void tearDown()
+{
+}
+
+static void test_simulated_flash_has_nor_semantics()
+{
+    MszSimulatedFlash flash(256, 2);
+    uint8_t data[4] = {0xF0, 0x0F, 0xFF, 0x00};
+    uint8_t read[4];
+
+    TEST_ASSERT_TRUE(flash.read(0, read, sizeof(read)));
+    TEST_ASSERT_EQUAL_UINT8(FLASH_ERASED_BYTE, read[0]);
+
+    // Programming only clears bits, erasing sets them all again.
+    TEST_ASSERT_TRUE(flash.program(0, data, sizeof(data)));
+    uint8_t over[4] = {0x3C, 0x3C, 0x3C, 0x3C};
+    flash.program(0, over, sizeof(over));
+    TEST_ASSERT_TRUE(flash.read(0, read, sizeof(read)));
+    TEST_ASSERT_EQUAL_UINT8(0x30, read[0]);
+    TEST_ASSERT_EQUAL_UINT8(0x0C, read[1]);
+    TEST_ASSERT_EQUAL_UINT8(0x3C, read[2]);
+    TEST_ASSERT_EQUAL_UINT8(0x00, read[3]);
+
+    TEST_ASSERT_TRUE(flash.erasePage(0));
+    TEST_ASSERT_TRUE(flash.read(0, read, sizeof(read)));
+    TEST_ASSERT_EQUAL_UINT8(FLASH_ERASED_BYTE, read[3]);
+    TEST_ASSERT_EQUAL_UINT32(1, flash.getEraseCount(0));
+
+    // Out of range accesses fail.
+    TEST_ASSERT_FALSE(flash.read(510, read, sizeof(read)));
+    TEST_ASSERT_FALSE(flash.erasePage(2));
+}
+
+static void test_random_operations_match_model()
+{
+    MszSimulatedFlash flash(4096, 16);
+    MszKvStore *store = new MszKvStore(flash);
+    TEST_ASSERT_TRUE(store->mount());
+    Model model;
+
+    for (int operation = 0; operation < 60000; operation++)
+    {
+        std::string key = keyName("/k", nextRandom() % 60);
+        uint32_t kind = nextRandom() % 10;
+        if (kind < 7)
+        {
+            std::string value = randomValue(nextRandom() % 20 == 0 ? 1500 : 200);
+            TEST_ASSERT_TRUE(store->put(key.c_str(), value.data(), value.size()));
+            model[key] = value;
+        }
+        else if (kind < 9)
+        {
+            TEST_ASSERT_TRUE(store->remove(key.c_str()));
+            model.erase(key);
+        }
+        else
+        {
+            TEST_ASSERT_EQUAL_UINT32(model.count(key) ? model[key].size() : 0, store->getLength(key.c_str()));
+        }
+
+        // A second store mounting the same flash sees the same state, as after a reboot.
+        if (operation % 10000 == 9999)
+        {
+            assertMatchesModel(*store, model);
+            delete store;
+            store = new MszKvStore(flash);
+            TEST_ASSERT_TRUE(store->mount());
+            assertMatchesModel(*store, model);
+        }
+    }
+    delete store;
+}
+
+static void test_power_cut_keeps_old_or_new_value()
+{
+    int interrupted = 0;
+    for (size_t budget = 0; budget < 3000; budget += 7)
+    {
+        MszSimulatedFlash flash(1024, 4);
+        Model model;
+        std::string pendingKey;
+        std::string pendingValue;
+        bool failed = false;
+        {
+            MszKvStore store(flash);
+            TEST_ASSERT_TRUE(store.mount());
+            for (uint32_t i = 0; i < 8; i++)
+            {
+                std::string value = randomValue(60);
+                TEST_ASSERT_TRUE(store.put(keyName("/p", i).c_str(), value.data(), value.size()));
+                model[keyName("/p", i)] = value;
+            }
+
+            // Power fails somewhere in a series of updates, including the ones that compact pages.
+            flash.failAfterProgrammedBytes(budget);
+            for (int i = 0; i < 400 && !failed; i++)
+            {
+                pendingKey = keyName("/p", nextRandom() % 8);
+                pendingValue = randomValue(60);
+                if (store.put(pendingKey.c_str(), pendingValue.data(), pendingValue.size()))
+                {
+                    model[pendingKey] = pendingValue;
+                }
+                else
+                {
+                    failed = true;
+                }
+            }
+        }
+        TEST_ASSERT_TRUE(failed);
+        interrupted++;
+        flash.restorePower();
+
+        // After the reboot every key holds its last written value, the interrupted one may hold the new one.
+        MszKvStore store(flash);
+        TEST_ASSERT_TRUE(store.mount());
+        TEST_ASSERT_EQUAL_INT(8, store.getKeyCount());
+        for (const auto &entry : model)
+        {
+            bool isOld = holds(store, entry.first, entry.second);
+            bool isNew = entry.first == pendingKey && holds(store, entry.first, pendingValue);
+            TEST_ASSERT_TRUE(isOld || isNew);
+        }
+
+        // The store keeps working on the recovered flash.
+        for (int i = 0; i < 300; i++)
+        {
+            std::string value = randomValue(60);
+            TEST_ASSERT_TRUE(store.put("/p1", value.data(), value.size()));
+        }
+    }
+    TEST_ASSERT_TRUE(interrupted > 400);
+}
+
+static void test_wear_leveling_moves_static_data()
+{
+    MszSimulatedFlash flash(4096, 16);
+    MszKvStore store(flash);
+    TEST_ASSERT_TRUE(store.mount());
+
+    // Static data fills most pages, a single hot key takes all updates.
+    for (uint32_t i = 0; i < 40; i++)
+    {
+        std::string value = randomValue(600);
+        TEST_ASSERT_TRUE(store.put(keyName("/static", i).c_str(), value.data(), value.size()));
+    }
+    for (int i = 0; i < 100000; i++)
+    {
+        std::string value = randomValue(100);
+        TEST_ASSERT_TRUE(store.put("/hot", value.data(), value.size()));
+    }
+
+    uint32_t minErases = flash.getEraseCount(0);
+    uint32_t maxErases = flash.getEraseCount(0);
+    for (size_t page = 1; page < flash.getPageCount(); page++)
+    {
+        minErases = flash.getEraseCount(page) < minErases ? flash.getEraseCount(page) : minErases;
+        maxErases = flash.getEraseCount(page) > maxErases ? flash.getEraseCount(page) : maxErases;
+    }
+    char message[96];
+    snprintf(message, sizeof(message), "page erases after 100000 hot updates: min %u max %u", (unsigned int)minErases,
+             (unsigned int)maxErases);
+    TEST_MESSAGE(message);
+
+    // Pages holding the static data joined the rotation, no page fell far behind.
+    TEST_ASSERT_TRUE(minErases > 0);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(minErases + KV_WEAR_LEVELING_DELTA + 2, maxErases);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(store.getMinEraseCount() + KV_WEAR_LEVELING_DELTA + 2, store.getMaxEraseCount());
+
+    for (uint32_t i = 0; i < 40; i++)
+    {
+        TEST_ASSERT_TRUE(store.contains(keyName("/static", i).c_str()));
+    }
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_simulated_flash_has_nor_semantics);
+    RUN_TEST(test_random_operations_match_model);
+    RUN_TEST(test_power_cut_keeps_old_or_new_value);
+    RUN_TEST(test_wear_leveling_moves_static_data);
+    return UNITY_END();
+}
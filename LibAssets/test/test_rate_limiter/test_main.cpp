@@ -0,0 +1,283 @@
+#include <Arduino.h>
+#include <unity.h>
+#include <vector>
+#include "../AssetApiTestBackend.h"
+#include "AssetRateLimiter.h"
+#include "AssetScheduler.h"
+
+// Admission control on a virtual clock: the limiter gets the time passed in, the flood test advances the clock of
+// the native Arduino core, which is what millis() and the scheduler run on.
+
+typedef MszTestApiBackend::Fields Fields;
+
+static MszSecretHandler secretHandler;
+static MszTestAssetApiServer api(0, 80);
+static MszTestApiBackend::Server &server = *MszTestApiBackend::Server::current;
+
+// Virtual time a request costs on the device: verifying the HMAC and logging an admitted one, answering 429 otherwise.
+static const unsigned int ADMITTED_REQUEST_MICROS = 3000;
+static const unsigned int REJECTED_REQUEST_MICROS = 40;
+// Requests the async server can have waiting at once on the device, one per connection.
+static const int PENDING_REQUESTS = 5;
+// The global burst is spent within this time, deadlines have to hold from then on.
+static const unsigned long BURST_MILLIS = 1000;
+
+static const uint32_t CLIENT_ADDRESS = 0x0A00000A;
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+// Addresses the limiter hashes to the same probe window, the first one is the given address.
+static std::vector<uint32_t> findCollidingAddresses(uint32_t address, size_t count)
+{
+    std::vector<uint32_t> addresses;
+    uint32_t slot = ((address * 2654435761u) >> 16) & (RATE_LIMIT_MAX_CLIENTS - 1);
+    for (uint32_t candidate = address; addresses.size() < count; candidate++)
+    {
+        if ((((candidate * 2654435761u) >> 16) & (RATE_LIMIT_MAX_CLIENTS - 1)) == slot)
+        {
+            addresses.push_back(candidate);
+        }
+    }
+    return addresses;
+}
+
+static void test_client_bucket_refills_at_its_rate()
+{
+    MszRateLimiter limiter;
+    limiter.configure(120, 10, 0, 0);
+
+    for (int i = 0; i < 10; i++)
+    {
+        TEST_ASSERT_EQUAL_UINT32(0, limiter.admit(CLIENT_ADDRESS, 1000));
+    }
+    TEST_ASSERT_EQUAL_UINT32(1, limiter.admit(CLIENT_ADDRESS, 1000));
+
+    // 120 requests per minute is one every 500 ms.
+    TEST_ASSERT_EQUAL_UINT32(1, limiter.admit(CLIENT_ADDRESS, 1499));
+    TEST_ASSERT_EQUAL_UINT32(0, limiter.admit(CLIENT_ADDRESS, 1500));
+    TEST_ASSERT_EQUAL_UINT32(1, limiter.admit(CLIENT_ADDRESS, 1500));
+
+    // A quiet period refills the burst, not more.
+    for (int i = 0; i < 10; i++)
+    {
+        TEST_ASSERT_EQUAL_UINT32(0, limiter.admit(CLIENT_ADDRESS, 600000));
+    }
+    TEST_ASSERT_EQUAL_UINT32(1, limiter.admit(CLIENT_ADDRESS, 600000));
+
+    // Other clients have their own bucket.
+    TEST_ASSERT_EQUAL_UINT32(0, limiter.admit(CLIENT_ADDRESS + 1, 600000));
+}
+
+static void test_global_bucket_limits_all_clients()
+{
+    MszRateLimiter limiter;
+    limiter.configure(0, 0, 600, 30);
+
+    for (uint32_t i = 0; i < 30; i++)
+    {
+        TEST_ASSERT_EQUAL_UINT32(0, limiter.admit(CLIENT_ADDRESS + i, 1000));
+    }
+    TEST_ASSERT_EQUAL_UINT32(1, limiter.admit(CLIENT_ADDRESS + 30, 1000));
+    TEST_ASSERT_EQUAL_UINT32(1, limiter.admit(0, 1000));
+
+    // 600 requests per minute is one every 100 ms, also for requests without an address.
+    TEST_ASSERT_EQUAL_UINT32(0, limiter.admit(0, 1100));
+    TEST_ASSERT_EQUAL_UINT32(1, limiter.admit(CLIENT_ADDRESS, 1100));
+}
+
+static void test_failed_authorizations_lead_to_penalty_box()
+{
+    MszRateLimiter limiter;
+    limiter.configure(0, 0, 0, 0);
+
+    TEST_ASSERT_EQUAL_UINT32(0, limiter.admit(CLIENT_ADDRESS, 1000));
+    for (int i = 0; i < RATE_LIMIT_AUTH_FAILURES - 1; i++)
+    {
+        limiter.reportAuthFailure(CLIENT_ADDRESS, 1000);
+    }
+
+    // A success in between starts the count over.
+    limiter.reportAuthSuccess(CLIENT_ADDRESS);
+    limiter.reportAuthFailure(CLIENT_ADDRESS, 1000);
+    TEST_ASSERT_EQUAL_UINT32(0, limiter.admit(CLIENT_ADDRESS, 1000));
+
+    for (int i = 0; i < RATE_LIMIT_AUTH_FAILURES - 1; i++)
+    {
+        limiter.reportAuthFailure(CLIENT_ADDRESS, 2000);
+    }
+    TEST_ASSERT_EQUAL_UINT32(RATE_LIMIT_PENALTY_SECONDS, limiter.admit(CLIENT_ADDRESS, 2000));
+    TEST_ASSERT_EQUAL_UINT32(1, limiter.admit(CLIENT_ADDRESS, 2000 + RATE_LIMIT_PENALTY_SECONDS * 1000UL - 1));
+    TEST_ASSERT_EQUAL_UINT32(0, limiter.admit(CLIENT_ADDRESS, 2000 + RATE_LIMIT_PENALTY_SECONDS * 1000UL));
+
+    // Other clients are not affected.
+    limiter.reportAuthFailure(CLIENT_ADDRESS, 3000);
+    TEST_ASSERT_EQUAL_UINT32(0, limiter.admit(CLIENT_ADDRESS + 1, 3000));
+}
+
+static void test_probe_window_evicts_least_recently_seen_client()
+{
+    MszRateLimiter limiter;
+    limiter.configure(120, 10, 0, 0);
+    std::vector<uint32_t> addresses = findCollidingAddresses(CLIENT_ADDRESS, MszRateLimiter::PROBE_COUNT + 1);
+
+    // A full window: a penalized client, a client without tokens, and two more seen later.
+    limiter.admit(addresses[0], 1000);
+    for (int i = 0; i < RATE_LIMIT_AUTH_FAILURES; i++)
+    {
+        limiter.reportAuthFailure(addresses[0], 1000);
+    }
+    for (int i = 0; i < 10; i++)
+    {
+        limiter.admit(addresses[1], 1001);
+    }
+    TEST_ASSERT_TRUE(limiter.admit(addresses[1], 1001) > 0);
+    limiter.admit(addresses[2], 1002);
+    limiter.admit(addresses[3], 1003);
+
+    // A new client replaces the least recently seen one that is not penalized, which comes back with a full bucket.
+    TEST_ASSERT_EQUAL_UINT32(0, limiter.admit(addresses[4], 1004));
+    TEST_ASSERT_TRUE(limiter.admit(addresses[0], 1005) > 0);
+    TEST_ASSERT_EQUAL_UINT32(0, limiter.admit(addresses[1], 1006));
+}
+
+static void test_flood_of_addresses_keeps_penalized_client()
+{
+    MszRateLimiter limiter;
+    uint32_t nowMillis = 1000;
+    limiter.admit(CLIENT_ADDRESS, nowMillis);
+    for (int i = 0; i < RATE_LIMIT_AUTH_FAILURES; i++)
+    {
+        limiter.reportAuthFailure(CLIENT_ADDRESS, nowMillis);
+    }
+
+    // Spoofed addresses churn through the table, the penalized client keeps its entry.
+    uint32_t state = 0x9E3779B9;
+    for (int i = 0; i < 100000; i++)
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        limiter.admit(state | 1, nowMillis + i / 10);
+    }
+    TEST_ASSERT_TRUE(limiter.admit(CLIENT_ADDRESS, nowMillis + 10000) > 0);
+}
+
+struct FloodResult
+{
+    uint32_t admitted;
+    uint32_t rejected;
+    SchedulerTaskStats rf;
+    SchedulerTaskStats measurement;
+    uint32_t rfMissesAfterBurst;
+    uint32_t measurementMissesAfterBurst;
+};
+
+// A flood of /info requests from a subnet, a request waiting on every connection at every pass of the loop, next to
+// the periodic work of the assets: polling the RF receiver every 10 ms and measuring every second with the deadline
+// of the depth sensor.
+static FloodResult runFlood(bool limited, unsigned long durationMs)
+{
+    if (limited)
+    {
+        api.getRateLimiter().configure(RATE_LIMIT_CLIENT_REQUESTS_PER_MINUTE, RATE_LIMIT_CLIENT_BURST,
+                                       RATE_LIMIT_GLOBAL_REQUESTS_PER_MINUTE, RATE_LIMIT_GLOBAL_BURST);
+    }
+    else
+    {
+        api.getRateLimiter().configure(0, 0, 0, 0);
+    }
+
+    FloodResult result = {};
+    uint32_t nextAddress = 0;
+    MszScheduler scheduler;
+    int rfTaskId = scheduler.addPeriodicTask("rf", []() { delayMicroseconds(200); }, 10, MszScheduler::PRIORITY_HIGH, 10);
+    int measurementTaskId = scheduler.addPeriodicTask("measurement", []() { delayMicroseconds(1500); }, 1000, MszScheduler::PRIORITY_HIGH, 100);
+    scheduler.addContinuousTask("api", [&]() {
+        for (int pending = 0; pending < PENDING_REQUESTS; pending++)
+        {
+            server.remoteAddress = 0x0A000000 | (1 + nextAddress++ % 200);
+            server.request("GET", "/info");
+            if (server.statusCode == HTTP_TOO_MANY_REQUESTS_CODE)
+            {
+                result.rejected++;
+                delayMicroseconds(REJECTED_REQUEST_MICROS);
+            }
+            else
+            {
+                result.admitted++;
+                delayMicroseconds(ADMITTED_REQUEST_MICROS);
+            }
+        }
+    }, MszScheduler::PRIORITY_LOW);
+
+    unsigned long startMs = millis();
+    uint32_t rfMissesInBurst = 0;
+    uint32_t measurementMissesInBurst = 0;
+    while (millis() - startMs < durationMs)
+    {
+        scheduler.runPending();
+        delayMicroseconds(100);
+        if (millis() - startMs < BURST_MILLIS)
+        {
+            rfMissesInBurst = scheduler.getTaskStats(rfTaskId).deadlineMisses;
+            measurementMissesInBurst = scheduler.getTaskStats(measurementTaskId).deadlineMisses;
+        }
+    }
+    result.rf = scheduler.getTaskStats(rfTaskId);
+    result.measurement = scheduler.getTaskStats(measurementTaskId);
+    result.rfMissesAfterBurst = result.rf.deadlineMisses - rfMissesInBurst;
+    result.measurementMissesAfterBurst = result.measurement.deadlineMisses - measurementMissesInBurst;
+
+    char message[192];
+    snprintf(message, sizeof(message), "%-9s admitted %6u rejected %6u, rf runs %4u misses %4u skipped %4u late %2lu ms, measurement runs %3u misses %3u late %2lu ms",
+             limited ? "limited" : "unlimited", (unsigned int)result.admitted, (unsigned int)result.rejected,
+             (unsigned int)result.rf.runs, (unsigned int)result.rf.deadlineMisses, (unsigned int)result.rf.skippedPeriods, result.rf.maxLatenessMs,
+             (unsigned int)result.measurement.runs, (unsigned int)result.measurement.deadlineMisses, result.measurement.maxLatenessMs);
+    TEST_MESSAGE(message);
+    return result;
+}
+
+static void test_flood_keeps_scheduler_deadlines()
+{
+    const unsigned long durationMs = 60000;
+    FloodResult limited = runFlood(true, durationMs);
+
+    // The global bucket caps what reaches the handlers, the rest is turned away cheaply.
+    uint32_t globalLimit = RATE_LIMIT_GLOBAL_BURST + RATE_LIMIT_GLOBAL_REQUESTS_PER_MINUTE * durationMs / 60000;
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(globalLimit, limited.admitted);
+    TEST_ASSERT_TRUE(limited.rejected > 100 * limited.admitted);
+    TEST_ASSERT_EQUAL_UINT32(0, limited.rfMissesAfterBurst);
+    TEST_ASSERT_EQUAL_UINT32(0, limited.measurementMissesAfterBurst);
+    TEST_ASSERT_TRUE(limited.rf.runs + limited.rf.skippedPeriods >= durationMs / 10 - 1);
+    TEST_ASSERT_TRUE(limited.measurement.runs >= durationMs / 1000 - 1);
+
+    // While the burst is spent, a pass can still serve every pending request, that bounds the lateness and the
+    // periods skipped.
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(PENDING_REQUESTS * ADMITTED_REQUEST_MICROS / 1000 + 1, limited.rf.maxLatenessMs);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(RATE_LIMIT_GLOBAL_BURST / PENDING_REQUESTS, limited.rf.skippedPeriods);
+    TEST_ASSERT_EQUAL_UINT32(0, limited.measurement.deadlineMisses);
+
+    // Without admission control the same flood makes the RF polling miss its deadline in a large share of its runs.
+    FloodResult unlimited = runFlood(false, durationMs);
+    TEST_ASSERT_TRUE(unlimited.rfMissesAfterBurst > unlimited.rf.runs / 4);
+}
+
+int main(int argc, char **argv)
+{
+    api.begin(&secretHandler);
+
+    UNITY_BEGIN();
+    RUN_TEST(test_client_bucket_refills_at_its_rate);
+    RUN_TEST(test_global_bucket_limits_all_clients);
+    RUN_TEST(test_failed_authorizations_lead_to_penalty_box);
+    RUN_TEST(test_probe_window_evicts_least_recently_seen_client);
+    RUN_TEST(test_flood_of_addresses_keeps_penalized_client);
+    RUN_TEST(test_flood_keeps_scheduler_deadlines);
+    return UNITY_END();
+}
@@ -0,0 +1,237 @@
+#include <Arduino.h>
+#include <unity.h>
+#include "AssetApiBaseData.h"
+#include "AssetRecordCodec.h"
+
+// Encoding and decoding of stored records, and reading the raw struct dumps stored before the encoding existed.
+
+MSZ_RECORD_DEFINE(AssetMetadataParams, ASSET_METADATA_RECORD_VERSION, ASSET_METADATA_RECORD_FIELDS)
+
+// Nested records like the receive actions of the radio plug.
+struct TestAction
+{
+    int8_t actionType;
+    char switchName[16];
+    int repeatProtocol;
+};
+#define TEST_ACTION_FIELDS(FIELD)   \
+    FIELD(1, Int, actionType)       \
+    FIELD(2, String, switchName)    \
+    FIELD(3, Int, repeatProtocol)
+MSZ_RECORD_DEFINE(TestAction, 1, TEST_ACTION_FIELDS)
+
+struct TestReceive
+{
+    bool isTriState;
+    unsigned long receiveValue;
+    char topic[32];
+    TestAction actions[4];
+};
+#define TEST_RECEIVE_FIELDS(FIELD)       \
+    FIELD(1, Bool, isTriState)           \
+    FIELD(2, Unsigned, receiveValue)     \
+    FIELD(3, String, topic)              \
+    FIELD(4, Records, actions)
+MSZ_RECORD_DEFINE(TestReceive, 1, TEST_RECEIVE_FIELDS)
+
+// Two versions of one schema, the second adds a field and makes the string longer.
+struct TestV1
+{
+    int a;
+    char s[4];
+};
+#define TEST_V1_FIELDS(FIELD) FIELD(1, Int, a) FIELD(2, String, s)
+MSZ_RECORD_DEFINE(TestV1, 1, TEST_V1_FIELDS)
+
+struct TestV2
+{
+    int a;
+    char s[8];
+    int added;
+};
+#define TEST_V2_FIELDS(FIELD) FIELD(1, Int, a) FIELD(2, String, s) FIELD(9, Int, added)
+MSZ_RECORD_DEFINE(TestV2, 2, TEST_V2_FIELDS)
+
+static uint8_t buffer[1024];
+
+static TestReceive makeReceive()
+{
+    TestReceive receive;
+    memset(&receive, 0, sizeof(receive));
+    receive.receiveValue = 5393;
+    strcpy(receive.topic, "home/livingroom/remote/a");
+    receive.actions[0].actionType = 1;
+    strcpy(receive.actions[0].switchName, "lamp");
+    receive.actions[1].repeatProtocol = -3;
+    return receive;
+}
+
+void setUp()
+{
+    memset(buffer, 0, sizeof(buffer));
+}
+
+void tearDown()
+{
+}
+
+static void test_metadata_round_trip()
+{
+    AssetMetadataParams metadata;
+    memset((void *)&metadata, 0x5A, sizeof(metadata));
+    strcpy(metadata.sensorName, "radioplug-livingroom");
+    strcpy(metadata.sensorLocation, "Living room, shelf");
+    strcpy(metadata.sensorMqttServer, "mqtt.local");
+    metadata.sensorMqttPort = 1883;
+    strcpy(metadata.sensorMqttUsername, "plug");
+    strcpy(metadata.sensorMqttPassword, "s3cr3t-pass");
+
+    size_t length = encodeRecord(metadata, buffer, sizeof(buffer));
+    TEST_ASSERT_TRUE(length > 0);
+    TEST_ASSERT_TRUE(length < sizeof(metadata));
+    TEST_ASSERT_EQUAL_UINT8(MSZ_RECORD_MARKER, buffer[0]);
+
+    AssetMetadataParams decoded;
+    memset((void *)&decoded, 0, sizeof(decoded));
+    TEST_ASSERT_TRUE(decodeRecord(buffer, length, decoded) == MszRecordFormat::Encoded);
+    TEST_ASSERT_EQUAL_STRING(metadata.sensorName, decoded.sensorName);
+    TEST_ASSERT_EQUAL_STRING(metadata.sensorLocation, decoded.sensorLocation);
+    TEST_ASSERT_EQUAL_STRING(metadata.sensorMqttServer, decoded.sensorMqttServer);
+    TEST_ASSERT_EQUAL_INT(1883, decoded.sensorMqttPort);
+    TEST_ASSERT_EQUAL_STRING(metadata.sensorMqttUsername, decoded.sensorMqttUsername);
+    TEST_ASSERT_EQUAL_STRING(metadata.sensorMqttPassword, decoded.sensorMqttPassword);
+}
+
+static void test_nested_records_round_trip()
+{
+    TestReceive receive = makeReceive();
+    size_t length = encodeRecord(receive, buffer, sizeof(buffer));
+    TEST_ASSERT_TRUE(length > 0);
+
+    TestReceive decoded;
+    memset(&decoded, 0xEE, sizeof(decoded));
+    TEST_ASSERT_TRUE(decodeRecord(buffer, length, decoded) == MszRecordFormat::Encoded);
+    TEST_ASSERT_FALSE(decoded.isTriState);
+    TEST_ASSERT_EQUAL_UINT32(5393, decoded.receiveValue);
+    TEST_ASSERT_EQUAL_STRING(receive.topic, decoded.topic);
+    TEST_ASSERT_EQUAL_INT(1, decoded.actions[0].actionType);
+    TEST_ASSERT_EQUAL_STRING("lamp", decoded.actions[0].switchName);
+    TEST_ASSERT_EQUAL_INT(-3, decoded.actions[1].repeatProtocol);
+    TEST_ASSERT_EQUAL_INT(0, decoded.actions[3].actionType);
+    TEST_ASSERT_EQUAL_UINT8(0, decoded.actions[3].switchName[0]);
+}
+
+static void test_raw_dump_is_migrated()
+{
+    TestReceive receive = makeReceive();
+    TestReceive decoded;
+    TEST_ASSERT_TRUE(decodeRecord((const uint8_t *)&receive, sizeof(receive), decoded) == MszRecordFormat::Raw);
+    TEST_ASSERT_EQUAL_MEMORY(&receive, &decoded, sizeof(receive));
+
+    TEST_ASSERT_TRUE(decodeRecord((const uint8_t *)&receive, sizeof(receive) - 1, decoded) == MszRecordFormat::Invalid);
+    TEST_ASSERT_TRUE(decodeRecord((const uint8_t *)&receive, 0, decoded) == MszRecordFormat::Invalid);
+}
+
+static void test_raw_dump_starting_with_marker_is_migrated()
+{
+    // A name beginning with the marker byte makes the dump start like an encoded record.
+    AssetMetadataParams metadata;
+    memset((void *)&metadata, 0, sizeof(metadata));
+    metadata.sensorName[0] = (char)MSZ_RECORD_MARKER;
+    strcpy(metadata.sensorName + 1, "-sensor");
+    strcpy(metadata.sensorLocation, "cellar");
+    metadata.sensorMqttPort = 1883;
+    AssetMetadataParams decoded;
+    TEST_ASSERT_TRUE(decodeRecord((const uint8_t *)&metadata, sizeof(metadata), decoded) == MszRecordFormat::Raw);
+    TEST_ASSERT_EQUAL_MEMORY(&metadata, &decoded, sizeof(metadata));
+
+    // Also when the byte after the marker passes as a version, older or newer than the schema.
+    for (int version = 0; version < 256; version += 17)
+    {
+        metadata.sensorName[1] = (char)version;
+        memset((void *)&decoded, 0, sizeof(decoded));
+        TEST_ASSERT_TRUE(decodeRecord((const uint8_t *)&metadata, sizeof(metadata), decoded) == MszRecordFormat::Raw);
+        TEST_ASSERT_EQUAL_MEMORY(&metadata, &decoded, sizeof(metadata));
+    }
+}
+
+static void test_schema_evolution()
+{
+    // An older record read with the newer schema keeps the defaults of the added fields.
+    TestV1 v1 = {-7, "abc"};
+    size_t length = encodeRecord(v1, buffer, sizeof(buffer));
+    TestV2 v2 = {0, "", 42};
+    TEST_ASSERT_TRUE(decodeRecord(buffer, length, v2) == MszRecordFormat::Encoded);
+    TEST_ASSERT_EQUAL_INT(-7, v2.a);
+    TEST_ASSERT_EQUAL_STRING("abc", v2.s);
+    TEST_ASSERT_EQUAL_INT(42, v2.added);
+
+    // A newer record is not read with an older schema.
+    TestV2 newer = {1, "toolong", 5};
+    length = encodeRecord(newer, buffer, sizeof(buffer));
+    TestV1 older = {};
+    TEST_ASSERT_TRUE(decodeRecord(buffer, length, older) == MszRecordFormat::Invalid);
+
+    // Unknown fields are skipped and long strings cut when the version allows it.
+    buffer[1] = 1;
+    TEST_ASSERT_TRUE(decodeRecord(buffer, length, older) == MszRecordFormat::Encoded);
+    TEST_ASSERT_EQUAL_INT(1, older.a);
+    TEST_ASSERT_EQUAL_STRING("too", older.s);
+}
+
+static void test_truncated_records_and_small_buffers()
+{
+    TestReceive receive = makeReceive();
+    size_t length = encodeRecord(receive, buffer, sizeof(buffer));
+    for (size_t truncated = 0; truncated < length; truncated++)
+    {
+        TestReceive decoded = {};
+        MszRecordFormat format = decodeRecord(buffer, truncated, decoded);
+        TEST_ASSERT_TRUE(format != MszRecordFormat::Raw || truncated == sizeof(TestReceive));
+    }
+
+    // Encoding into a buffer that is too small reports 0 instead of a partial record.
+    for (size_t capacity = 0; capacity < length; capacity++)
+    {
+        TEST_ASSERT_EQUAL_UINT32(0, encodeRecord(receive, buffer, capacity));
+    }
+    TEST_ASSERT_EQUAL_UINT32(length, encodeRecord(receive, buffer, length));
+}
+
+static void test_random_bytes_decode_safely()
+{
+    uint32_t state = 0x9E3779B9;
+    uint8_t random[sizeof(TestReceive) + 16];
+    for (int round = 0; round < 200000; round++)
+    {
+        size_t length = round % sizeof(random);
+        for (size_t i = 0; i < length; i++)
+        {
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            random[i] = (uint8_t)state;
+        }
+        if (length > 0 && (round & 1))
+        {
+            random[0] = MSZ_RECORD_MARKER;
+        }
+        TestReceive decoded = {};
+        MszRecordFormat format = decodeRecord(random, length, decoded);
+        TEST_ASSERT_TRUE(format != MszRecordFormat::Raw || length == sizeof(TestReceive));
+        TEST_ASSERT_TRUE(strnlen(decoded.topic, sizeof(decoded.topic)) < sizeof(decoded.topic) || format == MszRecordFormat::Raw);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_metadata_round_trip);
+    RUN_TEST(test_nested_records_round_trip);
+    RUN_TEST(test_raw_dump_is_migrated);
+    RUN_TEST(test_raw_dump_starting_with_marker_is_migrated);
+    RUN_TEST(test_schema_evolution);
+    RUN_TEST(test_truncated_records_and_small_buffers);
+    RUN_TEST(test_random_bytes_decode_safely);
+    return UNITY_END();
+}
@@ -0,0 +1,200 @@
+#include <Arduino.h>
+#include <unity.h>
+#include <climits>
+#include <string>
+#include <vector>
+#include "AssetScheduler.h"
+
+// The scheduler runs on a fake clock here, each test sets the time and advances it explicitly.
+
+static unsigned long fakeNowMs = 0;
+
+static unsigned long fakeClock()
+{
+    return fakeNowMs;
+}
+
+// Advances the fake clock one millisecond at a time, calling runPending() like a busy loop() would.
+static void runFor(MszScheduler &scheduler, unsigned long durationMs)
+{
+    for (unsigned long i = 0; i < durationMs; i++)
+    {
+        fakeNowMs++;
+        scheduler.runPending();
+    }
+}
+
+void setUp()
+{
+    fakeNowMs = 1000;
+}
+
+void tearDown()
+{
+}
+
+static void test_periodic_task_runs_every_period()
+{
+    MszScheduler scheduler(fakeClock);
+    std::vector<unsigned long> runTimes;
+    int taskId = scheduler.addPeriodicTask("periodic", [&]() { runTimes.push_back(fakeNowMs); }, 10, MszScheduler::PRIORITY_NORMAL, 2);
+
+    runFor(scheduler, 100);
+    TEST_ASSERT_EQUAL_UINT32(10, runTimes.size());
+    for (size_t i = 0; i < runTimes.size(); i++)
+    {
+        TEST_ASSERT_EQUAL_UINT32(1010 + 10 * i, runTimes[i]);
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, scheduler.getTaskStats(taskId).deadlineMisses);
+    TEST_ASSERT_EQUAL_UINT32(0, scheduler.getTaskStats(taskId).maxLatenessMs);
+}
+
+static void test_wheel_wraps_with_the_clock()
+{
+    // The clock overflows in the middle, tasks are due on both sides and beyond a full wheel turn.
+    fakeNowMs = ULONG_MAX - 100;
+    MszScheduler scheduler(fakeClock);
+    unsigned long shortRuns = 0;
+    unsigned long longRuns = 0;
+    std::vector<unsigned long> oneShotTimes;
+    scheduler.addPeriodicTask("short", [&]() { shortRuns++; }, 7, MszScheduler::PRIORITY_NORMAL);
+    scheduler.addPeriodicTask("long", [&]() { longRuns++; }, SCHEDULER_WHEEL_SLOTS * 2 + 3, MszScheduler::PRIORITY_NORMAL);
+    scheduler.addOneShotTask("oneShot", [&]() { oneShotTimes.push_back(fakeNowMs); }, 150, MszScheduler::PRIORITY_NORMAL);
+
+    runFor(scheduler, 400);
+    TEST_ASSERT_EQUAL_UINT32(400 / 7, shortRuns);
+    TEST_ASSERT_EQUAL_UINT32(400 / (SCHEDULER_WHEEL_SLOTS * 2 + 3), longRuns);
+    TEST_ASSERT_EQUAL_UINT32(1, oneShotTimes.size());
+    TEST_ASSERT_TRUE(oneShotTimes[0] == ULONG_MAX - 100 + 150);
+}
+
+static void test_missed_periods_are_skipped()
+{
+    MszScheduler scheduler(fakeClock);
+    std::vector<unsigned long> runTimes;
+    int taskId = scheduler.addPeriodicTask("periodic", [&]() { runTimes.push_back(fakeNowMs); }, 10, MszScheduler::PRIORITY_NORMAL, 5);
+
+    // The loop stalls for 55 ms: the task runs once, late, and the periods at 1020..1050 are skipped.
+    fakeNowMs += 55;
+    scheduler.runPending();
+    const SchedulerTaskStats &stats = scheduler.getTaskStats(taskId);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.runs);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.deadlineMisses);
+    TEST_ASSERT_EQUAL_UINT32(45, stats.maxLatenessMs);
+    TEST_ASSERT_EQUAL_UINT32(4, stats.skippedPeriods);
+
+    // The period stays in phase.
+    runFor(scheduler, 20);
+    TEST_ASSERT_EQUAL_UINT32(3, runTimes.size());
+    TEST_ASSERT_EQUAL_UINT32(1060, runTimes[1]);
+    TEST_ASSERT_EQUAL_UINT32(1070, runTimes[2]);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.deadlineMisses);
+}
+
+static void test_long_callback_skips_periods()
+{
+    MszScheduler scheduler(fakeClock);
+    int taskId = scheduler.addPeriodicTask("slow", [&]() { fakeNowMs += 25; }, 10, MszScheduler::PRIORITY_NORMAL);
+
+    runFor(scheduler, 10);
+    TEST_ASSERT_EQUAL_UINT32(1, scheduler.getTaskStats(taskId).runs);
+    TEST_ASSERT_EQUAL_UINT32(2, scheduler.getTaskStats(taskId).skippedPeriods);
+
+    // 1035 now, next run at 1040 rather than right away for each missed period.
+    runFor(scheduler, 4);
+    TEST_ASSERT_EQUAL_UINT32(1, scheduler.getTaskStats(taskId).runs);
+    runFor(scheduler, 1);
+    TEST_ASSERT_EQUAL_UINT32(2, scheduler.getTaskStats(taskId).runs);
+}
+
+static void test_one_shot_runs_once_and_can_be_enabled_again()
+{
+    MszScheduler scheduler(fakeClock);
+    std::vector<unsigned long> runTimes;
+    int taskId = scheduler.addOneShotTask("oneShot", [&]() { runTimes.push_back(fakeNowMs); }, 20, MszScheduler::PRIORITY_NORMAL);
+
+    runFor(scheduler, 100);
+    TEST_ASSERT_EQUAL_UINT32(1, runTimes.size());
+    TEST_ASSERT_EQUAL_UINT32(1020, runTimes[0]);
+
+    // Enabling a one-shot that ran makes it due right away.
+    TEST_ASSERT_TRUE(scheduler.setTaskEnabled(taskId, true));
+    scheduler.runPending();
+    TEST_ASSERT_EQUAL_UINT32(2, runTimes.size());
+    TEST_ASSERT_EQUAL_UINT32(1100, runTimes[1]);
+    runFor(scheduler, 100);
+    TEST_ASSERT_EQUAL_UINT32(2, runTimes.size());
+
+    // Scheduling it again runs it once after the delay.
+    TEST_ASSERT_TRUE(scheduler.scheduleTask(taskId, 30));
+    runFor(scheduler, 100);
+    TEST_ASSERT_EQUAL_UINT32(3, runTimes.size());
+    TEST_ASSERT_EQUAL_UINT32(1230, runTimes[2]);
+}
+
+static void test_disabled_one_shot_does_not_run()
+{
+    MszScheduler scheduler(fakeClock);
+    int runs = 0;
+    int taskId = scheduler.addOneShotTask("oneShot", [&]() { runs++; }, 20, MszScheduler::PRIORITY_NORMAL);
+
+    TEST_ASSERT_TRUE(scheduler.setTaskEnabled(taskId, false));
+    runFor(scheduler, 100);
+    TEST_ASSERT_EQUAL_INT(0, runs);
+
+    TEST_ASSERT_TRUE(scheduler.setTaskEnabled(taskId, true));
+    scheduler.runPending();
+    TEST_ASSERT_EQUAL_INT(1, runs);
+}
+
+static void test_due_tasks_run_in_priority_order()
+{
+    MszScheduler scheduler(fakeClock);
+    std::string order;
+    scheduler.addPeriodicTask("low", [&]() { order += "L"; }, 10, MszScheduler::PRIORITY_LOW);
+    scheduler.addPeriodicTask("normal1", [&]() { order += "N"; }, 10, MszScheduler::PRIORITY_NORMAL);
+    scheduler.addContinuousTask("continuous", [&]() { order += "C"; }, MszScheduler::PRIORITY_NORMAL);
+    scheduler.addPeriodicTask("high", [&]() { order += "H"; }, 10, MszScheduler::PRIORITY_HIGH);
+    scheduler.addOneShotTask("oneShot", [&]() { order += "O"; }, 10, MszScheduler::PRIORITY_HIGH);
+    scheduler.addPeriodicTask("normal2", [&]() { order += "n"; }, 10, MszScheduler::PRIORITY_NORMAL);
+
+    // Only the continuous task is due before the period elapses.
+    fakeNowMs += 9;
+    TEST_ASSERT_EQUAL_INT(1, scheduler.runPending());
+    TEST_ASSERT_EQUAL_STRING("C", order.c_str());
+
+    // Equal priorities run in the order the tasks were added.
+    order.clear();
+    fakeNowMs += 1;
+    TEST_ASSERT_EQUAL_INT(6, scheduler.runPending());
+    TEST_ASSERT_EQUAL_STRING("HONCnL", order.c_str());
+}
+
+static void test_task_scheduled_by_callback_waits_for_next_pass()
+{
+    MszScheduler scheduler(fakeClock);
+    int followUpRuns = 0;
+    int followUpId = scheduler.addOneShotTask("followUp", [&]() { followUpRuns++; }, 1000, MszScheduler::PRIORITY_HIGH);
+    scheduler.addOneShotTask("trigger", [&]() { scheduler.scheduleTask(followUpId, 0); }, 5, MszScheduler::PRIORITY_LOW);
+
+    runFor(scheduler, 5);
+    TEST_ASSERT_EQUAL_INT(0, followUpRuns);
+    scheduler.runPending();
+    TEST_ASSERT_EQUAL_INT(1, followUpRuns);
+    runFor(scheduler, 2000);
+    TEST_ASSERT_EQUAL_INT(1, followUpRuns);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_periodic_task_runs_every_period);
+    RUN_TEST(test_wheel_wraps_with_the_clock);
+    RUN_TEST(test_missed_periods_are_skipped);
+    RUN_TEST(test_long_callback_skips_periods);
+    RUN_TEST(test_one_shot_runs_once_and_can_be_enabled_again);
+    RUN_TEST(test_disabled_one_shot_does_not_run);
+    RUN_TEST(test_due_tasks_run_in_priority_order);
+    RUN_TEST(test_task_scheduled_by_callback_waits_for_next_pass);
+    return UNITY_END();
+}
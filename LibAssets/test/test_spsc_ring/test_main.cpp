@@ -0,0 +1,161 @@
+#include <Arduino.h>
+#include <unity.h>
+#include <stdint.h>
+#include <thread>
+#include "AssetSpscRing.h"
+
+// MszSpscRing with a producer and a consumer thread: order, loss, overflow counting and the wrap-around of the
+// indexes at SIZE_MAX.
+
+static const uint32_t THREADED_ITEMS = 500000;
+static const size_t BATCH_SIZE = 8;
+
+// Several words like a received RF code, so an item read while it is written shows up as a mismatch.
+struct TestItem
+{
+    uint32_t sequence;
+    uint32_t check;
+    uint64_t timestamp;
+};
+
+static TestItem makeItem(uint32_t sequence)
+{
+    return {sequence, sequence * 2654435761u, (uint64_t)sequence << 20};
+}
+
+static bool isItem(const TestItem &item, uint32_t sequence)
+{
+    return item.sequence == sequence && item.check == sequence * 2654435761u && item.timestamp == (uint64_t)sequence << 20;
+}
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+static void test_full_ring_counts_overflow_and_keeps_items()
+{
+    MszSpscRing<TestItem, 8> ring;
+    TestItem item;
+    TEST_ASSERT_FALSE(ring.tryPop(item));
+
+    for (uint32_t i = 0; i < 8; i++)
+    {
+        TEST_ASSERT_TRUE(ring.tryPush(makeItem(i)));
+    }
+    TEST_ASSERT_FALSE(ring.tryPush(makeItem(8)));
+    TEST_ASSERT_FALSE(ring.tryPush(makeItem(9)));
+    TEST_ASSERT_EQUAL_UINT32(2, ring.getOverflowCount());
+
+    // The items queued before the overflow come out, the dropped ones do not.
+    TestItem batch[16];
+    TEST_ASSERT_EQUAL_UINT32(8, ring.popBatch(batch, 16));
+    for (uint32_t i = 0; i < 8; i++)
+    {
+        TEST_ASSERT_TRUE(isItem(batch[i], i));
+    }
+    TEST_ASSERT_FALSE(ring.tryPop(item));
+    TEST_ASSERT_TRUE(ring.tryPush(makeItem(10)));
+    TEST_ASSERT_TRUE(ring.tryPop(item));
+    TEST_ASSERT_TRUE(isItem(item, 10));
+}
+
+static void test_indexes_wrap_at_size_max()
+{
+    MszSpscRing<TestItem, 8> ring(SIZE_MAX - 3);
+    TestItem item;
+    uint32_t pushed = 0;
+    uint32_t popped = 0;
+
+    // Fill and drain across the wrap-around, a full ring must still be detected while head < tail numerically.
+    for (int round = 0; round < 4; round++)
+    {
+        while (ring.tryPush(makeItem(pushed)))
+        {
+            pushed++;
+        }
+        TEST_ASSERT_EQUAL_UINT32(popped + 8, pushed);
+        for (int i = 0; i < 5; i++)
+        {
+            TEST_ASSERT_TRUE(ring.tryPop(item));
+            TEST_ASSERT_TRUE(isItem(item, popped));
+            popped++;
+        }
+    }
+    while (ring.tryPop(item))
+    {
+        TEST_ASSERT_TRUE(isItem(item, popped));
+        popped++;
+    }
+    TEST_ASSERT_EQUAL_UINT32(pushed, popped);
+    TEST_ASSERT_EQUAL_UINT32(4, ring.getOverflowCount());
+}
+
+// The producer retries until each item fits, so every failed push is an overflow and nothing may go missing.
+static void runThreaded(size_t startIndex)
+{
+    MszSpscRing<TestItem, 64> *ring = new MszSpscRing<TestItem, 64>(startIndex);
+    uint32_t failedPushes = 0;
+
+    std::thread producer([ring, &failedPushes]() {
+        for (uint32_t sequence = 0; sequence < THREADED_ITEMS; sequence++)
+        {
+            while (!ring->tryPush(makeItem(sequence)))
+            {
+                failedPushes++;
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    uint32_t expected = 0;
+    uint32_t mismatches = 0;
+    TestItem batch[BATCH_SIZE];
+    while (expected < THREADED_ITEMS)
+    {
+        size_t popped = ring->popBatch(batch, BATCH_SIZE);
+        if (popped == 0)
+        {
+            std::this_thread::yield();
+        }
+        for (size_t i = 0; i < popped; i++)
+        {
+            mismatches += isItem(batch[i], expected) ? 0 : 1;
+            expected++;
+        }
+    }
+    producer.join();
+
+    char message[96];
+    snprintf(message, sizeof(message), "%u items, %u pushes found the ring full", (unsigned int)THREADED_ITEMS,
+             (unsigned int)failedPushes);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_EQUAL_UINT32(0, mismatches);
+    TEST_ASSERT_EQUAL_UINT32(failedPushes, ring->getOverflowCount());
+    TestItem item;
+    TEST_ASSERT_FALSE(ring->tryPop(item));
+    delete ring;
+}
+
+static void test_two_threads_keep_order_without_loss()
+{
+    runThreaded(0);
+}
+
+static void test_two_threads_across_the_wrap_around()
+{
+    runThreaded(SIZE_MAX - THREADED_ITEMS / 2);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_full_ring_counts_overflow_and_keeps_items);
+    RUN_TEST(test_indexes_wrap_at_size_max);
+    RUN_TEST(test_two_threads_keep_order_without_loss);
+    RUN_TEST(test_two_threads_across_the_wrap_around);
+    return UNITY_END();
+}
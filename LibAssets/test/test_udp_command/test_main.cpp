@@ -0,0 +1,322 @@
+#include <Arduino.h>
+#include <unity.h>
+#include <TimeLib.h>
+#include <time.h>
+#include <string>
+#include "SecretHandler.h"
+#include "AssetUdpCommandServer.h"
+#include "AssetUdpCommandClient.h"
+
+// The signed UDP command path on loopback: HMAC-SHA256 against the RFC 4231 vectors, the token check of the HTTP API,
+// and MszUdpCommandServer driven by MszUdpCommandClient, its signature check, truncation and nonce window.
+
+static const uint16_t TEST_PORT = 47210;
+static const int SECRET_ID = 0;
+static const char *SECRET = "pool-secret-for-the-tests";
+static const int RESPONSE_TIMEOUT_MILLIS = 200;
+// How long to wait for a response that must not come.
+static const int NO_RESPONSE_MILLIS = 20;
+
+/// @brief Exposes the counters of the server to the tests.
+class TestUdpCommandServer : public MszUdpCommandServer
+{
+public:
+    TestUdpCommandServer() : MszUdpCommandServer(TEST_PORT) {}
+
+    uint32_t getCommands() { return this->commandsMetric->get(); }
+    uint32_t getRejectedMalformed() { return this->rejectedMalformedMetric->get(); }
+    uint32_t getRejectedSignature() { return this->rejectedSignatureMetric->get(); }
+    uint32_t getRejectedReplay() { return this->rejectedReplayMetric->get(); }
+};
+
+static MszSecretHandler secretHandler;
+static TestUdpCommandServer *server;
+static std::string lastSwitchName;
+static uint32_t nextClientId = 1000;
+
+static std::string toHex(const uint8_t *bytes, size_t length)
+{
+    std::string hex;
+    char digits[3];
+    for (size_t i = 0; i < length; i++)
+    {
+        snprintf(digits, sizeof(digits), "%02x", bytes[i]);
+        hex += digits;
+    }
+    return hex;
+}
+
+static std::string hmacHex(const char *key, const char *data)
+{
+    MszSecretHandler handler;
+    handler.setSecret(0, key, strlen(key));
+    uint8_t output[MszSecretHandler::SIGNATURE_LENGTH];
+    TEST_ASSERT_TRUE(handler.computeSignature(0, (const uint8_t *)data, strlen(data), output));
+    return toHex(output, sizeof(output));
+}
+
+// Sends one command, lets the server run one pass and returns the status of the response.
+static int exchange(MszUdpCommandClient &client, uint8_t command, uint64_t nonce, const char *payload, int timeoutMillis = RESPONSE_TIMEOUT_MILLIS)
+{
+    TEST_ASSERT_TRUE(client.send(command, nonce, (const uint8_t *)payload, strlen(payload)));
+    server->loop();
+    return client.receive(command, nonce, timeoutMillis);
+}
+
+static uint64_t nonceAt(uint32_t seconds, uint32_t counter)
+{
+    return ((uint64_t)seconds << 32) | counter;
+}
+
+void setUp()
+{
+    // The nonces carry the host time, the virtual clock of the server starts from it.
+    setTime((time_t)::time(NULL));
+    lastSwitchName.clear();
+}
+
+void tearDown()
+{
+}
+
+static void test_hmac_sha256_rfc4231_vectors()
+{
+    // Test cases 1, 2 and 6 of RFC 4231, the last with a key longer than a block.
+    std::string key1(20, '\x0b');
+    TEST_ASSERT_EQUAL_STRING("b0344c61d8db38535ca8afceaf0bf12b881dc200c9833da726e9376c2e32cff7", hmacHex(key1.c_str(), "Hi There").c_str());
+    TEST_ASSERT_EQUAL_STRING("5bdcc146bf60754e6a042426089575c75a003f089d2739839dec58b964ec3843",
+                             hmacHex("Jefe", "what do ya want for nothing?").c_str());
+    std::string key6(131, '\xaa');
+    TEST_ASSERT_EQUAL_STRING("60e431591ee0b67f0d8a26aacbf5b77f8e0bc6213728c5140546040f0ee37f54",
+                             hmacHex(key6.c_str(), "Test Using Larger Than Block-Size Key - Hash Key First").c_str());
+
+    // Messages around the block and padding boundaries, checked against each other: signing must not depend on
+    // how the data is split into blocks, so equal content gives equal signatures and one changed byte changes them.
+    for (size_t length = 50; length < 140; length++)
+    {
+        std::string data(length, 'x');
+        std::string changed = data;
+        changed[length - 1] = 'y';
+        TEST_ASSERT_TRUE(hmacHex(SECRET, data.c_str()) == hmacHex(SECRET, data.c_str()));
+        TEST_ASSERT_FALSE(hmacHex(SECRET, data.c_str()) == hmacHex(SECRET, changed.c_str()));
+    }
+
+    uint8_t output[MszSecretHandler::SIGNATURE_LENGTH];
+    MszSecretHandler empty;
+    TEST_ASSERT_FALSE(empty.computeSignature(0, (const uint8_t *)"x", 1, output));
+    TEST_ASSERT_FALSE(secretHandler.computeSignature(5, (const uint8_t *)"x", 1, output));
+}
+
+static void test_signatures_equal_compares_every_byte()
+{
+    uint8_t expected[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+    uint8_t actual[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+    TEST_ASSERT_TRUE(MszSecretHandler::signaturesEqual(expected, actual, sizeof(actual)));
+    for (size_t i = 0; i < sizeof(actual); i++)
+    {
+        actual[i] ^= 0x10;
+        TEST_ASSERT_FALSE(MszSecretHandler::signaturesEqual(expected, actual, sizeof(actual)));
+        actual[i] ^= 0x10;
+    }
+}
+
+static void test_token_signature_of_the_http_api()
+{
+    long timestamp = (long)now() - 10;
+    std::string signature = hmacHex(SECRET, ("settime" + std::to_string(timestamp)).c_str());
+    TEST_ASSERT_TRUE(secretHandler.validateTokenSignature("settime", timestamp, SECRET_ID, signature.c_str(), 60));
+
+    // Expired, signed for another token, altered, truncated or checked against a missing secret.
+    TEST_ASSERT_FALSE(secretHandler.validateTokenSignature("settime", timestamp, SECRET_ID, signature.c_str(), 5));
+    TEST_ASSERT_FALSE(secretHandler.validateTokenSignature("switch", timestamp, SECRET_ID, signature.c_str(), 60));
+    std::string altered = signature;
+    altered[40] = (altered[40] == '0') ? '1' : '0';
+    TEST_ASSERT_FALSE(secretHandler.validateTokenSignature("settime", timestamp, SECRET_ID, altered.c_str(), 60));
+    TEST_ASSERT_FALSE(secretHandler.validateTokenSignature("settime", timestamp, SECRET_ID, signature.substr(0, 32).c_str(), 60));
+    TEST_ASSERT_FALSE(secretHandler.validateTokenSignature("settime", timestamp, 3, signature.c_str(), 60));
+    TEST_ASSERT_FALSE(secretHandler.validateTokenSignature("settime", timestamp, 5, signature.c_str(), 60));
+}
+
+static void test_signed_command_is_dispatched_and_answered()
+{
+    MszUdpCommandClient client(&secretHandler, SECRET_ID, nextClientId++);
+    TEST_ASSERT_TRUE(client.begin("127.0.0.1", TEST_PORT));
+    uint32_t commands = server->getCommands();
+
+    TEST_ASSERT_EQUAL_INT(UDP_STATUS_OK, exchange(client, UDP_COMMAND_SWITCH_ON, client.nextNonce(), "pool-pump"));
+    TEST_ASSERT_EQUAL_STRING("pool-pump", lastSwitchName.c_str());
+    TEST_ASSERT_EQUAL_INT(UDP_STATUS_NOT_FOUND, exchange(client, UDP_COMMAND_SWITCH_ON, client.nextNonce(), "garage"));
+    TEST_ASSERT_EQUAL_INT(UDP_STATUS_UNKNOWN_COMMAND, exchange(client, 0x33, client.nextNonce(), ""));
+    TEST_ASSERT_EQUAL_UINT32(commands + 3, server->getCommands());
+}
+
+static void test_bad_signatures_and_malformed_datagrams_are_dropped()
+{
+    MszUdpCommandClient client(&secretHandler, SECRET_ID, nextClientId++);
+    TEST_ASSERT_TRUE(client.begin("127.0.0.1", TEST_PORT));
+    uint32_t rejectedSignature = server->getRejectedSignature();
+    uint32_t rejectedMalformed = server->getRejectedMalformed();
+
+    // Signed with another secret.
+    MszSecretHandler otherSecret;
+    otherSecret.setSecret(SECRET_ID, "another-secret", 14);
+    MszUdpCommandClient intruder(&otherSecret, SECRET_ID, nextClientId++);
+    TEST_ASSERT_TRUE(intruder.begin("127.0.0.1", TEST_PORT));
+    TEST_ASSERT_EQUAL_INT(MszUdpCommandClient::STATUS_TIMEOUT, exchange(intruder, UDP_COMMAND_SWITCH_ON, intruder.nextNonce(), "pool-pump", NO_RESPONSE_MILLIS));
+    TEST_ASSERT_EQUAL_STRING("", lastSwitchName.c_str());
+
+    // Every single bit flipped in the truncated signature, header or payload.
+    uint8_t datagram[UDP_MAX_DATAGRAM_LENGTH];
+    size_t length = client.encode(UDP_COMMAND_SWITCH_ON, client.nextNonce(), (const uint8_t *)"pool-pump", 9, datagram);
+    TEST_ASSERT_EQUAL_UINT32(UDP_HEADER_LENGTH + 9 + UDP_SIGNATURE_LENGTH, length);
+    int flipped = 0;
+    for (size_t byte = 3; byte < length; byte++)
+    {
+        // Flipping magic, version and length bytes makes the datagram malformed instead, those are checked below.
+        if (byte == 16 || byte == 17)
+        {
+            continue;
+        }
+        for (int bit = 0; bit < 8; bit++)
+        {
+            datagram[byte] ^= (1 << bit);
+            // Sent as raw datagrams, the client would sign them again.
+            WiFiUDP raw;
+            TEST_ASSERT_TRUE(raw.begin(0));
+            raw.beginPacket(IPAddress(127, 0, 0, 1), TEST_PORT);
+            raw.write(datagram, length);
+            TEST_ASSERT_TRUE(raw.endPacket());
+            server->loop();
+            datagram[byte] ^= (1 << bit);
+            flipped++;
+        }
+    }
+    // Commands with the response flag set are treated as malformed before the signature is checked.
+    TEST_ASSERT_EQUAL_UINT32(rejectedSignature + 1 + flipped - 1, server->getRejectedSignature());
+    TEST_ASSERT_EQUAL_STRING("", lastSwitchName.c_str());
+
+    // Wrong magic, version, length fields and datagrams too short to hold a signature.
+    WiFiUDP raw;
+    TEST_ASSERT_TRUE(raw.begin(0));
+    size_t malformedSizes[] = {0, 1, 2, 16, 17};
+    for (size_t index : malformedSizes)
+    {
+        uint8_t broken[UDP_MAX_DATAGRAM_LENGTH];
+        memcpy(broken, datagram, length);
+        broken[index] ^= 0x01;
+        raw.beginPacket(IPAddress(127, 0, 0, 1), TEST_PORT);
+        raw.write(broken, length);
+        raw.endPacket();
+        server->loop();
+    }
+    raw.beginPacket(IPAddress(127, 0, 0, 1), TEST_PORT);
+    raw.write(datagram, UDP_HEADER_LENGTH + UDP_SIGNATURE_LENGTH - 1);
+    raw.endPacket();
+    server->loop();
+    TEST_ASSERT_EQUAL_UINT32(rejectedMalformed + 1 + 5 + 1, server->getRejectedMalformed());
+
+    // The untouched datagram is still accepted.
+    raw.beginPacket(IPAddress(127, 0, 0, 1), TEST_PORT);
+    raw.write(datagram, length);
+    raw.endPacket();
+    server->loop();
+    TEST_ASSERT_EQUAL_STRING("pool-pump", lastSwitchName.c_str());
+}
+
+static void test_nonce_window_rejects_replays()
+{
+    MszUdpCommandClient client(&secretHandler, SECRET_ID, nextClientId++);
+    TEST_ASSERT_TRUE(client.begin("127.0.0.1", TEST_PORT));
+    uint32_t seconds = (uint32_t)now();
+    uint32_t rejectedReplay = server->getRejectedReplay();
+
+    TEST_ASSERT_EQUAL_INT(UDP_STATUS_OK, exchange(client, UDP_COMMAND_SWITCH_ON, nonceAt(seconds, 100), "pool-pump"));
+    // The same nonce again.
+    TEST_ASSERT_EQUAL_INT(MszUdpCommandClient::STATUS_TIMEOUT, exchange(client, UDP_COMMAND_SWITCH_ON, nonceAt(seconds, 100), "pool-pump", NO_RESPONSE_MILLIS));
+    // Reordered within the window of 64 nonces, once each.
+    TEST_ASSERT_EQUAL_INT(UDP_STATUS_OK, exchange(client, UDP_COMMAND_SWITCH_OFF, nonceAt(seconds, 40), "pool-pump"));
+    TEST_ASSERT_EQUAL_INT(MszUdpCommandClient::STATUS_TIMEOUT, exchange(client, UDP_COMMAND_SWITCH_OFF, nonceAt(seconds, 40), "pool-pump", NO_RESPONSE_MILLIS));
+    // Behind the window.
+    TEST_ASSERT_EQUAL_INT(MszUdpCommandClient::STATUS_TIMEOUT, exchange(client, UDP_COMMAND_SWITCH_OFF, nonceAt(seconds, 36), "pool-pump", NO_RESPONSE_MILLIS));
+    // Too old or too far ahead of the clock of the asset, for a client the asset has not seen yet too.
+    uint32_t maxAge = MszUdpCommandServer::UDP_MAX_NONCE_AGE_SECONDS;
+    TEST_ASSERT_EQUAL_INT(MszUdpCommandClient::STATUS_TIMEOUT, exchange(client, UDP_COMMAND_SWITCH_ON, nonceAt(seconds - maxAge - 1, 500), "pool-pump", NO_RESPONSE_MILLIS));
+    TEST_ASSERT_EQUAL_INT(MszUdpCommandClient::STATUS_TIMEOUT, exchange(client, UDP_COMMAND_SWITCH_ON, nonceAt(seconds + maxAge + 1, 1), "pool-pump", NO_RESPONSE_MILLIS));
+    MszUdpCommandClient newcomer(&secretHandler, SECRET_ID, nextClientId++);
+    TEST_ASSERT_TRUE(newcomer.begin("127.0.0.1", TEST_PORT));
+    TEST_ASSERT_EQUAL_INT(MszUdpCommandClient::STATUS_TIMEOUT, exchange(newcomer, UDP_COMMAND_SWITCH_ON, nonceAt(seconds - maxAge - 1, 1), "pool-pump", NO_RESPONSE_MILLIS));
+    TEST_ASSERT_EQUAL_UINT32(rejectedReplay + 6, server->getRejectedReplay());
+
+    // A client using the same id gets no second window.
+    MszUdpCommandClient sameId(&secretHandler, SECRET_ID, client.getClientId());
+    TEST_ASSERT_TRUE(sameId.begin("127.0.0.1", TEST_PORT));
+    TEST_ASSERT_EQUAL_INT(MszUdpCommandClient::STATUS_TIMEOUT, exchange(sameId, UDP_COMMAND_SWITCH_ON, nonceAt(seconds, 100), "pool-pump", NO_RESPONSE_MILLIS));
+    TEST_ASSERT_EQUAL_INT(UDP_STATUS_OK, exchange(sameId, UDP_COMMAND_SWITCH_ON, nonceAt(seconds, 101), "pool-pump"));
+}
+
+static void test_time_beacons_do_not_fill_the_client_table()
+{
+    // A gateway sending every beacon from a new process, so with a new client id, more often than clients expire.
+    uint32_t seconds = (uint32_t)now();
+    uint8_t payload[8];
+    uint64_t unixMillis = (uint64_t)seconds * 1000;
+    for (int i = 0; i < 8; i++)
+    {
+        payload[i] = (uint8_t)(unixMillis >> (56 - 8 * i));
+    }
+    uint64_t lastBeaconNonce = 0;
+    for (int beacon = 0; beacon < 3 * MAX_UDP_CLIENTS; beacon++)
+    {
+        MszUdpCommandClient gateway(&secretHandler, SECRET_ID, nextClientId++);
+        TEST_ASSERT_TRUE(gateway.begin("127.0.0.1", TEST_PORT));
+        lastBeaconNonce = nonceAt(seconds, 1000 + beacon);
+        TEST_ASSERT_TRUE(gateway.send(UDP_COMMAND_TIME, lastBeaconNonce, payload, sizeof(payload)));
+        server->loop();
+        TEST_ASSERT_EQUAL_INT(UDP_STATUS_OK, gateway.receive(UDP_COMMAND_TIME, lastBeaconNonce, RESPONSE_TIMEOUT_MILLIS));
+    }
+
+    // Commands of new clients are still accepted.
+    MszUdpCommandClient client(&secretHandler, SECRET_ID, nextClientId++);
+    TEST_ASSERT_TRUE(client.begin("127.0.0.1", TEST_PORT));
+    TEST_ASSERT_EQUAL_INT(UDP_STATUS_OK, exchange(client, UDP_COMMAND_SWITCH_ON, client.nextNonce(), "pool-pump"));
+
+    // An old time nonce is rejected whichever client sends it, so is the last one again.
+    uint32_t rejectedReplay = server->getRejectedReplay();
+    MszUdpCommandClient replayer(&secretHandler, SECRET_ID, nextClientId++);
+    TEST_ASSERT_TRUE(replayer.begin("127.0.0.1", TEST_PORT));
+    TEST_ASSERT_TRUE(replayer.send(UDP_COMMAND_TIME, nonceAt(seconds, 1000), payload, sizeof(payload)));
+    TEST_ASSERT_TRUE(replayer.send(UDP_COMMAND_TIME, lastBeaconNonce, payload, sizeof(payload)));
+    server->loop();
+    TEST_ASSERT_EQUAL_INT(MszUdpCommandClient::STATUS_TIMEOUT, replayer.receive(UDP_COMMAND_TIME, lastBeaconNonce, NO_RESPONSE_MILLIS));
+    TEST_ASSERT_EQUAL_UINT32(rejectedReplay + 2, server->getRejectedReplay());
+}
+
+int main(int argc, char **argv)
+{
+    secretHandler.setSecret(SECRET_ID, SECRET, strlen(SECRET));
+    server = new TestUdpCommandServer();
+    server->registerCommand(UDP_COMMAND_SWITCH_ON, [](const uint8_t *payload, size_t length) {
+        std::string name((const char *)payload, length);
+        if (name != "pool-pump")
+        {
+            return (uint8_t)UDP_STATUS_NOT_FOUND;
+        }
+        lastSwitchName = name;
+        return (uint8_t)UDP_STATUS_OK;
+    });
+    server->registerCommand(UDP_COMMAND_SWITCH_OFF, [](const uint8_t *payload, size_t length) {
+        lastSwitchName = std::string((const char *)payload, length);
+        return (uint8_t)UDP_STATUS_OK;
+    });
+    server->begin(&secretHandler, SECRET_ID);
+
+    UNITY_BEGIN();
+    RUN_TEST(test_hmac_sha256_rfc4231_vectors);
+    RUN_TEST(test_signatures_equal_compares_every_byte);
+    RUN_TEST(test_token_signature_of_the_http_api);
+    RUN_TEST(test_signed_command_is_dispatched_and_answered);
+    RUN_TEST(test_bad_signatures_and_malformed_datagrams_are_dropped);
+    RUN_TEST(test_nonce_window_rejects_replays);
+    RUN_TEST(test_time_beacons_do_not_fill_the_client_table);
+    return UNITY_END();
+}
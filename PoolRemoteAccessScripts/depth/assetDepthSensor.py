@@ -55,14 +55,14 @@ def update_depth_sensor_config(sensor_ip, headers, config):
 #
 def get_depth_sensor_measurements(sensor_ip, headers):
     mszutl.logIfTurnedOn("[Depth Measurements] Getting depth sensor measurements...")
-    response = mszutl.call_endpoint(sensor_ip, headers, 'measurements', '', verb='GET')
+    response = mszutl.call_endpoint(sensor_ip, headers, 'measurements', '', verb='GET', accept=mszutl.MSGPACK_CONTENT_TYPE)
 
     mszutl.logIfTurnedOn("[Depth Measurements] Response status code: {}".format(response.status_code))
-    mszutl.logIfTurnedOn("[Depth Measurements] Response body:")
+    mszutl.logIfTurnedOn("[Depth Measurements] Response body ({} bytes):".format(len(response.content)))
 
-    # Parse the response
+    # Parse the response, the measurement list is requested as MessagePack to save bytes on the wire
     if response.status_code == 200:
-        measurements = dentities.DepthSensorMeasurementCollection.from_json(response.text)
+        measurements = dentities.DepthSensorMeasurementCollection.from_dict(mszutl.decode_response_body(response))
         for m in measurements.measurements:
             # Rewrite the measureTime which is in ticks to formatted date using YYYY-mm-dd HH:MM:SS
             m.measureTime = datetime.datetime.fromtimestamp(m.measureTime).strftime("%Y-%m-%d %H:%M:%S")
@@ -1 +1 @@
-$HOME/depth/pyenv/bin/python $HOME/depth/assetDepthSensor.py --ip $depthIp --secret $depthSecret settime
+$HOME/depth/pyenv/bin/python $HOME/depth/assetUdpCommand.py --ip ${beaconIp:-255.255.255.255} --secret $depthSecret beacon
@@ -6,6 +6,12 @@
 #define MAX_SWITCH_NAME_LENGTH 64
 #define MAX_SWITCH_COMMAND_LENGTH 64
 #define MAX_SWITCH_MQTT_TOPIC_LENGTH 128
+#define MAX_SWITCH_RECEIVE_ACTIONS 4
+
+#define SWITCH_RECEIVE_ACTION_NONE 0
+#define SWITCH_RECEIVE_ACTION_SWITCH_ON 1
+#define SWITCH_RECEIVE_ACTION_SWITCH_OFF 2
+#define SWITCH_RECEIVE_ACTION_REPEAT 3
 
 /// @brief Defines the parameters for the Switch
 /// @details Defines a unique ID for the switch such that the config can be updated, a name, and the command.
@@ -22,12 +28,84 @@ struct SwitchDataParams
   int repeatTransmit;
 };
 
+// Stored fields of the switch structs, the codecs are generated from them with MSZ_RECORD_DEFINE.
+#define SWITCH_DATA_RECORD_VERSION 1
+#define SWITCH_DATA_RECORD_FIELDS(FIELD) \
+  FIELD(1, Bool, isTriState)             \
+  FIELD(2, Int, switchProtocol)          \
+  FIELD(3, String, switchName)           \
+  FIELD(4, String, switchOnCommand)      \
+  FIELD(5, String, switchOffCommand)     \
+  FIELD(6, Int, pulseLength)             \
+  FIELD(7, Int, repeatTransmit)
+
+/// @brief Local action executed on the device itself when a configured RF code is received.
+/// @details SWITCH_RECEIVE_ACTION_SWITCH_ON and _SWITCH_OFF turn the configured switch switchName on or off.
+///          SWITCH_RECEIVE_ACTION_REPEAT re-transmits the received code with repeatProtocol and repeatPulseLength,
+///          a repeatPulseLength of 0 uses the default pulse length.
+struct SwitchReceiveAction
+{
+  int actionType;
+  char switchName[MAX_SWITCH_NAME_LENGTH+1];
+  int repeatProtocol;
+  int repeatPulseLength;
+};
+
+#define SWITCH_RECEIVE_ACTION_RECORD_VERSION 1
+#define SWITCH_RECEIVE_ACTION_RECORD_FIELDS(FIELD) \
+  FIELD(1, Int, actionType)                        \
+  FIELD(2, String, switchName)                     \
+  FIELD(3, Int, repeatProtocol)                    \
+  FIELD(4, Int, repeatPulseLength)
+
+/// @brief Defines what happens when an RF code is received.
+/// @details The local actions run right away in the device and do not depend on the network. If switchTopic is
+///          not empty, switchCommand is published to it via MQTT afterwards. Unused actions are ACTION_NONE.
 struct SwitchReceiveParams
 {
   unsigned int switchProtocol;
   unsigned long switchReceiveDecimalValue;
   char switchTopic[MAX_SWITCH_MQTT_TOPIC_LENGTH+1];
   char switchCommand[MAX_SWITCH_COMMAND_LENGTH+1];
+  SwitchReceiveAction actions[MAX_SWITCH_RECEIVE_ACTIONS];
+};
+
+#define SWITCH_RECEIVE_RECORD_VERSION 1
+#define SWITCH_RECEIVE_RECORD_FIELDS(FIELD)     \
+  FIELD(1, Unsigned, switchProtocol)            \
+  FIELD(2, Unsigned, switchReceiveDecimalValue) \
+  FIELD(3, String, switchTopic)                 \
+  FIELD(4, String, switchCommand)               \
+  FIELD(5, Records, actions)
+
+/// @brief Receive parameters as stored before local actions existed, only used for migrating stored data.
+struct SwitchReceiveParamsLegacy
+{
+  unsigned int switchProtocol;
+  unsigned long switchReceiveDecimalValue;
+  char switchTopic[MAX_SWITCH_MQTT_TOPIC_LENGTH+1];
+  char switchCommand[MAX_SWITCH_COMMAND_LENGTH+1];
+};
+
+/// @brief RF code as received by the radio.
+/// @details Queued by the receive poll and handed to the lookup of the receive parameters and the MQTT publishing.
+///          pulseLength is the pulse length RCSwitch measured in microseconds, receivedMicros the time of the poll
+///          that picked the code up.
+struct SwitchReceivedCode
+{
+  unsigned long value;
+  unsigned int protocol;
+  unsigned int bitLength;
+  unsigned int pulseLength;
+  unsigned long receivedMicros;
+};
+
+/// @brief Request to send the on or off command of a switch via RF.
+/// @details Carries the loaded switch data so the radio does not need to access the file system.
+struct SwitchTransmitRequest
+{
+  SwitchDataParams switchData;
+  bool switchOn;
 };
 
 #endif // SWITCHDATA_H
\ No newline at end of file
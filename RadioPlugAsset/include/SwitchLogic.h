@@ -4,22 +4,49 @@
 #include <Arduino.h>
 #include <RCSwitch.h>
 #include <SecretHandler.h>
-#include <PubSubClient.h>
-#include <WifiClient.h>
+#include <Ticker.h>
+#include <unordered_map>
 #include "SwitchData.h"
 #include "AssetApiBaseData.h"
+#include "AssetMetrics.h"
 #include "SwitchRepository.h"
+#include "SwitchReceiveFilter.h"
+#include "SwitchMqtt.h"
+#include "AssetSpscRing.h"
+#if defined(MSZ_DUAL_CORE)
+#include "AssetBoundedQueue.h"
+#endif
 
+#define SWITCH_RECEIVE_QUEUE_SIZE 16
+#define SWITCH_TRANSMIT_QUEUE_SIZE 8
+#define SWITCH_MQTT_LONG_PRESS_SUFFIX "/longpress"
+
+/// @class MszSwitchLogic
+/// @brief Sends switch commands via RF and forwards received RF codes to MQTT.
+/// @details A timer polls the RF receiver every millisecond and queues received codes in a lock-free ring, so codes
+///          are not lost while the loop is busy. handleSwitchReceiveData() drains that ring in batches and drops the
+///          repeats of a button press before looking up the receive parameters or publishing anything via MQTT.
+///          The local actions of a received code (switching configured switches, repeating the code on another
+///          protocol) run before the MQTT publishing and work without network. A long press, if enabled, only
+///          publishes to the "/longpress" sub-topic of the configured topic.
+///          All MQTT traffic goes through one persistent session kept alive by handleMqtt(). With
+///          MSZ_SWITCH_MQTT_COMMANDS, switches are also switched via MQTT and every switch publishes its state.
+///          Single-core builds transmit right in toggleSwitch(). With MSZ_DUAL_CORE, handleRadio() runs on the
+///          realtime core and transmits the switch commands queued by the network core.
 class MszSwitchLogic
 {
 public:
     MszSwitchLogic();
 
+    void beginReceive();
     void handleSwitchReceiveData();
-    int toggleSwitch(String switchName, bool switchOn);
+    void handleMqtt();
+    int toggleSwitch(String switchName, bool switchOn, RequestTimings *timings = NULL);
+
+#if defined(MSZ_DUAL_CORE)
+    void handleRadio();
+#endif
 
-    static const int SWITCH_MAX_MQTTCONNECT_ATTEMPTS = 5;
-    
     static const int RCSWITCH_RECEIVE_PORT = 19;
     static const int RCSWITCH_SEND_PORT = 23;
     static const int RCSWITCH_DATA_PULSE_LENGTH = 512;
@@ -27,13 +54,41 @@ public:
     static const int RCSWITCH_REPEAT_TRANSMIT = 10;
     static const int RCSWITCH_BIT_LENGTH = 24;
 
+    // RCSwitch keeps a single received code only, and even short codes take more than 20ms on the air,
+    // so polling it every millisecond catches every code.
+    static const uint32_t RECEIVE_POLL_INTERVAL_MS = 1;
+    static const size_t RECEIVE_BATCH_SIZE = 8;
+
     static const int SWITCH_TOGGLE_SWITCHEDON = 1;
     static const int SWITCH_TOGGLE_SWITCHEDOFF = 0;
     static const int SWITCH_TOGGLE_NOTFOUND = -1;
+    static const int SWITCH_TOGGLE_BUSY = -2;
 
 protected:
     RCSwitch rcHandler;
-    WiFiClient wifiClient;
+    MszSwitchMqtt mqtt;
+
+    Ticker receivePollTicker;
+    MszSpscRing<SwitchReceivedCode, SWITCH_RECEIVE_QUEUE_SIZE> receiveRing;
+    MszSwitchReceiveFilter receiveFilter;
+#if defined(MSZ_DUAL_CORE)
+    MszBoundedQueue<SwitchTransmitRequest, SWITCH_TRANSMIT_QUEUE_SIZE> transmitQueue;
+#endif
+
+    static void pollReceiver(MszSwitchLogic *switchLogic);
+    void pollReceivedCode();
+    void processReceivedCode(const SwitchReceivedCode &receivedCode, bool longPress, std::unordered_map<int, SwitchReceiveParams> &savedReceiveParams);
+    void runReceiveActions(const SwitchReceivedCode &receivedCode, const SwitchReceiveParams &receiveParams);
+    bool dispatchTransmit(const SwitchDataParams &switchData, bool switchOn);
+    void transmit(const SwitchDataParams &switchData, bool switchOn);
+
+    MszCounter *rfCodesReceivedMetric;
+    MszCounter *rfReceiveOverflowsMetric;
+    MszCounter *rfRepeatsSuppressedMetric;
+    MszCounter *rfCodesMatchedMetric;
+    MszCounter *rfTransmitsMetric;
+    MszCounter *receiveActionsMetric;
+    MszCounter *mqttPublishFailuresMetric;
 };
 
 #endif // MSZ_SWITCHLOGIC_H
\ No newline at end of file
@@ -0,0 +1,58 @@
+#ifndef MSZ_SWITCHMQTT_H
+#define MSZ_SWITCHMQTT_H
+
+#include <Arduino.h>
+#include <functional>
+#include <PubSubClient.h>
+#include <WifiClient.h>
+#include "AssetApiBaseData.h"
+#include "AssetResourceVersions.h"
+
+/// @brief Called for a switch command received via MQTT, returns one of the MszSwitchLogic::SWITCH_TOGGLE_* values.
+typedef std::function<int(const String &switchName, bool switchOn)> SwitchMqttCommandHandler;
+
+/// @class MszSwitchMqtt
+/// @brief Keeps one MQTT session to the broker configured in the asset metadata open.
+/// @details loop() keeps the session alive and reconnects with an increasing back-off, it never blocks for longer
+///          than a single connection attempt. Whenever the metadata is saved, the session is closed and the next
+///          reconnect uses the new broker settings.
+///          When built with MSZ_SWITCH_MQTT_COMMANDS, the session subscribes to "<sensorName>/+/set". A payload of
+///          "on" or "off" sent to "<sensorName>/<switchName>/set" is handed to the command handler, the switch
+///          logic publishes the resulting state retained to "<sensorName>/<switchName>/state". Commands rely on the
+///          authentication of the broker instead of the HMAC of the HTTP API, hence they are opt-in.
+class MszSwitchMqtt
+{
+public:
+    MszSwitchMqtt();
+
+    void setCommandHandler(SwitchMqttCommandHandler handler);
+    void loop();
+    bool publish(const char *topic, const char *payload, bool retained = false);
+    void publishSwitchState(const String &switchName, bool switchOn);
+
+    static constexpr const char *TOPIC_COMMAND_SUFFIX = "/set";
+    static constexpr const char *TOPIC_STATE_SUFFIX = "/state";
+    static constexpr const char *PAYLOAD_ON = "on";
+    static constexpr const char *PAYLOAD_OFF = "off";
+
+    static const unsigned long RECONNECT_MIN_INTERVAL_MS = 2000;
+    static const unsigned long RECONNECT_MAX_INTERVAL_MS = 60000;
+    static const uint16_t KEEP_ALIVE_SECONDS = 30;
+
+protected:
+    WiFiClient wifiClient;
+    PubSubClient mqttClient;
+    SwitchMqttCommandHandler commandHandler;
+
+    AssetMetadataParams metadata;
+    bool metadataLoaded;
+    uint32_t metadataGeneration;
+    unsigned long lastConnectAttemptMs;
+    unsigned long reconnectIntervalMs;
+
+    bool refreshMetadata();
+    bool connect();
+    void handleMessage(char *topic, uint8_t *payload, unsigned int length);
+};
+
+#endif // MSZ_SWITCHMQTT_H
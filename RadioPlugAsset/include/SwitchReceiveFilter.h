@@ -0,0 +1,53 @@
+#ifndef MSZ_SWITCHRECEIVEFILTER_H
+#define MSZ_SWITCHRECEIVEFILTER_H
+
+#include <Arduino.h>
+#include "SwitchData.h"
+
+// Repeats of the same code and protocol closer together than this belong to the same button press.
+#ifndef SWITCH_RECEIVE_DEDUP_WINDOW_MS
+#define SWITCH_RECEIVE_DEDUP_WINDOW_MS 300
+#endif
+
+// A press whose repeats keep coming for this long is reported once more as long press, 0 disables it.
+#ifndef SWITCH_RECEIVE_LONG_PRESS_MS
+#define SWITCH_RECEIVE_LONG_PRESS_MS 0
+#endif
+
+#define SWITCH_RECEIVE_FILTER_SLOTS 8
+
+/// @class MszSwitchReceiveFilter
+/// @brief Collapses the repeats a remote sends per button press into a single press event.
+/// @details Keeps a tiny fixed table of the codes seen last, keyed by code and protocol. A code counts as new press
+///          if it was not seen within the de-duplication window, every repeat within the window extends the press.
+///          If long press detection is enabled, a press lasting longer than the long press time is reported once
+///          more as long press. When all slots are in use, the slot seen least recently is reused.
+class MszSwitchReceiveFilter
+{
+public:
+    MszSwitchReceiveFilter(unsigned long windowMs = SWITCH_RECEIVE_DEDUP_WINDOW_MS,
+                           unsigned long longPressMs = SWITCH_RECEIVE_LONG_PRESS_MS);
+
+    int filter(const SwitchReceivedCode &receivedCode);
+
+    static const int RECEIVE_EVENT_REPEAT = 0;
+    static const int RECEIVE_EVENT_PRESS = 1;
+    static const int RECEIVE_EVENT_LONG_PRESS = 2;
+
+private:
+    struct PressSlot
+    {
+        bool inUse;
+        bool longPressReported;
+        unsigned long value;
+        unsigned int protocol;
+        unsigned long firstSeenMicros;
+        unsigned long lastSeenMicros;
+    };
+
+    unsigned long windowMicros;
+    unsigned long longPressMicros;
+    PressSlot slots[SWITCH_RECEIVE_FILTER_SLOTS];
+};
+
+#endif // MSZ_SWITCHRECEIVEFILTER_H
@@ -13,7 +13,10 @@ public:
   MszSwitchRepository();
 
   static constexpr const char *SWITCH_FILENAME_PREFIX = "/swf";
-  static constexpr const char *SWITCH_FILENAME_RECEIVE_FILENAME = "/swr";
+  // Receive data is stored one record per entry, keyed by the decimal code, so changing one entry writes only that one.
+  static constexpr const char *SWITCH_RECEIVE_ENTRY_PREFIX = "/swr3/";
+  static constexpr const char *SWITCH_FILENAME_RECEIVE_FILENAME = "/swr2";
+  static constexpr const char *SWITCH_FILENAME_RECEIVE_LEGACY_FILENAME = "/swr";
 
   static const int SWITCH_MAX_RECEIVE_ENTRIES = 32;
 
@@ -23,6 +26,10 @@ public:
 
   std::unordered_map<int, SwitchReceiveParams> loadSwitchReceiveData();
   bool saveSwitchReceiveData(std::unordered_map<int, SwitchReceiveParams> receiveParams);
+
+private:
+  std::unordered_map<int, SwitchReceiveParams> loadSwitchReceiveFile();
+  std::unordered_map<int, SwitchReceiveParams> loadLegacySwitchReceiveData();
 };
 
 #endif // MSZ_SWITCHREPOSITORY_H
\ No newline at end of file
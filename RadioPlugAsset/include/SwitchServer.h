@@ -8,9 +8,12 @@
 #include "SwitchData.h"
 #include "SwitchRepository.h"
 
+#define SWITCH_API_ROUTE_SLOTS 8
+
 /// @class MszSwitchWebApi
 /// @brief Switch Web Server class handling on/off requests.
-/// @details This class handles the web server which is used to turn on and off radio switches.
+/// @details This class handles the web server which is used to turn on and off radio switches, it is served through
+///          MszAssetApiServer with the web server backend the build flags select.
 class MszSwitchWebApi
 : public MszAssetApiBase
 {
@@ -25,6 +28,9 @@ public:
   static constexpr const char *API_ENDPOINT_UPDATESWITCHDATA = "/updateswitchdata";
   static constexpr const char *API_ENDPOINT_UPDATESWITCHRECEIVE = "/updateswitchreceive";
 
+  static const MszApiRoute ROUTES[];
+  static const MszApiRouteTable<SWITCH_API_ROUTE_SLOTS> ROUTE_TABLE;
+
   static constexpr const char *API_PARAM_SWITCHID = "switchid";
   static constexpr const char *API_PARAM_SWITCHNAME = "switchname";
   static constexpr const char *API_PARAM_SWITCHCOMMAND = "switchcommand";
@@ -42,6 +48,12 @@ public:
   static constexpr const char *PARAM_RECEIVE_PROTOCOL = "recprot";
   static constexpr const char *PARAM_RECEIVE_TOPIC = "rectopic";
   static constexpr const char *PARAM_RECEIVE_COMMAND = "reccmd";
+  static constexpr const char *PARAM_RECEIVE_ACTIONS = "recactions";
+
+  // Local actions are passed comma-separated, e.g. "on:lamp,off:fan,repeat:1:350" (repeat:<protocol>[:<pulselength>]).
+  static constexpr const char *RECEIVE_ACTION_SWITCH_ON = "on";
+  static constexpr const char *RECEIVE_ACTION_SWITCH_OFF = "off";
+  static constexpr const char *RECEIVE_ACTION_REPEAT = "repeat";
 
   static const int HTTP_AUTH_SECRET_ID = 0;
   static const int TOKEN_EXPIRATION_SECONDS = 60;
@@ -60,19 +72,20 @@ protected:
    * The configuration method is overridden by the specific API servers such as this SwitchServer
    */
   virtual void beginCfg() override;
+  virtual const MszApiRoute *findRoute(MszHttpMethod method, const char *path) override;
 
   /*
-   * The methods below contain the library-specific request handling. They call the corresponding
-   * core-methods which are library independent.
+   * The request handlers, called through the route table once a request is authorized.
    */
-  void handleSwitchOn();
-  void handleSwitchOff();
-  void handleUpdateSwitchData();
-  void handleUpdateSwitchReceive();
+  CoreHandlerResponse handleSwitchOn();
+  CoreHandlerResponse handleSwitchOff();
+  CoreHandlerResponse handleUpdateSwitchData();
+  CoreHandlerResponse handleUpdateSwitchReceive();
 
 private:
   bool getSwitchDataParams(SwitchDataParams &switchParams);
   bool getSwitchReceiveParams(SwitchReceiveParams &receiveParams);
+  bool getSwitchReceiveActions(String paramReceiveActions, SwitchReceiveParams &receiveParams);
   CoreHandlerResponse handleSwitchOnOffCore(bool switchItOn);
 };
 
@@ -0,0 +1,22 @@
+#ifndef MSZ_SWITCHUDPCOMMANDS_H
+#define MSZ_SWITCHUDPCOMMANDS_H
+
+#include <Arduino.h>
+#include "AssetUdpCommandServer.h"
+#include "SwitchLogic.h"
+
+/// @class MszSwitchUdpCommands
+/// @brief Switch commands of the UDP command protocol, they take the same path as /switchon and /switchoff.
+/// @details Switch on and off carry the switch name as payload. A scene carries a list of switches, each as a
+///          state byte (0 = off, 1 = on), a name length byte and the name, and switches all of them in one go.
+class MszSwitchUdpCommands
+{
+public:
+    static void registerCommands(MszUdpCommandServer &udpServer, MszSwitchLogic *switchLogic);
+
+private:
+    static uint8_t switchByName(MszSwitchLogic *switchLogic, const uint8_t *name, size_t nameLength, bool switchOn);
+    static uint8_t switchScene(MszSwitchLogic *switchLogic, const uint8_t *payload, size_t length);
+};
+
+#endif // MSZ_SWITCHUDPCOMMANDS_H
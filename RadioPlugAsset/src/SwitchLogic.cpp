@@ -18,8 +18,24 @@ MszSwitchLogic::MszSwitchLogic()
     rcHandler.setProtocol(RCSWITCH_DATA_PROTOCOL);
     rcHandler.setRepeatTransmit(RCSWITCH_REPEAT_TRANSMIT);
 
-    // Keep a reference to the WifiClient
-    this->wifiClient = wifiClient;
+    // Switch commands received via MQTT take the same path as the ones received via HTTP.
+    this->mqtt.setCommandHandler([this](const String &switchName, bool switchOn)
+                                 { return this->toggleSwitch(switchName, switchOn); });
+
+    // Register the metrics exposed on /metrics.
+    this->rfCodesReceivedMetric = MszMetricsRegistry::registerCounter("switch_rf_codes_received_total", "RF codes received.");
+    this->rfReceiveOverflowsMetric = MszMetricsRegistry::registerCounter("switch_rf_receive_overflows_total", "RF codes dropped because the receive queue was full.");
+    this->rfRepeatsSuppressedMetric = MszMetricsRegistry::registerCounter("switch_rf_repeats_suppressed_total", "RF codes dropped as repeats of the same button press.");
+    this->rfCodesMatchedMetric = MszMetricsRegistry::registerCounter("switch_rf_codes_matched_total", "RF codes received matching a configured receive entry.");
+    this->rfTransmitsMetric = MszMetricsRegistry::registerCounter("switch_rf_transmits_total", "Switch commands sent via RF.");
+    this->receiveActionsMetric = MszMetricsRegistry::registerCounter("switch_receive_actions_total", "Local actions run for received RF codes.");
+    this->mqttPublishFailuresMetric = MszMetricsRegistry::registerCounter("switch_mqtt_publish_failures_total", "MQTT messages that could not be published.");
+}
+
+void MszSwitchLogic::beginReceive()
+{
+    Serial.println("MszSwitchLogic::beginReceive - polling the RF receiver every " + String(RECEIVE_POLL_INTERVAL_MS) + "ms");
+    this->receivePollTicker.attach_ms(RECEIVE_POLL_INTERVAL_MS, MszSwitchLogic::pollReceiver, this);
 }
 
 /*
@@ -29,95 +45,148 @@ void MszSwitchLogic::handleSwitchReceiveData()
 {
     //Serial.println("MszSwitchLogic::handleSwitchReceiveData - enter");
 
-    if (rcHandler.available())
+    SwitchReceivedCode receivedCodes[RECEIVE_BATCH_SIZE];
+    size_t receivedCount = this->receiveRing.popBatch(receivedCodes, RECEIVE_BATCH_SIZE);
+
+    // Drop the repeats of a button press first, they must not cause any file system or network access.
+    SwitchReceivedCode pressedCodes[RECEIVE_BATCH_SIZE];
+    bool longPresses[RECEIVE_BATCH_SIZE];
+    size_t pressedCount = 0;
+    for (size_t i = 0; i < receivedCount; i++)
+    {
+        int receiveEvent = this->receiveFilter.filter(receivedCodes[i]);
+        if (receiveEvent == MszSwitchReceiveFilter::RECEIVE_EVENT_REPEAT)
+        {
+            this->rfRepeatsSuppressedMetric->increment();
+            continue;
+        }
+        pressedCodes[pressedCount] = receivedCodes[i];
+        longPresses[pressedCount] = (receiveEvent == MszSwitchReceiveFilter::RECEIVE_EVENT_LONG_PRESS);
+        pressedCount++;
+    }
+    if (pressedCount == 0)
+    {
+        return;
+    }
+
+    // The receive configuration is loaded once per batch rather than once per code.
+    MszSwitchRepository switchRepository;
+    std::unordered_map<int, SwitchReceiveParams> savedReceiveParams = switchRepository.loadSwitchReceiveData();
+    for (size_t i = 0; i < pressedCount; i++)
+    {
+        this->processReceivedCode(pressedCodes[i], longPresses[i], savedReceiveParams);
+    }
+
+    //Serial.println("MszSwitchLogic::handleSwitchReceiveData - exit");
+}
+
+void MszSwitchLogic::handleMqtt()
+{
+    this->mqtt.loop();
+}
+
+#if defined(MSZ_DUAL_CORE)
+void MszSwitchLogic::handleRadio()
+{
+    SwitchTransmitRequest transmitRequest;
+    while (this->transmitQueue.tryPop(transmitRequest))
+    {
+        this->transmit(transmitRequest.switchData, transmitRequest.switchOn);
+    }
+}
+#endif
+
+void MszSwitchLogic::pollReceiver(MszSwitchLogic *switchLogic)
+{
+    switchLogic->pollReceivedCode();
+}
+
+void MszSwitchLogic::pollReceivedCode()
+{
+    // Runs in timer context: no logging, no allocation, just hand the code over to the loop.
+    if (!rcHandler.available())
+    {
+        return;
+    }
+
+    SwitchReceivedCode receivedCode;
+    receivedCode.value = rcHandler.getReceivedValue();
+    receivedCode.protocol = rcHandler.getReceivedProtocol();
+    receivedCode.bitLength = rcHandler.getReceivedBitlength();
+    receivedCode.pulseLength = rcHandler.getReceivedDelay();
+    receivedCode.receivedMicros = micros();
+    rcHandler.resetAvailable();
+
+    this->rfCodesReceivedMetric->increment();
+    if (!this->receiveRing.tryPush(receivedCode))
     {
-        unsigned long receivedValue = rcHandler.getReceivedValue();
-        unsigned int receivedProtocol = rcHandler.getReceivedProtocol();
-        Serial.println("MszSwitchLogic::handleSwitchReceiveData - Received " + String(receivedValue) + " / " + String(receivedProtocol) + "bit");
-        
-        rcHandler.resetAvailable();
-
-        MszSwitchRepository switchRepository;
-        std::unordered_map<int, SwitchReceiveParams> savedReceiveParams = switchRepository.loadSwitchReceiveData();
-        if (savedReceiveParams.find(receivedValue) != savedReceiveParams.end())
+        this->rfReceiveOverflowsMetric->increment();
+    }
+}
+
+void MszSwitchLogic::processReceivedCode(const SwitchReceivedCode &receivedCode, bool longPress, std::unordered_map<int, SwitchReceiveParams> &savedReceiveParams)
+{
+    unsigned long receivedValue = receivedCode.value;
+    unsigned int receivedProtocol = receivedCode.protocol;
+    Serial.println("MszSwitchLogic::processReceivedCode - Received " + String(receivedValue) + " / protocol " + String(receivedProtocol) + " / " +
+                   String(receivedCode.bitLength) + "bit / " + String(receivedCode.pulseLength) + "us, " +
+                   String((micros() - receivedCode.receivedMicros) / 1000) + "ms ago" + (longPress ? ", long press" : ""));
+
+    if (savedReceiveParams.find(receivedValue) != savedReceiveParams.end())
+    {
+        Serial.println("MszSwitchLogic::processReceivedCode - Found entry for: " + String(receivedValue));
+        SwitchReceiveParams receiveParams = savedReceiveParams[receivedValue];
+        this->rfCodesMatchedMetric->increment();
+
+        if (receivedProtocol != receiveParams.switchProtocol)
         {
-            Serial.println("MszSwitchLogic::handleSwitchReceiveData - Found entry for: " + String(receivedValue));
-            SwitchReceiveParams receiveParams = savedReceiveParams[receivedValue];
+            Serial.println("MszSwitchLogic::processReceivedCode - Protocol mismatch: " + String(receivedProtocol) + " / " + String(receiveParams.switchProtocol));
+            return;
+        }
+
+        // Local actions first, they must neither wait for nor depend on the MQTT server.
+        if (!longPress)
+        {
+            this->runReceiveActions(receivedCode, receiveParams);
+        }
 
-            if (receivedProtocol != receiveParams.switchProtocol)
+        // Next send the MQTT message per the receive parameters configuration over the persistent MQTT session.
+        if (strnlen(receiveParams.switchTopic, MAX_SWITCH_MQTT_TOPIC_LENGTH) > 0)
+        {
+            char switchTopic[MAX_SWITCH_MQTT_TOPIC_LENGTH + sizeof(SWITCH_MQTT_LONG_PRESS_SUFFIX)];
+            snprintf(switchTopic, sizeof(switchTopic), "%s%s", receiveParams.switchTopic, longPress ? SWITCH_MQTT_LONG_PRESS_SUFFIX : "");
+
+            Serial.println("MszSwitchLogic::processReceivedCode - Sending " + String(receiveParams.switchCommand) + " to MQTT topic " + String(switchTopic));
+            if (this->mqtt.publish(switchTopic, receiveParams.switchCommand))
             {
-                Serial.println("MszSwitchLogic::handleSwitchReceiveData - Protocol mismatch: " + String(receivedProtocol) + " / " + String(receiveParams.switchProtocol));
-                return;
+                Serial.println("MszSwitchLogic::processReceivedCode - Sent MQTT message");
             }
-
-            // Next send the MQTT message per the receive parameters configuration and the global metadata configuration.
-            AssetMetadataParams assetMetadata = switchRepository.loadMetadata();
-            if (strnlen(receiveParams.switchTopic, MAX_SWITCH_MQTT_TOPIC_LENGTH) > 0)
+            else
             {
-                Serial.println("MszSwitchLogic::handleSwitchReceiveData - Sending " + String(receiveParams.switchCommand) + " to MQTT topic " + String(receiveParams.switchCommand) + " on MQTT Server " + assetMetadata.sensorMqttServer);
-
-                if(assetMetadata.sensorMqttServer != NULL && assetMetadata.sensorMqttServer[0] != '\0')
-                {
-                    // First connect to the MQTT server
-                    int failedConnectionAttempts = 0;
-                    PubSubClient mqttClient(wifiClient);
-                    mqttClient.setServer(assetMetadata.sensorMqttServer, assetMetadata.sensorMqttPort);
-                    while(!mqttClient.connected())
-                    {
-                        Serial.println("MszSwitchLogic::handleSwitchReceiveData - Connecting to MQTT server");
-                        if(mqttClient.connect(assetMetadata.sensorMqttUsername, assetMetadata.sensorMqttUsername, assetMetadata.sensorMqttPassword))
-                        {
-                            Serial.println("MszSwitchLogic::handleSwitchReceiveData - Connected to MQTT server");
-                            // Send this to MQTT server assetMetadata.sensorMqttServer with the topic receiveParams.switchTopic and the content receiveParams.switchCommand
-                            mqttClient.publish(receiveParams.switchTopic, receiveParams.switchCommand);
-                            Serial.println("MszSwitchLogic::handleSwitchReceiveData - Sent MQTT message");
-                            break;
-                        }
-                        else if (failedConnectionAttempts >= SWITCH_MAX_MQTTCONNECT_ATTEMPTS)
-                        {
-                            Serial.println("MszSwitchLogic::handleSwitchReceiveData - Failed to connect to MQTT server after " + String(failedConnectionAttempts) + " attempts");
-                            ESP.restart();
-                            break;
-                        }
-                        else
-                        {
-                            failedConnectionAttempts++;
-                            Serial.println("MszSwitchLogic::handleSwitchReceiveData - Failed to connect to MQTT server");
-                            delay(500 + ((failedConnectionAttempts - 1) * 1000));
-                        }
-                    }
-
-                    // Disconnect from the MQTT server. I know this is the most efficient way, but I will need to optimize later when
-                    // everytying is working.
-                    if(mqttClient.connected())
-                    {
-                        mqttClient.disconnect();
-                        Serial.println("MszSwitchLogic::handleSwitchReceiveData - Disconnected from MQTT server");
-                    }
-                }
-                else
-                {
-                    Serial.println("MszSwitchLogic::handleSwitchReceiveData - No MQTT server configured");
-                }
+                this->mqttPublishFailuresMetric->increment();
+                Serial.println("MszSwitchLogic::processReceivedCode - Failed to send MQTT message");
             }
         }
-        else
-        {
-            Serial.println("MszSwitchLogic::handleSwitchReceiveData - No entry found for: " + String(receivedValue));
-        }
     }
-
-    //Serial.println("MszSwitchLogic::handleSwitchReceiveData - exit");
+    else
+    {
+        Serial.println("MszSwitchLogic::processReceivedCode - No entry found for: " + String(receivedValue));
+    }
 }
 
-int MszSwitchLogic::toggleSwitch(String switchName, bool switchOn)
+int MszSwitchLogic::toggleSwitch(String switchName, bool switchOn, RequestTimings *timings)
 {
     SwitchDataParams switchParams;
 
     Serial.println("MszSwitchLogic::toggleSwitch - enter");
 
+    unsigned long storageStartMicros = micros();
     MszSwitchRepository switchRepository;
     SwitchDataParams switchData = switchRepository.loadSwitchData(switchName);
+    if (timings != NULL)
+    {
+        timings->addSince(RequestStage::Storage, storageStartMicros);
+    }
     if (strnlen(switchData.switchName, MAX_SWITCH_NAME_LENGTH) == 0)
     {
         Serial.println("MszSwitchLogic::toggleSwitch - enter - switch not found");
@@ -126,19 +195,107 @@ int MszSwitchLogic::toggleSwitch(String switchName, bool switchOn)
     }
     else
     {
-        rcHandler.enableTransmit(RCSWITCH_SEND_PORT);
-        rcHandler.setProtocol(switchData.switchProtocol);
-        rcHandler.setPulseLength(switchData.pulseLength > 0 ? switchData.pulseLength : RCSWITCH_DATA_PULSE_LENGTH);
-        rcHandler.setRepeatTransmit(switchData.repeatTransmit > 0 ? switchData.repeatTransmit : RCSWITCH_REPEAT_TRANSMIT);
-        if (switchData.isTriState)
+        // In the dual-core mode, the radio core owns the RF module, hence the RF stage only covers queueing there.
+        unsigned long rfStartMicros = micros();
+        bool dispatched = this->dispatchTransmit(switchData, switchOn);
+        if (timings != NULL)
         {
-            rcHandler.sendTriState((switchOn ? switchData.switchOnCommand : switchData.switchOffCommand));
+            timings->addSince(RequestStage::Rf, rfStartMicros);
         }
-        else
+        if (!dispatched)
         {
-            rcHandler.send((switchOn ? switchData.switchOnCommand : switchData.switchOffCommand));
+            Serial.println("MszSwitchLogic::toggleSwitch - transmit queue full");
+            Serial.println("MszSwitchLogic::toggleSwitch - exit");
+            return SWITCH_TOGGLE_BUSY;
         }
+#if defined(MSZ_SWITCH_MQTT_COMMANDS)
+        this->mqtt.publishSwitchState(switchName, switchOn);
+#endif
         Serial.println("MszSwitchLogic::toggleSwitch - exit");
         return switchOn ? SWITCH_TOGGLE_SWITCHEDON : SWITCH_TOGGLE_SWITCHEDOFF;
     }
-}
\ No newline at end of file
+}
+
+void MszSwitchLogic::runReceiveActions(const SwitchReceivedCode &receivedCode, const SwitchReceiveParams &receiveParams)
+{
+    for (int i = 0; i < MAX_SWITCH_RECEIVE_ACTIONS; i++)
+    {
+        const SwitchReceiveAction &action = receiveParams.actions[i];
+        switch (action.actionType)
+        {
+        case SWITCH_RECEIVE_ACTION_SWITCH_ON:
+        case SWITCH_RECEIVE_ACTION_SWITCH_OFF:
+        {
+            bool switchOn = (action.actionType == SWITCH_RECEIVE_ACTION_SWITCH_ON);
+            Serial.println("MszSwitchLogic::runReceiveActions - switching " + String(action.switchName) + (switchOn ? " on" : " off"));
+            int toggleResult = this->toggleSwitch(String(action.switchName), switchOn);
+            if (toggleResult == SWITCH_TOGGLE_NOTFOUND || toggleResult == SWITCH_TOGGLE_BUSY)
+            {
+                Serial.println("MszSwitchLogic::runReceiveActions - switching " + String(action.switchName) + " failed with " + String(toggleResult));
+                continue;
+            }
+            break;
+        }
+        case SWITCH_RECEIVE_ACTION_REPEAT:
+        {
+            // Repeat the received code bit by bit, as binary command it goes through the regular transmit path.
+            SwitchDataParams repeatData;
+            memset(&repeatData, 0, sizeof(repeatData));
+            repeatData.isTriState = false;
+            repeatData.switchProtocol = action.repeatProtocol;
+            repeatData.pulseLength = action.repeatPulseLength;
+            unsigned int bitLength = receivedCode.bitLength > 0 ? receivedCode.bitLength : RCSWITCH_BIT_LENGTH;
+            if (bitLength > MAX_SWITCH_COMMAND_LENGTH)
+            {
+                bitLength = MAX_SWITCH_COMMAND_LENGTH;
+            }
+            for (unsigned int bit = 0; bit < bitLength; bit++)
+            {
+                repeatData.switchOnCommand[bit] = ((receivedCode.value >> (bitLength - 1 - bit)) & 1) ? '1' : '0';
+            }
+            repeatData.switchOnCommand[bitLength] = '\0';
+
+            Serial.println("MszSwitchLogic::runReceiveActions - repeating " + String(receivedCode.value) + " with protocol " + String(action.repeatProtocol));
+            if (!this->dispatchTransmit(repeatData, true))
+            {
+                Serial.println("MszSwitchLogic::runReceiveActions - transmit queue full, repeat dropped");
+                continue;
+            }
+            break;
+        }
+        default:
+            continue;
+        }
+        this->receiveActionsMetric->increment();
+    }
+}
+
+bool MszSwitchLogic::dispatchTransmit(const SwitchDataParams &switchData, bool switchOn)
+{
+#if defined(MSZ_DUAL_CORE)
+    SwitchTransmitRequest transmitRequest;
+    transmitRequest.switchData = switchData;
+    transmitRequest.switchOn = switchOn;
+    return this->transmitQueue.tryPush(transmitRequest);
+#else
+    this->transmit(switchData, switchOn);
+    return true;
+#endif
+}
+
+void MszSwitchLogic::transmit(const SwitchDataParams &switchData, bool switchOn)
+{
+    rcHandler.enableTransmit(RCSWITCH_SEND_PORT);
+    rcHandler.setProtocol(switchData.switchProtocol);
+    rcHandler.setPulseLength(switchData.pulseLength > 0 ? switchData.pulseLength : RCSWITCH_DATA_PULSE_LENGTH);
+    rcHandler.setRepeatTransmit(switchData.repeatTransmit > 0 ? switchData.repeatTransmit : RCSWITCH_REPEAT_TRANSMIT);
+    if (switchData.isTriState)
+    {
+        rcHandler.sendTriState((switchOn ? switchData.switchOnCommand : switchData.switchOffCommand));
+    }
+    else
+    {
+        rcHandler.send((switchOn ? switchData.switchOnCommand : switchData.switchOffCommand));
+    }
+    this->rfTransmitsMetric->increment();
+}
@@ -0,0 +1,167 @@
+#include "SwitchMqtt.h"
+#include "SwitchLogic.h"
+
+MszSwitchMqtt::MszSwitchMqtt()
+    : mqttClient(wifiClient)
+{
+    this->commandHandler = NULL;
+    this->metadataLoaded = false;
+    this->metadataGeneration = 0;
+    this->lastConnectAttemptMs = 0;
+    this->reconnectIntervalMs = 0;
+    this->mqttClient.setKeepAlive(KEEP_ALIVE_SECONDS);
+    this->mqttClient.setCallback([this](char *topic, uint8_t *payload, unsigned int length)
+                                 { this->handleMessage(topic, payload, length); });
+}
+
+void MszSwitchMqtt::setCommandHandler(SwitchMqttCommandHandler handler)
+{
+    this->commandHandler = handler;
+}
+
+void MszSwitchMqtt::loop()
+{
+    // Saved metadata may point to another broker, start over with it.
+    if (this->metadataLoaded && this->metadataGeneration != MszResourceVersions::getGeneration(MszResourceVersions::RESOURCE_METADATA))
+    {
+        Serial.println("MszSwitchMqtt::loop - metadata changed, reconnecting");
+        this->mqttClient.disconnect();
+        this->metadataLoaded = false;
+        this->reconnectIntervalMs = 0;
+    }
+
+    if (this->mqttClient.connected())
+    {
+        this->mqttClient.loop();
+        return;
+    }
+
+#if defined(MSZ_SWITCH_MQTT_COMMANDS)
+    // Commands can only arrive over an open session, all other work connects on demand when publishing.
+    this->connect();
+#endif
+}
+
+bool MszSwitchMqtt::publish(const char *topic, const char *payload, bool retained)
+{
+    if (!this->mqttClient.connected() && !this->connect())
+    {
+        return false;
+    }
+    return this->mqttClient.publish(topic, payload, retained);
+}
+
+void MszSwitchMqtt::publishSwitchState(const String &switchName, bool switchOn)
+{
+    if (!this->refreshMetadata() || this->metadata.sensorName[0] == '\0')
+    {
+        return;
+    }
+
+    String stateTopic = String(this->metadata.sensorName) + "/" + switchName + TOPIC_STATE_SUFFIX;
+    if (!this->publish(stateTopic.c_str(), switchOn ? PAYLOAD_ON : PAYLOAD_OFF, true))
+    {
+        Serial.println("MszSwitchMqtt::publishSwitchState - failed to publish to " + stateTopic);
+    }
+}
+
+bool MszSwitchMqtt::refreshMetadata()
+{
+    if (!this->metadataLoaded)
+    {
+        MszSwitchRepository switchRepository;
+        this->metadataGeneration = MszResourceVersions::getGeneration(MszResourceVersions::RESOURCE_METADATA);
+        this->metadata = switchRepository.loadMetadata();
+        this->metadataLoaded = true;
+    }
+    return this->metadata.sensorMqttServer[0] != '\0';
+}
+
+bool MszSwitchMqtt::connect()
+{
+    // Back off between failed attempts, an unreachable broker must not stall the loop on every pass.
+    unsigned long now = millis();
+    if (this->reconnectIntervalMs > 0 && now - this->lastConnectAttemptMs < this->reconnectIntervalMs)
+    {
+        return false;
+    }
+    this->lastConnectAttemptMs = now;
+
+    if (!this->refreshMetadata())
+    {
+        Serial.println("MszSwitchMqtt::connect - No MQTT server configured");
+        this->reconnectIntervalMs = RECONNECT_MAX_INTERVAL_MS;
+        return false;
+    }
+
+    Serial.println("MszSwitchMqtt::connect - Connecting to MQTT server " + String(this->metadata.sensorMqttServer));
+    this->mqttClient.setServer(this->metadata.sensorMqttServer, this->metadata.sensorMqttPort);
+    const char *clientId = (this->metadata.sensorName[0] != '\0' ? this->metadata.sensorName : this->metadata.sensorMqttUsername);
+    if (!this->mqttClient.connect(clientId, this->metadata.sensorMqttUsername, this->metadata.sensorMqttPassword))
+    {
+        this->reconnectIntervalMs = (this->reconnectIntervalMs == 0 ? RECONNECT_MIN_INTERVAL_MS : this->reconnectIntervalMs * 2);
+        if (this->reconnectIntervalMs > RECONNECT_MAX_INTERVAL_MS)
+        {
+            this->reconnectIntervalMs = RECONNECT_MAX_INTERVAL_MS;
+        }
+        Serial.println("MszSwitchMqtt::connect - Failed to connect, state " + String(this->mqttClient.state()) + ", retrying in " + String(this->reconnectIntervalMs) + "ms");
+        return false;
+    }
+    this->reconnectIntervalMs = 0;
+    Serial.println("MszSwitchMqtt::connect - Connected to MQTT server");
+
+#if defined(MSZ_SWITCH_MQTT_COMMANDS)
+    if (this->metadata.sensorName[0] != '\0')
+    {
+        String commandTopic = String(this->metadata.sensorName) + "/+" + TOPIC_COMMAND_SUFFIX;
+        if (!this->mqttClient.subscribe(commandTopic.c_str()))
+        {
+            Serial.println("MszSwitchMqtt::connect - Failed to subscribe to " + commandTopic);
+        }
+    }
+#endif
+    return true;
+}
+
+void MszSwitchMqtt::handleMessage(char *topic, uint8_t *payload, unsigned int length)
+{
+    // Only "<sensorName>/<switchName>/set" is subscribed, anything else is ignored.
+    String topicName(topic);
+    String topicPrefix = String(this->metadata.sensorName) + "/";
+    if (!topicName.startsWith(topicPrefix) || !topicName.endsWith(TOPIC_COMMAND_SUFFIX) || this->commandHandler == NULL)
+    {
+        return;
+    }
+    String switchName = topicName.substring(topicPrefix.length(), topicName.length() - strlen(TOPIC_COMMAND_SUFFIX));
+
+    String command;
+    command.reserve(length);
+    for (unsigned int i = 0; i < length; i++)
+    {
+        command += (char)payload[i];
+    }
+    command.trim();
+    command.toLowerCase();
+
+    bool switchOn;
+    if (command == PAYLOAD_ON || command == "1" || command == "true")
+    {
+        switchOn = true;
+    }
+    else if (command == PAYLOAD_OFF || command == "0" || command == "false")
+    {
+        switchOn = false;
+    }
+    else
+    {
+        Serial.println("MszSwitchMqtt::handleMessage - invalid command " + command + " for " + switchName);
+        return;
+    }
+
+    Serial.println("MszSwitchMqtt::handleMessage - switching " + switchName + (switchOn ? " on" : " off"));
+    int toggleResult = this->commandHandler(switchName, switchOn);
+    if (toggleResult != MszSwitchLogic::SWITCH_TOGGLE_SWITCHEDON && toggleResult != MszSwitchLogic::SWITCH_TOGGLE_SWITCHEDOFF)
+    {
+        Serial.println("MszSwitchMqtt::handleMessage - switching " + switchName + " failed with " + String(toggleResult));
+    }
+}
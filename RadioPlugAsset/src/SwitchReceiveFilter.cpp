@@ -0,0 +1,62 @@
+#include "SwitchReceiveFilter.h"
+
+MszSwitchReceiveFilter::MszSwitchReceiveFilter(unsigned long windowMs, unsigned long longPressMs)
+{
+    this->windowMicros = windowMs * 1000UL;
+    this->longPressMicros = longPressMs * 1000UL;
+    for (int i = 0; i < SWITCH_RECEIVE_FILTER_SLOTS; i++)
+    {
+        this->slots[i].inUse = false;
+    }
+}
+
+int MszSwitchReceiveFilter::filter(const SwitchReceivedCode &receivedCode)
+{
+    unsigned long now = receivedCode.receivedMicros;
+
+    // Unsigned differences keep working across the wrap-around of micros().
+    PressSlot *freeSlot = NULL;
+    for (int i = 0; i < SWITCH_RECEIVE_FILTER_SLOTS; i++)
+    {
+        PressSlot &slot = this->slots[i];
+        if (!slot.inUse)
+        {
+            if (freeSlot == NULL || freeSlot->inUse)
+            {
+                freeSlot = &slot;
+            }
+            continue;
+        }
+
+        if (slot.value == receivedCode.value && slot.protocol == receivedCode.protocol)
+        {
+            if (now - slot.lastSeenMicros <= this->windowMicros)
+            {
+                slot.lastSeenMicros = now;
+                if (this->longPressMicros > 0 && !slot.longPressReported && now - slot.firstSeenMicros >= this->longPressMicros)
+                {
+                    slot.longPressReported = true;
+                    return RECEIVE_EVENT_LONG_PRESS;
+                }
+                return RECEIVE_EVENT_REPEAT;
+            }
+
+            // Seen before, but long enough ago for this to be a new press.
+            freeSlot = &slot;
+            break;
+        }
+
+        if (freeSlot == NULL || (freeSlot->inUse && now - slot.lastSeenMicros > now - freeSlot->lastSeenMicros))
+        {
+            freeSlot = &slot;
+        }
+    }
+
+    freeSlot->inUse = true;
+    freeSlot->longPressReported = false;
+    freeSlot->value = receivedCode.value;
+    freeSlot->protocol = receivedCode.protocol;
+    freeSlot->firstSeenMicros = now;
+    freeSlot->lastSeenMicros = now;
+    return RECEIVE_EVENT_PRESS;
+}
@@ -1,10 +1,12 @@
 #include <Arduino.h>
 #include <functional>
 #include "SwitchRepository.h"
+#include <vector>
+#include <AssetWriteBehindStore.h>
 
-#ifdef ESP32
-
-#include <SPIFFS.h>
+MSZ_RECORD_DEFINE(SwitchDataParams, SWITCH_DATA_RECORD_VERSION, SWITCH_DATA_RECORD_FIELDS)
+MSZ_RECORD_DEFINE(SwitchReceiveAction, SWITCH_RECEIVE_ACTION_RECORD_VERSION, SWITCH_RECEIVE_ACTION_RECORD_FIELDS)
+MSZ_RECORD_DEFINE(SwitchReceiveParams, SWITCH_RECEIVE_RECORD_VERSION, SWITCH_RECEIVE_RECORD_FIELDS)
 
 MszSwitchRepository::MszSwitchRepository() : AssetBaseRepository()
 {
@@ -15,23 +17,17 @@ SwitchDataParams MszSwitchRepository::loadSwitchData(String switchName)
     Serial.println("SwitchRepository::loadSwitchData - enter");
 
     SwitchDataParams switchData;
+    switchData.isTriState = false;
+    switchData.switchProtocol = 0;
+    switchData.switchName[0] = '\0';
+    switchData.switchOnCommand[0] = '\0';
+    switchData.switchOffCommand[0] = '\0';
+    switchData.pulseLength = 0;
+    switchData.repeatTransmit = 0;
     String fileName = String(SWITCH_FILENAME_PREFIX) + switchName;
-    File file = SPIFFS.open(fileName.c_str(), "r");
-    if (file)
-    {
-        file.readBytes((char *)&switchData, sizeof(switchData));
-        file.close();
-    }
-    else
+    if (!MszWriteBehindStore::readRecord(fileName.c_str(), switchData))
     {
         Serial.println("SwitchRepository::loadSwitchData - failed to open file");
-        switchData.isTriState = false;
-        switchData.switchProtocol = 0;
-        switchData.switchName[0] = '\0';
-        switchData.switchOnCommand[0] = '\0';
-        switchData.switchOffCommand[0] = '\0';
-        switchData.pulseLength = 0;
-        switchData.repeatTransmit = 0;
     }
 
     Serial.println("SwitchRepository::loadSwitchData - switchName = " + String(switchData.switchName));
@@ -58,18 +54,12 @@ bool MszSwitchRepository::saveSwitchData(String switchName, SwitchDataParams swi
     Serial.println("SwitchRepository::saveSwitchData - pulseLength = " + String(switchDataParams.pulseLength));
     Serial.println("SwitchRepository::saveSwitchData - repeatTransmit = " + String(switchDataParams.repeatTransmit));
 
-    bool succeeded = false;
+    // Staged for the next group commit, bulk provisioning of many switches ends up in one batch of writes.
     String fileName = String(SWITCH_FILENAME_PREFIX) + switchName;
-    File file = SPIFFS.open(fileName.c_str(), "w");
-    if (file)
-    {
-        file.write((const uint8_t *)&switchDataParams, sizeof(switchDataParams));
-        file.close();
-        succeeded = true;
-    }
-    else
+    bool succeeded = MszWriteBehindStore::writeRecord(fileName.c_str(), switchDataParams);
+    if (!succeeded)
     {
-        Serial.println("SwitchRepository::saveSwitchData - failed to open file");
+        Serial.println("SwitchRepository::saveSwitchData - failed to stage file");
     }
 
     Serial.println("SwitchRepository::saveSwitchData - exit");
@@ -83,29 +73,36 @@ std::unordered_map<int, SwitchReceiveParams> MszSwitchRepository::loadSwitchRece
     // We return a hashmap, the key of the items is the decimal from the 
     // radio switch. The value contains the MQTT topic data in the SwitchReceiveParams struct.
     std::unordered_map<int, SwitchReceiveParams> receiveParams;
-    
-    // Load the whole file with a maximum of SWITCH_MAX_RECEIVE_ENTRIES entries.
-    File file = SPIFFS.open(SWITCH_FILENAME_RECEIVE_FILENAME, "r");
-    if (file)
+    // The paths are collected first, reading may stage a migrated entry, which changes what is visited.
+    std::vector<String> paths;
+    MszWriteBehindStore::forEachPath(SWITCH_RECEIVE_ENTRY_PREFIX, [&paths](const char *path) {
+        paths.push_back(String(path));
+    });
+    for (size_t i = 0; i < paths.size(); i++)
     {
-        while (file.available())
+        SwitchReceiveParams receiveParam;
+        memset(&receiveParam, 0, sizeof(receiveParam));
+        if (MszWriteBehindStore::readRecord(paths[i].c_str(), receiveParam))
         {
-            SwitchReceiveParams receiveParam;
-            file.readBytes((char *)&receiveParam, sizeof(receiveParam));
-            if ((receiveParam.switchReceiveDecimalValue >= 0))
-            {
-                receiveParams[receiveParam.switchReceiveDecimalValue] = receiveParam;
-            }
-            else
-            {
-                Serial.println("SwitchRepository::loadSwitchReceiveData - invalid switchReceiveDecimalValue");
-            }
+            receiveParams[receiveParam.switchReceiveDecimalValue] = receiveParam;
+        }
+        else
+        {
+            Serial.println("SwitchRepository::loadSwitchReceiveData - invalid entry " + paths[i]);
         }
-        file.close();
     }
-    else
+
+    // Receive data stored as one file, or before local actions existed, is converted on the next save.
+    if (receiveParams.empty())
     {
-        Serial.println("SwitchRepository::loadSwitchReceiveData - failed to open file");
+        if (MszWriteBehindStore::exists(SWITCH_FILENAME_RECEIVE_FILENAME))
+        {
+            receiveParams = this->loadSwitchReceiveFile();
+        }
+        else if (MszWriteBehindStore::exists(SWITCH_FILENAME_RECEIVE_LEGACY_FILENAME))
+        {
+            receiveParams = this->loadLegacySwitchReceiveData();
+        }
     }
 
     Serial.println("SwitchRepository::loadSwitchReceiveData - exit");
@@ -123,30 +120,113 @@ bool MszSwitchRepository::saveSwitchReceiveData (std::unordered_map<int, SwitchR
         return false;
     }
 
-    // Now write the contents to the file.
-    bool succeeded = false;
-    File file = SPIFFS.open(SWITCH_FILENAME_RECEIVE_FILENAME, "w");
-    if (file)
+    // Entries no longer configured are removed, the paths are collected first as removing changes what is visited.
+    std::vector<String> stalePaths;
+    size_t prefixLength = strlen(SWITCH_RECEIVE_ENTRY_PREFIX);
+    MszWriteBehindStore::forEachPath(SWITCH_RECEIVE_ENTRY_PREFIX, [&](const char *path) {
+        if (receiveParams.find(atoi(path + prefixLength)) == receiveParams.end())
+        {
+            stalePaths.push_back(String(path));
+        }
+    });
+    bool succeeded = true;
+    for (size_t i = 0; i < stalePaths.size(); i++)
+    {
+        succeeded = MszWriteBehindStore::remove(stalePaths[i].c_str()) && succeeded;
+    }
+
+    // Entries with unchanged content cost no flash write when committed.
+    for (auto it = receiveParams.begin(); it != receiveParams.end(); ++it)
     {
-        for (auto it = receiveParams.begin(); it != receiveParams.end(); ++it)
+        Serial.println("SwitchRepository::saveSwitchReceiveData - key = " + String(it->first) + " val = " + String(it->second.switchCommand));
+        String path = String(SWITCH_RECEIVE_ENTRY_PREFIX) + String(it->first);
+        succeeded = MszWriteBehindStore::writeRecord(path.c_str(), it->second) && succeeded;
+    }
+
+    if (succeeded)
+    {
+        // Files of the former formats are obsolete once the entries are stored, they are removed after those commits.
+        if (MszWriteBehindStore::exists(SWITCH_FILENAME_RECEIVE_FILENAME))
         {
-            Serial.println("SwitchRepository::saveSwitchReceiveData - key = " + String(it->first) + " val = " + String(it->second.switchCommand));
-            if(file.write((const uint8_t *)&it->second, sizeof(it->second)) != sizeof(it->second))
-            {
-                Serial.println("SwitchRepository::saveSwitchReceiveData - failed to write data");
-                break;
-            }
+            MszWriteBehindStore::remove(SWITCH_FILENAME_RECEIVE_FILENAME);
+        }
+        if (MszWriteBehindStore::exists(SWITCH_FILENAME_RECEIVE_LEGACY_FILENAME))
+        {
+            MszWriteBehindStore::remove(SWITCH_FILENAME_RECEIVE_LEGACY_FILENAME);
         }
-        file.close();
-        succeeded = true;
     }
     else
     {
-        Serial.println("SwitchRepository::saveSwitchReceiveData - failed to open file for writing data");
+        Serial.println("SwitchRepository::saveSwitchReceiveData - failed to stage entries for writing data");
     }
 
     Serial.println("SwitchRepository::saveSwitchReceiveData - exit");
     return succeeded;
 }
 
-#endif
\ No newline at end of file
+std::unordered_map<int, SwitchReceiveParams> MszSwitchRepository::loadSwitchReceiveFile()
+{
+    Serial.println("SwitchRepository::loadSwitchReceiveFile - enter");
+
+    // Load the whole file with a maximum of SWITCH_MAX_RECEIVE_ENTRIES entries.
+    std::unordered_map<int, SwitchReceiveParams> receiveParams;
+    std::vector<SwitchReceiveParams> entries(SWITCH_MAX_RECEIVE_ENTRIES);
+    size_t readLength = MszWriteBehindStore::read(SWITCH_FILENAME_RECEIVE_FILENAME, entries.data(), entries.size() * sizeof(SwitchReceiveParams));
+    if (readLength > 0)
+    {
+        for (size_t i = 0; i < readLength / sizeof(SwitchReceiveParams); i++)
+        {
+            const SwitchReceiveParams &receiveParam = entries[i];
+            if ((receiveParam.switchReceiveDecimalValue >= 0))
+            {
+                receiveParams[receiveParam.switchReceiveDecimalValue] = receiveParam;
+            }
+            else
+            {
+                Serial.println("SwitchRepository::loadSwitchReceiveFile - invalid switchReceiveDecimalValue");
+            }
+        }
+    }
+    else
+    {
+        Serial.println("SwitchRepository::loadSwitchReceiveFile - failed to open file");
+    }
+
+    Serial.println("SwitchRepository::loadSwitchReceiveFile - exit");
+    return receiveParams;
+}
+
+std::unordered_map<int, SwitchReceiveParams> MszSwitchRepository::loadLegacySwitchReceiveData()
+{
+    Serial.println("SwitchRepository::loadLegacySwitchReceiveData - enter");
+
+    // Load the whole file with a maximum of SWITCH_MAX_RECEIVE_ENTRIES entries.
+    std::unordered_map<int, SwitchReceiveParams> receiveParams;
+    std::vector<SwitchReceiveParamsLegacy> entries(SWITCH_MAX_RECEIVE_ENTRIES);
+    size_t readLength = MszWriteBehindStore::read(SWITCH_FILENAME_RECEIVE_LEGACY_FILENAME, entries.data(), entries.size() * sizeof(SwitchReceiveParamsLegacy));
+    if (readLength > 0)
+    {
+        if (readLength % sizeof(SwitchReceiveParamsLegacy) != 0)
+        {
+            Serial.println("SwitchRepository::loadLegacySwitchReceiveData - truncated entry");
+        }
+        for (size_t i = 0; i < readLength / sizeof(SwitchReceiveParamsLegacy); i++)
+        {
+            const SwitchReceiveParamsLegacy &legacyParam = entries[i];
+            SwitchReceiveParams receiveParam;
+            memset(&receiveParam, 0, sizeof(receiveParam));
+            receiveParam.switchProtocol = legacyParam.switchProtocol;
+            receiveParam.switchReceiveDecimalValue = legacyParam.switchReceiveDecimalValue;
+            memcpy(receiveParam.switchTopic, legacyParam.switchTopic, sizeof(receiveParam.switchTopic));
+            memcpy(receiveParam.switchCommand, legacyParam.switchCommand, sizeof(receiveParam.switchCommand));
+            receiveParams[receiveParam.switchReceiveDecimalValue] = receiveParam;
+        }
+    }
+    else
+    {
+        Serial.println("SwitchRepository::loadLegacySwitchReceiveData - failed to open file");
+    }
+
+    Serial.println("SwitchRepository::loadLegacySwitchReceiveData - exit");
+    return receiveParams;
+}
\ No newline at end of file
@@ -5,6 +5,16 @@
 #include "SwitchServer.h"
 #include "SecretHandler.h"
 
+constexpr MszApiRoute MszSwitchWebApi::ROUTES[] = {
+  {MszHttpMethod::Put, MszSwitchWebApi::API_ENDPOINT_ON, static_cast<MszApiHandler>(&MszSwitchWebApi::handleSwitchOn), true, MszResourceVersions::NO_RESOURCE},
+  {MszHttpMethod::Put, MszSwitchWebApi::API_ENDPOINT_OFF, static_cast<MszApiHandler>(&MszSwitchWebApi::handleSwitchOff), true, MszResourceVersions::NO_RESOURCE},
+  {MszHttpMethod::Put, MszSwitchWebApi::API_ENDPOINT_UPDATESWITCHRECEIVE, static_cast<MszApiHandler>(&MszSwitchWebApi::handleUpdateSwitchReceive), true, MszResourceVersions::NO_RESOURCE},
+  {MszHttpMethod::Put, MszSwitchWebApi::API_ENDPOINT_UPDATESWITCHDATA, static_cast<MszApiHandler>(&MszSwitchWebApi::handleUpdateSwitchData), true, MszResourceVersions::NO_RESOURCE},
+};
+constexpr MszApiRouteTable<SWITCH_API_ROUTE_SLOTS> MszSwitchWebApi::ROUTE_TABLE =
+    mszMakeRouteTable<SWITCH_API_ROUTE_SLOTS>(MszSwitchWebApi::ROUTES, sizeof(MszSwitchWebApi::ROUTES) / sizeof(MszSwitchWebApi::ROUTES[0]));
+static_assert(MszSwitchWebApi::ROUTE_TABLE.seed != API_ROUTE_NO_SEED, "No perfect hash for the switch API routes, increase SWITCH_API_ROUTE_SLOTS.");
+
 /*
  * The base class constructors and public initialization methods are doing all the initialization, already.
  */
@@ -25,17 +35,16 @@ void MszSwitchWebApi::configure(MszSwitchLogic *switchLogicInstance)
  * Main execution functions - begin and loop
  */
 
+const MszApiRoute *MszSwitchWebApi::findRoute(MszHttpMethod method, const char *path)
+{
+  const MszApiRoute *route = MszSwitchWebApi::ROUTE_TABLE.find(method, path);
+  return (route != NULL) ? route : MszAssetApiBase::findRoute(method, path);
+}
+
 void MszSwitchWebApi::beginCfg()
 {
   Serial.println("MszSwitchWebApi::beginCfg() - enter");
 
-  Serial.println("MszSwitchWebApi::beginCfg() - Configuring Switch API secret handler");
-  this->registerPutEndpoint(API_ENDPOINT_ON, std::bind(&MszSwitchWebApi::handleSwitchOn, this));
-  this->registerPutEndpoint(API_ENDPOINT_OFF, std::bind(&MszSwitchWebApi::handleSwitchOff, this));
-  this->registerPutEndpoint(API_ENDPOINT_UPDATESWITCHRECEIVE, std::bind(&MszSwitchWebApi::handleUpdateSwitchReceive, this));
-  this->registerPutEndpoint(API_ENDPOINT_UPDATESWITCHDATA, std::bind(&MszSwitchWebApi::handleUpdateSwitchData, this));
-  Serial.println("MszSwitchWebApi::beginCfg() - Switch API endpoints configured!");
-
   // If the switch logic is not present, throw an exception
   if (this->switchLogic == nullptr)
   {
@@ -46,102 +55,102 @@ void MszSwitchWebApi::beginCfg()
   Serial.println("MszSwitchWebApi::beginCfg() - exit");
 }
 
-void MszSwitchWebApi::handleSwitchOn()
+CoreHandlerResponse MszSwitchWebApi::handleSwitchOn()
 {
   Serial.println("Switch API handleSwitchOn - enter");
-  performAuthorizedAction([&]()
-                          { return this->handleSwitchOnOffCore(true); });
-  Serial.println("Switch API handleSwitchOn - exit");
+  return this->handleSwitchOnOffCore(true);
 }
 
-void MszSwitchWebApi::handleSwitchOff()
+CoreHandlerResponse MszSwitchWebApi::handleSwitchOff()
 {
   Serial.println("Switch API handleSwitchOff - enter");
-  performAuthorizedAction([&]()
-                          { return this->handleSwitchOnOffCore(false); });
-  Serial.println("Switch API handleSwitchOff - exit");
+  return this->handleSwitchOnOffCore(false);
 }
 
-void MszSwitchWebApi::handleUpdateSwitchData()
+CoreHandlerResponse MszSwitchWebApi::handleUpdateSwitchData()
 {
   Serial.println("MszSwitchWebApi::handleUpdateSwitchData - enter");
-  performAuthorizedAction([&]()
-                          {
-    // First, get the switch parameters from the request.
-    SwitchDataParams switchData;
-    if (!(this->getSwitchDataParams(switchData)))
-    {
-      Serial.println("MszSwitchWebApi::handleUpdateSwitchDataCore - switch data invalid");
-
-      CoreHandlerResponse response;
-      response.statusCode = HTTP_BAD_REQUEST_CODE;
-      response.contentType = HTTP_RESPONSE_CONTENT_TYPE_APPLICATION_JSON;
-      response.returnContent = this->getErrorJsonDocument(
-                                      HTTP_BAD_REQUEST_CODE,
-                                      "Invalid Switch Data!",
-                                      "You did not provide valid switch data for updating the switch!");
-
-      Serial.println("MszSwitchWebApi::handleUpdateSwitchDataCore - exit");
-      return response;
-    }
-    
-    // If all parameters are validated, execute the core logic.
-    MszSwitchRepository switchRepository;
-    bool succeeded = switchRepository.saveSwitchData(switchData.switchName, switchData);
+  // First, get the switch parameters from the request.
+  SwitchDataParams switchData;
+  if (!(this->getSwitchDataParams(switchData)))
+  {
+    Serial.println("MszSwitchWebApi::handleUpdateSwitchDataCore - switch data invalid");
 
     CoreHandlerResponse response;
-    response.statusCode = (succeeded ? HTTP_OK_CODE : HTTP_INTERNAL_SERVER_ERROR_CODE);
+    response.statusCode = HTTP_BAD_REQUEST_CODE;
     response.contentType = HTTP_RESPONSE_CONTENT_TYPE_APPLICATION_JSON;
+    response.returnContent = this->getErrorJsonDocument(
+                                    HTTP_BAD_REQUEST_CODE,
+                                    "Invalid Switch Data!",
+                                    "You did not provide valid switch data for updating the switch!");
+
+    Serial.println("MszSwitchWebApi::handleUpdateSwitchDataCore - exit");
+    return response;
+  }
+  
+  // If all parameters are validated, execute the core logic.
+  unsigned long storageStartMicros = micros();
+  MszSwitchRepository switchRepository;
+  bool succeeded = switchRepository.saveSwitchData(switchData.switchName, switchData);
+  this->requestTimings.addSince(RequestStage::Storage, storageStartMicros);
 
-    JsonDocument respDoc;
-    respDoc["switchName"] = switchData.switchName;
-    respDoc["switchStatus"] = (succeeded ? "SWITCH_UPDATED" : "SWITCH_UPDATE_FAILED");
-    serializeJsonPretty(respDoc, response.returnContent);
-    
-    return response; });
-  Serial.println("MszSwitchWebApi::handleUpdateSwitchData - exit");
+  CoreHandlerResponse response;
+  response.statusCode = (succeeded ? HTTP_OK_CODE : HTTP_INTERNAL_SERVER_ERROR_CODE);
+  response.contentType = HTTP_RESPONSE_CONTENT_TYPE_APPLICATION_JSON;
+
+  JsonDocument respDoc(&this->requestArena);
+  respDoc["switchName"] = switchData.switchName;
+  respDoc["switchStatus"] = (succeeded ? "SWITCH_UPDATED" : "SWITCH_UPDATE_FAILED");
+  response.returnContent = this->serializeJsonDocument(respDoc);
+  
+  return response;
 }
 
-void MszSwitchWebApi::handleUpdateSwitchReceive()
+CoreHandlerResponse MszSwitchWebApi::handleUpdateSwitchReceive()
 {
   Serial.println("MszSwitchWebApi::handleUpdateSwitchReceive - enter");
-  performAuthorizedAction([&]()
-                          {
-    // First, get the switch parameters from the request.
-    SwitchReceiveParams receiveParams;
-    if (!(this->getSwitchReceiveParams(receiveParams)))
-    {
-      Serial.println("MszSwitchWebApi::handleUpdateSwitchReceiveCore - switch receive data invalid");
-
-      CoreHandlerResponse response;
-      response.statusCode = HTTP_BAD_REQUEST_CODE;
-      response.contentType = HTTP_RESPONSE_CONTENT_TYPE_APPLICATION_JSON;
-      response.returnContent = this->getErrorJsonDocument(
-                                      HTTP_BAD_REQUEST_CODE,
-                                      "Invalid Switch Receive Data!",
-                                      "You did not provide valid switch receive data for updating the switch!");
-
-      Serial.println("MszSwitchWebApi::handleUpdateSwitchReceiveCore - exit");
-      return response;
-    }
-    
-    // If all parameters are validated, execute the core logic.
-    MszSwitchRepository switchRepository;
-    std::unordered_map<int, SwitchReceiveParams> receiveData = switchRepository.loadSwitchReceiveData();
-    receiveData[receiveParams.switchReceiveDecimalValue] = receiveParams;
-    bool succeeded = switchRepository.saveSwitchReceiveData(receiveData);
+  // First, get the switch parameters from the request.
+  SwitchReceiveParams receiveParams;
+  if (!(this->getSwitchReceiveParams(receiveParams)))
+  {
+    Serial.println("MszSwitchWebApi::handleUpdateSwitchReceiveCore - switch receive data invalid");
 
     CoreHandlerResponse response;
-    response.statusCode = (succeeded ? HTTP_OK_CODE : HTTP_INTERNAL_SERVER_ERROR_CODE);
+    response.statusCode = HTTP_BAD_REQUEST_CODE;
     response.contentType = HTTP_RESPONSE_CONTENT_TYPE_APPLICATION_JSON;
+    response.returnContent = this->getErrorJsonDocument(
+                                    HTTP_BAD_REQUEST_CODE,
+                                    "Invalid Switch Receive Data!",
+                                    "You did not provide valid switch receive data for updating the switch!");
+
+    Serial.println("MszSwitchWebApi::handleUpdateSwitchReceiveCore - exit");
+    return response;
+  }
+  
+  // If all parameters are validated, execute the core logic.
+  unsigned long storageStartMicros = micros();
+  MszSwitchRepository switchRepository;
+  std::unordered_map<int, SwitchReceiveParams> receiveData = switchRepository.loadSwitchReceiveData();
+  receiveData[receiveParams.switchReceiveDecimalValue] = receiveParams;
+  bool succeeded = switchRepository.saveSwitchReceiveData(receiveData);
+  this->requestTimings.addSince(RequestStage::Storage, storageStartMicros);
+
+  CoreHandlerResponse response;
+  response.statusCode = (succeeded ? HTTP_OK_CODE : HTTP_INTERNAL_SERVER_ERROR_CODE);
+  response.contentType = HTTP_RESPONSE_CONTENT_TYPE_APPLICATION_JSON;
 
-    JsonDocument respDoc;
-    respDoc["switchReceiveValue"] = receiveParams.switchReceiveDecimalValue;
-    respDoc["switchStatus"] = (succeeded ? "SWITCH_RECEIVE_UPDATED" : "SWITCH_RECEIVE_UPDATE_FAILED");
-    serializeJsonPretty(respDoc, response.returnContent);
-    
-    return response; });
-  Serial.println("MszSwitchWebApi::handleUpdateSwitchReceive - exit");
+  JsonDocument respDoc(&this->requestArena);
+  respDoc["switchReceiveValue"] = receiveParams.switchReceiveDecimalValue;
+  int actionCount = 0;
+  while (actionCount < MAX_SWITCH_RECEIVE_ACTIONS && receiveParams.actions[actionCount].actionType != SWITCH_RECEIVE_ACTION_NONE)
+  {
+    actionCount++;
+  }
+  respDoc["switchReceiveActions"] = actionCount;
+  respDoc["switchStatus"] = (succeeded ? "SWITCH_RECEIVE_UPDATED" : "SWITCH_RECEIVE_UPDATE_FAILED");
+  response.returnContent = this->serializeJsonDocument(respDoc);
+  
+  return response;
 }
 
 /*
@@ -236,23 +245,31 @@ bool MszSwitchWebApi::getSwitchReceiveParams(SwitchReceiveParams &receiveParams)
   String paramReceiveProtocol = this->getQueryStringParam(MszSwitchWebApi::PARAM_RECEIVE_PROTOCOL);
   String paramReceiveTopic = this->getQueryStringParam(MszSwitchWebApi::PARAM_RECEIVE_TOPIC);
   String paramReceiveCommand = this->getQueryStringParam(MszSwitchWebApi::PARAM_RECEIVE_COMMAND);
+  String paramReceiveActions = this->getQueryStringParam(MszSwitchWebApi::PARAM_RECEIVE_ACTIONS);
 
-  if (paramReceiveValue == nullptr || paramReceiveProtocol == nullptr || paramReceiveCommand == nullptr || paramReceiveTopic == nullptr)
+  if (paramReceiveValue == nullptr || paramReceiveProtocol == nullptr || paramReceiveValue == "" || paramReceiveProtocol == "")
   {
     Serial.println("Getting switch receive parameters - missing parameters - exit.");
     return false;
   }
 
-  if (paramReceiveValue == "" || paramReceiveProtocol == "" || paramReceiveCommand == "" || paramReceiveTopic == "")
+  // A received code needs something to do, an MQTT message, local actions or both.
+  bool hasMqttMessage = (paramReceiveTopic != nullptr && paramReceiveTopic != "" && paramReceiveCommand != nullptr && paramReceiveCommand != "");
+  bool hasActions = (paramReceiveActions != nullptr && paramReceiveActions != "");
+  if (!hasMqttMessage && !hasActions)
   {
     Serial.println("Getting switch receive parameters - missing parameters - exit.");
     return false;
   }
 
   // Move the items into the structure
+  memset(&receiveParams, 0, sizeof(receiveParams));
+  if (hasMqttMessage)
+  {
+    paramReceiveCommand.toCharArray(receiveParams.switchCommand, MAX_SWITCH_COMMAND_LENGTH + 1);
+    paramReceiveTopic.toCharArray(receiveParams.switchTopic, MAX_SWITCH_MQTT_TOPIC_LENGTH + 1);
+  }
   receiveParams.switchReceiveDecimalValue = paramReceiveValue.toInt();
-  paramReceiveCommand.toCharArray(receiveParams.switchCommand, MAX_SWITCH_COMMAND_LENGTH + 1);
-  paramReceiveTopic.toCharArray(receiveParams.switchTopic, MAX_SWITCH_MQTT_TOPIC_LENGTH + 1);
 
   // Read types that require conversion from parameters - protocol.
   std::istringstream convProto(paramReceiveProtocol.c_str());
@@ -263,10 +280,81 @@ bool MszSwitchWebApi::getSwitchReceiveParams(SwitchReceiveParams &receiveParams)
     return false;
   }
 
+  if (hasActions && !this->getSwitchReceiveActions(paramReceiveActions, receiveParams))
+  {
+    Serial.println("Getting switch receive parameters - invalid actions - exit.");
+    return false;
+  }
+
   Serial.println("Getting switch receive parameters - exit.");
   return true;
 }
 
+bool MszSwitchWebApi::getSwitchReceiveActions(String paramReceiveActions, SwitchReceiveParams &receiveParams)
+{
+  int actionCount = 0;
+  int actionStart = 0;
+  while (actionStart <= (int)paramReceiveActions.length())
+  {
+    int actionEnd = paramReceiveActions.indexOf(',', actionStart);
+    if (actionEnd < 0)
+    {
+      actionEnd = paramReceiveActions.length();
+    }
+    String actionParam = paramReceiveActions.substring(actionStart, actionEnd);
+    actionStart = actionEnd + 1;
+
+    if (actionCount >= MAX_SWITCH_RECEIVE_ACTIONS)
+    {
+      Serial.println("Getting switch receive actions - too many actions.");
+      return false;
+    }
+
+    int typeEnd = actionParam.indexOf(':');
+    if (typeEnd <= 0)
+    {
+      Serial.println("Getting switch receive actions - invalid action " + actionParam);
+      return false;
+    }
+    String actionType = actionParam.substring(0, typeEnd);
+    String actionArgs = actionParam.substring(typeEnd + 1);
+
+    SwitchReceiveAction &action = receiveParams.actions[actionCount];
+    if (actionType == RECEIVE_ACTION_SWITCH_ON || actionType == RECEIVE_ACTION_SWITCH_OFF)
+    {
+      if (actionArgs == "" || actionArgs.length() > MAX_SWITCH_NAME_LENGTH)
+      {
+        Serial.println("Getting switch receive actions - invalid switch name " + actionArgs);
+        return false;
+      }
+      action.actionType = (actionType == RECEIVE_ACTION_SWITCH_ON ? SWITCH_RECEIVE_ACTION_SWITCH_ON : SWITCH_RECEIVE_ACTION_SWITCH_OFF);
+      actionArgs.toCharArray(action.switchName, MAX_SWITCH_NAME_LENGTH + 1);
+    }
+    else if (actionType == RECEIVE_ACTION_REPEAT)
+    {
+      int protocolEnd = actionArgs.indexOf(':');
+      action.actionType = SWITCH_RECEIVE_ACTION_REPEAT;
+      action.repeatProtocol = (protocolEnd < 0 ? actionArgs : actionArgs.substring(0, protocolEnd)).toInt();
+      action.repeatPulseLength = (protocolEnd < 0 ? 0 : actionArgs.substring(protocolEnd + 1).toInt());
+
+      // Repeating on the protocol the code was received with would make the device receive its own repeats.
+      if (action.repeatProtocol <= 0 || action.repeatPulseLength < 0 || (unsigned int)action.repeatProtocol == receiveParams.switchProtocol)
+      {
+        Serial.println("Getting switch receive actions - invalid repeat " + actionArgs);
+        return false;
+      }
+    }
+    else
+    {
+      Serial.println("Getting switch receive actions - unknown action " + actionType);
+      return false;
+    }
+    actionCount++;
+  }
+
+  return true;
+}
+
 CoreHandlerResponse MszSwitchWebApi::handleSwitchOnOffCore(bool switchItOn)
 {
   Serial.println("Switch API handleSwitchOnOffCore - enter");
@@ -293,8 +381,8 @@ CoreHandlerResponse MszSwitchWebApi::handleSwitchOnOffCore(bool switchItOn)
   MszSwitchRepository switchRepository;
   CoreHandlerResponse response;
 
-  int switchSucceeded = this->switchLogic->toggleSwitch(switchName, switchItOn);
-  if (switchSucceeded)
+  int switchResult = this->switchLogic->toggleSwitch(switchName, switchItOn, &this->requestTimings);
+  if (switchResult == MszSwitchLogic::SWITCH_TOGGLE_NOTFOUND)
   {
     Serial.println("Switch API handleSwitchOnOffCore - switch not found");
 
@@ -305,16 +393,27 @@ CoreHandlerResponse MszSwitchWebApi::handleSwitchOnOffCore(bool switchItOn)
         "Switch not found!",
         "Switch " + switchName + " cannot be found!");
   }
+  else if (switchResult == MszSwitchLogic::SWITCH_TOGGLE_BUSY)
+  {
+    Serial.println("Switch API handleSwitchOnOffCore - radio busy");
+
+    response.statusCode = HTTP_SERVICE_UNAVAILABLE_CODE;
+    response.contentType = HTTP_RESPONSE_CONTENT_TYPE_APPLICATION_JSON;
+    response.returnContent = this->getErrorJsonDocument(
+        HTTP_SERVICE_UNAVAILABLE_CODE,
+        "Radio busy!",
+        "Too many switch commands are pending, please retry " + switchName + " later!");
+  }
   else
   {
     Serial.println("Preparing response data...");
     response.statusCode = HTTP_OK_CODE;
     response.contentType = HTTP_RESPONSE_CONTENT_TYPE_APPLICATION_JSON;
 
-    JsonDocument respDoc;
+    JsonDocument respDoc(&this->requestArena);
     respDoc["switchName"] = switchName;
     respDoc["switchStatus"] = (switchItOn ? "ON" : "OFF");
-    serializeJsonPretty(respDoc, response.returnContent);
+    response.returnContent = this->serializeJsonDocument(respDoc);
   }
 
   Serial.println("Switch API handleSwitchOnOffCore - exit");
@@ -0,0 +1,66 @@
+#include "SwitchUdpCommands.h"
+
+void MszSwitchUdpCommands::registerCommands(MszUdpCommandServer &udpServer, MszSwitchLogic *switchLogic)
+{
+    udpServer.registerCommand(UDP_COMMAND_SWITCH_ON, [switchLogic](const uint8_t *payload, size_t length)
+                              { return MszSwitchUdpCommands::switchByName(switchLogic, payload, length, true); });
+    udpServer.registerCommand(UDP_COMMAND_SWITCH_OFF, [switchLogic](const uint8_t *payload, size_t length)
+                              { return MszSwitchUdpCommands::switchByName(switchLogic, payload, length, false); });
+    udpServer.registerCommand(UDP_COMMAND_SCENE, [switchLogic](const uint8_t *payload, size_t length)
+                              { return MszSwitchUdpCommands::switchScene(switchLogic, payload, length); });
+}
+
+uint8_t MszSwitchUdpCommands::switchByName(MszSwitchLogic *switchLogic, const uint8_t *name, size_t nameLength, bool switchOn)
+{
+    if (nameLength == 0 || nameLength > MAX_SWITCH_NAME_LENGTH)
+    {
+        return UDP_STATUS_BAD_REQUEST;
+    }
+
+    char switchName[MAX_SWITCH_NAME_LENGTH + 1];
+    memcpy(switchName, name, nameLength);
+    switchName[nameLength] = '\0';
+
+    int toggleResult = switchLogic->toggleSwitch(String(switchName), switchOn);
+    if (toggleResult == MszSwitchLogic::SWITCH_TOGGLE_NOTFOUND)
+    {
+        return UDP_STATUS_NOT_FOUND;
+    }
+    if (toggleResult == MszSwitchLogic::SWITCH_TOGGLE_BUSY)
+    {
+        return UDP_STATUS_BUSY;
+    }
+    return UDP_STATUS_OK;
+}
+
+uint8_t MszSwitchUdpCommands::switchScene(MszSwitchLogic *switchLogic, const uint8_t *payload, size_t length)
+{
+    // Validate the whole scene first, a malformed scene must not switch only some of its switches.
+    size_t offset = 0;
+    while (offset < length)
+    {
+        if (offset + 2 > length || payload[offset] > 1 || offset + 2 + payload[offset + 1] > length)
+        {
+            return UDP_STATUS_BAD_REQUEST;
+        }
+        offset += 2 + payload[offset + 1];
+    }
+    if (length == 0)
+    {
+        return UDP_STATUS_BAD_REQUEST;
+    }
+
+    // Switch all of them, the first failure is the status of the scene.
+    uint8_t sceneStatus = UDP_STATUS_OK;
+    offset = 0;
+    while (offset < length)
+    {
+        uint8_t status = MszSwitchUdpCommands::switchByName(switchLogic, payload + offset + 2, payload[offset + 1], payload[offset] == 1);
+        if (sceneStatus == UDP_STATUS_OK)
+        {
+            sceneStatus = status;
+        }
+        offset += 2 + payload[offset + 1];
+    }
+    return sceneStatus;
+}
@@ -1,15 +1,26 @@
 #include "SecretHandler.h"
 #include "AssetUtilWifi.h"
+#include "AssetLoopProfiler.h"
+#include "AssetScheduler.h"
+#include "AssetUdpCommandServer.h"
+#include "SwitchUdpCommands.h"
 #include <Arduino.h>
 #include <Preferences.h>
 
+#if defined(MSZ_DUAL_CORE)
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "AssetCoreTask.h"
+#endif
+
 #if defined(ESP32)
 #include <WiFi.h>
-#include "SwitchServerEsp32.h"
 #elif defined(ESP8266)
 #include <ESP8266WiFi.h>
-#include "SwitchServerEsp8266.h"
 #endif
+#include "AssetApiServer.h"
+#include "AssetWriteBehindStore.h"
+#include "SwitchServer.h"
 
 #include <DNSServer.h>
 #include <WiFiManager.h>
@@ -27,11 +38,32 @@ Preferences preferences;
 MszSecretHandler *secretHandler;
 MszSwitchLogic *switchLogic;
 
-#if defined(ESP32)
-MszSwitchApiEsp32 switchServer(MszSwitchWebApi::HTTP_AUTH_SECRET_ID, 80);
-#elif defined(ESP8266)
-MszSwitchApiEsp8266 switchServer(MszSwitchWebApi::HTTP_AUTH_SECRET_ID, 80);
-#endif
+// All work of the loop runs as tasks of the scheduler. With MSZ_DUAL_CORE, the scheduler runs on the
+// network core and the radio gets the realtime core for itself.
+MszScheduler scheduler;
+const unsigned long METRICS_SAMPLE_INTERVAL_MS = 10000;
+const unsigned long STORAGE_COMMIT_CHECK_INTERVAL_MS = 250;
+
+// Loop phases reported by the loop profiler when built with MSZ_LOOP_PROFILER.
+enum LoopPhase
+{
+  LOOP_PHASE_RF_RECEIVE,
+  LOOP_PHASE_WEB_SERVER,
+  LOOP_PHASE_UDP,
+  LOOP_PHASE_MQTT,
+  LOOP_PHASE_HOUSEKEEPING,
+  LOOP_PHASE_COUNT
+};
+const char *const LOOP_PHASE_NAMES[LOOP_PHASE_COUNT] = {"rfReceive", "webServer", "udp", "mqtt", "housekeeping"};
+const uint32_t LOOP_BUDGET_MICROS = 20000;
+
+// The web server backend follows the build flags, see AssetApiServer.h.
+MszAssetApiServer<MszSwitchWebApi> switchServer(MszSwitchWebApi::HTTP_AUTH_SECRET_ID, 80);
+
+// Signed UDP commands are the fast path for switching next to the HTTP API.
+MszUdpCommandServer udpServer;
+
+void runNetworkPass();
 
 void setup()
 {
@@ -64,13 +96,64 @@ void setup()
 
   // After WiFi was set-up, we can configure the web server.
   switchServer.begin(secretHandler);
+  MszSwitchUdpCommands::registerCommands(udpServer, switchLogic);
+  udpServer.begin(secretHandler, MszSwitchWebApi::HTTP_AUTH_SECRET_ID);
+
+  // Received RF codes are queued by a timer from now on, independent of how busy the loop is.
+  switchLogic->beginReceive();
+
+  // Register the work of the loop, received RF codes are handled before web requests.
+  scheduler.addContinuousTask("rfReceive", []() {
+    switchLogic->handleSwitchReceiveData();
+    MSZ_LOOP_PROFILER_PHASE(LOOP_PHASE_RF_RECEIVE);
+  }, MszScheduler::PRIORITY_HIGH);
+  scheduler.addContinuousTask("webServer", []() {
+    switchServer.loop();
+    MSZ_LOOP_PROFILER_PHASE(LOOP_PHASE_WEB_SERVER);
+  }, MszScheduler::PRIORITY_NORMAL);
+  scheduler.addContinuousTask("udp", []() {
+    udpServer.loop();
+    MSZ_LOOP_PROFILER_PHASE(LOOP_PHASE_UDP);
+  }, MszScheduler::PRIORITY_NORMAL);
+  scheduler.addContinuousTask("mqtt", []() {
+    switchLogic->handleMqtt();
+    MSZ_LOOP_PROFILER_PHASE(LOOP_PHASE_MQTT);
+  }, MszScheduler::PRIORITY_NORMAL);
+  scheduler.addPeriodicTask("metrics", []() {
+    switchServer.sampleSystemMetrics();
+    MSZ_LOOP_PROFILER_PHASE(LOOP_PHASE_HOUSEKEEPING);
+  }, METRICS_SAMPLE_INTERVAL_MS, MszScheduler::PRIORITY_LOW);
+  scheduler.addPeriodicTask("storageCommit", []() {
+    // Settings updated by the APIs reach the flash here in one batch, not inside the requests.
+    MszWriteBehindStore::loop();
+    MSZ_LOOP_PROFILER_PHASE(LOOP_PHASE_HOUSEKEEPING);
+  }, STORAGE_COMMIT_CHECK_INTERVAL_MS, MszScheduler::PRIORITY_LOW);
+
+  MSZ_LOOP_PROFILER_SETUP(LOOP_PHASE_NAMES, LOOP_PHASE_COUNT, LOOP_BUDGET_MICROS);
+
+#if defined(MSZ_DUAL_CORE)
+  // The radio transmits on the realtime core, the network core hands switch commands over through a queue.
+  MszCoreTask::start("radio", []() { switchLogic->handleRadio(); }, MSZ_REALTIME_CORE);
+  MszCoreTask::start("network", []() { runNetworkPass(); }, MSZ_NETWORK_CORE);
+#endif
 }
 
-void loop()
+void runNetworkPass()
 {
-  // put your main code here, to run repeatedly:
-  switchServer.loop();
+  MSZ_LOOP_PROFILER_BEGIN();
+
+  // Run all tasks that are due, RF receive and the web server on every pass.
+  scheduler.runPending();
 
-  // handle RC receive commands
-  switchLogic->handleSwitchReceiveData();
+  MSZ_LOOP_PROFILER_END();
+}
+
+void loop()
+{
+#if defined(MSZ_DUAL_CORE)
+  // All work runs in the core-pinned tasks started in setup().
+  vTaskDelete(NULL);
+#else
+  runNetworkPass();
+#endif
 }
\ No newline at end of file